@@ -0,0 +1,336 @@
+/* ----------------------------------------------------------------------------
+
+    (EN) armethyst-batch - runs a manifest of independent programs on a thread pool
+		
+	armethyst - A simple ARM Simulator written in C++ for Computer Architecture
+    teaching purposes. Free software licensed under the MIT License (see license
+    below).
+
+    (PT) armethyst-batch - executa uma lista de programas independentes em um
+		  conjunto de threads
+    
+	armethyst - Um simulador ARM simples escrito em C++ para o ensino de
+    Arquitetura de Computadores. Software livre licenciado pela MIT License
+    (veja a licença, em inglês, abaixo).
+
+    (EN) MIT LICENSE:
+
+    Copyright 2020 André Vital Saúde
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+   ----------------------------------------------------------------------------
+*/
+
+#include "config.h"
+#include "Factory.h"
+#include "Memory.h"
+#include "Processor.h"
+#include "CPU.h"
+#include "ElfLoader.h"
+#include "SimulatorError.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+
+using namespace std;
+
+/**
+ * Uso: armethyst-batch [-j threads] [-l limite] manifesto [resultados]
+ *
+ * Cada linha do manifesto descreve um programa independente:
+ *
+ *		binário  início  memória  [símbolo=valor ...]
+ *
+ *	- início: endereço inicial, ou "-" para o ponto de entrada do ELF;
+ *	- memória: tamanho da memória em bytes (BasicMemory; o topo da pilha
+ *	  é o fim da memória);
+ *	- símbolo=valor: entradas, escritas como palavras de 64 bits nos
+ *	  símbolos do programa antes da execução.
+ *
+ * Linhas vazias e o que segue # são ignorados.
+ *
+ * Cada programa tem sua própria memória e processador, criados pela
+ * Factory, e é executado pela CPU do processador (getCPU) em uma das
+ * threads (por omissão, uma por núcleo do hospedeiro), com no máximo
+ * limite instruções. As threads tiram trabalho da própria fila e, quando
+ * ela se esvazia, roubam do fim das filas das outras.
+ *
+ * Os resultados, um por linha na ordem do manifesto, vão para o arquivo
+ * resultados (ou a saída padrão):
+ *
+ *		linha  binário  estado  instruções  microssegundos
+ *
+ * com estado finished, error ou limit (ver CPU::ExitReason), ou
+ * load-error e input-error se o programa não pôde ser preparado: o
+ * binário não pôde ser carregado ou a memória alocada, ou uma entrada
+ * não existe ou não cabe na memória. Um acesso do programa fora da
+ * memória também termina com error. O motivo vai para a saída de erros,
+ * e os demais programas são executados normalmente.
+ */
+
+struct Job {
+	int line;
+	string binary;
+	uint64_t startAddress;		// CPU::NO_ADDRESS: ponto de entrada
+	uint64_t memorySize;
+	vector<pair<string, uint64_t>> inputs;
+};
+
+struct JobResult {
+	string status;
+	uint64_t retired;
+	uint64_t hostMicroseconds;
+	string error;				// motivo de load-error, input-error e
+								// de error por acesso fora da memória
+};
+
+/**
+ * Filas de trabalho, uma por thread, cada uma protegida por seu mutex.
+ * A dona retira do início e as outras roubam do fim, de modo que
+ * disputam a mesma fila apenas quando ela está quase vazia.
+ */
+class JobQueues
+{
+	public:
+		JobQueues(int workers, size_t jobs) : queues(workers)
+		{
+			// trechos contíguos do manifesto para cada thread
+			for (size_t i = 0; i < jobs; i++) {
+				queues[i * workers / jobs].jobs.push_back(i);
+			}
+		}
+
+		/**
+		 * Próximo trabalho da thread worker. Retorna false quando não há
+		 * mais trabalho em nenhuma fila.
+		 */
+		bool next(int worker, size_t &job)
+		{
+			int workers = queues.size();
+			for (int k = 0; k < workers; k++) {
+				Queue &queue = queues[(worker + k) % workers];
+				lock_guard<mutex> lock(queue.lock);
+				if (queue.jobs.empty()) {
+					continue;
+				}
+				if (k == 0) {
+					job = queue.jobs.front();
+					queue.jobs.pop_front();
+				} else {
+					job = queue.jobs.back();
+					queue.jobs.pop_back();
+				}
+				return true;
+			}
+			return false;
+		}
+
+	private:
+		struct Queue {
+			mutex lock;
+			deque<size_t> jobs;
+		};
+		vector<Queue> queues;
+};
+
+static uint64_t parseNumber(const string &text, const string &what, int line)
+{
+	try {
+		size_t end;
+		uint64_t value = stoull(text, &end, 0);
+		if (end == text.size()) {
+			return value;
+		}
+	} catch (const exception &) {
+	}
+	cerr << "Line " << line << ": invalid " << what << " " << text << endl;
+	exit(1);
+}
+
+static vector<Job> readManifest(const string &filename)
+{
+	ifstream file(filename);
+	if (!file.is_open()) {
+		cerr << "Unable to open file " << filename << endl;
+		exit(1);
+	}
+
+	vector<Job> jobs;
+	string text;
+	for (int line = 1; getline(file, text); line++) {
+		text = text.substr(0, text.find('#'));
+		istringstream fields(text);
+		Job job;
+		string start, size, input;
+		if (!(fields >> job.binary)) {
+			continue;
+		}
+		if (!(fields >> start >> size)) {
+			cerr << "Line " << line << ": expected binary, start address and memory size" << endl;
+			exit(1);
+		}
+		job.line = line;
+		job.startAddress = start == "-" ? CPU::NO_ADDRESS : parseNumber(start, "start address", line);
+		job.memorySize = parseNumber(size, "memory size", line);
+		while (fields >> input) {
+			size_t equals = input.find('=');
+			if (equals == string::npos) {
+				cerr << "Line " << line << ": expected symbol=value, found " << input << endl;
+				exit(1);
+			}
+			job.inputs.push_back({input.substr(0, equals),
+					parseNumber(input.substr(equals + 1), "input value", line)});
+		}
+		jobs.push_back(job);
+	}
+	return jobs;
+}
+
+static JobResult runJob(const Job &job, uint64_t limit)
+{
+	JobResult result = {"", 0, 0, ""};
+	auto begin = chrono::steady_clock::now();
+
+	// erros de preparação são registrados no resultado do programa
+	Memory* memory = nullptr;
+	Processor* processor = nullptr;
+	uint64_t entry = 0;
+	const char *stage = "load-error";
+	try {
+		memory = Factory::createMemory(job.memorySize);
+		processor = Factory::createProcessor(memory);
+		ElfLoader loader(memory);
+		entry = loader.load(job.binary);
+
+		// writeBytes verifica os limites da memória
+		stage = "input-error";
+		for (const pair<string, uint64_t> &input : job.inputs) {
+			uint64_t address = loader.findSymbol(input.first);
+			if (!address) {
+				throw SimulatorError("undefined symbol " + input.first);
+			}
+			memory->writeBytes(address, &input.second, sizeof(input.second));
+		}
+	} catch (const SimulatorError &error) {
+		result.status = stage;
+		result.error = error.what();
+	}
+
+	if (result.status.empty()) {
+		CPU* cpu = processor->getCPU();
+		cpu->setSP(MEM_IMPL == MEM_IMPL_SPARSE ? STACKADDRESS : job.memorySize);
+		cpu->start(job.startAddress == CPU::NO_ADDRESS ? entry : job.startAddress);
+		try {
+			CPU::RunResult run = cpu->runFor(limit);
+
+			static const char *reasons[] = {"finished", "error", "limit", "address"};
+			result.status = reasons[run.reason];
+			result.retired = run.retired;
+		} catch (const SimulatorError &error) {
+			// acesso do programa fora da memória: só este programa falha
+			result.status = "error";
+			result.error = error.what();
+		}
+	}
+
+	delete processor;
+	delete memory;
+
+	result.hostMicroseconds = chrono::duration_cast<chrono::microseconds>(
+			chrono::steady_clock::now() - begin).count();
+	return result;
+}
+
+int main(int argc, char *argv[])
+{
+	int workers = thread::hardware_concurrency();
+	uint64_t limit = CPU::NO_LIMIT;
+	vector<string> files;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+			workers = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc) {
+			limit = parseNumber(argv[++i], "instruction limit", 0);
+		} else {
+			files.push_back(argv[i]);
+		}
+	}
+	if (files.empty() || files.size() > 2) {
+		cerr << "Usage: armethyst-batch [-j threads] [-l limit] manifest [results]" << endl;
+		return 1;
+	}
+	if (workers < 1) {
+		workers = 1;
+	}
+
+	vector<Job> jobs = readManifest(files[0]);
+	vector<JobResult> results(jobs.size());
+	if ((size_t)workers > jobs.size() && !jobs.empty()) {
+		workers = jobs.size();
+	}
+
+	JobQueues queues(workers, jobs.size());
+	vector<thread> threads;
+	for (int w = 0; w < workers; w++) {
+		threads.emplace_back([&, w]() {
+			size_t job;
+			while (queues.next(w, job)) {
+				results[job] = runJob(jobs[job], limit);
+			}
+		});
+	}
+	for (thread &t : threads) {
+		t.join();
+	}
+
+	ofstream resultsFile;
+	if (files.size() > 1) {
+		resultsFile.open(files[1]);
+		if (!resultsFile.is_open()) {
+			cerr << "Unable to open file " << files[1] << endl;
+			return 1;
+		}
+	}
+	ostream &out = files.size() > 1 ? resultsFile : cout;
+	out << "# line binary status retired host_us" << endl;
+	int failed = 0;
+	for (size_t i = 0; i < jobs.size(); i++) {
+		out << jobs[i].line << " " << jobs[i].binary << " " << results[i].status << " "
+				<< results[i].retired << " " << results[i].hostMicroseconds << "\n";
+		if (results[i].status != "finished") {
+			failed++;
+		}
+		if (!results[i].error.empty()) {
+			cerr << "Line " << jobs[i].line << ": " << results[i].error << endl;
+		}
+	}
+
+	return failed ? 1 : 0;
+}
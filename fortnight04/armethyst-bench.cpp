@@ -0,0 +1,812 @@
+/* ----------------------------------------------------------------------------
+
+    (EN) armethyst-bench - measures the interpreter throughput on a manifest of programs
+		
+	armethyst - A simple ARM Simulator written in C++ for Computer Architecture
+    teaching purposes. Free software licensed under the MIT License (see license
+    below).
+
+    (PT) armethyst-bench - mede o desempenho do simulador em uma lista de
+		  programas
+    
+	armethyst - Um simulador ARM simples escrito em C++ para o ensino de
+    Arquitetura de Computadores. Software livre licenciado pela MIT License
+    (veja a licença, em inglês, abaixo).
+
+    (EN) MIT LICENSE:
+
+    Copyright 2020 André Vital Saúde
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+   ----------------------------------------------------------------------------
+*/
+
+#include "config.h"
+#include "Factory.h"
+#include "Memory.h"
+#include "Processor.h"
+#include "CPU.h"
+#include "ElfLoader.h"
+#include "Assembler.h"
+#include "SimulatorError.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+using namespace std;
+
+/**
+ * Uso: armethyst-bench [-r repetições] [-l limite] manifesto [resultados]
+ *
+ * O manifesto tem o formato do manifesto do armethyst-batch:
+ *
+ *		binário  início  memória  [símbolo=valor ...]
+ *
+ * Cada programa é executado repetições vezes (por omissão, 3), cada vez
+ * em um processo filho, com memória, processador e CPU criados pela
+ * Factory, como no armethyst-batch. Mede-se apenas a execução (runFor),
+ * sem a carga do binário, e informa-se a execução mais rápida e o maior
+ * pico de memória residente (RSS) dos filhos, que inclui a memória
+ * simulada e as estruturas da CPU (caches de decodificação e de blocos,
+ * código nativo).
+ *
+ * Os resultados vão para o arquivo resultados (ou a saída padrão), um
+ * objeto JSON por linha, na ordem do manifesto:
+ *
+ *		{"benchmark": "isummation", "cpu": "FastCPU",
+ *		 "memory": "BasicMemory", "status": "finished",
+ *		 "instructions": ..., "seconds": ..., "mips": ...,
+ *		 "ns_per_instruction": ..., "peak_rss_kb": ...}
+ *
+ * com status como no armethyst-batch (finished, error, limit,
+ * load-error, input-error) ou crash, se o filho terminou de forma
+ * anormal. A saída dos programas e das implementações é descartada.
+ *
+ * Só as execuções terminadas (finished) ou interrompidas pelo limite
+ * (limit) são medidas; das demais, a linha traz seconds, mips e
+ * ns_per_instruction nulos, e o armethyst-bench termina com status 1
+ * depois de executar todo o manifesto.
+ *
+ * Binários @nome são programas gerados pelo Assembler no próprio
+ * processo, com tamanho dado pelos pares símbolo=valor, que aqui são
+ * parâmetros do gerador (ver generateProgram).
+ */
+
+static const char *cpuNames[] = {"BasicCPU", "FastCPU", "JITCPU", "PipelinedCPU"};
+static const char *memoryNames[] = {"BasicMemory", "SparseMemory"};
+
+struct Job {
+	string name;
+	string binary;
+	uint64_t startAddress;		// CPU::NO_ADDRESS: ponto de entrada
+	uint64_t memorySize;
+	vector<pair<string, uint64_t>> inputs;
+};
+
+/**
+ * Resultado de uma execução, enviado pelo filho ao pai.
+ */
+struct Measure {
+	char status[16];
+	uint64_t retired;
+	uint64_t nanoseconds;
+};
+
+/**
+ * Se a execução foi medida: terminou ou atingiu o limite de instruções.
+ */
+static bool measured(const Measure &measure)
+{
+	return strcmp(measure.status, "finished") == 0 || strcmp(measure.status, "limit") == 0;
+}
+
+static uint64_t parseNumber(const string &text, const string &what, int line)
+{
+	try {
+		size_t end;
+		uint64_t value = stoull(text, &end, 0);
+		if (end == text.size()) {
+			return value;
+		}
+	} catch (const exception &) {
+	}
+	cerr << "Line " << line << ": invalid " << what << " " << text << endl;
+	exit(1);
+}
+
+static vector<Job> readManifest(const string &filename)
+{
+	ifstream file(filename);
+	if (!file.is_open()) {
+		cerr << "Unable to open file " << filename << endl;
+		exit(1);
+	}
+
+	vector<Job> jobs;
+	string text;
+	for (int line = 1; getline(file, text); line++) {
+		text = text.substr(0, text.find('#'));
+		istringstream fields(text);
+		Job job;
+		string start, size, input;
+		if (!(fields >> job.binary)) {
+			continue;
+		}
+		if (!(fields >> start >> size)) {
+			cerr << "Line " << line << ": expected binary, start address and memory size" << endl;
+			exit(1);
+		}
+		job.startAddress = start == "-" ? CPU::NO_ADDRESS : parseNumber(start, "start address", line);
+		job.memorySize = parseNumber(size, "memory size", line);
+		while (fields >> input) {
+			size_t equals = input.find('=');
+			if (equals == string::npos) {
+				cerr << "Line " << line << ": expected symbol=value, found " << input << endl;
+				exit(1);
+			}
+			job.inputs.push_back({input.substr(0, equals),
+					parseNumber(input.substr(equals + 1), "input value", line)});
+		}
+
+		// nome: o binário sem diretório, extensão e o @ dos gerados
+		job.name = job.binary.substr(job.binary.find_last_of('/') + 1);
+		job.name = job.name.substr(0, job.name.find('.'));
+		if (job.name[0] == '@') {
+			job.name.erase(0, 1);
+		}
+		jobs.push_back(job);
+	}
+	return jobs;
+}
+
+/**
+ * Parâmetro name de um programa gerado, ou value se não for dado.
+ */
+static uint64_t parameter(const Job &job, const string &name, uint64_t value)
+{
+	for (const pair<string, uint64_t> &input : job.inputs) {
+		if (input.first == name) {
+			value = input.second;
+		}
+	}
+	return value;
+}
+
+/**
+ * Os programas gerados usam apenas instruções que a BasicCPU decodifica
+ * (ver Assembler), para que sejam medidos com todas as CPUs: sem ADRP,
+ * ADR nem ADD com imediato, eles leem os endereços dos seus dados e as
+ * constantes de um bloco de PARAMS_SIZE bytes logo abaixo da pilha, a
+ * partir de SP. Os dados ficam depois do código, abaixo de 4 GiB, e os
+ * endereços são lidos e somados em registradores de 32 bits.
+ */
+#define PARAMS_SIZE 64
+
+/**
+ * @sum: soma dos size inteiros (32 bits) de um vetor preenchido antes
+ * com v[i] = i, como isummation, com i e a soma em registradores.
+ */
+static void generateSum(Assembler &as, Assembler &params, const Job &job)
+{
+	Assembler::Label fill, fillTest, loop, test, result, v;
+
+	as.sub(X(5), SP, PARAMS_SIZE);
+	as.ldr(W(0), X(5));			// v
+	as.ldr(W(4), X(5), 4);		// size
+	as.ldr(W(6), X(5), 8);		// 1
+	as.ldr(W(10), X(5), 12);	// 4
+	as.ldr(W(2), X(5), 16);		// 0
+
+	// v[i] = i, com o endereço de v[i] em w7 e os restantes em x9
+	as.add(W(7), W(0), W(2));
+	as.add(W(9), W(4), W(2));
+	as.b(fillTest);
+	as.bind(fill);
+	as.str(W(2), X(7));
+	as.add(W(2), W(2), W(6));
+	as.add(W(7), W(7), W(10));
+	as.sub(X(9), X(9), 1);
+	as.bind(fillTest);
+	as.cmp(W(9), 0);
+	as.b(Assembler::NE, fill);
+
+	as.ldr(W(2), X(5), 16);
+	as.add(W(3), W(2), W(2));
+	as.add(W(9), W(4), W(2));
+	as.b(test);
+	as.bind(loop);
+	as.ldr(W(1), X(0), X(2), true);
+	as.add(W(3), W(3), W(1));
+	as.add(W(2), W(2), W(6));
+	as.sub(X(9), X(9), 1);
+	as.bind(test);
+	as.cmp(W(9), 0);
+	as.b(Assembler::NE, loop);
+	as.ldr(W(8), X(5), 20);		// result
+	as.str(W(3), X(8));
+	as.ret();
+
+	uint64_t size = parameter(job, "size", 1 << 20);
+	as.align(8);
+	as.bind(result);
+	as.dword(0);
+	as.bind(v);
+	as.reserve(size * 4);
+
+	params.word(v.getAddress());
+	params.word(size);
+	params.word(1);
+	params.word(4);
+	params.word(0);
+	params.word(result.getAddress());
+}
+
+/**
+ * @unrolled: laço com um corpo de size instruções sem desvios (ALU,
+ * leituras e escritas, ponto flutuante), executado n vezes. Mede as
+ * caches de instruções decodificadas, de blocos e de código nativo
+ * com código maior que elas.
+ */
+static void generateUnrolled(Assembler &as, Assembler &params, const Job &job)
+{
+	Assembler::Label body, done, buffer;
+
+	as.sub(X(5), SP, PARAMS_SIZE);
+	as.ldr(W(0), X(5));			// buffer
+	as.ldr(W(9), X(5), 4);		// n
+	as.bind(body);
+	uint64_t size = parameter(job, "size", 65536);
+	for (uint64_t i = 0; i < size; i++) {
+		switch (i % 8) {
+			case 0: as.add(W(1), W(1), W(2)); break;
+			case 1: as.sub(X(3), X(3), 1); break;
+			case 2: as.ldr(W(4), X(0), (i % 64) * 4); break;
+			case 3: as.add(W(5), W(5), W(4)); break;
+			case 4: as.str(W(3), X(0), ((i + 8) % 64) * 4); break;
+			case 5: as.fadd(S(0), S(0), S(1)); break;
+			case 6: as.ldrsw(X(6), X(0), (i % 64) * 4); break;
+			case 7: as.fsub(S(2), S(2), S(3)); break;
+		}
+	}
+	// B.cond alcança apenas ±1 MiB
+	as.sub(X(9), X(9), 1);
+	as.cmp(W(9), 0);
+	as.b(Assembler::EQ, done);
+	as.b(body);
+	as.bind(done);
+	as.ret();
+
+	as.align(8);
+	as.bind(buffer);
+	as.reserve(64 * 4);
+
+	params.word(buffer.getAddress());
+	params.word(parameter(job, "n", 100));
+}
+
+/**
+ * @alu: apenas ALU inteira (ADD de 32 bits com registrador deslocado,
+ * SUB com imediato de 64 bits, CMP), sem acessos à memória no laço, como
+ * benchmarks/alu.S: 20 instruções por volta, n voltas.
+ */
+static void generateAlu(Assembler &as, Assembler &params, const Job &job)
+{
+	Assembler::Label loop, result;
+
+	as.sub(X(15), SP, PARAMS_SIZE);
+	as.ldr(W(9), X(15));		// n
+	as.ldr(W(1), X(15), 4);		// 0
+	as.ldr(W(2), X(15), 8);		// 3
+	as.ldr(W(3), X(15), 12);	// 5
+	as.ldr(W(4), X(15), 16);	// 7
+	as.ldr(W(5), X(15), 20);	// 11
+	as.ldr(W(6), X(15), 24);	// 13
+	as.ldr(W(7), X(15), 28);	// 17
+	as.bind(loop);
+	as.add(W(1), W(1), W(2));
+	as.add(W(2), W(2), W(3), Assembler::LSL, 1);
+	as.sub(X(3), X(3), 7);
+	as.add(W(4), W(4), W(1), Assembler::LSR, 3);
+	as.add(W(5), W(5), W(6));
+	as.sub(X(6), X(6), 1);
+	as.add(W(7), W(7), W(1), Assembler::ASR, 2);
+	as.add(W(8), W(2), W(5));
+	as.add(W(1), W(1), W(8));
+	as.sub(X(2), X(2), 9);
+	as.add(W(3), W(3), W(7));
+	as.add(W(4), W(4), W(1), Assembler::LSL, 4);
+	as.cmp(W(5), 100);
+	as.add(W(10), W(10), W(4));
+	as.sub(X(11), X(11), 4095);
+	as.add(W(6), W(6), W(11));
+	as.add(W(12), W(12), W(10), Assembler::LSR, 1);
+	as.sub(X(9), X(9), 1);
+	as.cmp(W(9), 0);
+	as.b(Assembler::NE, loop);
+	as.add(W(1), W(1), W(12));
+	as.ldr(W(8), X(15), 32);	// result
+	as.str(W(1), X(8));
+	as.ret();
+
+	as.align(8);
+	as.bind(result);
+	as.word(0);
+
+	params.word(parameter(job, "n", 2000000));
+	static const uint32_t constants[] = {0, 3, 5, 7, 11, 13, 17};
+	for (uint32_t constant : constants) {
+		params.word(constant);
+	}
+	params.word(result.getAddress());
+}
+
+/**
+ * @ldst: acessos à memória, como benchmarks/ldst.S, com palavras de 32
+ * bits: b[i] += a[i], desenrolado 4 vezes, com endereçamento base +
+ * imediato e base + registrador, em passes passagens sobre os size
+ * elementos de cada vetor, depois de preencher a[i] = i. 8 leituras e 4
+ * escritas em 21 instruções por volta.
+ */
+static void generateLdst(Assembler &as, Assembler &params, const Job &job)
+{
+	Assembler::Label fill, fillTest, pass, loop, a, b;
+
+	as.sub(X(15), SP, PARAMS_SIZE);
+	as.ldr(W(9), X(15));		// passes
+	as.ldr(W(0), X(15), 4);		// a
+	as.ldr(W(10), X(15), 8);	// size
+	as.ldr(W(11), X(15), 12);	// 1
+	as.ldr(W(12), X(15), 16);	// 4
+	as.ldr(W(2), X(15), 20);	// 0
+
+	// a[i] = i, como em @sum
+	as.add(W(7), W(0), W(2));
+	as.add(W(8), W(10), W(2));
+	as.b(fillTest);
+	as.bind(fill);
+	as.str(W(2), X(7));
+	as.add(W(2), W(2), W(11));
+	as.add(W(7), W(7), W(12));
+	as.sub(X(8), X(8), 1);
+	as.bind(fillTest);
+	as.cmp(W(8), 0);
+	as.b(Assembler::NE, fill);
+
+	as.bind(pass);
+	as.ldr(W(0), X(15), 4);		// a
+	as.ldr(W(1), X(15), 24);	// b
+	as.ldr(W(8), X(15), 28);	// size / 4
+	as.ldr(W(2), X(15), 32);	// 2
+	as.ldr(W(13), X(15), 36);	// 16
+	as.bind(loop);
+	as.ldr(W(3), X(0));
+	as.ldr(W(4), X(1));
+	as.add(W(3), W(3), W(4));
+	as.str(W(3), X(1));
+	as.ldr(W(5), X(0), 4);
+	as.ldr(W(6), X(1), 4);
+	as.add(W(5), W(5), W(6));
+	as.str(W(5), X(1), 4);
+	as.ldr(W(3), X(0), X(2), true);
+	as.ldr(W(4), X(1), X(2), true);
+	as.add(W(3), W(3), W(4));
+	as.str(W(3), X(1), 8);
+	as.ldr(W(5), X(0), 12);
+	as.ldr(W(6), X(1), 12);
+	as.add(W(5), W(5), W(6));
+	as.str(W(5), X(1), 12);
+	as.add(W(0), W(0), W(13));
+	as.add(W(1), W(1), W(13));
+	as.sub(X(8), X(8), 1);
+	as.cmp(W(8), 0);
+	as.b(Assembler::NE, loop);
+	as.sub(X(9), X(9), 1);
+	as.cmp(W(9), 0);
+	as.b(Assembler::NE, pass);
+	as.ret();
+
+	// os laços testam o contador depois da primeira volta
+	uint64_t size = max<uint64_t>(parameter(job, "size", 1 << 19) & ~(uint64_t)3, 4);
+	uint64_t passes = max<uint64_t>(parameter(job, "passes", 16), 1);
+	as.align(8);
+	as.bind(a);
+	as.reserve(size * 4);
+	as.bind(b);
+	as.reserve(size * 4);
+
+	params.word(passes);
+	params.word(a.getAddress());
+	params.word(size);
+	params.word(1);
+	params.word(4);
+	params.word(0);
+	params.word(b.getAddress());
+	params.word(size / 4);
+	params.word(2);
+	params.word(16);
+}
+
+/**
+ * @branch: desvios, como benchmarks/branch.S: percorre ciclicamente uma
+ * tabela de 61 valores irregulares e, para cada um, toma caminhos
+ * diferentes com B.cond e chamadas, além do desvio do laço; n voltas.
+ * Sem BL, a chamada põe em X30 o endereço de retorno, lido dos
+ * parâmetros, e desvia com B; a sub-rotina retorna com RET.
+ */
+static void generateBranch(Assembler &as, Assembler &params, const Job &job)
+{
+	static const uint32_t pattern[] = {
+		1, 0, 0, 3, 1, 2, 0, 1, 3, 3, 0, 2, 1, 0, 2, 2,
+		0, 1, 1, 3, 0, 0, 2, 1, 3, 0, 1, 2, 2, 0, 3, 1,
+		1, 0, 3, 2, 0, 1, 0, 0, 2, 3, 1, 1, 0, 2, 0, 3,
+		2, 1, 0, 1, 3, 0, 2, 0, 1, 1, 3, 2, 0
+	};
+	Assembler::Label loop, zero, one, two, next, skip, odd, even, evenDone;
+	Assembler::Label afterOdd, afterEven, result, table;
+
+	as.sub(X(15), SP, PARAMS_SIZE);
+	as.ldr(W(9), X(15));		// n
+	as.ldr(W(0), X(15), 4);		// table
+	as.ldr(W(1), X(15), 8);		// 0
+	as.ldr(W(26), X(15), 8);	// 0, para as cópias de registradores
+	as.ldr(W(20), X(15), 12);	// 1
+	as.ldr(W(21), X(15), 16);	// 2
+	as.ldr(W(22), X(15), 20);	// 3
+	as.ldr(W(23), X(15), 24);	// 4
+	as.ldr(W(24), X(15), 28);	// retorno de odd
+	as.ldr(W(25), X(15), 32);	// retorno de even
+	as.add(W(19), W(30), W(26));	// EXITADDRESS
+	as.add(W(5), W(26), W(26));
+	as.add(W(6), W(26), W(26));
+	as.bind(loop);
+	as.ldr(W(3), X(0), X(1), true);
+	as.cmp(W(3), 0);
+	as.b(Assembler::EQ, zero);
+	as.cmp(W(3), 2);
+	as.b(Assembler::LT, one);
+	as.b(Assembler::EQ, two);
+	as.add(W(30), W(24), W(26));	// bl odd
+	as.b(odd);
+	as.bind(afterOdd);
+	as.b(next);
+	as.bind(two);
+	as.add(W(5), W(5), W(21));
+	as.b(next);
+	as.bind(one);
+	as.add(W(30), W(25), W(26));	// bl even
+	as.b(even);
+	as.bind(afterEven);
+	as.cmp(W(6), 0);
+	as.b(Assembler::NE, next);
+	as.add(W(5), W(5), W(20));
+	as.b(next);
+	as.bind(zero);
+	as.sub(X(5), X(5), 1);
+	as.bind(next);
+	as.add(W(1), W(1), W(20));
+	as.cmp(W(1), 61);
+	as.b(Assembler::NE, skip);
+	as.ldr(W(1), X(15), 8);
+	as.bind(skip);
+	as.sub(X(9), X(9), 1);
+	as.cmp(W(9), 0);
+	as.b(Assembler::NE, loop);
+	as.ldr(W(8), X(15), 36);	// result
+	as.str(W(5), X(8));
+	as.ret(X(19));
+
+	as.bind(odd);
+	as.add(W(6), W(6), W(22));
+	as.ret();
+	as.bind(even);
+	as.sub(X(6), X(6), 1);
+	as.cmp(W(6), 0);
+	as.b(Assembler::GE, evenDone);
+	as.add(W(6), W(6), W(23));
+	as.bind(evenDone);
+	as.ret();
+
+	as.align(8);
+	as.bind(result);
+	as.word(0);
+	as.bind(table);
+	for (uint32_t value : pattern) {
+		as.word(value);
+	}
+
+	params.word(parameter(job, "n", 2000000));
+	params.word(table.getAddress());
+	params.word(0);
+	params.word(1);
+	params.word(2);
+	params.word(3);
+	params.word(4);
+	params.word(afterOdd.getAddress());
+	params.word(afterEven.getAddress());
+	params.word(result.getAddress());
+}
+
+/**
+ * @fp: ponto flutuante, com FADD e FSUB de 32 bits, os que a BasicCPU
+ * decodifica, em cadeias de dependências como as de benchmarks/fp.S e
+ * fpops (uma parábola por diferenças finitas, y += d, d += 2a, e somas
+ * acumuladas): 22 instruções por volta, das quais 19 de ponto
+ * flutuante, n voltas. Sem LDR e FMOV de ponto flutuante na BasicCPU,
+ * os operandos ficam nos registradores, com os valores iniciais da CPU.
+ */
+static void generateFp(Assembler &as, Assembler &params, const Job &job)
+{
+	Assembler::Label loop;
+
+	as.sub(X(15), SP, PARAMS_SIZE);
+	as.ldr(W(9), X(15));		// n
+	as.bind(loop);
+	as.fadd(S(0), S(0), S(1));
+	as.fadd(S(1), S(1), S(2));
+	as.fsub(S(3), S(0), S(4));
+	as.fadd(S(5), S(5), S(3));
+	as.fsub(S(4), S(4), S(6));
+	as.fadd(S(6), S(6), S(1));
+	as.fadd(S(7), S(7), S(0));
+	as.fsub(S(8), S(7), S(5));
+	as.fadd(S(9), S(9), S(8));
+	as.fsub(S(10), S(10), S(9));
+	as.fadd(S(11), S(11), S(10));
+	as.fadd(S(12), S(12), S(3));
+	as.fsub(S(13), S(12), S(11));
+	as.fadd(S(14), S(14), S(13));
+	as.fadd(S(15), S(15), S(14));
+	as.fsub(S(16), S(16), S(15));
+	as.fadd(S(17), S(17), S(16));
+	as.fadd(S(18), S(18), S(2));
+	as.fsub(S(19), S(19), S(18));
+	as.sub(X(9), X(9), 1);
+	as.cmp(W(9), 0);
+	as.b(Assembler::NE, loop);
+	as.ret();
+
+	params.word(parameter(job, "n", 2000000));
+}
+
+/**
+ * Gera o programa job.binary (@nome) em memory, a partir de
+ * STARTADDRESS, com seus parâmetros abaixo de stack, e retorna o ponto
+ * de entrada, ou CPU::NO_ADDRESS se o gerador não existir ou o programa
+ * não couber na memória.
+ */
+static uint64_t generateProgram(const Job &job, Memory *memory, uint64_t stack)
+{
+	Assembler as(memory);
+	Assembler params(memory, stack - PARAMS_SIZE);
+	if (job.binary == "@sum") {
+		generateSum(as, params, job);
+	} else if (job.binary == "@unrolled") {
+		generateUnrolled(as, params, job);
+	} else if (job.binary == "@alu") {
+		generateAlu(as, params, job);
+	} else if (job.binary == "@ldst") {
+		generateLdst(as, params, job);
+	} else if (job.binary == "@branch") {
+		generateBranch(as, params, job);
+	} else if (job.binary == "@fp") {
+		generateFp(as, params, job);
+	} else {
+		return CPU::NO_ADDRESS;
+	}
+	// uma página livre para a pilha
+	if (MEM_IMPL == MEM_IMPL_BASIC && as.finish() + 4096 > job.memorySize) {
+		return CPU::NO_ADDRESS;
+	}
+	params.finish();
+	return STARTADDRESS;
+}
+
+/**
+ * Executa job no processo filho.
+ */
+static Measure runJob(const Job &job, uint64_t limit)
+{
+	Measure measure = {"", 0, 0};
+	bool generated = job.binary[0] == '@';
+
+	Memory* memory = nullptr;
+	Processor* processor = nullptr;
+	uint64_t entry;
+	uint64_t stack = MEM_IMPL == MEM_IMPL_SPARSE ? STACKADDRESS : job.memorySize;
+	const char *stage = generated ? "input-error" : "load-error";
+	try {
+		memory = Factory::createMemory(job.memorySize);
+		processor = Factory::createProcessor(memory);
+		if (generated) {
+			entry = generateProgram(job, memory, stack);
+			if (entry == CPU::NO_ADDRESS) {
+				throw SimulatorError("unable to generate " + job.binary);
+			}
+		} else {
+			ElfLoader loader(memory);
+			entry = loader.load(job.binary);
+
+			// writeBytes verifica os limites da memória
+			stage = "input-error";
+			for (const pair<string, uint64_t> &input : job.inputs) {
+				uint64_t address = loader.findSymbol(input.first);
+				if (!address) {
+					throw SimulatorError("undefined symbol " + input.first);
+				}
+				memory->writeBytes(address, &input.second, sizeof(input.second));
+			}
+		}
+	} catch (const SimulatorError &) {
+		strcpy(measure.status, stage);
+		return measure;
+	}
+
+	CPU* cpu = processor->getCPU();
+	cpu->setSP(stack);
+	cpu->start(job.startAddress == CPU::NO_ADDRESS ? entry : job.startAddress);
+
+	auto begin = chrono::steady_clock::now();
+	try {
+		CPU::RunResult run = cpu->runFor(limit);
+		measure.nanoseconds = chrono::duration_cast<chrono::nanoseconds>(
+				chrono::steady_clock::now() - begin).count();
+
+		static const char *reasons[] = {"finished", "error", "limit", "address"};
+		strcpy(measure.status, reasons[run.reason]);
+		measure.retired = run.retired;
+	} catch (const SimulatorError &) {
+		// acesso do programa fora da memória, como no armethyst-batch
+		strcpy(measure.status, "error");
+	}
+
+	delete processor;
+	delete memory;
+	return measure;
+}
+
+/**
+ * Executa job em um processo filho, para que o pico de RSS seja o da
+ * execução e que uma falha do simulador não interrompa as medidas.
+ */
+static Measure runChild(const Job &job, uint64_t limit, uint64_t &peakRSS)
+{
+	Measure measure = {"crash", 0, 0};
+	int channel[2];
+	if (pipe(channel) != 0) {
+		perror("pipe");
+		exit(1);
+	}
+
+	cout.flush();
+	pid_t pid = fork();
+	if (pid < 0) {
+		perror("fork");
+		exit(1);
+	}
+	if (pid == 0) {
+		close(channel[0]);
+		if (!freopen("/dev/null", "w", stdout)) {
+			_exit(1);
+		}
+		Measure child = runJob(job, limit);
+		ssize_t written = write(channel[1], &child, sizeof(child));
+		_exit(written == sizeof(child) ? 0 : 1);
+	}
+
+	close(channel[1]);
+	Measure received;
+	if (read(channel[0], &received, sizeof(received)) == sizeof(received)) {
+		measure = received;
+	}
+	close(channel[0]);
+
+	int status;
+	struct rusage usage;
+	if (wait4(pid, &status, 0, &usage) == pid) {
+		// ru_maxrss em kB (Linux)
+		peakRSS = max(peakRSS, (uint64_t)usage.ru_maxrss);
+	}
+	return measure;
+}
+
+int main(int argc, char *argv[])
+{
+	int repeats = 3;
+	uint64_t limit = CPU::NO_LIMIT;
+	vector<string> files;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+			repeats = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc) {
+			limit = parseNumber(argv[++i], "instruction limit", 0);
+		} else {
+			files.push_back(argv[i]);
+		}
+	}
+	if (files.empty() || files.size() > 2) {
+		cerr << "Usage: armethyst-bench [-r repeats] [-l limit] manifest [results]" << endl;
+		return 1;
+	}
+	if (repeats < 1) {
+		repeats = 1;
+	}
+
+	vector<Job> jobs = readManifest(files[0]);
+
+	ofstream resultsFile;
+	if (files.size() > 1) {
+		resultsFile.open(files[1]);
+		if (!resultsFile.is_open()) {
+			cerr << "Unable to open file " << files[1] << endl;
+			return 1;
+		}
+	}
+	ostream &out = files.size() > 1 ? resultsFile : cout;
+
+	int status = 0;
+	for (const Job &job : jobs) {
+		// a execução medida mais rápida ou, se nenhuma foi medida, a última
+		Measure best = {"", 0, 0};
+		uint64_t peakRSS = 0;
+		for (int r = 0; r < repeats; r++) {
+			Measure measure = runChild(job, limit, peakRSS);
+			if (r == 0 || !measured(best)
+					|| (measured(measure) && measure.nanoseconds < best.nanoseconds)) {
+				best = measure;
+			}
+		}
+
+		ostringstream result;
+		result << "{\"benchmark\": \"" << job.name << "\""
+				<< ", \"cpu\": \"" << cpuNames[CPU_IMPL] << "\""
+				<< ", \"memory\": \"" << memoryNames[MEM_IMPL] << "\""
+				<< ", \"status\": \"" << best.status << "\""
+				<< ", \"instructions\": " << best.retired;
+		if (measured(best)) {
+			double mips = best.nanoseconds ? best.retired * 1e3 / best.nanoseconds : 0;
+			double nsPerInstruction = best.retired ? (double)best.nanoseconds / best.retired : 0;
+			result << ", \"seconds\": " << best.nanoseconds / 1e9
+					<< ", \"mips\": " << mips
+					<< ", \"ns_per_instruction\": " << nsPerInstruction;
+			cerr << job.name << ": " << best.status << ", " << best.retired << " instructions, "
+					<< mips << " MIPS" << endl;
+		} else {
+			result << ", \"seconds\": null, \"mips\": null, \"ns_per_instruction\": null";
+			cerr << job.name << ": failed (" << best.status << "), " << best.retired
+					<< " instructions" << endl;
+			status = 1;
+		}
+		result << ", \"peak_rss_kb\": " << peakRSS << "}";
+		out << result.str() << endl;
+	}
+
+	return status;
+}
@@ -0,0 +1,74 @@
+/* ----------------------------------------------------------------------------
+
+    (EN) armethyst-static - FastCPU and FlatMemory composed at compile time
+		
+	armethyst - A simple ARM Simulator written in C++ for Computer Architecture
+    teaching purposes. Free software licensed under the MIT License (see license
+    below).
+
+    (PT) armethyst-static - FastCPU e FlatMemory compostas em tempo de compilação
+    
+	armethyst - Um simulador ARM simples escrito em C++ para o ensino de
+    Arquitetura de Computadores. Software livre licenciado pela MIT License
+    (veja a licença, em inglês, abaixo).
+
+    (EN) MIT LICENSE:
+
+    Copyright 2020 André Vital Saúde
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+   ----------------------------------------------------------------------------
+*/
+
+#include "config.h"
+
+#include "StaticProcessor.h"
+#include "FastCPU.h"
+#include "FlatMemory.h"
+#include "ElfLoader.h"
+#include "SimulatorError.h"
+
+using namespace std;
+
+int main()
+{
+	// (EN) create processor, with its CPU and memory
+	// (PT) cria processador, com sua CPU e memória
+	StaticProcessor<FastCPU, FlatMemory> *processor =
+			new StaticProcessor<FastCPU, FlatMemory>();
+
+	// (EN) load executable binary (ELF), applying relocations
+	// (PT) carrega binário executável (ELF), aplicando as relocações
+	ElfLoader loader(processor->getMemory());
+	uint64_t entry;
+	try {
+		entry = loader.load(FILENAME);
+	} catch (const SimulatorError &error) {
+		cout << error.what() << endl;
+		cout << "Aborting... " << endl;
+		return 1;
+	}
+
+	// (EN) start processor at the entry point
+	// (PT) inicia processador no ponto de entrada
+	int result = processor->run(entry);
+
+	return result;
+}
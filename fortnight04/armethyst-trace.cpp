@@ -0,0 +1,110 @@
+/* ----------------------------------------------------------------------------
+
+    (EN) armethyst-trace - converts a binary memory trace to text
+		
+	armethyst - A simple ARM Simulator written in C++ for Computer Architecture
+    teaching purposes. Free software licensed under the MIT License (see license
+    below).
+
+    (PT) armethyst-trace - converte um registro binário de acessos à memória para
+		  texto
+    
+	armethyst - Um simulador ARM simples escrito em C++ para o ensino de
+    Arquitetura de Computadores. Software livre licenciado pela MIT License
+    (veja a licença, em inglês, abaixo).
+
+    (EN) MIT LICENSE:
+
+    Copyright 2020 André Vital Saúde
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+   ----------------------------------------------------------------------------
+*/
+
+#include "config.h"
+#include "MemoryTrace.h"
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <cstring>
+#include <vector>
+
+using namespace std;
+
+/**
+ * Uso: armethyst-trace [-v] [arquivo]
+ *
+ * Escreve na saída padrão o registro arquivo (MEMORY_TRACE_FILE, se
+ * omitido) no formato texto, uma linha por acesso:
+ *
+ *		ri 0000000000000040
+ *
+ * Com -v, e se o registro guardar os valores, acrescenta o tamanho do
+ * acesso e o valor lido ou escrito.
+ */
+int main(int argc, char *argv[])
+{
+	bool printValues = false;
+	string filename = MEMORY_TRACE_FILE;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-v") == 0) {
+			printValues = true;
+		} else {
+			filename = argv[i];
+		}
+	}
+
+	ifstream file(filename, ios::in | ios::binary);
+	if (!file.is_open()) {
+		cerr << "Unable to open file " << filename << endl;
+		return 1;
+	}
+
+	TraceHeader header;
+	if (!file.read((char *)&header, sizeof(header))
+			|| memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) != 0
+			|| header.version != TRACE_VERSION) {
+		cerr << filename << ": not a memory trace" << endl;
+		return 1;
+	}
+	bool values = header.flags & TRACE_FLAG_VALUES;
+	uint64_t recordWords = values ? 2 : 1;
+
+	static const char *names[] = {"ri", "rd", "wi", "wd"};
+	vector<uint64_t> words(recordWords * 4096);
+	cout << hex << setfill('0');
+	while (file.read((char *)words.data(), words.size() * sizeof(uint64_t)) || file.gcount()) {
+		uint64_t count = file.gcount() / sizeof(uint64_t);
+		for (uint64_t i = 0; i + recordWords <= count; i += recordWords) {
+			uint64_t word = words[i];
+			cout << names[MemoryTrace::recordType(word) & 3] << " "
+					<< setw(16) << MemoryTrace::recordAddress(word);
+			if (printValues && values) {
+				unsigned size = MemoryTrace::recordSize(word);
+				cout << " " << dec << size << " " << hex
+						<< setw(2 * size) << words[i + 1];
+			}
+			cout << '\n';
+		}
+	}
+
+	return 0;
+}
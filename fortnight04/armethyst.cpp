@@ -38,6 +38,12 @@
 #include "Factory.h"
 #include "Memory.h"
 #include "Processor.h"
+#include "ElfLoader.h"
+#include "SimulatorError.h"
+#include "Profiler.h"
+#if PROC_IMPL == PROC_IMPL_MULTICORE
+#include "MultiCoreProcessor.h"
+#endif
 
 using namespace std;
 
@@ -51,17 +57,76 @@ int main()
 	// (PT) cria processador
 	Processor* processor = Factory::createProcessor(memory);
 		
-	// (EN) load executable binary
-	// (PT) carrega binário executável
-	memory->loadBinary(FILENAME);
-	
-	// (EN) create human readable representation of the binary file
-	// (PT) cria representação legível do arquivo binário
-	memory->writeBinaryAsText(FILENAME);
+	// (EN) load executable binary (ELF), applying relocations
+	// (PT) carrega binário executável (ELF), aplicando as relocações
+	ElfLoader loader(memory);
+	uint64_t entry;
+	try {
+		entry = loader.load(FILENAME);
+	} catch (const SimulatorError &error) {
+		cout << error.what() << endl;
+		cout << "Aborting... " << endl;
+		return 1;
+	}
+
+#if PROC_IMPL == PROC_IMPL_MULTICORE
+	// (EN) core i starts at symbol core<i>, if defined, else at the entry point
+	// (PT) o núcleo i inicia no símbolo core<i>, se definido, senão no ponto de entrada
+	MultiCoreProcessor* multiCore = (MultiCoreProcessor*) processor;
+	for (int i = 0; i < multiCore->getCores(); i++) {
+		uint64_t address = loader.findSymbol("core" + to_string(i));
+		if (address) {
+			multiCore->setStartAddress(i, address);
+		}
+	}
+#endif
+
+#if PROFILE_ENABLED
+	// (EN) profile every core, adding up their counts in the report
+	// (PT) perfil de cada núcleo, com as contagens somadas no relatório
+	vector<Profiler*> profilers;
+#if PROC_IMPL == PROC_IMPL_MULTICORE
+	for (int i = 0; i < multiCore->getCores(); i++) {
+		profilers.push_back(new Profiler(loader));
+		multiCore->getCPU(i)->setProfiler(profilers.back());
+	}
+#else
+	profilers.push_back(new Profiler(loader));
+	processor->getCPU()->setProfiler(profilers.back());
+#endif
+#endif
+
+	// (EN) start processor at the entry point
+	// (PT) inicia processador no ponto de entrada
+	// (EN) checkpoint errors are reported like load errors
+	// (PT) erros de checkpoint são informados como os de carga
+	int result;
+	try {
+		result = processor->run(entry);
+	} catch (const SimulatorError &error) {
+		cout << error.what() << endl;
+		cout << "Aborting... " << endl;
+		return 1;
+	}
+
+#if PROFILE_ENABLED
+	// (EN) write the profile report
+	// (PT) escreve o relatório do perfil
+	for (size_t i = 1; i < profilers.size(); i++) {
+		profilers[0]->merge(*profilers[i]);
+	}
+	profilers[0]->report(PROFILE_FILE);
+#endif
 
-	// (EN) start processor
-	// (PT) inicia processador
-	int result = processor->run(STARTADDRESS);	
+	// (EN) release processor and memory (CachedMemory reports its statistics)
+	// (PT) libera processador e memória (CachedMemory informa suas estatísticas)
+	delete processor;
+	delete memory;
+#if PROFILE_ENABLED
+	for (Profiler *profiler : profilers) {
+		delete profiler;
+	}
+#endif
 	
 	return result;
 }
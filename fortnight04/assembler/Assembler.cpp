@@ -0,0 +1,514 @@
+/* ----------------------------------------------------------------------------
+
+    (EN) Assembler - emits AArch64 instructions and data directly into a Memory
+		
+	armethyst - A simple ARM Simulator written in C++ for Computer Architecture
+    teaching purposes. Free software licensed under the MIT License (see license
+    below).
+
+    (PT) Assembler - escreve instruções AArch64 e dados diretamente em uma
+		  Memory
+    
+	armethyst - Um simulador ARM simples escrito em C++ para o ensino de
+    Arquitetura de Computadores. Software livre licenciado pela MIT License
+    (veja a licença, em inglês, abaixo).
+
+    (EN) MIT LICENSE:
+
+    Copyright 2020 André Vital Saúde
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+   ----------------------------------------------------------------------------
+*/
+
+#include "Assembler.h"
+
+#include <iostream>
+#include <sstream>
+#include <cstring>
+#include <cmath>
+#include <cstdlib>
+
+using namespace std;
+
+Assembler::Assembler(Memory *memory, uint64_t address)
+{
+	this->memory = memory;
+	this->address = address;
+	pendingUses = 0;
+}
+
+void Assembler::fail(string message)
+{
+	cout << "Assembler: " << message << " at 0x" << hex << address << dec << endl;
+	cout << "Aborting... " << endl;
+	exit(1);
+}
+
+void Assembler::bind(Label &label)
+{
+	if (label.bound) {
+		fail("label bound twice");
+	}
+	label.bound = true;
+	label.address = address;
+	for (pair<uint64_t, Label::Use> &use : label.uses) {
+		uint32_t ir = memory->readInstruction32(use.first);
+		memory->writeInstruction32(use.first, resolve(ir, use.first, address, use.second));
+	}
+	pendingUses -= label.uses.size();
+	label.uses.clear();
+}
+
+uint64_t Assembler::finish()
+{
+	if (pendingUses) {
+		fail(to_string(pendingUses) + " references to undefined labels");
+	}
+	return address;
+}
+
+/**
+ * Dados
+ */
+void Assembler::word(uint32_t value)
+{
+	memory->writeData32(address, value);
+	address += 4;
+}
+
+void Assembler::dword(uint64_t value)
+{
+	memory->writeData64(address, value);
+	address += 8;
+}
+
+void Assembler::float32(float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	word(bits);
+}
+
+void Assembler::float64(double value)
+{
+	uint64_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	dword(bits);
+}
+
+void Assembler::align(uint64_t bytes)
+{
+	address = (address + bytes - 1) & ~(bytes - 1);
+}
+
+void Assembler::reserve(uint64_t bytes)
+{
+	address += bytes;
+}
+
+void Assembler::emit(uint32_t ir)
+{
+	if (address & 3) {
+		fail("unaligned instruction");
+	}
+	memory->writeInstruction32(address, ir);
+	address += 4;
+}
+
+/**
+ * Campos de tamanho
+ */
+uint32_t Assembler::sf(Reg r)
+{
+	if (r.n > 31 || (r.type != REG_X && r.type != REG_W)) {
+		fail("expected an integer register");
+	}
+	return r.type == REG_X ? 0x80000000 : 0;
+}
+
+uint32_t Assembler::sf(Reg r, Reg same)
+{
+	if (r.type != same.type) {
+		fail("mixed W and X registers");
+	}
+	return sf(r);
+}
+
+uint32_t Assembler::ftype(Reg r, Reg same)
+{
+	if (r.n > 31 || (r.type != REG_S && r.type != REG_D)) {
+		fail("expected a floating-point register");
+	}
+	if (r.type != same.type) {
+		fail("mixed S and D registers");
+	}
+	return r.type == REG_D ? 0x00400000 : 0;
+}
+
+/**
+ * C4.1.2 Add/subtract (immediate)
+ *
+ * op: bits 30-29 (sub, setFlags).
+ */
+void Assembler::addSubImm(uint32_t op, Reg d, Reg n, int64_t imm)
+{
+	uint32_t ir = 0x11000000 | op | sf(d, n);
+	if (imm >= 0 && imm < 0x1000) {
+		ir |= imm << 10;
+	} else if (imm >= 0 && imm < 0x1000000 && !(imm & 0xFFF)) {
+		ir |= 0x00400000 | (imm >> 12) << 10;	// sh = 1
+	} else {
+		fail("immediate " + to_string(imm) + " out of range");
+	}
+	emit(ir | n.n << 5 | d.n);
+}
+
+void Assembler::add(Reg d, Reg n, int64_t imm)
+{
+	addSubImm(imm < 0 ? 0x40000000 : 0, d, n, imm < 0 ? -imm : imm);
+}
+
+void Assembler::sub(Reg d, Reg n, int64_t imm)
+{
+	addSubImm(imm < 0 ? 0 : 0x40000000, d, n, imm < 0 ? -imm : imm);
+}
+
+void Assembler::adds(Reg d, Reg n, int64_t imm)
+{
+	addSubImm(0x20000000, d, n, imm);
+}
+
+void Assembler::subs(Reg d, Reg n, int64_t imm)
+{
+	addSubImm(0x60000000, d, n, imm);
+}
+
+void Assembler::cmp(Reg n, int64_t imm)
+{
+	addSubImm(0x60000000, {31, n.type}, n, imm);
+}
+
+/**
+ * C4.1.2 PC-rel. addressing
+ */
+void Assembler::adr(Reg d, Label &label)
+{
+	if (sf(d) == 0) {
+		fail("ADR needs an X register");
+	}
+	emitUse(0x10000000 | d.n, label, Label::USE_ADR);
+}
+
+void Assembler::adrp(Reg d, Label &label)
+{
+	if (sf(d) == 0) {
+		fail("ADRP needs an X register");
+	}
+	emitUse(0x90000000 | d.n, label, Label::USE_ADRP);
+}
+
+void Assembler::addressOf(Reg d, Label &label)
+{
+	adrp(d, label);
+	emitUse(0x91000000 | d.n << 5 | d.n, label, Label::USE_LO12);	// ADD Xd, Xd, #lo12
+}
+
+/**
+ * C4.1.5 Add/subtract (shifted register)
+ */
+void Assembler::addSubReg(uint32_t op, Reg d, Reg n, Reg m, Shift shift, int amount)
+{
+	uint32_t size = sf(d, n);
+	sf(m, d);
+	if (amount < 0 || amount >= (size ? 64 : 32)) {
+		fail("shift amount " + to_string(amount) + " out of range");
+	}
+	emit(0x0B000000 | op | size | shift << 22 | m.n << 16 | amount << 10 | n.n << 5 | d.n);
+}
+
+void Assembler::add(Reg d, Reg n, Reg m, Shift shift, int amount)
+{
+	addSubReg(0, d, n, m, shift, amount);
+}
+
+void Assembler::sub(Reg d, Reg n, Reg m, Shift shift, int amount)
+{
+	addSubReg(0x40000000, d, n, m, shift, amount);
+}
+
+void Assembler::adds(Reg d, Reg n, Reg m, Shift shift, int amount)
+{
+	addSubReg(0x20000000, d, n, m, shift, amount);
+}
+
+void Assembler::subs(Reg d, Reg n, Reg m, Shift shift, int amount)
+{
+	addSubReg(0x60000000, d, n, m, shift, amount);
+}
+
+void Assembler::cmp(Reg n, Reg m, Shift shift, int amount)
+{
+	addSubReg(0x60000000, {31, n.type}, n, m, shift, amount);
+}
+
+/**
+ * C4.1.4 Loads and Stores
+ *
+ * opc: bits 23-22 (0: STR, 1: LDR, 2: LDRSW); size: log2 do tamanho.
+ */
+void Assembler::loadStore(uint32_t opc, uint32_t size, Reg t, Reg n, int64_t offset)
+{
+	if (n.type != REG_X) {
+		fail("expected an X base register");
+	}
+	uint32_t simd = t.type == REG_S || t.type == REG_D ? 0x04000000 : 0;
+	uint32_t ir = size << 30 | simd | opc << 22 | n.n << 5 | t.n;
+
+	if (offset >= 0 && !(offset & ((1 << size) - 1)) && (offset >> size) < 0x1000) {
+		// unsigned immediate
+		emit(ir | 0x39000000 | (offset >> size) << 10);
+	} else if (offset >= -256 && offset < 256) {
+		// unscaled immediate: LDUR, STUR
+		emit(ir | 0x38000000 | (offset & 0x1FF) << 12);
+	} else {
+		fail("offset " + to_string(offset) + " out of range");
+	}
+}
+
+void Assembler::loadStore(uint32_t opc, uint32_t size, Reg t, Reg n, Reg m, bool scaled)
+{
+	if (n.type != REG_X || m.type != REG_X) {
+		fail("expected X base and offset registers");
+	}
+	uint32_t simd = t.type == REG_S || t.type == REG_D ? 0x04000000 : 0;
+
+	// option = 011 (LSL), S = scaled
+	emit(size << 30 | simd | 0x38206800 | opc << 22 | m.n << 16 | (scaled ? 0x1000 : 0)
+			| n.n << 5 | t.n);
+}
+
+/**
+ * Tamanho (log2) do acesso de LDR e STR com o registrador t.
+ */
+static uint32_t accessSize(Assembler::Reg t)
+{
+	return t.type == Assembler::REG_X || t.type == Assembler::REG_D ? 3 : 2;
+}
+
+void Assembler::ldr(Reg t, Reg n, int64_t offset)
+{
+	loadStore(1, accessSize(t), t, n, offset);
+}
+
+void Assembler::str(Reg t, Reg n, int64_t offset)
+{
+	loadStore(0, accessSize(t), t, n, offset);
+}
+
+void Assembler::ldrsw(Reg t, Reg n, int64_t offset)
+{
+	if (t.type != REG_X) {
+		fail("LDRSW needs an X register");
+	}
+	loadStore(2, 2, t, n, offset);
+}
+
+void Assembler::ldr(Reg t, Reg n, Reg m, bool scaled)
+{
+	loadStore(1, accessSize(t), t, n, m, scaled);
+}
+
+void Assembler::str(Reg t, Reg n, Reg m, bool scaled)
+{
+	loadStore(0, accessSize(t), t, n, m, scaled);
+}
+
+void Assembler::ldrsw(Reg t, Reg n, Reg m, bool scaled)
+{
+	if (t.type != REG_X) {
+		fail("LDRSW needs an X register");
+	}
+	loadStore(2, 2, t, n, m, scaled);
+}
+
+/**
+ * C4.1.3 Branches
+ */
+void Assembler::b(Label &label)
+{
+	emitUse(0x14000000, label, Label::USE_B26);
+}
+
+void Assembler::bl(Label &label)
+{
+	emitUse(0x94000000, label, Label::USE_B26);
+}
+
+void Assembler::b(Cond cond, Label &label)
+{
+	emitUse(0x54000000 | cond, label, Label::USE_IMM19);
+}
+
+void Assembler::cbz(Reg t, Label &label)
+{
+	emitUse(0x34000000 | sf(t) | t.n, label, Label::USE_IMM19);
+}
+
+void Assembler::cbnz(Reg t, Label &label)
+{
+	emitUse(0x35000000 | sf(t) | t.n, label, Label::USE_IMM19);
+}
+
+void Assembler::br(Reg n)
+{
+	sf(n);
+	emit(0xD61F0000 | n.n << 5);
+}
+
+void Assembler::blr(Reg n)
+{
+	sf(n);
+	emit(0xD63F0000 | n.n << 5);
+}
+
+void Assembler::ret()
+{
+	ret(X(30));
+}
+
+void Assembler::ret(Reg n)
+{
+	sf(n);
+	emit(0xD65F0000 | n.n << 5);
+}
+
+void Assembler::nop()
+{
+	emit(0xD503201F);
+}
+
+/**
+ * C4.1.6 Floating-point data-processing
+ */
+void Assembler::floatOp(uint32_t ir, Reg d, Reg n, Reg m)
+{
+	uint32_t type = ftype(d, n);
+	ftype(m, d);
+	emit(ir | type | m.n << 16 | n.n << 5 | d.n);
+}
+
+void Assembler::fmul(Reg d, Reg n, Reg m)
+{
+	floatOp(0x1E200800, d, n, m);
+}
+
+void Assembler::fdiv(Reg d, Reg n, Reg m)
+{
+	floatOp(0x1E201800, d, n, m);
+}
+
+void Assembler::fadd(Reg d, Reg n, Reg m)
+{
+	floatOp(0x1E202800, d, n, m);
+}
+
+void Assembler::fsub(Reg d, Reg n, Reg m)
+{
+	floatOp(0x1E203800, d, n, m);
+}
+
+void Assembler::fmov(Reg d, Reg n)
+{
+	emit(0x1E204000 | ftype(d, n) | n.n << 5 | d.n);
+}
+
+void Assembler::fabs(Reg d, Reg n)
+{
+	emit(0x1E20C000 | ftype(d, n) | n.n << 5 | d.n);
+}
+
+void Assembler::fneg(Reg d, Reg n)
+{
+	emit(0x1E214000 | ftype(d, n) | n.n << 5 | d.n);
+}
+
+void Assembler::fmov(Reg d, double value)
+{
+	// imm8 = a:b:c:d:e:f:g:h representa (-1)^a * 2^((bcd ^ 100) - 3) *
+	// (16 + efgh) / 16 (VFPExpandImm)
+	for (uint32_t imm8 = 0; imm8 < 256; imm8++) {
+		double expanded = ldexp((16 + (imm8 & 0xF)) / 16.0, (int)(((imm8 >> 4) & 7) ^ 4) - 3);
+		if ((imm8 & 0x80 ? -expanded : expanded) == value) {
+			emit(0x1E201000 | ftype(d, d) | imm8 << 13 | d.n);
+			return;
+		}
+	}
+	ostringstream text;
+	text << "value " << value << " not encodable in FMOV";
+	fail(text.str());
+}
+
+/**
+ * Rótulos
+ */
+void Assembler::emitUse(uint32_t ir, Label &label, Label::Use use)
+{
+	if (label.bound) {
+		emit(resolve(ir, address, label.address, use));
+		return;
+	}
+	label.uses.push_back({address, use});
+	pendingUses++;
+	emit(ir);
+}
+
+uint32_t Assembler::resolve(uint32_t ir, uint64_t place, uint64_t target, Label::Use use)
+{
+	int64_t offset = target - place;
+	switch (use) {
+		case Label::USE_LO12:
+			return (ir & ~0x003FFC00) | (target & 0xFFF) << 10;
+		case Label::USE_B26:
+			if (offset < -(1 << 27) || offset >= (1 << 27)) {
+				fail("branch target out of range");
+			}
+			return (ir & ~0x03FFFFFF) | ((offset >> 2) & 0x03FFFFFF);
+		case Label::USE_IMM19:
+			if (offset < -(1 << 20) || offset >= (1 << 20)) {
+				fail("branch target out of range");
+			}
+			return (ir & ~0x00FFFFE0) | ((offset >> 2) & 0x7FFFF) << 5;
+		case Label::USE_ADRP:
+			offset = (int64_t)(target & ~0xFFFULL) - (int64_t)(place & ~0xFFFULL);
+			offset >>= 12;
+			if (offset < -(1 << 20) || offset >= (1 << 20)) {
+				fail("ADRP target out of range");
+			}
+			break;
+		case Label::USE_ADR:
+			if (offset < -(1 << 20) || offset >= (1 << 20)) {
+				fail("ADR target out of range");
+			}
+			break;
+	}
+	// immlo (bits 30-29) e immhi (bits 23-5) de ADR e ADRP
+	return (ir & ~0x60FFFFE0) | (offset & 3) << 29 | ((offset >> 2) & 0x7FFFF) << 5;
+}
@@ -0,0 +1,297 @@
+/* ----------------------------------------------------------------------------
+
+    (EN) Assembler - emits AArch64 instructions and data directly into a Memory
+		
+	armethyst - A simple ARM Simulator written in C++ for Computer Architecture
+    teaching purposes. Free software licensed under the MIT License (see license
+    below).
+
+    (PT) Assembler - escreve instruções AArch64 e dados diretamente em uma
+		  Memory
+    
+	armethyst - Um simulador ARM simples escrito em C++ para o ensino de
+    Arquitetura de Computadores. Software livre licenciado pela MIT License
+    (veja a licença, em inglês, abaixo).
+
+    (EN) MIT LICENSE:
+
+    Copyright 2020 André Vital Saúde
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+   ----------------------------------------------------------------------------
+*/
+
+#pragma once
+
+#include "config.h"
+#include "Memory.h"
+
+#include <string>
+#include <vector>
+
+/**
+ * Assembler
+ *
+ * Montador AArch64 em C++, para gerar programas de teste e de medida no
+ * próprio processo, sem toolchain externa: cada método escreve uma
+ * instrução (ou dado) na memória, no endereço corrente, e avança o
+ * endereço. Ex., a soma de isummation.S:
+ *
+ *		Assembler as(memory);
+ *		Assembler::Label loop, test;
+ *		...
+ *		as.b(test);
+ *		as.bind(loop);
+ *		as.ldr(W(1), X(0), X(2), true);		// ldr w1, [x0, x2, lsl 2]
+ *		as.add(W(3), W(3), W(1));
+ *		as.add(X(2), X(2), 1);
+ *		as.bind(test);
+ *		as.cmp(X(2), X(4));
+ *		as.b(Assembler::LT, loop);
+ *		as.ret();
+ *
+ * Cobre as instruções decodificadas pela BasicCPU (SUB com imediato de
+ * 64 bits, CMP com imediato de 32 bits, ADD de 32 bits com registrador
+ * deslocado, LDR e STR de 32 bits com imediato, LDR de 32 bits com
+ * registrador, LDRSW com imediato, B, B.cond, RET, FADD e FSUB de 32
+ * bits) e as demais da FastCPU: ADD com imediato, ADDS, SUBS, ADR, ADRP
+ * (e addressOf), LDR e STR de 64 bits e de ponto flutuante, BL, CBZ,
+ * CBNZ, BR, BLR, NOP e as operações escalares de ponto flutuante.
+ *
+ * Os registradores são dados por X(n), W(n), S(n) e D(n), e o tamanho
+ * da operação é o dos registradores (X/D: 64 bits, W/S: 32 bits). O
+ * registrador 31 é SP ou ZR conforme a instrução, como na arquitetura:
+ * XZR e WZR são sinônimos de X(31) e W(31).
+ *
+ * Desvios e endereços podem se referir a rótulos (Label) ainda não
+ * definidos, que são corrigidos quando o rótulo é definido (bind).
+ *
+ * Operandos inválidos (imediato fora do alcance, registrador do tipo
+ * errado, rótulo distante ou não definido em finish) encerram o
+ * simulador, como os erros do ElfLoader.
+ */
+class Assembler
+{
+	public:
+		enum RegType { REG_X, REG_W, REG_S, REG_D };
+
+		/**
+		 * Registrador de um operando: número e tipo.
+		 */
+		struct Reg {
+			uint8_t n;
+			RegType type;
+		};
+
+		/**
+		 * Condições de B.cond (C1.2.4).
+		 */
+		enum Cond {
+			EQ, NE, CS, CC, MI, PL, VS, VC, HI, LS, GE, LT, GT, LE, AL
+		};
+
+		/**
+		 * Deslocamentos do registrador Rm (ADD, SUB com registrador).
+		 */
+		enum Shift { LSL, LSR, ASR };
+
+		/**
+		 * Rótulo: um endereço do programa, definido por bind, que
+		 * instruções anteriores podem referenciar.
+		 */
+		class Label
+		{
+			public:
+				bool isBound() { return bound; }
+				uint64_t getAddress() { return address; }
+
+			private:
+				friend class Assembler;
+
+				enum Use { USE_B26, USE_IMM19, USE_ADR, USE_ADRP, USE_LO12 };
+
+				bool bound = false;
+				uint64_t address = 0;
+
+				// instruções à espera do endereço
+				std::vector<std::pair<uint64_t, Use>> uses;
+		};
+
+		/**
+		 * Monta a partir de address, em memory.
+		 */
+		Assembler(Memory *memory, uint64_t address = STARTADDRESS);
+
+		/**
+		 * Endereço corrente (próxima instrução ou dado).
+		 */
+		uint64_t here() { return address; }
+
+		/**
+		 * Define label no endereço corrente, corrigindo as instruções
+		 * que já o referenciam.
+		 */
+		void bind(Label &label);
+
+		/**
+		 * Verifica que não há referências a rótulos não definidos e
+		 * retorna o endereço corrente.
+		 */
+		uint64_t finish();
+
+		/**
+		 * Dados
+		 */
+		void word(uint32_t value);
+		void dword(uint64_t value);
+		void float32(float value);
+		void float64(double value);
+
+		// alinha o endereço corrente a bytes (potência de 2)
+		void align(uint64_t bytes);
+
+		// reserva bytes sem escrevê-los (a memória começa zerada)
+		void reserve(uint64_t bytes);
+
+		/**
+		 * Data Processing -- Immediate
+		 *
+		 * imm de 12 bits, ou de 24 bits com os 12 inferiores nulos (LSL
+		 * #12). ADD e SUB aceitam imm negativo (trocando a operação).
+		 */
+		void add(Reg d, Reg n, int64_t imm);
+		void sub(Reg d, Reg n, int64_t imm);
+		void adds(Reg d, Reg n, int64_t imm);
+		void subs(Reg d, Reg n, int64_t imm);
+		void cmp(Reg n, int64_t imm);
+
+		// endereço de label: ADR (±1 MiB), ADRP (página de 4 KiB) e
+		// ADRP + ADD (±4 GiB)
+		void adr(Reg d, Label &label);
+		void adrp(Reg d, Label &label);
+		void addressOf(Reg d, Label &label);
+
+		/**
+		 * Data Processing -- Register (registrador deslocado)
+		 */
+		void add(Reg d, Reg n, Reg m, Shift shift = LSL, int amount = 0);
+		void sub(Reg d, Reg n, Reg m, Shift shift = LSL, int amount = 0);
+		void adds(Reg d, Reg n, Reg m, Shift shift = LSL, int amount = 0);
+		void subs(Reg d, Reg n, Reg m, Shift shift = LSL, int amount = 0);
+		void cmp(Reg n, Reg m, Shift shift = LSL, int amount = 0);
+
+		/**
+		 * Loads and Stores
+		 *
+		 * Com deslocamento imediato (múltiplo do tamanho, até 4095
+		 * vezes o tamanho; ou, senão, de -256 a 255, como LDUR/STUR) ou
+		 * com registrador Xm, multiplicado pelo tamanho se scaled.
+		 * O tamanho é o do registrador t (W, X, S ou D).
+		 */
+		void ldr(Reg t, Reg n, int64_t offset = 0);
+		void str(Reg t, Reg n, int64_t offset = 0);
+		void ldrsw(Reg t, Reg n, int64_t offset = 0);
+		void ldr(Reg t, Reg n, Reg m, bool scaled = false);
+		void str(Reg t, Reg n, Reg m, bool scaled = false);
+		void ldrsw(Reg t, Reg n, Reg m, bool scaled = false);
+
+		/**
+		 * Branches
+		 */
+		void b(Label &label);
+		void bl(Label &label);
+		void b(Cond cond, Label &label);
+		void cbz(Reg t, Label &label);
+		void cbnz(Reg t, Label &label);
+		void br(Reg n);
+		void blr(Reg n);
+		void ret();		// RET X30
+		void ret(Reg n);
+		void nop();
+
+		/**
+		 * Data Processing -- Scalar Floating-Point
+		 */
+		void fadd(Reg d, Reg n, Reg m);
+		void fsub(Reg d, Reg n, Reg m);
+		void fmul(Reg d, Reg n, Reg m);
+		void fdiv(Reg d, Reg n, Reg m);
+		void fmov(Reg d, Reg n);
+		void fneg(Reg d, Reg n);
+		void fabs(Reg d, Reg n);
+
+		// value deve ser ±(16..31)/16 * 2^(-3..4), como em FMOV
+		// (imediato)
+		void fmov(Reg d, double value);
+
+		/**
+		 * Escreve a instrução ir no endereço corrente.
+		 */
+		void emit(uint32_t ir);
+
+	private:
+		Memory *memory;
+		uint64_t address;
+
+		// referências a rótulos ainda não definidos
+		uint64_t pendingUses;
+
+		void fail(std::string message);
+
+		/**
+		 * Campos de tamanho: sf (bit 31) de registradores inteiros e
+		 * ftype (bits 23-22) de registradores de ponto flutuante. Falham
+		 * se r não for do tipo esperado ou de tipo diferente de same.
+		 */
+		uint32_t sf(Reg r);
+		uint32_t sf(Reg r, Reg same);
+		uint32_t ftype(Reg r, Reg same);
+
+		void addSubImm(uint32_t op, Reg d, Reg n, int64_t imm);
+		void addSubReg(uint32_t op, Reg d, Reg n, Reg m, Shift shift, int amount);
+		void loadStore(uint32_t opc, uint32_t size, Reg t, Reg n, int64_t offset);
+		void loadStore(uint32_t opc, uint32_t size, Reg t, Reg n, Reg m, bool scaled);
+		void floatOp(uint32_t ir, Reg d, Reg n, Reg m);
+
+		/**
+		 * Referência de ir (no endereço corrente) a label: escreve ir
+		 * com o deslocamento, se label já estiver definido, ou o
+		 * registra para bind.
+		 */
+		void emitUse(uint32_t ir, Label &label, Label::Use use);
+
+		/**
+		 * Preenche o campo de ir que referencia target, a partir de
+		 * place.
+		 */
+		uint32_t resolve(uint32_t ir, uint64_t place, uint64_t target, Label::Use use);
+};
+
+/**
+ * Registradores para os operandos do Assembler.
+ */
+inline Assembler::Reg X(int n) { return {(uint8_t)n, Assembler::REG_X}; }
+inline Assembler::Reg W(int n) { return {(uint8_t)n, Assembler::REG_W}; }
+inline Assembler::Reg S(int n) { return {(uint8_t)n, Assembler::REG_S}; }
+inline Assembler::Reg D(int n) { return {(uint8_t)n, Assembler::REG_D}; }
+
+const Assembler::Reg SP = X(31);
+const Assembler::Reg XZR = X(31);
+const Assembler::Reg WZR = W(31);
@@ -0,0 +1,259 @@
+/* ----------------------------------------------------------------------------
+
+    (EN) armethyst - A simple ARM Simulator written in C++ for Computer Architecture
+    teaching purposes. Free software licensed under the MIT License (see license
+    below).
+
+    (PT) armethyst - Um simulador ARM simples escrito em C++ para o ensino de
+    Arquitetura de Computadores. Software livre licenciado pela MIT License
+    (veja a licença, em inglês, abaixo).
+
+    (EN) MIT LICENSE:
+
+    Copyright 2020 André Vital Saúde
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+   ----------------------------------------------------------------------------
+*/
+
+#include "AssemblerCheck.h"
+#include "Check.h"
+#include "Assembler.h"
+
+#include <iomanip>
+
+using namespace std;
+
+/**
+ * Codificação esperada de cada instrução, na ordem em que
+ * checkEncodings as monta a partir de STARTADDRESS (palavras do
+ * llvm-mc; ADRP e o ADD de :lo12: calculados à mão).
+ */
+struct Encoding {
+	const char *text;
+	uint32_t word;
+};
+
+static const Encoding encodings[] = {
+	{"sub x1, x2, #5", 0xd1001441},
+	{"sub x1, x2, #5, lsl #12", 0xd1401441},
+	{"sub x1, x2, #5 (add #-5)", 0xd1001441},
+	{"add w3, w4, #4095", 0x113ffc83},
+	{"adds x5, x6, #1", 0xb10004c5},
+	{"subs w7, w8, #2", 0x71000907},
+	{"cmp w9, #3", 0x71000d3f},
+	{"cmp x9, #3", 0xf1000d3f},
+	{"add sp, sp, #16", 0x910043ff},
+	{"add w3, w3, w1", 0x0b010063},
+	{"add x1, x2, x3, lsl #2", 0x8b030841},
+	{"sub w1, w2, w3, lsr #4", 0x4b431041},
+	{"adds x1, x2, x3, asr #63", 0xab83fc41},
+	{"subs w1, w2, w3", 0x6b030041},
+	{"cmp x1, x2", 0xeb02003f},
+	{"ldr w1, [x0, #8]", 0xb9400801},
+	{"ldr x1, [x0, #4088]", 0xf947fc01},
+	{"str w2, [sp, #4]", 0xb90007e2},
+	{"stur x2, [x0, #-8]", 0xf81f8002},
+	{"ldr w1, [x0, x2, lsl #2]", 0xb8627801},
+	{"ldr x1, [x0, x2]", 0xf8626801},
+	{"str w1, [x0, x2, lsl #2]", 0xb8227801},
+	{"ldrsw x14, [x5]", 0xb98000ae},
+	{"ldrsw x14, [x5, #4]", 0xb98004ae},
+	{"ldrsw x1, [x0, x2, lsl #2]", 0xb8a27801},
+	{"ldr s0, [x0, #4]", 0xbd400400},
+	{"str d1, [x0, #16]", 0xfd000801},
+	{"ldr d2, [x0, x1, lsl #3]", 0xfc617802},
+	{"fadd s0, s0, s1", 0x1e212800},
+	{"fsub s3, s3, s2", 0x1e223863},
+	{"fadd d0, d1, d2", 0x1e622820},
+	{"fmul d3, d4, d5", 0x1e650883},
+	{"fdiv s6, s7, s8", 0x1e2818e6},
+	{"fmov d1, d2", 0x1e604041},
+	{"fneg s1, s2", 0x1e214041},
+	{"fabs d1, d2", 0x1e60c041},
+	{"fmov s0, #1.5", 0x1e2f1000},
+	{"fmov d0, #-2.0", 0x1e701000},
+	{"br x16", 0xd61f0200},
+	{"blr x17", 0xd63f0220},
+	{"ret", 0xd65f03c0},
+	{"ret x1", 0xd65f0020},
+	{"nop", 0xd503201f},
+	// back:
+	{"nop", 0xd503201f},
+	{"b back", 0x17ffffff},
+	{"b fwd", 0x14000007},
+	{"bl fwd", 0x94000006},
+	{"b.ne back", 0x54ffff81},
+	{"b.ge fwd", 0x5400008a},
+	{"cbz w1, fwd", 0x34000061},
+	{"cbnz x2, back", 0xb5ffff22},
+	{"adr x3, fwd", 0x10000023},
+	// fwd:
+	{"nop", 0xd503201f},
+	{"adrp x4, far", 0xb0000004},
+	{"adrp x5, far", 0xb0000005},
+	{"add x5, x5, :lo12:far", 0x910040a5},
+};
+
+#define ENCODINGS (sizeof(encodings) / sizeof(encodings[0]))
+
+/**
+ * Cada instrução montada é lida da memória e comparada com a palavra
+ * esperada; os rótulos são referenciados antes (fwd, far) e depois
+ * (back) de definidos.
+ */
+static void checkEncodings()
+{
+	string name = "Assembler encodings";
+	beginCheck(name);
+
+	Memory *memory = createMemory(MEM_IMPL_BASIC);
+	Assembler as(memory);
+	Assembler::Label back, fwd, far;
+
+	as.sub(X(1), X(2), 5);
+	as.sub(X(1), X(2), 0x5000);
+	as.add(X(1), X(2), -5);
+	as.add(W(3), W(4), 4095);
+	as.adds(X(5), X(6), 1);
+	as.subs(W(7), W(8), 2);
+	as.cmp(W(9), 3);
+	as.cmp(X(9), 3);
+	as.add(SP, SP, 16);
+	as.add(W(3), W(3), W(1));
+	as.add(X(1), X(2), X(3), Assembler::LSL, 2);
+	as.sub(W(1), W(2), W(3), Assembler::LSR, 4);
+	as.adds(X(1), X(2), X(3), Assembler::ASR, 63);
+	as.subs(W(1), W(2), W(3));
+	as.cmp(X(1), X(2));
+	as.ldr(W(1), X(0), 8);
+	as.ldr(X(1), X(0), 4088);
+	as.str(W(2), SP, 4);
+	as.str(X(2), X(0), -8);
+	as.ldr(W(1), X(0), X(2), true);
+	as.ldr(X(1), X(0), X(2));
+	as.str(W(1), X(0), X(2), true);
+	as.ldrsw(X(14), X(5));
+	as.ldrsw(X(14), X(5), 4);
+	as.ldrsw(X(1), X(0), X(2), true);
+	as.ldr(S(0), X(0), 4);
+	as.str(D(1), X(0), 16);
+	as.ldr(D(2), X(0), X(1), true);
+	as.fadd(S(0), S(0), S(1));
+	as.fsub(S(3), S(3), S(2));
+	as.fadd(D(0), D(1), D(2));
+	as.fmul(D(3), D(4), D(5));
+	as.fdiv(S(6), S(7), S(8));
+	as.fmov(D(1), D(2));
+	as.fneg(S(1), S(2));
+	as.fabs(D(1), D(2));
+	as.fmov(S(0), 1.5);
+	as.fmov(D(0), -2.0);
+	as.br(X(16));
+	as.blr(X(17));
+	as.ret();
+	as.ret(X(1));
+	as.nop();
+	as.bind(back);
+	as.nop();
+	as.b(back);
+	as.b(fwd);
+	as.bl(fwd);
+	as.b(Assembler::NE, back);
+	as.b(Assembler::GE, fwd);
+	as.cbz(W(1), fwd);
+	as.cbnz(X(2), back);
+	as.adr(X(3), fwd);
+	as.bind(fwd);
+	as.nop();
+	as.adrp(X(4), far);
+	as.addressOf(X(5), far);
+	uint64_t codeEnd = as.here();
+
+	// far na página seguinte ao código, 16 bytes depois do início
+	as.align(0x1000);
+	as.reserve(16);
+	as.bind(far);
+	as.finish();
+
+	CHECK(codeEnd == STARTADDRESS + 4 * ENCODINGS);
+	CHECK(far.getAddress() == 0x1010);
+	int wrong = 0;
+	for (unsigned i = 0; i < ENCODINGS; i++) {
+		uint32_t word = memory->readInstruction32(STARTADDRESS + 4 * i);
+		if (word != encodings[i].word) {
+			cout << "	" << encodings[i].text << ": 0x" << hex << setw(8)
+					<< setfill('0') << word << ";  Expected 0x" << setw(8)
+					<< encodings[i].word << dec << setfill(' ') << endl;
+			wrong++;
+		}
+	}
+	cout << "	" << ENCODINGS - wrong << " of " << ENCODINGS
+			<< " instructions encoded as expected" << endl;
+	CHECK(wrong == 0);
+
+	delete memory;
+	endCheck(name);
+}
+
+/**
+ * Dados: little-endian, alinhados por align (a BasicMemory só lê dados
+ * alinhados) e separados por reserve.
+ */
+static void checkData()
+{
+	string name = "Assembler data";
+	beginCheck(name);
+
+	Memory *memory = createMemory(MEM_IMPL_BASIC);
+	Assembler as(memory);
+	Assembler::Label words, floats;
+	as.bind(words);
+	as.word(0x12345678);
+	as.align(8);
+	as.dword(0x0123456789abcdefULL);
+	as.align(8);
+	as.bind(floats);
+	as.float32(1.5f);
+	as.reserve(4);
+	as.float64(-0.25);
+	uint64_t end = as.finish();
+
+	uint64_t w = words.getAddress();
+	uint64_t f = floats.getAddress();
+	CHECK(w == STARTADDRESS);
+	CHECK(memory->readData32(w) == 0x12345678);
+	CHECK(memory->readData64(w + 8) == 0x0123456789abcdefULL);
+	CHECK(f == w + 16);
+	CHECK(memory->readData32(w + 4) == 0);
+	CHECK(memory->readData32(f) == 0x3fc00000);
+	CHECK(memory->readData32(f + 4) == 0);
+	CHECK(memory->readData64(f + 8) == 0xbfd0000000000000ULL);
+	CHECK(end == f + 16);
+
+	delete memory;
+	endCheck(name);
+}
+
+void checkAssembler()
+{
+	checkEncodings();
+	checkData();
+}
@@ -0,0 +1,257 @@
+/* ----------------------------------------------------------------------------
+
+    (EN) Checkpoint - Checkpoint file format of the simulator state. Part of
+	armethyst project.
+		
+	armethyst - A simple ARM Simulator written in C++ for Computer Architecture
+    teaching purposes. Free software licensed under the MIT License (see license
+    below).
+
+    (PT) Checkpoint - Formato de arquivo de checkpoint do estado do simulador.
+	Parte do projeto armethyst.
+    
+	armethyst - Um simulador ARM simples escrito em C++ para o ensino de
+    Arquitetura de Computadores. Software livre licenciado pela MIT License
+    (veja a licença, em inglês, abaixo).
+
+    (EN) MIT LICENSE:
+
+    Copyright 2020 André Vital Saúde
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+   ----------------------------------------------------------------------------
+*/
+
+#include "Checkpoint.h"
+#include "SimulatorError.h"
+
+#include <cstring>
+
+using namespace std;
+
+#define PAGE_WORDS (CHECKPOINT_PAGE_SIZE / 8)
+
+CheckpointWriter::CheckpointWriter(string filename)
+{
+	this->filename = filename;
+	file.open(filename, ios::out | ios::binary | ios::trunc);
+	if (!file.is_open()) {
+		throw SimulatorError("Unable to open file " + filename);
+	}
+
+	char magic[8] = CHECKPOINT_MAGIC;
+	uint32_t version = CHECKPOINT_VERSION;
+	write(magic, sizeof(magic));
+	write(&version, sizeof(version));
+}
+
+void CheckpointWriter::section(const char *tag)
+{
+	write(tag, 4);
+}
+
+void CheckpointWriter::write(const void *bytes, uint64_t size)
+{
+	if (!file.write((const char *)bytes, size)) {
+		throw SimulatorError("Unable to write file " + filename);
+	}
+}
+
+void CheckpointWriter::writeUint64(uint64_t value)
+{
+	write(&value, sizeof(value));
+}
+
+void CheckpointWriter::writeString(const string &value)
+{
+	writeUint64(value.size());
+	write(value.data(), value.size());
+}
+
+void CheckpointWriter::writeCPUState(const CPUState &state)
+{
+	section("CPU ");
+	write(&state, sizeof(state));
+}
+
+/**
+ * Compressão dos trechos de palavras nulas (ver Checkpoint.h).
+ */
+void CheckpointWriter::writePage(uint64_t address, const uint8_t *page, bool empty)
+{
+	uint64_t words[PAGE_WORDS];
+	memcpy(words, page, CHECKPOINT_PAGE_SIZE);
+
+	// o pior caso (palavras nulas isoladas) pode exceder a página
+	uint8_t compressed[2 * CHECKPOINT_PAGE_SIZE];
+	uint32_t size = 0;
+	bool zero = true;
+	for (int i = 0; i < PAGE_WORDS; ) {
+		uint16_t zeros = 0, literals = 0;
+		while (i + zeros < PAGE_WORDS && !words[i + zeros]) {
+			zeros++;
+		}
+		while (i + zeros + literals < PAGE_WORDS && words[i + zeros + literals]) {
+			literals++;
+		}
+		memcpy(compressed + size, &zeros, 2);
+		memcpy(compressed + size + 2, &literals, 2);
+		memcpy(compressed + size + 4, &words[i + zeros], literals * 8);
+		size += 4 + literals * 8;
+		zero = zero && !literals;
+		i += zeros + literals;
+	}
+	if (zero && !empty) {
+		return;
+	}
+
+	writeUint64(address);
+	if (size < CHECKPOINT_PAGE_SIZE) {
+		write(&size, sizeof(size));
+		write(compressed, size);
+	} else {
+		size = CHECKPOINT_PAGE_SIZE;
+		write(&size, sizeof(size));
+		write(page, size);
+	}
+}
+
+void CheckpointWriter::endPages()
+{
+	writeUint64(CHECKPOINT_END_PAGES);
+}
+
+CheckpointReader::CheckpointReader(string filename)
+{
+	this->filename = filename;
+	file.open(filename, ios::in | ios::binary);
+	if (!file.is_open()) {
+		throw SimulatorError("Unable to open file " + filename);
+	}
+
+	char magic[8];
+	uint32_t version;
+	read(magic, sizeof(magic));
+	read(&version, sizeof(version));
+	if (memcmp(magic, CHECKPOINT_MAGIC, sizeof(magic)) != 0 || version != CHECKPOINT_VERSION) {
+		fail("not a checkpoint");
+	}
+}
+
+void CheckpointReader::fail(string message)
+{
+	throw SimulatorError(filename + ": " + message);
+}
+
+void CheckpointReader::section(const char *tag)
+{
+	char found[4];
+	read(found, sizeof(found));
+	if (memcmp(found, tag, sizeof(found)) != 0) {
+		fail(string("expected section ") + tag);
+	}
+}
+
+bool CheckpointReader::section(const char *tag, const char *alternative)
+{
+	char found[4];
+	read(found, sizeof(found));
+	if (memcmp(found, tag, sizeof(found)) == 0) {
+		return false;
+	}
+	if (memcmp(found, alternative, sizeof(found)) != 0) {
+		fail(string("expected section ") + tag + " or " + alternative);
+	}
+	return true;
+}
+
+void CheckpointReader::read(void *bytes, uint64_t size)
+{
+	if (!file.read((char *)bytes, size)) {
+		fail("unexpected end of file");
+	}
+}
+
+uint64_t CheckpointReader::readUint64()
+{
+	uint64_t value;
+	read(&value, sizeof(value));
+	return value;
+}
+
+string CheckpointReader::readString()
+{
+	uint64_t size = readUint64();
+	if (size > 4096) {
+		fail("invalid string");
+	}
+	string value(size, '\0');
+	read(&value[0], size);
+	return value;
+}
+
+void CheckpointReader::readCPUState(CPUState &state)
+{
+	section("CPU ");
+	read(&state, sizeof(state));
+}
+
+bool CheckpointReader::readPage(uint64_t &address, uint8_t *page)
+{
+	address = readUint64();
+	if (address == CHECKPOINT_END_PAGES) {
+		return false;
+	}
+
+	uint32_t size;
+	read(&size, sizeof(size));
+	if (size == CHECKPOINT_PAGE_SIZE) {
+		read(page, size);
+		return true;
+	}
+
+	uint8_t compressed[CHECKPOINT_PAGE_SIZE];
+	if (size > sizeof(compressed)) {
+		fail("invalid page");
+	}
+	read(compressed, size);
+	uint64_t words[PAGE_WORDS];
+	uint32_t position = 0;
+	int i = 0;
+	while (position + 4 <= size) {
+		uint16_t zeros, literals;
+		memcpy(&zeros, compressed + position, 2);
+		memcpy(&literals, compressed + position + 2, 2);
+		position += 4;
+		if (i + zeros + literals > PAGE_WORDS || position + literals * 8 > size) {
+			fail("invalid page");
+		}
+		memset(&words[i], 0, zeros * 8);
+		i += zeros;
+		memcpy(&words[i], compressed + position, literals * 8);
+		i += literals;
+		position += literals * 8;
+	}
+	if (i != PAGE_WORDS || position != size) {
+		fail("invalid page");
+	}
+	memcpy(page, words, CHECKPOINT_PAGE_SIZE);
+	return true;
+}
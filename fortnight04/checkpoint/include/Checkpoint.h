@@ -0,0 +1,172 @@
+/* ----------------------------------------------------------------------------
+
+    (EN) Checkpoint - Checkpoint file format of the simulator state. Part of
+	armethyst project.
+		
+	armethyst - A simple ARM Simulator written in C++ for Computer Architecture
+    teaching purposes. Free software licensed under the MIT License (see license
+    below).
+
+    (PT) Checkpoint - Formato de arquivo de checkpoint do estado do simulador.
+	Parte do projeto armethyst.
+    
+	armethyst - Um simulador ARM simples escrito em C++ para o ensino de
+    Arquitetura de Computadores. Software livre licenciado pela MIT License
+    (veja a licença, em inglês, abaixo).
+
+    (EN) MIT LICENSE:
+
+    Copyright 2020 André Vital Saúde
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+   ----------------------------------------------------------------------------
+*/
+
+#pragma once
+
+#include <string>
+#include <fstream>
+#include <cstdint>
+
+// Identificação do arquivo de checkpoint
+#define CHECKPOINT_MAGIC "ARMCKPT"
+#define CHECKPOINT_VERSION 2
+
+// Tamanho das páginas gravadas, independente da implementação de memória
+#define CHECKPOINT_PAGE_SIZE 4096
+
+// Endereço que termina a lista de páginas
+#define CHECKPOINT_END_PAGES (~(uint64_t)0)
+
+/**
+ * Estado arquitetural de um núcleo, comum a todas as implementações de
+ * CPU: um checkpoint gravado com uma CPU pode ser restaurado em outra.
+ */
+struct CPUState {
+	uint64_t R[31];		// X0-X30
+	uint64_t SP;
+	uint64_t PC;
+	uint64_t V[32][2];	// V0-V31: [0] bits 63-0 (D, S), [1] bits 127-64
+	uint32_t NZCV;		// flags nos bits 31 (N), 30 (Z), 29 (C) e 28 (V)
+	uint32_t error;		// CPU::CPUerrorCode
+	uint32_t finished;	// processo terminado
+	uint32_t reserved;
+};
+
+/**
+ * Arquivo de checkpoint
+ *
+ * Um cabeçalho (CHECKPOINT_MAGIC, CHECKPOINT_VERSION) seguido de seções,
+ * cada uma iniciada por uma etiqueta de 4 caracteres:
+ *
+ *	- "PROC": número de núcleos (64 bits);
+ *	- "CPU ": um CPUState, para cada núcleo;
+ *	- "MEM ": tamanho do espaço de endereços (64 bits) e as páginas de
+ *	  CHECKPOINT_PAGE_SIZE bytes que não são inteiramente nulas, cada uma
+ *	  com seu endereço (64 bits), o tamanho dos dados (32 bits) e os dados,
+ *	  terminadas pelo endereço CHECKPOINT_END_PAGES.
+ *
+ * Um checkpoint incremental (Processor::saveIncremental) começa por uma
+ * seção "BASE", com o nome do checkpoint anterior (tamanho em 64 bits e
+ * os caracteres), relativo ao diretório do incremental ou absoluto, e
+ * tem, no lugar de "MEM ", uma seção "MEMI" no mesmo formato, com apenas
+ * as páginas escritas desde o anterior, inclusive as nulas. Restaurá-lo restaura antes, recursivamente, o anterior.
+ *
+ * Os dados de uma página são comprimidos como uma sequência de trechos
+ * de palavras de 64 bits: número de palavras nulas (16 bits), número de
+ * palavras seguintes não comprimidas (16 bits) e essas palavras. Se a
+ * compressão não reduzir a página, ela é gravada sem compressão, com
+ * tamanho CHECKPOINT_PAGE_SIZE.
+ *
+ * Erros (arquivo inexistente, inválido ou de outra configuração)
+ * lançam SimulatorError.
+ */
+class CheckpointWriter
+{
+	public:
+		/**
+		 * Cria filename e grava o cabeçalho.
+		 */
+		CheckpointWriter(std::string filename);
+
+		/**
+		 * Inicia a seção tag (4 caracteres).
+		 */
+		void section(const char *tag);
+
+		void write(const void *bytes, uint64_t size);
+		void writeUint64(uint64_t value);
+		void writeString(const std::string &value);
+		void writeCPUState(const CPUState &state);
+
+		/**
+		 * Grava a página de CHECKPOINT_PAGE_SIZE bytes em address,
+		 * comprimida, se ela não for inteiramente nula ou se empty
+		 * (seção "MEMI").
+		 */
+		void writePage(uint64_t address, const uint8_t *page, bool empty = false);
+
+		/**
+		 * Termina a lista de páginas.
+		 */
+		void endPages();
+
+	private:
+		std::string filename;
+		std::ofstream file;
+};
+
+class CheckpointReader
+{
+	public:
+		/**
+		 * Abre filename e confere o cabeçalho.
+		 */
+		CheckpointReader(std::string filename);
+
+		/**
+		 * Lê o início da seção tag; lança SimulatorError se a
+		 * próxima seção for outra.
+		 */
+		void section(const char *tag);
+
+		/**
+		 * Lê o início da seção tag ou da seção alternative; retorna true
+		 * se for alternative.
+		 */
+		bool section(const char *tag, const char *alternative);
+
+		void read(void *bytes, uint64_t size);
+		uint64_t readUint64();
+		std::string readString();
+		void readCPUState(CPUState &state);
+
+		/**
+		 * Lê a próxima página para page, com CHECKPOINT_PAGE_SIZE bytes,
+		 * e seu endereço para address. Retorna false no fim da lista.
+		 */
+		bool readPage(uint64_t &address, uint8_t *page);
+
+	private:
+		std::string filename;
+		std::ifstream file;
+
+		void fail(std::string message);
+};
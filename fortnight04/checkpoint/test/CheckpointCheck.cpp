@@ -0,0 +1,161 @@
+/* ----------------------------------------------------------------------------
+
+    (EN) armethyst - A simple ARM Simulator written in C++ for Computer Architecture
+    teaching purposes. Free software licensed under the MIT License (see license
+    below).
+
+    (PT) armethyst - Um simulador ARM simples escrito em C++ para o ensino de
+    Arquitetura de Computadores. Software livre licenciado pela MIT License
+    (veja a licença, em inglês, abaixo).
+
+    (EN) MIT LICENSE:
+
+    Copyright 2020 André Vital Saúde
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+   ----------------------------------------------------------------------------
+*/
+
+#include "CheckpointCheck.h"
+#include "Check.h"
+#include "SimulatorError.h"
+
+#include <cstdio>
+#include <fstream>
+
+using namespace std;
+
+#define CHECK_N 1000
+#define CHECKPOINT_FILE "runcheck.ckpt"
+
+// instrução em que o checkpoint é gravado, no meio do laço de soma
+#define CHECKPOINT_AT 9001
+
+/**
+ * O checkpoint gravado por uma CPU no meio do programa, restaurado em
+ * outra implementação de CPU, sobre uma memória nova, reproduz o estado
+ * do momento em que foi gravado, e a execução restaurada termina com o
+ * mesmo estado e a mesma memória que a original.
+ */
+static void checkRoundTrip(int saveImpl, int restoreImpl, int memImpl)
+{
+	string name = "checkpoint from " + cpuName(saveImpl) + " restored on "
+					+ cpuName(restoreImpl) + " (" + memoryName(memImpl) + ")";
+	beginCheck(name);
+
+	Memory *memory = createMemory(memImpl);
+	CheckProgram program = assembleCheckProgram(memory, CHECK_N);
+	CheckProcessor *processor = new CheckProcessor(saveImpl, memory);
+	CPU *cpu = processor->getCPU();
+	startCheckProgram(cpu, program);
+	CHECK(cpu->runFor(CHECKPOINT_AT).retired == CHECKPOINT_AT);
+
+	CPUState saved;
+	cpu->getState(saved);
+	processor->save(CHECKPOINT_FILE);
+	cpu->runFor(CPU::NO_LIMIT);
+
+	Memory *restoredMemory = createMemory(memImpl);
+	CheckProcessor *restored = new CheckProcessor(restoreImpl, restoredMemory);
+	CPU *restoredCPU = restored->getCPU();
+	restored->restore(CHECKPOINT_FILE);
+	CPUState state;
+	restoredCPU->getState(state);
+	CHECK(sameState(saved, state));
+
+	CPU::RunResult result = restoredCPU->runFor(CPU::NO_LIMIT);
+	CHECK(result.reason == CPU::EXIT_FINISHED);
+	CPUState expected;
+	cpu->getState(expected);
+	restoredCPU->getState(state);
+	if (!sameState(expected, state)) {
+		printStateDiff(expected, state);
+	}
+	CHECK(sameState(expected, state));
+	CHECK(restoredMemory->readData32(program.result) == checkProgramSum(CHECK_N));
+	checkSameMemory(memory, restoredMemory, STARTADDRESS,
+					CHECK_PROGRAM_END(CHECK_N) - STARTADDRESS);
+
+	delete restored;
+	delete restoredMemory;
+	delete processor;
+	delete memory;
+	remove(CHECKPOINT_FILE);
+	endCheck(name);
+}
+
+/**
+ * Checkpoint que não pode ser gravado, inexistente, inválido ou truncado
+ * lança SimulatorError, em vez de encerrar o simulador.
+ */
+static void checkErrors()
+{
+	string name = "checkpoint errors";
+	beginCheck(name);
+
+	Memory *memory = createMemory(MEM_IMPL_BASIC);
+	CheckProgram program = assembleCheckProgram(memory, CHECK_N);
+	CheckProcessor *processor = new CheckProcessor(CPU_IMPL_FAST, memory);
+	startCheckProgram(processor->getCPU(), program);
+	processor->getCPU()->runFor(CHECKPOINT_AT);
+
+	int thrown = 0;
+	try {
+		processor->save("runcheck.missing/" CHECKPOINT_FILE);
+	} catch (const SimulatorError &) {
+		thrown++;
+	}
+	try {
+		processor->restore("runcheck.missing/" CHECKPOINT_FILE);
+	} catch (const SimulatorError &) {
+		thrown++;
+	}
+	ofstream(CHECKPOINT_FILE) << "not a checkpoint";
+	try {
+		processor->restore(CHECKPOINT_FILE);
+	} catch (const SimulatorError &) {
+		thrown++;
+	}
+	processor->save(CHECKPOINT_FILE);
+	ifstream complete(CHECKPOINT_FILE, ios::binary);
+	string data((istreambuf_iterator<char>(complete)), istreambuf_iterator<char>());
+	complete.close();
+	ofstream(CHECKPOINT_FILE, ios::binary) << data.substr(0, data.size() / 2);
+	try {
+		processor->restore(CHECKPOINT_FILE);
+	} catch (const SimulatorError &) {
+		thrown++;
+	}
+	CHECK(thrown == 4);
+
+	delete processor;
+	delete memory;
+	remove(CHECKPOINT_FILE);
+	endCheck(name);
+}
+
+void checkCheckpoint()
+{
+	checkRoundTrip(CPU_IMPL_FAST, CPU_IMPL_BASIC, MEM_IMPL_BASIC);
+	checkRoundTrip(CPU_IMPL_BASIC, CPU_IMPL_JIT, MEM_IMPL_BASIC);
+	checkRoundTrip(CPU_IMPL_JIT, CPU_IMPL_FAST, MEM_IMPL_SPARSE);
+	checkRoundTrip(CPU_IMPL_FAST, CPU_IMPL_FAST, MEM_IMPL_SPARSE);
+	checkErrors();
+}
@@ -0,0 +1,256 @@
+/* ----------------------------------------------------------------------------
+
+    (EN) armethyst - A simple ARM Simulator written in C++ for Computer Architecture
+    teaching purposes. Free software licensed under the MIT License (see license
+    below).
+
+    (PT) armethyst - Um simulador ARM simples escrito em C++ para o ensino de
+    Arquitetura de Computadores. Software livre licenciado pela MIT License
+    (veja a licença, em inglês, abaixo).
+
+    (EN) MIT LICENSE:
+
+    Copyright 2020 André Vital Saúde
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+   ----------------------------------------------------------------------------
+*/
+
+#include "IncrementalCheck.h"
+#include "Check.h"
+
+#include <cstdio>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+// v ocupa 8 páginas, e o programa cabe em MEMORY_SIZE
+#define CHECK_N (8 * HOST_PAGE_SIZE / 4)
+
+// checkpoints da cadeia: um quarto e metade do preenchimento de v e,
+// duas vezes, o laço de soma, que não escreve na memória
+static const uint64_t chainAt[] = {12000, 25000, 60000, 100000};
+static const char *chainFile[] = {
+	"runcheck.0.ckpt", "runcheck.1.ckpt", "runcheck.2.ckpt", "runcheck.3.ckpt"
+};
+#define CHAIN 4
+
+// incremental gravado depois de restaurar o meio da cadeia
+#define BRANCH_AT 40000
+#define BRANCH_FILE "runcheck.4.ckpt"
+
+// cadeia gravada em outro diretório, depois movido
+#define CHAIN_DIR "runcheck.dir"
+#define MOVED_DIR "runcheck.moved"
+
+static uint64_t fileSize(const char *filename)
+{
+	struct stat st;
+	CHECK(stat(filename, &st) == 0);
+	return st.st_size;
+}
+
+/**
+ * Restaura filename em um processador novo, de cpuImpl sobre uma memória
+ * nova, e verifica o estado gravado. O processador e sua memória passam
+ * a ser do chamador.
+ */
+static CheckProcessor *restoreChecked(const char *filename, const CPUState &saved,
+										int cpuImpl, int memImpl)
+{
+	CheckProcessor *processor = new CheckProcessor(cpuImpl, createMemory(memImpl));
+	processor->restore(filename);
+	CPUState state;
+	processor->getCPU()->getState(state);
+	if (!sameState(saved, state)) {
+		cout << "	" << filename << ":" << endl;
+		printStateDiff(saved, state);
+	}
+	CHECK(sameState(saved, state));
+	return processor;
+}
+
+/**
+ * Executa processor até o fim e o compara com o estado e a memória
+ * finais da execução sem checkpoints.
+ */
+static void checkFinish(CheckProcessor *processor, CPU *ref, Memory *refMemory)
+{
+	CHECK(processor->getCPU()->runFor(CPU::NO_LIMIT).reason == CPU::EXIT_FINISHED);
+	CPUState expected, state;
+	ref->getState(expected);
+	processor->getCPU()->getState(state);
+	CHECK(sameState(expected, state));
+	checkSameMemory(refMemory, processor->getMemory(), STARTADDRESS,
+					CHECK_PROGRAM_END(CHECK_N) - STARTADDRESS);
+}
+
+/**
+ * Uma cadeia completo, incremental, incremental, gravada pela FastCPU
+ * (que escreve em v diretamente, pela TLB), restaurada em outra CPU a
+ * partir de cada elo. Depois de restaurar o meio da cadeia, o próximo
+ * incremental tem o restaurado como base. Com a SparseMemory, um
+ * incremental sem páginas escritas é bem menor que o completo.
+ */
+static void checkChain(int restoreImpl, int memImpl)
+{
+	string name = "incremental checkpoints from FastCPU restored on "
+					+ cpuName(restoreImpl) + " (" + memoryName(memImpl) + ")";
+	beginCheck(name);
+
+	Memory *refMemory = createMemory(memImpl);
+	CheckProgram program = assembleCheckProgram(refMemory, CHECK_N);
+	CPU *ref = createCPU(CPU_IMPL_BASIC, refMemory);
+	startCheckProgram(ref, program);
+	CHECK(ref->runFor(CPU::NO_LIMIT).reason == CPU::EXIT_FINISHED);
+
+	Memory *memory = createMemory(memImpl);
+	assembleCheckProgram(memory, CHECK_N);
+	CheckProcessor *processor = new CheckProcessor(CPU_IMPL_FAST, memory);
+	startCheckProgram(processor->getCPU(), program);
+	CPUState saved[CHAIN];
+	uint64_t retired = 0;
+	for (int i = 0; i < CHAIN; i++) {
+		retired += processor->getCPU()->runFor(chainAt[i] - retired).retired;
+		CHECK(retired == chainAt[i]);
+		processor->getCPU()->getState(saved[i]);
+		if (i == 0) {
+			processor->save(chainFile[i]);
+		} else {
+			processor->saveIncremental(chainFile[i]);
+		}
+	}
+	checkFinish(processor, ref, refMemory);
+	delete processor;
+	delete memory;
+
+	uint64_t sizes[CHAIN];
+	for (int i = 0; i < CHAIN; i++) {
+		sizes[i] = fileSize(chainFile[i]);
+	}
+	cout << "	checkpoint sizes: " << sizes[0] << " full, " << sizes[1] << ", "
+			<< sizes[2] << " and " << sizes[3] << " incremental" << endl;
+	if (memImpl == MEM_IMPL_SPARSE) {
+		CHECK(sizes[3] < sizes[0] / 4);
+	}
+
+	for (int i = 0; i < CHAIN; i++) {
+		processor = restoreChecked(chainFile[i], saved[i], restoreImpl, memImpl);
+		memory = processor->getMemory();
+		checkFinish(processor, ref, refMemory);
+		delete processor;
+		delete memory;
+	}
+
+	// base restaurada: o meio da cadeia
+	processor = restoreChecked(chainFile[1], saved[1], restoreImpl, memImpl);
+	memory = processor->getMemory();
+	CPUState branch;
+	uint64_t branchAt = BRANCH_AT - chainAt[1];
+	CHECK(processor->getCPU()->runFor(branchAt).retired == branchAt);
+	processor->getCPU()->getState(branch);
+	processor->saveIncremental(BRANCH_FILE);
+	delete processor;
+	delete memory;
+
+	processor = restoreChecked(BRANCH_FILE, branch, CPU_IMPL_FAST, memImpl);
+	memory = processor->getMemory();
+	checkFinish(processor, ref, refMemory);
+	delete processor;
+	delete memory;
+
+	for (int i = 0; i < CHAIN; i++) {
+		remove(chainFile[i]);
+	}
+	remove(BRANCH_FILE);
+	delete ref;
+	delete refMemory;
+	endCheck(name);
+}
+
+/**
+ * A base é procurada no diretório do incremental, não no diretório
+ * corrente: uma cadeia gravada em outro diretório é restaurada pelo
+ * caminho até ela e continua válida depois de movida. Uma base em outro
+ * diretório que o do incremental é gravada com o caminho absoluto.
+ */
+static void checkMovedChain(int memImpl)
+{
+	string name = "incremental checkpoints moved to another directory ("
+					+ memoryName(memImpl) + ")";
+	beginCheck(name);
+
+	Memory *refMemory = createMemory(memImpl);
+	CheckProgram program = assembleCheckProgram(refMemory, CHECK_N);
+	CPU *ref = createCPU(CPU_IMPL_BASIC, refMemory);
+	startCheckProgram(ref, program);
+	CHECK(ref->runFor(CPU::NO_LIMIT).reason == CPU::EXIT_FINISHED);
+
+	mkdir(CHAIN_DIR, 0755);
+	Memory *memory = createMemory(memImpl);
+	assembleCheckProgram(memory, CHECK_N);
+	CheckProcessor *processor = new CheckProcessor(CPU_IMPL_FAST, memory);
+	startCheckProgram(processor->getCPU(), program);
+	CPUState saved[3];
+	uint64_t retired = 0;
+	for (int i = 0; i < 3; i++) {
+		retired += processor->getCPU()->runFor(chainAt[i] - retired).retired;
+		processor->getCPU()->getState(saved[i]);
+		if (i == 0) {
+			processor->save(CHAIN_DIR "/0.ckpt");
+		} else if (i == 1) {
+			processor->saveIncremental(CHAIN_DIR "/1.ckpt");
+		} else {
+			processor->saveIncremental(chainFile[2]);
+		}
+	}
+	delete processor;
+	delete memory;
+
+	processor = restoreChecked(chainFile[2], saved[2], CPU_IMPL_BASIC, memImpl);
+	memory = processor->getMemory();
+	checkFinish(processor, ref, refMemory);
+	delete processor;
+	delete memory;
+
+	CHECK(rename(CHAIN_DIR, MOVED_DIR) == 0);
+	processor = restoreChecked(MOVED_DIR "/1.ckpt", saved[1], CPU_IMPL_BASIC, memImpl);
+	memory = processor->getMemory();
+	checkFinish(processor, ref, refMemory);
+	delete processor;
+	delete memory;
+
+	remove(MOVED_DIR "/0.ckpt");
+	remove(MOVED_DIR "/1.ckpt");
+	rmdir(MOVED_DIR);
+	remove(chainFile[2]);
+	delete ref;
+	delete refMemory;
+	endCheck(name);
+}
+
+void checkIncrementalCheckpoint()
+{
+	checkChain(CPU_IMPL_BASIC, MEM_IMPL_SPARSE);
+	checkChain(CPU_IMPL_JIT, MEM_IMPL_SPARSE);
+	checkChain(CPU_IMPL_FAST, MEM_IMPL_BASIC);
+	checkMovedChain(MEM_IMPL_SPARSE);
+}
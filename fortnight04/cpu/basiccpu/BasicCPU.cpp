@@ -33,11 +33,28 @@
    ----------------------------------------------------------------------------
 */
 
+#include "config.h"
 #include "BasicCPU.h"
 #include "Util.h"
+#include "Checkpoint.h"
+
+#include <iostream>
+#include <cstring>
+
+using namespace std;
 
 BasicCPU::BasicCPU(Memory *memory) {
 	this->memory = memory;
+
+	// cache de instruções decodificadas, inicialmente vazia
+	decodeCache = new DecodedInstruction[DECODE_CACHE_SIZE]();
+	DI = &decodeCache[0];
+	memory->addListener(this);
+}
+
+BasicCPU::~BasicCPU() {
+	memory->removeListener(this);
+	delete[] decodeCache;
 }
 
 /**
@@ -45,38 +62,203 @@ BasicCPU::BasicCPU(Memory *memory) {
  */
 int BasicCPU::run(uint64_t startAddress)
 {
+	start(startAddress);
+	execute(NO_LIMIT, NO_ADDRESS);
+
+	if (cpuError) {
+		return 1;
+	}
+	
+	return 0;
+};
 
+void BasicCPU::start(uint64_t startAddress)
+{
 	// inicia PC com o valor de startAddress
 	PC = startAddress;
 
+	// retorno de main para EXITADDRESS
+	R[30] = EXITADDRESS;
+
+	cpuError = CPUerrorCode::NONE;
+	processFinished = false;
+}
+
+CPU::RunResult BasicCPU::runFor(uint64_t maxInstructions)
+{
+	return execute(maxInstructions, NO_ADDRESS);
+}
+
+CPU::RunResult BasicCPU::runUntil(uint64_t address)
+{
+	return execute(NO_LIMIT, address);
+}
+
+CPU::RunResult BasicCPU::execute(uint64_t maxInstructions, uint64_t stopAddress)
+{
+	RunResult result = {0, EXIT_LIMIT, PC};
+
 	// ciclo da máquina
-	while ((cpuError != CPUerrorCode::NONE) && !processFinished) {
-		IF();
-		ID();
-		if (fpOp == FPOpFlag::FP_UNDEF) {
-			EXI();
-		} else {
-			EXF();
+	while (cpuError == CPUerrorCode::NONE && !processFinished) {
+		if (result.retired == maxInstructions) {
+			break;
+		}
+		if (PC == stopAddress && result.retired) {
+			result.reason = EXIT_ADDRESS;
+			break;
+		}
+		if (step()) {
+			cout << "Instruction not implemented: 0x" << hex << IR
+					<< " at 0x" << PC << dec << endl;
+			cpuError = CPUerrorCode::UNDEFINED_INSTRUCTION;
+			break;
+		}
+		result.retired++;
+
+		// retorno de main: fim do processo
+		if (PC == EXITADDRESS) {
+			processFinished = true;
 		}
-		MEM();
-		WB();
 	}
-	
+
 	if (cpuError) {
+		result.reason = EXIT_ERROR;
+	} else if (processFinished) {
+		result.reason = EXIT_FINISHED;
+	}
+	result.PC = PC;
+	retiredTotal += result.retired;
+	return result;
+}
+
+int BasicCPU::step()
+{
+	uint64_t pc = PC;
+
+	IF();
+	if (ID()) {
 		return 1;
 	}
-	
+	if (fpOp == FPOpFlag::FP_UNDEF) {
+		if (EXI()) {
+			return 1;
+		}
+	} else {
+		if (EXF()) {
+			return 1;
+		}
+	}
+	if (MEM() || WB()) {
+		return 1;
+	}
+
+	// desvios escrevem PC em WB (B.cond não tomado escreve PC + 4)
+	if (WBctrl == WBctrlFlag::RegWrite && Rd == &PC) {
+		if (observingBranches()) {
+			resolveBranch(pc, branchType(DI), taken, PC);
+		}
+	} else {
+		PC += 4;
+	}
+	if (profiler) {
+		profiler->count(pc, 1, 1);
+	}
 	return 0;
-};
+}
+
+void BasicCPU::setSP(uint64_t address)
+{
+	SP = address;
+}
+
+void BasicCPU::save(CheckpointWriter &checkpoint)
+{
+	CPUState state;
+	getState(state);
+	checkpoint.writeCPUState(state);
+}
+
+void BasicCPU::restore(CheckpointReader &checkpoint)
+{
+	CPUState state;
+	checkpoint.readCPUState(state);
+	setState(state);
+}
+
+void BasicCPU::getState(CPUState &state)
+{
+	memcpy(state.R, R, sizeof(state.R));
+	state.SP = SP;
+	state.PC = PC;
+	// apenas os 64 bits inferiores de cada registrador V são modelados
+	for (int i = 0; i < 32; i++) {
+		state.V[i][0] = V[i];
+		state.V[i][1] = 0;
+	}
+	state.NZCV = flags.getNZCV();
+	state.error = cpuError;
+	state.finished = processFinished;
+	state.reserved = 0;
+}
+
+void BasicCPU::setState(const CPUState &state)
+{
+	memcpy(R, state.R, sizeof(R));
+	SP = state.SP;
+	PC = state.PC;
+	for (int i = 0; i < 32; i++) {
+		V[i] = state.V[i][0];
+	}
+	flags.setNZCV(state.NZCV);
+	cpuError = (CPUerrorCode)state.error;
+	processFinished = state.finished;
+}
+
+/**
+ * Métodos herdados de MemoryListener
+ *
+ * Invalida as entradas da cache de instruções decodificadas que
+ * correspondem ao intervalo alterado.
+ */
+void BasicCPU::codeModified(uint64_t address, uint64_t size)
+{
+	// intervalo maior que a cache: invalida todas as entradas
+	if (size >= ((uint64_t)DECODE_CACHE_SIZE << 2)) {
+		for (int i = 0; i < DECODE_CACHE_SIZE; i++) {
+			decodeCache[i].valid = false;
+		}
+		return;
+	}
+
+	for (uint64_t a = address & ~(uint64_t)3; a < address + size; a += 4) {
+		DecodedInstruction *entry = &decodeCache[(a >> 2) & (DECODE_CACHE_SIZE - 1)];
+		if (entry->address == a) {
+			entry->valid = false;
+		}
+	}
+}
 
 /**
  * Busca da instrução.
  * 
  * Lê a memória de instruções no endereço PC e coloca no registrador IR.
+ * Se a instrução em PC já foi decodificada, IR é lido da cache de
+ * instruções decodificadas e a memória não é acessada; a busca ainda é
+ * informada às caches simuladas (CACHE_ENABLED).
  */
 void BasicCPU::IF()
 {
+	if (CACHE_ENABLED) {
+		memory->fetchInstructions(PC, 1);
+	}
+	DI = &decodeCache[(PC >> 2) & (DECODE_CACHE_SIZE - 1)];
+	if (DI->valid && DI->address == PC) {
+		IR = DI->IR;
+		return;
+	}
+
 	IR = memory->readInstruction32(PC);
+	DI->valid = false;
 };
 
 /**
@@ -89,10 +271,44 @@ void BasicCPU::IF()
  * Escreve A, B e ALUctrl para o estágio EXI
  * ATIVIDADE FUTURA: escreve registradores para os estágios EXF, MEM e WB.
  *
+ * A decodificação propriamente dita só acontece se a entrada DI da cache
+ * (escolhida em IF) não for válida; caso contrário apenas os operandos
+ * são lidos, por DI->readOperands.
+ *
  * Retorna 0: se executou corretamente e
  *		   1: se a instrução não estiver implementada.
  */
 int BasicCPU::ID()
+{
+	if (!DI->valid) {
+		if (decode(DI)) {
+			return 1; // instrução não implementada
+		}
+		DI->address = PC;
+		DI->IR = IR;
+		DI->valid = true;
+	}
+
+	// sinais de controle
+	fpOp = DI->fpOp;
+	ALUctrl = DI->ALUctrl;
+	FlagsCtrl = DI->FlagsCtrl;
+	MEMctrl = DI->MEMctrl;
+	WBctrl = DI->WBctrl;
+	MemtoReg = DI->MemtoReg;
+	Rd = DI->Rd;
+
+	// leitura dos registradores
+	return (this->*(DI->readOperands))(DI);
+};
+
+/**
+ * Decodifica IR em di, escolhendo o grupo da instrução.
+ *
+ * Retorna 0: se executou corretamente e
+ *		   1: se a instrução não estiver implementada.
+ */
+int BasicCPU::decode(DecodedInstruction *di)
 {
 	// TODO
 	// Acrescente os cases no switch já iniciado, para detectar o grupo
@@ -106,8 +322,9 @@ int BasicCPU::ID()
 	//		1. Para 'sub sp, sp, #32', chamar 'decodeDataProcImm()',
 	//		2. Para 'add w1, w1, w0', chamar 'decodeDataProcReg()',
 
-	// operação inteira como padrão
-	fpOp = FPOpFlag::FP_UNDEF;
+	// operação inteira, sem escrita das flags, como padrão
+	di->fpOp = FPOpFlag::FP_UNDEF;
+	di->FlagsCtrl = FlagsCtrlFlag::FLAGS_NONE;
 
 	int group = IR & 0x1E000000; // bits 28-25	
 	switch (group)
@@ -115,12 +332,12 @@ int BasicCPU::ID()
 		//100x Data Processing -- Immediate
 		case 0x10000000: // x = 0
 		case 0x12000000: // x = 1
-			return decodeDataProcImm();
+			return decodeDataProcImm(di);
 			break;
 		// x101 Data Processing -- Register on page C4-278
 		case 0x0A000000: 
 		case 0x1A000000:
-			return decodeDataProcReg();
+			return decodeDataProcReg(di);
 			break;
 		
 		// TODO
@@ -129,7 +346,7 @@ int BasicCPU::ID()
 		// x111 Data Processing -- Scalar Floating-Point and Advanced SIMD on page C4-288
 		case 0x1e000000: //x = 1
 		case 0x0e000000: //x = 0
-			return decodeDataProcFloat();
+			return decodeDataProcFloat(di);
 			break;
 		
 		// ATIVIDADE FUTURA
@@ -140,13 +357,13 @@ int BasicCPU::ID()
 		case 0x0C000000: //x = 0, x = 1;
 		case 0x18000000: //x = 1, x = 0;
 		case 0x1C000000: //x = 1, x = 1;
-			return decodeLoadStore();
+			return decodeLoadStore(di);
 			break;
 
 		// 101x Branches, Exception Generating and System instructions on page C4-237
 		case 0x14000000:
 		case 0x16000000:
-			return decodeBranches();
+			return decodeBranches(di);
 			break;
 		
 		default:
@@ -165,9 +382,8 @@ int BasicCPU::ID()
  * Retorna 0: se executou corretamente e
  *		   1: se a instrução não estiver implementada.
  */
-int BasicCPU::decodeDataProcImm() {
-	unsigned int n, d;
-	int imm;
+int BasicCPU::decodeDataProcImm(DecodedInstruction *di) {
+	unsigned int d;
 	
 	/* Add/subtract (immediate) (pp. 233-234)
 		This section describes the encoding of the Add/subtract (immediate)
@@ -182,34 +398,29 @@ int BasicCPU::decodeDataProcImm() {
 			if (IR & 0x00400000) return 1; // sh = 1 não implementado
 			
 			// ler A e B
-			n = (IR & 0x000003E0) >> 5;
-			if (n == 31) {
-				A = SP;
-			} else {
-				A = getX(n); // 64-bit variant
-			}
-			imm = (IR & 0x003FFC00) >> 10;
-			B = imm;
+			di->n = (IR & 0x000003E0) >> 5;
+			di->imm = (IR & 0x003FFC00) >> 10;
+			di->readOperands = &BasicCPU::readImmediate;
 			
 			// registrador destino
 			d = (IR & 0x0000001F);
 			if (d == 31) {
-				Rd = &SP;
+				di->Rd = &SP;
 			} else {
-				Rd = &(R[d]);
+				di->Rd = &(R[d]);
 			}
 			
 			// atribuir ALUctrl
-			ALUctrl = ALUctrlFlag::SUB;
+			di->ALUctrl = ALUctrlFlag::SUB;
 			
 			// atribuir MEMctrl
-			MEMctrl = MEMctrlFlag::MEM_NONE;
+			di->MEMctrl = MEMctrlFlag::MEM_NONE;
 			
 			// atribuir WBctrl
-			WBctrl = WBctrlFlag::RegWrite;
+			di->WBctrl = WBctrlFlag::RegWrite;
 			
 			// atribuir MemtoReg
-			MemtoReg = false;
+			di->MemtoReg = false;
 			
 			return 0;
 
@@ -219,34 +430,32 @@ int BasicCPU::decodeDataProcImm() {
 			if (IR & 0x00400000) return 1; // sh = 1 nÃ£o implementado
 
 			// ler A e B
-			n = (IR & 0x000003E0) >> 5;
-			if (n == 31) {
-				A = SP;
-			} else {
-				A = getX(n); // 64-bit variant
-			}
-			imm = (IR & 0x003FFC00) >> 10;
-			B = imm;
+			di->n = (IR & 0x000003E0) >> 5;
+			di->imm = (IR & 0x003FFC00) >> 10;
+			di->readOperands = &BasicCPU::readImmediate;
 
 			// registrador destino
 			d = (IR & 0x0000001F);
 			if (d == 31) {
-				Rd = &SP;
+				di->Rd = &SP;
 			} else {
-				Rd = &(R[d]);
+				di->Rd = &(R[d]);
 			}
 
 			// atribuir ALUctrl
-			ALUctrl = ALUctrlFlag::SUB;
+			di->ALUctrl = ALUctrlFlag::SUB;
+
+			// atribuir FlagsCtrl: NZCV da subtração de 32 bits
+			di->FlagsCtrl = FlagsCtrlFlag::FLAGS_32;
 
 			// atribuir MEMctrl
-			MEMctrl = MEMctrlFlag::MEM_NONE;
+			di->MEMctrl = MEMctrlFlag::MEM_NONE;
 
 			// atribuir WBctrl
-			WBctrl = WBctrlFlag::WB_NONE;
+			di->WBctrl = WBctrlFlag::WB_NONE;
 
 			// atribuir MemtoReg
-			MemtoReg = false;
+			di->MemtoReg = false;
 
 			return 0;
 
@@ -266,38 +475,36 @@ int BasicCPU::decodeDataProcImm() {
  * Retorna 0: se executou corretamente e
  *		   1: se a instrução não estiver implementada.
  */
-int BasicCPU::decodeBranches() {
+int BasicCPU::decodeBranches(DecodedInstruction *di) {
 	// instrução não implementada
 	int32_t imm26 = (IR & 0x03FFFFFF);
 	int32_t imm19 = (IR & 0x00FFFFE0);
-	int32_t condicao;
-	unsigned int n;
 	//switch para pegar o branch
 	switch (IR & 0xFC000000) { 
 		//000101 unconditional branch to a label on page C6-722 - verificação
 		case 0x14000000: //aplico a mascara pra ver se o que eu peguei é o que eu esperava
 			//exercício
 			// eliminação dos zeros à esquerda, casting explícito para uint64_t e retorno dos 26 bits à posição original, mas com 2 bits 0 à direita
-			B = ((int64_t)(imm26 << 6)) >> 4;
-			//declara reg a
-			A = PC; //salvo o endereço da instrução (PC) em A
+			di->imm = ((int64_t)(imm26 << 6)) >> 4;
+			//A recebe o endereço da instrução (PC), em readBranch
+			di->readOperands = &BasicCPU::readBranch;
 			//declara reg d
-			Rd = &PC; // salvo o endereço da instrução (PC) no registrador de destino
+			di->Rd = &PC; // salvo o endereço da instrução (PC) no registrador de destino
 
 			// Atribuição das Flags
 
 			// atribuir ALUctrl
 			//estagio de execução
-			ALUctrl = ALUctrlFlag::ADD;//adição
+			di->ALUctrl = ALUctrlFlag::ADD;//adição
 			// atribuir MEMctrl
 			//estágio de acesso a memoria
-			MEMctrl = MEMctrlFlag::MEM_NONE; //none pq nao acesso a memoria
+			di->MEMctrl = MEMctrlFlag::MEM_NONE; //none pq nao acesso a memoria
 			// atribuir WBctrl
 			//estagio de write back
-			WBctrl = WBctrlFlag::RegWrite; //onde eu vou escrever a informação, que é no registrador, por isso o "RegWrite"
+			di->WBctrl = WBctrlFlag::RegWrite; //onde eu vou escrever a informação, que é no registrador, por isso o "RegWrite"
 			// atribuir MemtoReg
 			//segunda pleg para o estagio WB
-			MemtoReg=false;// como a info não vem da memoria é falso
+			di->MemtoReg=false;// como a info não vem da memoria é falso
 
 			return 0;
 
@@ -306,67 +513,57 @@ int BasicCPU::decodeBranches() {
 
 	switch(IR & 0xFF000010){
 		case 0x54000000:
-			condicao = (IR & 0x0000000F);
-			if(condicao == 13){
-				if(not(Z_flag == 0 && N_flag == V_flag)){
-					A = PC;
-					B = (((int64_t)(imm19 << 8)) >> 13) << 2;
-					Rd = &PC;
+			// a condição depende das flags NZCV no momento da execução
+			// e é avaliada em readConditionalBranch
+			di->cond = (IR & 0x0000000F);
+			di->imm = (((int64_t)(imm19 << 8)) >> 13) << 2;
+			di->readOperands = &BasicCPU::readConditionalBranch;
+			di->Rd = &PC;
 
 			// atribuir ALUctrl
 			//estagio de execução
-			ALUctrl = ALUctrlFlag::ADD; //adição
+			di->ALUctrl = ALUctrlFlag::ADD; //adição
 
 			// atribuir MEMctrl
 			//estágio de acesso a memoria
-			MEMctrl = MEMctrlFlag::MEM_NONE; //none pq nao acessa a memoria
+			di->MEMctrl = MEMctrlFlag::MEM_NONE; //none pq nao acessa a memoria
 
 			// atribuir WBctrl
 			//estagio de write back
-			WBctrl = WBctrlFlag::RegWrite; //onde eu vou escrever a informação, que é no registrador, por isso o "RegWrite"
+			di->WBctrl = WBctrlFlag::RegWrite; //onde eu vou escrever a informação, que é no registrador, por isso o "RegWrite"
 
 			// atribuir MemtoReg
 			//segunda pleg para o estagio WB
-			MemtoReg=false;// como a info não vem da memoria é falso
+			di->MemtoReg=false;// como a info não vem da memoria é falso
 
 			return 0;
-			}
-		}
-
 	}		
 	switch (IR & 0xFFFFFC1F) { 
 
 		case 0xD65F0000: 
 			//C6.2.207 RET on page 1053
-			n = (((IR & 0x000003E0) << 21)>>26);
-			if(n==0){
-				A=getX(30);
-			}
-			else{
-			A = getX(n);
-			
-			B = ZR; 
+			di->n = (((IR & 0x000003E0) << 21)>>26);
+			di->readOperands = &BasicCPU::readReturn;
 
-			Rd = &PC;
+			di->Rd = &PC;
 				// salvo o endereço da instrução (PC) no registrador de destino
 				
 			// Atribuição das Flags
 
 			// atribuir ALUctrl
 			//estagio de execução
-			ALUctrl = ALUctrlFlag::ADD;//adição
+			di->ALUctrl = ALUctrlFlag::ADD;//adição
 			// atribuir MEMctrl
 			//estágio de acesso a memoria
-			MEMctrl = MEMctrlFlag::MEM_NONE; //none pq nao acesso a memoria
+			di->MEMctrl = MEMctrlFlag::MEM_NONE; //none pq nao acesso a memoria
 			// atribuir WBctrl
 			//estagio de write back
-			WBctrl = WBctrlFlag::RegWrite; //onde eu vou escrever a informação, que é no registrador, por isso o "RegWrite"
+			di->WBctrl = WBctrlFlag::RegWrite; //onde eu vou escrever a informação, que é no registrador, por isso o "RegWrite"
 			// atribuir MemtoReg
 			//segunda pleg para o estagio WB
-			MemtoReg=false;// como a info não vem da memoria é falso
+			di->MemtoReg=false;// como a info não vem da memoria é falso
 
 			return 0;
-		}		
 
 	}
 	return 1;
@@ -379,122 +576,93 @@ int BasicCPU::decodeBranches() {
  * Retorna 0: se executou corretamente e
  *		   1: se a instrução não estiver implementada.
  */
-int BasicCPU::decodeLoadStore() {
+int BasicCPU::decodeLoadStore(DecodedInstruction *di) {
 	// instrução não implementada
-	unsigned int n,d;
+	unsigned int d;
 	switch (IR & 0xFFC00000) { 
 		case 0xB9800000://LDRSW C6.2.131 Immediate (Unsigned offset) 913
-			n = (IR & 0x000003e0) >> 5;
-			if (n == 31) {
-				A = SP;
-			}
-			else {
-				A = R[n];
-			}
-			B = (IR & 0x003ffc00) >> 8; // immediate
-			Rd = &R[IR & 0x0000001F];
+			di->n = (IR & 0x000003e0) >> 5;
+			di->imm = (IR & 0x003ffc00) >> 8; // immediate
+			di->readOperands = &BasicCPU::readImmediate;
+			di->Rd = &R[IR & 0x0000001F];
 
 			// atribuir ALUctrl
-			ALUctrl = ALUctrlFlag::ADD;//adição
+			di->ALUctrl = ALUctrlFlag::ADD;//adição
 			// atribuir MEMctrl
-			MEMctrl = MEMctrlFlag::READ64;
+			di->MEMctrl = MEMctrlFlag::READ64;
 			// atribuir WBctrl
-			WBctrl = WBctrlFlag::RegWrite;
+			di->WBctrl = WBctrlFlag::RegWrite;
 			// atribuir MemtoReg
-			MemtoReg=true;
+			di->MemtoReg=true;
 
 			return 0;
 		case 0xB9400000://LDR C6.2.119 Immediate (Unsigned offset) 886 
 		//32 bits
-			n = (IR & 0x000003E0) >> 5;
-			if (n == 31) {
-				A = SP;
-			}
-			else {
-				A =R[n];
-			}
-
-			B = ((IR & 0x003FFC00) >> 10) << 2;
+			di->n = (IR & 0x000003E0) >> 5;
+			di->imm = ((IR & 0x003FFC00) >> 10) << 2;
+			di->readOperands = &BasicCPU::readImmediate;
 
 			d = IR & 0x0000001F;
 			if (d == 31) {
-				Rd = &SP;
+				di->Rd = &SP;
 			}
 			else {
-				Rd = &R[d];
+				di->Rd = &R[d];
 			}
 
 			// atribuir ALUctrl
-			ALUctrl = ALUctrlFlag::ADD;//adição
+			di->ALUctrl = ALUctrlFlag::ADD;//adição
 			// atribuir MEMctrl
-			MEMctrl = MEMctrlFlag::READ32;
+			di->MEMctrl = MEMctrlFlag::READ32;
 			// atribuir WBctrl
-			WBctrl = WBctrlFlag::RegWrite;
+			di->WBctrl = WBctrlFlag::RegWrite;
 			// atribuir MemtoReg
-			MemtoReg=true;
+			di->MemtoReg=true;
 
 			return 0;
 		case 0xB9000000://STR C6.2.257 Unsigned offset 1135
 			//size = 10, 32 bit
-			n = (IR & 0x000003E0) >> 5;
-			if (n == 31) {
-				A = SP;
-			}
-			else {
-				A = R[n];
-			}
-
-			B = ((IR & 0x003FFC00) >> 10) << 2; //offset = imm12 << scale. scale == size
+			di->n = (IR & 0x000003E0) >> 5;
+			di->imm = ((IR & 0x003FFC00) >> 10) << 2; //offset = imm12 << scale. scale == size
+			di->readOperands = &BasicCPU::readImmediate;
 
 			d = IR & 0x0000001F;
 			if (d == 31) {
-				Rd = (uint64_t*) &ZR;
+				di->Rd = (uint64_t*) &ZR;
 			}
 			else {
-				Rd = &R[d];
+				di->Rd = &R[d];
 			}
 
 			// atribuir ALUctrl
-			ALUctrl = ALUctrlFlag::ADD;//adição
+			di->ALUctrl = ALUctrlFlag::ADD;//adição
 			// atribuir MEMctrl
-			MEMctrl = MEMctrlFlag::WRITE32;
+			di->MEMctrl = MEMctrlFlag::WRITE32;
 			// atribuir WBctrl
-			WBctrl = WBctrlFlag::WB_NONE;
+			di->WBctrl = WBctrlFlag::WB_NONE;
 			// atribuir MemtoReg
-			MemtoReg=false;
+			di->MemtoReg=false;
 
 			return 0;
 	}
 	switch (IR & 0xFFE0FC00) {
 		//1111 1111 1110 0000 1111 1100 0000 0000
 		case 0xB8607800://LDR (Register) C6.2.121 891
-			n = (IR & 0x000003E0) >> 5;
-			if (n == 31) {
-				A = SP;
-			}
-			else {
-				A = R[n];
-			}
-
-			n = (IR & 0x001F0000) >> 16;
-			if (n == 31) {
-				B = SP << 2;
-			}
-			else {
-				B = R[n] << 2;
-			}
+			di->n = (IR & 0x000003E0) >> 5;
+			di->m = (IR & 0x001F0000) >> 16;
+			di->readOperands = &BasicCPU::readRegisterOffset;
 
 			d = IR & 0x0000001F;
-			Rd = &R[d];
+			di->Rd = &R[d];
 
 			// atribuir ALUctrl
-			ALUctrl = ALUctrlFlag::ADD;//adicao
+			di->ALUctrl = ALUctrlFlag::ADD;//adicao
 			// atribuir MEMctrl
-			MEMctrl = MEMctrlFlag::READ32;
+			di->MEMctrl = MEMctrlFlag::READ32;
 			// atribuir WBctrl
-			WBctrl = WBctrlFlag::RegWrite;
+			di->WBctrl = WBctrlFlag::RegWrite;
 			// atribuir MemtoReg
-			MemtoReg=true;
+			di->MemtoReg=true;
 
 			return 0;
 
@@ -509,14 +677,12 @@ int BasicCPU::decodeLoadStore() {
  * Retorna 0: se executou corretamente e
  *		   1: se a instrução não estiver implementada.
  */
-int BasicCPU::decodeDataProcReg() {
+int BasicCPU::decodeDataProcReg(DecodedInstruction *di) {
 	// TODO
 	// acrescentar switches e cases à medida em que forem sendo
 	// adicionadas implementações de instruções de processamento
 	// de dados por registrador.
 
-	unsigned int n,m,shift,imm6;
-	
 	switch (IR & 0xFF200000)
 	{
 		
@@ -526,45 +692,30 @@ int BasicCPU::decodeDataProcReg() {
 			// sf == 1 not implemented (64 bits)
 			if (IR & 0x80000000) return 1;
 		
-			n=(IR & 0x000003E0) >> 5;
-			A=getW(n);
-		
-			m=(IR & 0x001F0000) >> 16;
-			int BW=getW(m);
-		
-			shift=(IR & 0x00C00000) >> 22;
-			imm6=(IR & 0x0000FC00) >> 10;
+			di->n=(IR & 0x000003E0) >> 5;
+			di->m=(IR & 0x001F0000) >> 16;
 		
-			switch(shift){
-				case 0://LSL
-					B= BW << imm6;
-					break;
-				case 1://LSR
-					B=((unsigned long)BW) >> imm6;
-					break;
-				case 2://ASR
-					B=((signed long)BW) >> imm6;
-					break;
-				default:
-					return 1;
-			}
+			di->shift=(IR & 0x00C00000) >> 22;
+			di->imm=(IR & 0x0000FC00) >> 10;
+			if (di->shift == 3) return 1; // ROR não implementado
+			di->readOperands = &BasicCPU::readShiftedRegister;
 
 			// atribuir ALUctrl
-			ALUctrl = ALUctrlFlag::ADD;
+			di->ALUctrl = ALUctrlFlag::ADD;
 			
 			// ATIVIDADE FUTURA:
 			// implementar informações para os estágios MEM e WB.
-			MEMctrl = MEMctrlFlag::MEM_NONE;
-			WBctrl = WBctrlFlag::RegWrite;
-			MemtoReg=false;
+			di->MEMctrl = MEMctrlFlag::MEM_NONE;
+			di->WBctrl = WBctrlFlag::RegWrite;
+			di->MemtoReg=false;
 			unsigned int d = (IR & 0x0000001F);
 			if (d == 31)
 			{
-				Rd = &SP;
+				di->Rd = &SP;
 			}
 			else
 			{
-				Rd = &(R[d]);
+				di->Rd = &(R[d]);
 			}
 
 			return 0;
@@ -582,8 +733,8 @@ int BasicCPU::decodeDataProcReg() {
  * Retorna 0: se executou corretamente e
  *		   1: se a instrução não estiver implementada.
  */
-int BasicCPU::decodeDataProcFloat() {
-	unsigned int n,m,d;
+int BasicCPU::decodeDataProcFloat(DecodedInstruction *di) {
+	unsigned int d;
 
 	// TODO
 	// Acrescente os cases no switch já iniciado, para implementar a
@@ -603,30 +754,28 @@ int BasicCPU::decodeDataProcFloat() {
 			// implementado apenas ftype='00'
 			if (IR & 0x00C00000) return 1;
 
-			fpOp = FPOpFlag::FP_REG_32;
+			di->fpOp = FPOpFlag::FP_REG_32;
 			
 			// ler A e B
-			n = (IR & 0x000003E0) >> 5;
-			A = getSasInt(n); // 32-bit variant
-
-			m = (IR & 0x001F0000) >> 16;
-			B = getSasInt(m);
+			di->n = (IR & 0x000003E0) >> 5;
+			di->m = (IR & 0x001F0000) >> 16;
+			di->readOperands = &BasicCPU::readFloat32; // 32-bit variant
 
 			// registrador destino
 			d = (IR & 0x0000001F);
-			Rd = &(V[d]);
+			di->Rd = &(V[d]);
 			
 			// atribuir ALUctrl
-			ALUctrl = ALUctrlFlag::SUB;
+			di->ALUctrl = ALUctrlFlag::SUB;
 			
 			// atribuir MEMctrl
-			MEMctrl = MEMctrlFlag::MEM_NONE;
+			di->MEMctrl = MEMctrlFlag::MEM_NONE;
 			
 			// atribuir WBctrl
-			WBctrl = WBctrlFlag::RegWrite;
+			di->WBctrl = WBctrlFlag::RegWrite;
 			
 			// atribuir MemtoReg
-			MemtoReg = false;
+			di->MemtoReg = false;
 			
 			return 0;
 		case 0x1E202800:
@@ -635,30 +784,28 @@ int BasicCPU::decodeDataProcFloat() {
 			// implementado apenas ftype='00'
 			if (IR & 0x00C00000) return 1;
 
-			fpOp = FPOpFlag::FP_REG_32;
+			di->fpOp = FPOpFlag::FP_REG_32;
 
 			// ler A e B
-			n = (IR & 0x000003E0) >> 5;
-			A = getSasInt(n); // 32-bit variant
-
-			m = (IR & 0x001F0000) >> 16;
-			B = getSasInt(m);
+			di->n = (IR & 0x000003E0) >> 5;
+			di->m = (IR & 0x001F0000) >> 16;
+			di->readOperands = &BasicCPU::readFloat32; // 32-bit variant
 
 			// registrador destino
 			d = (IR & 0x0000001F);
-			Rd = &(V[d]);
+			di->Rd = &(V[d]);
 
 			// atribuir ALUctrl
-			ALUctrl = ALUctrlFlag::ADD;
+			di->ALUctrl = ALUctrlFlag::ADD;
 
 			// atribuir MEMctrl
-			MEMctrl = MEMctrlFlag::MEM_NONE;
+			di->MEMctrl = MEMctrlFlag::MEM_NONE;
 
 			// atribuir WBctrl
-			WBctrl = WBctrlFlag::RegWrite;
+			di->WBctrl = WBctrlFlag::RegWrite;
 
 			// atribuir MemtoReg
-			MemtoReg = false;
+			di->MemtoReg = false;
 
 			return 0;
 
@@ -671,6 +818,129 @@ int BasicCPU::decodeDataProcFloat() {
 	return 1;
 }
 
+/**
+ * Leitura de operandos de uma instrução pré-decodificada.
+ */
+
+/**
+ * A = Rn (ou SP, se n = 31), B = imediato.
+ */
+int BasicCPU::readImmediate(DecodedInstruction *di)
+{
+	if (di->n == 31) {
+		A = SP;
+	} else {
+		A = getX(di->n); // 64-bit variant
+	}
+	B = di->imm;
+	return 0;
+}
+
+/**
+ * A = Wn, B = Wm deslocado de imm bits conforme shift.
+ */
+int BasicCPU::readShiftedRegister(DecodedInstruction *di)
+{
+	A=getW(di->n);
+	int BW=getW(di->m);
+
+	switch(di->shift){
+		case 0://LSL
+			B= BW << di->imm;
+			break;
+		case 1://LSR
+			B=((unsigned long)BW) >> di->imm;
+			break;
+		case 2://ASR
+			B=((signed long)BW) >> di->imm;
+			break;
+		default:
+			return 1;
+	}
+	return 0;
+}
+
+/**
+ * A = Rn (ou SP), B = Rm (ou SP) << 2.
+ */
+int BasicCPU::readRegisterOffset(DecodedInstruction *di)
+{
+	if (di->n == 31) {
+		A = SP;
+	}
+	else {
+		A = R[di->n];
+	}
+
+	if (di->m == 31) {
+		B = SP << 2;
+	}
+	else {
+		B = R[di->m] << 2;
+	}
+	return 0;
+}
+
+/**
+ * A = PC, B = deslocamento.
+ */
+int BasicCPU::readBranch(DecodedInstruction *di)
+{
+	A = PC; //salvo o endereço da instrução (PC) em A
+	B = di->imm;
+	taken = true;
+	return 0;
+}
+
+/**
+ * A = PC, B = deslocamento, se a condição di->cond for verdadeira
+ * para as flags NZCV atuais, ou B = 4, se não for. As flags são
+ * avaliadas só aqui, a partir da última operação registrada em EXI.
+ */
+int BasicCPU::readConditionalBranch(DecodedInstruction *di)
+{
+	A = PC;
+	taken = flags.condition(di->cond);
+	B = taken ? di->imm : 4;
+	return 0;
+}
+
+/**
+ * A = Xn, B = 0.
+ */
+int BasicCPU::readReturn(DecodedInstruction *di)
+{
+	A = getX(di->n);
+	B = ZR;
+	taken = true;
+	return 0;
+}
+
+/**
+ * A = Sn, B = Sm (32 bits, sem conversão).
+ */
+int BasicCPU::readFloat32(DecodedInstruction *di)
+{
+	A = getSasInt(di->n);
+	B = getSasInt(di->m);
+	return 0;
+}
+
+/**
+ * B.cond é condicional, RET é retorno e B é direto (únicos desvios
+ * implementados).
+ */
+BranchPredictor::BranchType BasicCPU::branchType(DecodedInstruction *di)
+{
+	if (di->readOperands == &BasicCPU::readConditionalBranch) {
+		return BranchPredictor::BRANCH_CONDITIONAL;
+	}
+	if (di->readOperands == &BasicCPU::readReturn) {
+		return BranchPredictor::BRANCH_RETURN;
+	}
+	return BranchPredictor::BRANCH_DIRECT;
+}
+
 
 /**
  * Execução lógico aritmética inteira.
@@ -696,17 +966,30 @@ int BasicCPU::EXI()
 	{
 		case ALUctrlFlag::SUB:
 			ALUout = A - B;
-			return 0;
+			break;
 		case ALUctrlFlag::ADD:
 			ALUout = A + B;
-			return 0;
+			break;
 		default:
 			// Controle não implementado
 			return 1;
 	}
-	
-	// Controle não implementado
-	return 1;
+
+	// flags NZCV: só a operação é registrada (ver Flags)
+	if (FlagsCtrl == FlagsCtrlFlag::FLAGS_64) {
+		if (ALUctrl == ALUctrlFlag::SUB) {
+			flags.setSub<uint64_t>(A, B, ALUout);
+		} else {
+			flags.setAdd<uint64_t>(A, B, ALUout);
+		}
+	} else if (FlagsCtrl == FlagsCtrlFlag::FLAGS_32) {
+		if (ALUctrl == ALUctrlFlag::SUB) {
+			flags.setSub<uint32_t>(A, B, ALUout);
+		} else {
+			flags.setAdd<uint32_t>(A, B, ALUout);
+		}
+	}
+	return 0;
 };
 
 		
@@ -44,6 +44,7 @@
 #pragma once
 
 #include "CPU.h"
+#include "Flags.h"
 
 // Códigos de controle
 enum FPOpFlag {FP_UNDEF,FP_REG_128,FP_REG_64,FP_REG_32,FP_REG_16,FP_REG_8,FP_VEC_128,FP_VEC_64};
@@ -51,9 +52,52 @@ enum ALUctrlFlag {ALU_UNDEF, ALU_NONE, ADD, SUB, DIV, MUL};
 enum MEMctrlFlag {MEM_UNDEF, MEM_NONE, READ32, WRITE32, READ64, WRITE64};
 enum WBctrlFlag {WB_UNDEF, WB_NONE, RegWrite};
 
-// Flags aritméticas
+// Flags aritméticas: largura da operação que escreve NZCV em EXI
+enum FlagsCtrlFlag {FLAGS_NONE, FLAGS_32, FLAGS_64};
 
-class BasicCPU: public CPU
+class BasicCPU;
+
+/**
+ * Instrução pré-decodificada.
+ *
+ * Guarda tudo o que ID() extrai de IR e que não depende do valor dos
+ * registradores, de forma que cada instrução estática seja decodificada
+ * uma única vez (ver decodeCache em BasicCPU). O que depende dos
+ * registradores (A e B) é lido a cada execução pela rotina readOperands.
+ */
+struct DecodedInstruction
+{
+	// endereço da instrução (chave da cache) e conteúdo lido em IF
+	uint64_t address;
+	uint32_t IR;
+	bool valid;
+
+	// índices dos registradores fonte Rn e Rm
+	unsigned int n, m;
+
+	// registrador destino
+	uint64_t *Rd;
+
+	// valor imediato, já estendido e deslocado
+	int64_t imm;
+
+	// tipo de deslocamento (ADD shifted register) ou condição (B.cond)
+	unsigned int shift;
+	unsigned int cond;
+
+	// sinais de controle para os estágios seguintes
+	FPOpFlag fpOp;
+	ALUctrlFlag ALUctrl;
+	FlagsCtrlFlag FlagsCtrl;
+	MEMctrlFlag MEMctrl;
+	WBctrlFlag WBctrl;
+	bool MemtoReg;
+
+	// rotina que lê A e B do banco de registradores
+	int (BasicCPU::*readOperands)(DecodedInstruction *di);
+};
+
+class BasicCPU: public CPU, public MemoryListener
 {
 	protected:
 	
@@ -184,17 +228,37 @@ class BasicCPU: public CPU
 		// ALUout, 64 bits, saída do estágio de execução de operação
 		// inteira (EXI)
 		uint64_t ALUout;
+
+		// taken, bool, saída do estágio de decodificação de desvios
+		// (ID), informa se o desvio é tomado. Um B.cond tomado para
+		// PC + 4 também escreve PC + 4, por isso o resultado não pode
+		// ser deduzido de ALUout.
+		bool taken = false;
 		
+		// FlagsCtrl, enum, saída do estágio de decodificação da
+		// instrução (ID), informa se EXI escreve as flags NZCV a partir
+		// de ALUctrl, A, B e ALUout, e com que largura (32 ou 64 bits).
+		FlagsCtrlFlag FlagsCtrl = FlagsCtrlFlag::FLAGS_NONE;
+
 		// flags NZCV, saída do estágio de execução de algumas operações
 		// inteiras. Indicam que o resultado é negativo (N) ou zero (Z)
 		// e indica se a operação resultou em um carry (C) ou
-		// overflow (V). 
-		bool N_flag, Z_flag, C_flag, V_flag;
+		// overflow (V). Guardam apenas a última operação, e N, Z, C e
+		// V só são calculadas quando lidas (ver Flags).
+		Flags flags;
 
 		// MDR, 64 bits, saída do estágio de acesso à memória de
 		// dados (MEM).
 		uint64_t MDR;
 
+		// Cache de instruções decodificadas
+		//		Mapeamento direto indexado por PC, com DECODE_CACHE_SIZE
+		//		entradas. IF() aponta DI para a entrada de PC e, se ela é
+		//		válida, dispensa a leitura da memória e a decodificação
+		//		em ID().
+		DecodedInstruction *decodeCache;
+		DecodedInstruction *DI;
+
 		/**
 		 * Caminho de dados (Datapath)
 		 *
@@ -207,6 +271,8 @@ class BasicCPU: public CPU
 		 * Busca da instrução.
 		 * 
 		 * Lê a memória de instruções no endereço PC e coloca no registrador IR.
+		 * Se a instrução em PC já foi decodificada, IR é lido da cache de
+		 * instruções decodificadas e a memória não é acessada.
 		 */
 		void IF();
 
@@ -220,6 +286,9 @@ class BasicCPU: public CPU
 		 * Escreve A, B e ALUctrl para o estágio EXI
 		 * ATIVIDADE FUTURA: escreve registradores para os estágios EXF, MEM e WB.
 		 *
+		 * A decodificação propriamente dita só acontece se a entrada DI da
+		 * cache (escolhida em IF) não for válida.
+		 *
 		 * Retorna 0: se executou corretamente e
 		 *		   1: se a instrução não estiver implementada.
 		 */
@@ -269,13 +338,50 @@ class BasicCPU: public CPU
 		
 	public:
 		BasicCPU(Memory *memory);
+		~BasicCPU();
 		
 		/**
 		 * Métodos herdados de CPU
 		 */
 		int run(uint64_t startAddress);
+		void start(uint64_t startAddress);
+		RunResult runFor(uint64_t maxInstructions);
+		RunResult runUntil(uint64_t address);
+		void setSP(uint64_t address);
+		void save(CheckpointWriter &checkpoint);
+		void restore(CheckpointReader &checkpoint);
+		void getState(CPUState &state);
+		void setState(const CPUState &state);
+
+		/**
+		 * Métodos herdados de MemoryListener
+		 */
+		void codeModified(uint64_t address, uint64_t size);
 		
 	private:
+		/**
+		 * Ciclo da máquina, a partir de PC, até o fim do programa, um
+		 * erro, maxInstructions instruções ou o endereço stopAddress.
+		 */
+		RunResult execute(uint64_t maxInstructions, uint64_t stopAddress);
+
+		/**
+		 * Executa a instrução em PC, passando por todos os estágios, e
+		 * avança PC para a instrução seguinte se ela não for um desvio.
+		 *
+		 * Retorna 0: se executou corretamente e
+		 *		   1: se algum estágio não estiver implementado.
+		 */
+		int step();
+
+		/**
+		 * Decodifica IR em di, escolhendo o grupo da instrução.
+		 *
+		 * Retorna 0: se executou corretamente e
+		 *		   1: se a instrução não estiver implementada.
+		 */
+		int decode(DecodedInstruction *di);
+
 		/**
 		 * Decodifica instruções do grupo
 		 * 		100x Data Processing -- Immediate
@@ -284,10 +390,13 @@ class BasicCPU: public CPU
 		 * This section describes the encoding of the Data Processing -- Immediate group.
 		 * The encodings in this section are decoded from A64 instruction set encoding.
 		 *
+		 * Os métodos decodeGROUP() escrevem em di apenas o que não depende
+		 * do valor dos registradores.
+		 *
 		 * Retorna 0: se executou corretamente e
 		 *		   1: se a instrução não estiver implementada.
 		 */
-		int decodeDataProcImm();
+		int decodeDataProcImm(DecodedInstruction *di);
 
 		/**
 		 * ATIVIDADE FUTURA: Decodifica instruções do grupo
@@ -296,7 +405,7 @@ class BasicCPU: public CPU
 		 * Retorna 0: se executou corretamente e
 		 *		   1: se a instrução não estiver implementada.
 		 */
-		int decodeBranches();
+		int decodeBranches(DecodedInstruction *di);
 
 		/**
 		 * ATIVIDADE FUTURA: Decodifica instruções do grupo
@@ -305,7 +414,7 @@ class BasicCPU: public CPU
 		 * Retorna 0: se executou corretamente e
 		 *		   1: se a instrução não estiver implementada.
 		 */
-		int decodeLoadStore();
+		int decodeLoadStore(DecodedInstruction *di);
 
 		/**
 		 * Decodifica instruções do grupo
@@ -314,7 +423,7 @@ class BasicCPU: public CPU
 		 * Retorna 0: se executou corretamente e
 		 *		   1: se a instrução não estiver implementada.
 		 */
-		int decodeDataProcReg();
+		int decodeDataProcReg(DecodedInstruction *di);
 
 		/**
 		 * ATIVIDADE FUTURA: Decodifica instruções do grupo
@@ -324,6 +433,45 @@ class BasicCPU: public CPU
 		 * Retorna 0: se executou corretamente e
 		 *		   1: se a instrução não estiver implementada.
 		 */
-		int decodeDataProcFloat();
+		int decodeDataProcFloat(DecodedInstruction *di);
+
+	protected:
+		/**
+		 * Leitura de operandos de uma instrução pré-decodificada.
+		 *
+		 * Cada instrução decodificada aponta (readOperands) para um dos
+		 * métodos abaixo, que escrevem A e B a partir do banco de
+		 * registradores.
+		 *
+		 * Retorna 0: se executou corretamente e
+		 *		   1: se a instrução não puder ser executada.
+		 */
+
+		// A = Rn (ou SP), B = imediato
+		int readImmediate(DecodedInstruction *di);
+
+		// A = Wn, B = Wm deslocado
+		int readShiftedRegister(DecodedInstruction *di);
+
+		// A = Rn (ou SP), B = Rm << 2
+		int readRegisterOffset(DecodedInstruction *di);
+
+		// A = PC, B = deslocamento
+		int readBranch(DecodedInstruction *di);
+
+		// A = PC, B = deslocamento, se a condição for verdadeira, ou
+		// 4, se não for
+		int readConditionalBranch(DecodedInstruction *di);
+
+		// A = Xn, B = 0
+		int readReturn(DecodedInstruction *di);
+
+		// A = Sn, B = Sm
+		int readFloat32(DecodedInstruction *di);
+
+		/**
+		 * Tipo, para os modelos de previsão, do desvio decodificado em di.
+		 */
+		BranchPredictor::BranchType branchType(DecodedInstruction *di);
 	
 };
@@ -43,12 +43,17 @@ BasicCPUTest::BasicCPUTest(Memory *memory)
 {
 }
 	
+void BasicCPUTest::setPC(uint64_t address) {
+	PC = address;
+}
+
 void BasicCPUTest::setSP(uint64_t address) {
 	SP = address;
 }
 
 void BasicCPUTest::resetFlags() {
 	ALUctrl = ALUctrlFlag::ALU_UNDEF;
+	FlagsCtrl = FlagsCtrlFlag::FLAGS_NONE;
 	fpOp = FPOpFlag::FP_UNDEF;
 	MEMctrl = MEMctrlFlag::MEM_UNDEF;
 	WBctrl = WBctrlFlag::WB_UNDEF;
@@ -50,6 +50,7 @@ class BasicCPUTest: public BasicCPU
 		BasicCPUTest(Memory *memory);
 		
 		// registers
+		void setPC(uint64_t address);
 		void setSP(uint64_t address);
 		void setW(int n, uint32_t value);
 		void setX(int n, uint64_t value);
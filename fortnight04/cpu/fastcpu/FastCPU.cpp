@@ -0,0 +1,1611 @@
+/* ----------------------------------------------------------------------------
+
+    (EN) FastCPU - a CPU for production runs, with the following characteristics:
+		- AArch64 ISA (limited), from ARMv8
+		- direct-threaded interpreter over predecoded instructions
+		
+	armethyst - A simple ARM Simulator written in C++ for Computer Architecture
+    teaching purposes. Free software licensed under the MIT License (see license
+    below).
+
+    (PT) FastCPU - uma CPU para execuções longas, com as seguintes características:
+		- AArch64 ISA (limitado), do ARMv8
+		- interpretador com código encadeado (direct threading) sobre
+		  instruções pré-decodificadas
+    
+	armethyst - Um simulador ARM simples escrito em C++ para o ensino de
+    Arquitetura de Computadores. Software livre licenciado pela MIT License
+    (veja a licença, em inglês, abaixo).
+
+    (EN) MIT LICENSE:
+
+    Copyright 2020 André Vital Saúde
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+   ----------------------------------------------------------------------------
+*/
+
+#include "config.h"
+#include "FastCPU.h"
+#include "Checkpoint.h"
+#include "Simd.h"
+
+#include <iostream>
+#include <iomanip>
+#include <cstring>
+#include <algorithm>
+
+using namespace std;
+
+/**
+ * Acesso aos registradores ponto flutuante sem conversão.
+ */
+static inline float asFloat(uint64_t value)
+{
+	float f;
+	uint32_t low = (uint32_t)value;
+	memcpy(&f, &low, sizeof(f));
+	return f;
+}
+
+static inline uint64_t fromFloat(float value)
+{
+	uint32_t low;
+	memcpy(&low, &value, sizeof(low));
+	return low;
+}
+
+static inline double asDouble(uint64_t value)
+{
+	double d;
+	memcpy(&d, &value, sizeof(d));
+	return d;
+}
+
+static inline uint64_t fromDouble(double value)
+{
+	uint64_t u;
+	memcpy(&u, &value, sizeof(u));
+	return u;
+}
+
+/**
+ * Índice em X do registrador r quando o registrador 31 é SP.
+ */
+static inline uint8_t regSP(uint32_t r)
+{
+	return r;
+}
+
+/**
+ * Índice em X do registrador r, quando lido, se o registrador 31 é ZR.
+ */
+static inline uint8_t regZR(uint32_t r)
+{
+	return r == 31 ? 32 : r;
+}
+
+/**
+ * Índice em X do registrador r, quando escrito, se o registrador 31 é ZR.
+ */
+static inline uint8_t regZRdest(uint32_t r)
+{
+	return r == 31 ? 33 : r;
+}
+
+/**
+ * Estende o sinal dos 'bits' bits menos significativos de value.
+ */
+static inline int64_t signExtend(uint64_t value, int bits)
+{
+	return ((int64_t)(value << (64 - bits))) >> (64 - bits);
+}
+
+/**
+ * Desloca o registrador Rm conforme o campo shift de
+ * 'Add/subtract (shifted register)'.
+ */
+static inline uint64_t shiftX(uint64_t value, uint8_t shift, uint8_t amount)
+{
+	switch (shift) {
+		case 0: return value << amount;						// LSL
+		case 1: return value >> amount;						// LSR
+		default: return (uint64_t)((int64_t)value >> amount);	// ASR
+	}
+}
+
+static inline uint32_t shiftW(uint32_t value, uint8_t shift, uint8_t amount)
+{
+	switch (shift) {
+		case 0: return value << amount;						// LSL
+		case 1: return value >> amount;						// LSR
+		default: return (uint32_t)((int32_t)value >> amount);	// ASR
+	}
+}
+
+/**
+ * Estende o registrador Rm conforme o campo option de
+ * 'Load/store register (register offset)'.
+ */
+static inline uint64_t extendReg(uint64_t value, uint8_t option)
+{
+	switch (option) {
+		case 2: return (uint32_t)value;				// UXTW
+		case 6: return (int64_t)(int32_t)value;		// SXTW
+		default: return value;						// LSL (UXTX), SXTX
+	}
+}
+
+/**
+ * VFPExpandImm: expande o imediato de 8 bits de FMOV (immediate).
+ */
+static inline uint64_t expandFPImm(uint32_t imm8, bool isDouble)
+{
+	uint64_t sign = (imm8 >> 7) & 1;
+	uint64_t b6 = (imm8 >> 6) & 1;
+	uint64_t low = imm8 & 0x3F;
+	if (isDouble) {
+		// sign : NOT(b6) : b6 x 8 : imm8<5:0> : Zeros(48)
+		uint64_t exp = ((b6 ^ 1) << 10) | (b6 ? 0x3FC : 0) | (low >> 4);
+		return (sign << 63) | (exp << 52) | ((low & 0xF) << 48);
+	}
+	// sign : NOT(b6) : b6 x 5 : imm8<5:0> : Zeros(19)
+	uint64_t exp = ((b6 ^ 1) << 7) | (b6 ? 0x7C : 0) | (low >> 4);
+	return (sign << 31) | (exp << 23) | ((low & 0xF) << 19);
+}
+
+FastCPU::FastCPU(Memory *memory)
+{
+	this->memory = memory;
+	memset(X, 0, sizeof(X));
+	memset(V, 0, sizeof(V));
+	PC = 0;
+	blockStats = BlockStats();
+	flushTLB();
+	memoryEvents = false;
+	pagesChanged = false;
+	memory->addListener(this);
+}
+
+FastCPU::~FastCPU()
+{
+	memory->removeListener(this);
+	for (auto &entry : blocks) {
+		delete entry.second;
+	}
+	for (Block *block : retiredBlocks) {
+		delete block;
+	}
+}
+
+void FastCPU::setSP(uint64_t address)
+{
+	X[31] = address;
+}
+
+void FastCPU::save(CheckpointWriter &checkpoint)
+{
+	CPUState state;
+	getState(state);
+	checkpoint.writeCPUState(state);
+}
+
+void FastCPU::restore(CheckpointReader &checkpoint)
+{
+	CPUState state;
+	checkpoint.readCPUState(state);
+	setState(state);
+}
+
+void FastCPU::getState(CPUState &state)
+{
+	memcpy(state.R, X, sizeof(state.R));
+	state.SP = X[31];
+	state.PC = PC;
+	memcpy(state.V, V, sizeof(state.V));
+	state.NZCV = flags.getNZCV();
+	state.error = cpuError;
+	state.finished = processFinished;
+	state.reserved = 0;
+}
+
+void FastCPU::setState(const CPUState &state)
+{
+	memcpy(X, state.R, sizeof(state.R));
+	X[31] = state.SP;
+	PC = state.PC;
+	memcpy(V, state.V, sizeof(V));
+	flags.setNZCV(state.NZCV);
+	cpuError = (CPUerrorCode)state.error;
+	processFinished = state.finished;
+}
+
+/**
+ * Métodos herdados de MemoryListener
+ *
+ * Os avisos são aplicados na entrada do próximo bloco: um bloco com
+ * instruções alteradas durante sua própria execução termina de executar
+ * com as instruções antigas.
+ */
+void FastCPU::codeModified(uint64_t address, uint64_t size)
+{
+	lock_guard<mutex> lock(eventLock);
+	modifiedRanges.push_back(make_pair(address, size));
+	memoryEvents = true;
+}
+
+/**
+ * A memória avisa quando páginas entregues deixam de valer (checkpoint,
+ * fork, mapFile, primeira instrução lida da página): as seguintes serão
+ * consultadas novamente.
+ */
+void FastCPU::hostPagesChanged()
+{
+	lock_guard<mutex> lock(eventLock);
+	pagesChanged = true;
+	memoryEvents = true;
+}
+
+void FastCPU::applyMemoryEvents()
+{
+	vector<pair<uint64_t, uint64_t>> ranges;
+	bool flush;
+	{
+		lock_guard<mutex> lock(eventLock);
+		ranges.swap(modifiedRanges);
+		flush = pagesChanged;
+		pagesChanged = false;
+		memoryEvents = false;
+	}
+	if (flush) {
+		flushTLB();
+	}
+	for (auto &range : ranges) {
+		invalidateBlocks(range.first, range.second);
+	}
+}
+
+/**
+ * Os blocos que contêm instruções alteradas saem da cache e todo
+ * encadeamento é desfeito. Um bloco invalidado durante sua própria
+ * execução só é liberado no próximo run().
+ */
+void FastCPU::invalidateBlocks(uint64_t address, uint64_t size)
+{
+	uint64_t end = address + size;
+	bool removed = false;
+	for (auto entry = blocks.begin(); entry != blocks.end(); ) {
+		Block *block = entry->second;
+		if (end <= block->scanStart || address >= block->scanEnd) {
+			entry++;
+			continue;
+		}
+		retiredBlocks.push_back(block);
+		entry = blocks.erase(entry);
+		removed = true;
+	}
+
+	if (removed) {
+		unchainBlocks();
+	}
+}
+
+void FastCPU::unchainBlocks()
+{
+	for (auto &entry : blocks) {
+		entry.second->taken = nullptr;
+		entry.second->fallthrough = nullptr;
+	}
+	for (Block *block : retiredBlocks) {
+		block->taken = nullptr;
+		block->fallthrough = nullptr;
+	}
+}
+
+void FastCPU::flushTLB()
+{
+	for (TLBEntry &entry : tlb) {
+		entry = TLBEntry{TLB_INVALID, TLB_INVALID, nullptr, 0};
+	}
+}
+
+/**
+ * TLB de software
+ *
+ * Uma página entregue para escrita também pode ser lida diretamente; a
+ * consulta para leitura de outra página descarta a permissão de escrita
+ * da entrada.
+ */
+uint64_t FastCPU::readMiss(Memory *memory, uint64_t address, unsigned size)
+{
+	TLBEntry &entry = tlb[tlbIndex(address)];
+	uint64_t page = address & ~(HOST_PAGE_SIZE - 1);
+	if ((entry.readTag & ~TLB_NO_HOST) != page) {
+		uint8_t *host = memory->getHostPage(address, false);
+		entry = TLBEntry{host ? page : page | TLB_NO_HOST, TLB_INVALID, host, 0};
+	}
+
+	if (entry.readTag == page && !(address & (size - 1))) {
+		uint8_t *host = entry.host + (address & (HOST_PAGE_SIZE - 1));
+		if (size == 4) {
+			uint32_t value;
+			memcpy(&value, host, sizeof(value));
+			return value;
+		}
+		uint64_t value;
+		memcpy(&value, host, sizeof(value));
+		return value;
+	}
+	return size == 4 ? memory->readData32(address) : memory->readData64(address);
+}
+
+void FastCPU::writeMiss(Memory *memory, uint64_t address, unsigned size, uint64_t value)
+{
+	TLBEntry &entry = tlb[tlbIndex(address)];
+	uint64_t page = address & ~(HOST_PAGE_SIZE - 1);
+	if ((entry.writeTag & ~TLB_NO_HOST) != page) {
+		uint8_t *host = memory->getHostPage(address, true);
+		if (host) {
+			entry = TLBEntry{page, page, host, 0};
+		} else {
+			if ((entry.readTag & ~TLB_NO_HOST) != page) {
+				entry.readTag = TLB_INVALID;
+			}
+			entry.writeTag = page | TLB_NO_HOST;
+		}
+	}
+
+	if (entry.writeTag == page && !(address & (size - 1))) {
+		uint8_t *host = entry.host + (address & (HOST_PAGE_SIZE - 1));
+		if (size == 4) {
+			uint32_t word = (uint32_t)value;
+			memcpy(host, &word, sizeof(word));
+		} else {
+			memcpy(host, &value, sizeof(value));
+		}
+		return;
+	}
+	if (size == 4) {
+		memory->writeData32(address, (uint32_t)value);
+	} else {
+		memory->writeData64(address, value);
+	}
+}
+
+FastCPU::Block *FastCPU::getBlock(uint64_t address)
+{
+	auto found = blocks.find(address);
+	if (found != blocks.end()) {
+		return found->second;
+	}
+
+	Block *block = translate(address);
+	blocks[address] = block;
+	blockStats.translated++;
+	return block;
+}
+
+/**
+ * Tradução
+ *
+ * Decodifica instruções a partir de address até o primeiro desvio (ou
+ * instrução não implementada, que encerra a execução). Blocos longos
+ * são cortados em BLOCK_MAX_SIZE instruções.
+ */
+FastCPU::Block *FastCPU::translate(uint64_t address, uint64_t maxSize)
+{
+	Block *block = new Block;
+	block->address = address;
+	block->taken = nullptr;
+	block->fallthrough = nullptr;
+	block->execCount = 0;
+	block->native = nullptr;
+
+	Instruction inst;
+	inst.liveFlags = 0;
+	Op op = OP_END_BLOCK;
+	for (uint64_t i = 0; i < maxSize; i++) {
+		op = decode(memory->readInstruction32(address + (i << 2)), &inst);
+		inst.handler = handlers[op];
+		inst.op = op;
+		block->code.push_back(inst);
+		if (op == OP_UNDEFINED || (op >= OP_B && op <= OP_RET)) {
+			break;
+		}
+	}
+
+	block->size = block->code.size();
+	block->scanStart = address;
+	block->scanEnd = address + (block->size << 2);
+	if (op != OP_UNDEFINED && !(op >= OP_B && op <= OP_RET)) {
+		inst.handler = handlers[OP_END_BLOCK];
+		inst.op = OP_END_BLOCK;
+		block->code.push_back(inst);
+	}
+	if (MACRO_FUSION) {
+		fuse(block);
+	}
+	return block;
+}
+
+/**
+ * Fusão de pares
+ *
+ * O tratador do par executa as duas instruções e segue para a que vem
+ * depois delas, economizando um despacho. A segunda instrução mantém seu
+ * tratador, usado quando a execução começa nela (código nativo que para
+ * no meio do par, ver JITCPU), e op continua a ser a operação original
+ * de cada instrução, de modo que a JITCPU e os modelos de previsão de
+ * desvios não veem a fusão.
+ *
+ * Pares:
+ *	- ADRP Xd, página + ADD Xd, Xd, #imm (endereço de um símbolo);
+ *	- LDR Rd, [...] + ADD Rd, Rd, #imm (incremento de variável na
+ *	  memória);
+ *	- SUBS (ou CMP) + B.cond: a condição é calculada dos operandos, e as
+ *	  flags só são escritas nas saídas do desvio em que flagsLive
+ *	  indica que podem ser lidas, ou se a execução pode parar antes de
+ *	  elas serem reescritas (ver interpret).
+ */
+void FastCPU::fuse(Block *block)
+{
+	for (uint64_t i = 0; i + 1 < block->size; i++) {
+		Instruction &first = block->code[i];
+		Instruction &second = block->code[i + 1];
+		Op fused = OP_UNDEFINED;
+
+		switch (first.op) {
+			case OP_ADRP:
+				if (second.op == OP_ADD_X_IMM && second.n == first.d && second.d == first.d) {
+					fused = OP_ADRP_ADD;
+				}
+				break;
+			case OP_LDR_W:
+			case OP_LDR_X:
+				if (second.op == (first.op == OP_LDR_W ? OP_ADD_W_IMM : OP_ADD_X_IMM)
+						&& second.n == first.d && second.d == first.d) {
+					fused = first.op == OP_LDR_W ? OP_LDR_W_ADD : OP_LDR_X_ADD;
+				}
+				break;
+			case OP_SUBS_X_IMM:
+			case OP_SUBS_W_IMM:
+			case OP_SUBS_X_REG:
+			case OP_SUBS_W_REG:
+				if (second.op == OP_BCOND) {
+					static const Op bcond[] = {
+						OP_SUBS_X_IMM_BCOND, OP_SUBS_W_IMM_BCOND,
+						OP_SUBS_X_REG_BCOND, OP_SUBS_W_REG_BCOND,
+					};
+					fused = bcond[(first.op >= OP_SUBS_X_REG) * 2 + (first.op == OP_SUBS_W_IMM
+											|| first.op == OP_SUBS_W_REG)];
+					uint64_t pc = block->address + ((i + 1) << 2);
+					second.liveFlags = (flagsLive(pc + second.imm, 1, block) ? LIVE_TAKEN : 0)
+										| (flagsLive(pc + 4, 1, block) ? LIVE_NOT_TAKEN : 0);
+				}
+				break;
+			default:
+				break;
+		}
+
+		if (fused != OP_UNDEFINED) {
+			first.handler = handlers[fused];
+			i++;
+		}
+	}
+}
+
+bool FastCPU::flagsLive(uint64_t address, int depth, Block *block)
+{
+	Instruction inst;
+	for (int i = 0; i < FUSION_SCAN; i++, address += 4) {
+		block->scanStart = min(block->scanStart, address);
+		block->scanEnd = max(block->scanEnd, address + 4);
+		switch (decode(memory->readInstruction32(address), &inst)) {
+			case OP_ADDS_X_IMM: case OP_ADDS_W_IMM:
+			case OP_SUBS_X_IMM: case OP_SUBS_W_IMM:
+			case OP_ADDS_X_REG: case OP_ADDS_W_REG:
+			case OP_SUBS_X_REG: case OP_SUBS_W_REG:
+				// reescritas antes de serem lidas
+				return false;
+			case OP_B:
+				address += inst.imm - 4;
+				break;
+			case OP_CBZ_X: case OP_CBZ_W:
+			case OP_CBNZ_X: case OP_CBNZ_W:
+				return depth == 0 || flagsLive(address + inst.imm, depth - 1, block)
+						|| flagsLive(address + 4, depth - 1, block);
+			case OP_BCOND: case OP_BL: case OP_BLR: case OP_BR: case OP_RET:
+			case OP_UNDEFINED:
+				return true;
+			default:
+				break;
+		}
+	}
+	return true;
+}
+
+void FastCPU::printBlockStats()
+{
+	uint64_t hits = blockStats.entries - blockStats.translated;
+	uint64_t fused = 0;
+	for (auto &entry : blocks) {
+		for (Instruction &inst : entry.second->code) {
+			for (int op = OP_ADRP_ADD; op < OP_COUNT; op++) {
+				fused += inst.handler == handlers[op];
+			}
+		}
+	}
+	cout << "Block cache: " << blocks.size() << " blocks, "
+			<< blockStats.entries << " block executions ("
+			<< blockStats.chained << " chained), "
+			<< fused << " fused pairs, hit rate ";
+	if (blockStats.entries) {
+		streamsize precision = cout.precision();
+		cout << fixed << setprecision(2)
+				<< 100.0 * hits / blockStats.entries << "%" << endl;
+		cout.unsetf(ios::floatfield);
+		cout.precision(precision);
+	} else {
+		cout << "-" << endl;
+	}
+}
+
+/**
+ * Métodos herdados de CPU
+ */
+int FastCPU::run(uint64_t startAddress)
+{
+	return execute(memory, startAddress);
+}
+
+void FastCPU::start(uint64_t startAddress)
+{
+	PC = startAddress;
+	X[30] = EXITADDRESS;
+	cpuError = CPUerrorCode::NONE;
+	processFinished = false;
+	blockStats = BlockStats();
+}
+
+CPU::RunResult FastCPU::runFor(uint64_t maxInstructions)
+{
+	return interpret(memory, maxInstructions, NO_ADDRESS);
+}
+
+CPU::RunResult FastCPU::runUntil(uint64_t address)
+{
+	// endereços não alinhados nunca são alcançados
+	if (address & 3) {
+		address = NO_ADDRESS;
+	}
+	return interpret(memory, NO_LIMIT, address);
+}
+
+template <class MemoryType>
+int FastCPU::execute(MemoryType *memory, uint64_t startAddress)
+{
+	start(startAddress);
+	interpret(memory, NO_LIMIT, NO_ADDRESS);
+	printBlockStats();
+
+	if (cpuError) {
+		return 1;
+	}
+
+	return 0;
+}
+
+/**
+ * Laço do interpretador. Executa a partir de PC; ip aponta a instrução corrente, dentro de block;
+ * cada tratador executa sua instrução e salta diretamente (goto *) para o
+ * tratador da instrução seguinte. Na saída de um bloco, o sucessor já
+ * encadeado é executado diretamente; senão é buscado na cache (ou
+ * traduzido) e encadeado ao bloco que saiu.
+ *
+ * Blocos com código nativo executam nele até uma saída: desvios tomados
+ * ou não seguem o encadeamento normal, e as demais saídas continuam
+ * no interpretador, na instrução em que o código nativo parou.
+ *
+ * As instruções executadas são contadas por bloco, na entrada. Um bloco
+ * que ultrapassaria maxInstructions, ou que contém stopAddress, é
+ * substituído por uma cópia truncada, descartada no próximo
+ * interpret(); assim o laço só verifica os limites na entrada dos
+ * blocos, e não a cada instrução. Se a execução pode parar até
+ * 2 * FUSION_SCAN instruções depois do bloco, ou em um endereço
+ * examinado por flagsLive, o B.cond fundido escreve as flags nas duas
+ * saídas: elas ainda não foram reescritas quando getState, save ou
+ * fork as leem.
+ *
+ * O parâmetro memory esconde o atributo de mesmo nome: os tratadores
+ * acessam a memória pelo tipo MemoryType. Cada instanciação tem sua
+ * própria tabela de rótulos; se a CPU passa a executar com outra, os
+ * blocos traduzidos com a anterior são descartados.
+ */
+template <class MemoryType>
+CPU::RunResult FastCPU::interpret(MemoryType *memory, uint64_t maxInstructions,
+									uint64_t stopAddress)
+{
+	static const void * const labels[] = {
+		&&op_end_block, &&op_undefined, &&op_nop,
+		&&op_add_x_imm, &&op_add_w_imm,
+		&&op_adds_x_imm, &&op_adds_w_imm,
+		&&op_subs_x_imm, &&op_subs_w_imm,
+		&&op_adr, &&op_adrp,
+		&&op_add_x_reg, &&op_add_w_reg,
+		&&op_sub_x_reg, &&op_sub_w_reg,
+		&&op_adds_x_reg, &&op_adds_w_reg,
+		&&op_subs_x_reg, &&op_subs_w_reg,
+		&&op_ldr_w, &&op_ldr_x, &&op_ldrsw, &&op_str_w, &&op_str_x,
+		&&op_ldr_s, &&op_ldr_d, &&op_str_s, &&op_str_d, &&op_ldr_q, &&op_str_q,
+		&&op_ldr_w_reg, &&op_ldr_x_reg, &&op_ldrsw_reg, &&op_str_w_reg, &&op_str_x_reg,
+		&&op_ldr_s_reg, &&op_ldr_d_reg, &&op_str_s_reg, &&op_str_d_reg,
+		&&op_ldr_q_reg, &&op_str_q_reg,
+		&&op_b, &&op_bl, &&op_bcond, &&op_cbz_x, &&op_cbz_w, &&op_cbnz_x, &&op_cbnz_w,
+		&&op_br, &&op_blr, &&op_ret,
+		&&op_fadd_s, &&op_fsub_s, &&op_fmul_s, &&op_fdiv_s,
+		&&op_fadd_d, &&op_fsub_d, &&op_fmul_d, &&op_fdiv_d,
+		&&op_fmov_s, &&op_fneg_s, &&op_fabs_s,
+		&&op_fmov_d, &&op_fneg_d, &&op_fabs_d,
+		&&op_fmov_imm,
+		&&op_add_16b, &&op_add_8h, &&op_add_4s, &&op_add_2d,
+		&&op_sub_16b, &&op_sub_8h, &&op_sub_4s, &&op_sub_2d,
+		&&op_mul_16b, &&op_mul_8h, &&op_mul_4s,
+		&&op_fadd_4s, &&op_fadd_2d, &&op_fsub_4s, &&op_fsub_2d,
+		&&op_fmul_4s, &&op_fmul_2d, &&op_fmla_4s, &&op_fmla_2d,
+		&&op_adrp_add,
+		&&op_ldr_w_add, &&op_ldr_x_add,
+		&&op_subs_x_imm_bcond, &&op_subs_w_imm_bcond,
+		&&op_subs_x_reg_bcond, &&op_subs_w_reg_bcond,
+	};
+	static_assert(sizeof(labels) / sizeof(labels[0]) == OP_COUNT,
+					"FastCPU: labels must follow enum Op");
+	if (handlers != labels) {
+		for (auto &entry : blocks) {
+			retiredBlocks.push_back(entry.second);
+		}
+		blocks.clear();
+		handlers = labels;
+	}
+
+	Block *block;
+	Instruction *ip;
+	uint64_t target;
+	Block **link;	// saída a encadear ao próximo bloco buscado
+	uint8_t forceFlags = 0;	// saídas do B.cond fundido que escrevem as flags
+	RunResult result = {0, EXIT_LIMIT, PC};
+
+	// endereço da instrução corrente
+#define CURRENT_PC() (block->address + ((uint64_t)(ip - block->code.data()) << 2))
+	// executa a instrução apontada por ip
+#define DISPATCH() goto *ip->handler
+	// executa a instrução seguinte
+#define NEXT() do { ip++; DISPATCH(); } while (0)
+	// sai do bloco pela saída exit (taken ou fallthrough), para o
+	// endereço t
+#define CHAIN(exit, t) do { \
+		if (block->exit) { \
+			block = block->exit; \
+			blockStats.chained++; \
+			goto enter_block; \
+		} \
+		target = (t); \
+		link = &block->exit; \
+		goto lookup; \
+	} while (0)
+	// desvia para o endereço t, sem encadeamento (desvio indireto)
+#define JUMP(t) do { target = (t); link = nullptr; goto lookup; } while (0)
+	// informa aos modelos de previsão o desvio corrente, para t
+#define BRANCH(taken, t) do { \
+		if (observingBranches()) { \
+			resolveBranch(CURRENT_PC(), branchType(ip->op), taken, t); \
+		} \
+	} while (0)
+	// o desvio direto corrente foi tomado ou não
+#define TAKEN() do { \
+		BRANCH(true, CURRENT_PC() + ip->imm); \
+		CHAIN(taken, CURRENT_PC() + ip->imm); \
+	} while (0)
+#define NOT_TAKEN() do { \
+		BRANCH(false, CURRENT_PC() + 4); \
+		CHAIN(fallthrough, CURRENT_PC() + 4); \
+	} while (0)
+
+	for (Block *retired : retiredBlocks) {
+		delete retired;
+	}
+	retiredBlocks.clear();
+
+	if (cpuError || processFinished) {
+		goto done;
+	}
+	JUMP(PC);
+
+lookup:
+	if (memoryEvents.load(memory_order_relaxed)) {
+		applyMemoryEvents();
+	}
+	// busca na cache de blocos
+	if (target & 3) {
+		cout << "Unaligned branch target: 0x" << hex << target << dec << endl;
+		cpuError = CPUerrorCode::UNALIGNED_PC;
+		PC = target;
+		goto done;
+	}
+	block = getBlock(target);
+	if (link) {
+		*link = block;
+	}
+
+enter_block:
+	// avisos da memória chegaram: o bloco pode ter sido invalidado
+	if (memoryEvents.load(memory_order_relaxed)) {
+		target = block->address;
+		link = nullptr;
+		goto lookup;
+	}
+	if (result.retired == maxInstructions
+			|| (block->address == stopAddress && result.retired)) {
+		PC = block->address;
+		result.reason = result.retired == maxInstructions ? EXIT_LIMIT : EXIT_ADDRESS;
+		goto done;
+	}
+	if (maxInstructions - result.retired < block->size
+			|| (stopAddress > block->address
+				&& stopAddress - block->address < (block->size << 2))) {
+		uint64_t size = maxInstructions - result.retired;
+		if (stopAddress > block->address && (stopAddress - block->address) >> 2 < size) {
+			size = (stopAddress - block->address) >> 2;
+		}
+		block = translate(block->address, size);
+		retiredBlocks.push_back(block);
+	}
+	forceFlags = maxInstructions - result.retired < block->size + 2 * FUSION_SCAN
+					|| (stopAddress >= block->scanStart && stopAddress < block->scanEnd)
+				? LIVE_TAKEN | LIVE_NOT_TAKEN : 0;
+	result.retired += block->size;
+	if (CACHE_ENABLED) {
+		memory->fetchInstructions(block->address, block->size);
+	}
+	if (profiler) {
+		profiler->count(block->address, block->size, 1);
+	}
+	blockStats.entries++;
+	if (++block->execCount == hotThreshold) {
+		onHotBlock(block);
+	}
+	ip = block->code.data();
+	if (block->native) {
+		goto run_native;
+	}
+	DISPATCH();
+
+run_native:
+	{
+		uint64_t exit = block->native(X);
+		if (nativeFault) {
+			exception_ptr fault = nativeFault;
+			nativeFault = nullptr;
+			rethrow_exception(fault);
+		}
+		ip += exit >> 2;
+		switch (exit & 3) {
+			case NATIVE_TAKEN:
+				TAKEN();
+			case NATIVE_NOT_TAKEN:
+				NOT_TAKEN();
+			default:
+				DISPATCH();
+		}
+	}
+
+op_end_block:
+	CHAIN(fallthrough, CURRENT_PC());
+
+op_undefined:
+	PC = CURRENT_PC();
+	result.retired -= block->size - (ip - block->code.data());
+	if (profiler) {
+		profiler->count(PC, block->size - (ip - block->code.data()), -1);
+	}
+	cout << "Instruction not implemented: 0x" << hex
+			<< memory->readInstruction32(PC) << " at 0x" << PC << dec << endl;
+	cpuError = CPUerrorCode::UNDEFINED_INSTRUCTION;
+	goto done;
+
+op_nop:
+	NEXT();
+
+	/*
+	 * Data Processing -- Immediate
+	 */
+op_add_x_imm:
+	X[ip->d] = X[ip->n] + ip->imm;
+	NEXT();
+
+op_add_w_imm:
+	X[ip->d] = (uint32_t)(X[ip->n] + ip->imm);
+	NEXT();
+
+op_adds_x_imm:
+	{
+		uint64_t a = X[ip->n], b = ip->imm, r = a + b;
+		flags.setAdd<uint64_t>(a, b, r);
+		X[ip->d] = r;
+		NEXT();
+	}
+
+op_adds_w_imm:
+	{
+		uint32_t a = X[ip->n], b = ip->imm, r = a + b;
+		flags.setAdd<uint32_t>(a, b, r);
+		X[ip->d] = r;
+		NEXT();
+	}
+
+op_subs_x_imm:
+	{
+		uint64_t a = X[ip->n], b = ip->imm, r = a - b;
+		flags.setSub<uint64_t>(a, b, r);
+		X[ip->d] = r;
+		NEXT();
+	}
+
+op_subs_w_imm:
+	{
+		uint32_t a = X[ip->n], b = ip->imm, r = a - b;
+		flags.setSub<uint32_t>(a, b, r);
+		X[ip->d] = r;
+		NEXT();
+	}
+
+op_adr:
+	X[ip->d] = CURRENT_PC() + ip->imm;
+	NEXT();
+
+op_adrp:
+	X[ip->d] = (CURRENT_PC() & ~(uint64_t)0xFFF) + ip->imm;
+	NEXT();
+
+	/*
+	 * Data Processing -- Register
+	 */
+op_add_x_reg:
+	X[ip->d] = X[ip->n] + shiftX(X[ip->m], ip->ext, ip->amount);
+	NEXT();
+
+op_add_w_reg:
+	X[ip->d] = (uint32_t)(X[ip->n] + shiftW(X[ip->m], ip->ext, ip->amount));
+	NEXT();
+
+op_sub_x_reg:
+	X[ip->d] = X[ip->n] - shiftX(X[ip->m], ip->ext, ip->amount);
+	NEXT();
+
+op_sub_w_reg:
+	X[ip->d] = (uint32_t)(X[ip->n] - shiftW(X[ip->m], ip->ext, ip->amount));
+	NEXT();
+
+op_adds_x_reg:
+	{
+		uint64_t a = X[ip->n], b = shiftX(X[ip->m], ip->ext, ip->amount), r = a + b;
+		flags.setAdd<uint64_t>(a, b, r);
+		X[ip->d] = r;
+		NEXT();
+	}
+
+op_adds_w_reg:
+	{
+		uint32_t a = X[ip->n], b = shiftW(X[ip->m], ip->ext, ip->amount), r = a + b;
+		flags.setAdd<uint32_t>(a, b, r);
+		X[ip->d] = r;
+		NEXT();
+	}
+
+op_subs_x_reg:
+	{
+		uint64_t a = X[ip->n], b = shiftX(X[ip->m], ip->ext, ip->amount), r = a - b;
+		flags.setSub<uint64_t>(a, b, r);
+		X[ip->d] = r;
+		NEXT();
+	}
+
+op_subs_w_reg:
+	{
+		uint32_t a = X[ip->n], b = shiftW(X[ip->m], ip->ext, ip->amount), r = a - b;
+		flags.setSub<uint32_t>(a, b, r);
+		X[ip->d] = r;
+		NEXT();
+	}
+
+	/*
+	 * Loads and Stores
+	 */
+#define ADDR_IMM() (X[ip->n] + ip->imm)
+#define ADDR_REG() (X[ip->n] + (extendReg(X[ip->m], ip->ext) << ip->amount))
+	// escrita escalar em Vd (S ou D), que zera os bits 127-64
+#define SET_VD(value) do { V[ip->d][0] = (value); V[ip->d][1] = 0; } while (0)
+	// Qd, em duas palavras de 64 bits
+#define LOAD_Q(address) do { \
+		uint64_t a_ = (address); \
+		V[ip->d][0] = readData64(memory, a_); \
+		V[ip->d][1] = readData64(memory, a_ + 8); \
+		NEXT(); \
+	} while (0)
+#define STORE_Q(address) do { \
+		uint64_t a_ = (address); \
+		writeData64(memory, a_, V[ip->d][0]); \
+		writeData64(memory, a_ + 8, V[ip->d][1]); \
+		NEXT(); \
+	} while (0)
+
+op_ldr_w:
+	X[ip->d] = readData32(memory, ADDR_IMM());
+	NEXT();
+
+op_ldr_x:
+	X[ip->d] = readData64(memory, ADDR_IMM());
+	NEXT();
+
+op_ldrsw:
+	X[ip->d] = (int64_t)(int32_t)readData32(memory, ADDR_IMM());
+	NEXT();
+
+op_str_w:
+	writeData32(memory, ADDR_IMM(), (uint32_t)X[ip->d]);
+	NEXT();
+
+op_str_x:
+	writeData64(memory, ADDR_IMM(), X[ip->d]);
+	NEXT();
+
+op_ldr_s:
+	SET_VD(readData32(memory, ADDR_IMM()));
+	NEXT();
+
+op_ldr_d:
+	SET_VD(readData64(memory, ADDR_IMM()));
+	NEXT();
+
+op_str_s:
+	writeData32(memory, ADDR_IMM(), (uint32_t)V[ip->d][0]);
+	NEXT();
+
+op_str_d:
+	writeData64(memory, ADDR_IMM(), V[ip->d][0]);
+	NEXT();
+
+op_ldr_q:
+	LOAD_Q(ADDR_IMM());
+
+op_str_q:
+	STORE_Q(ADDR_IMM());
+
+op_ldr_w_reg:
+	X[ip->d] = readData32(memory, ADDR_REG());
+	NEXT();
+
+op_ldr_x_reg:
+	X[ip->d] = readData64(memory, ADDR_REG());
+	NEXT();
+
+op_ldrsw_reg:
+	X[ip->d] = (int64_t)(int32_t)readData32(memory, ADDR_REG());
+	NEXT();
+
+op_str_w_reg:
+	writeData32(memory, ADDR_REG(), (uint32_t)X[ip->d]);
+	NEXT();
+
+op_str_x_reg:
+	writeData64(memory, ADDR_REG(), X[ip->d]);
+	NEXT();
+
+op_ldr_s_reg:
+	SET_VD(readData32(memory, ADDR_REG()));
+	NEXT();
+
+op_ldr_d_reg:
+	SET_VD(readData64(memory, ADDR_REG()));
+	NEXT();
+
+op_str_s_reg:
+	writeData32(memory, ADDR_REG(), (uint32_t)V[ip->d][0]);
+	NEXT();
+
+op_str_d_reg:
+	writeData64(memory, ADDR_REG(), V[ip->d][0]);
+	NEXT();
+
+op_ldr_q_reg:
+	LOAD_Q(ADDR_REG());
+
+op_str_q_reg:
+	STORE_Q(ADDR_REG());
+
+	/*
+	 * Branches
+	 */
+op_b:
+	TAKEN();
+
+op_bl:
+	X[30] = CURRENT_PC() + 4;
+	TAKEN();
+
+op_bcond:
+	if (flags.condition(ip->ext)) {
+		TAKEN();
+	}
+	NOT_TAKEN();
+
+op_cbz_x:
+	if (X[ip->d] == 0) TAKEN();
+	NOT_TAKEN();
+
+op_cbz_w:
+	if ((uint32_t)X[ip->d] == 0) TAKEN();
+	NOT_TAKEN();
+
+op_cbnz_x:
+	if (X[ip->d] != 0) TAKEN();
+	NOT_TAKEN();
+
+op_cbnz_w:
+	if ((uint32_t)X[ip->d] != 0) TAKEN();
+	NOT_TAKEN();
+
+op_blr:
+	target = X[ip->n];
+	X[30] = CURRENT_PC() + 4;
+	goto branch_register;
+
+op_br:
+op_ret:
+	target = X[ip->n];
+
+branch_register:
+	BRANCH(true, target);
+	// retorno de main: fim do processo
+	if (target == EXITADDRESS) {
+		processFinished = true;
+		PC = target;
+		goto done;
+	}
+	JUMP(target);
+
+	/*
+	 * Data Processing -- Scalar Floating-Point
+	 */
+op_fadd_s:
+	SET_VD(fromFloat(asFloat(V[ip->n][0]) + asFloat(V[ip->m][0])));
+	NEXT();
+
+op_fsub_s:
+	SET_VD(fromFloat(asFloat(V[ip->n][0]) - asFloat(V[ip->m][0])));
+	NEXT();
+
+op_fmul_s:
+	SET_VD(fromFloat(asFloat(V[ip->n][0]) * asFloat(V[ip->m][0])));
+	NEXT();
+
+op_fdiv_s:
+	SET_VD(fromFloat(asFloat(V[ip->n][0]) / asFloat(V[ip->m][0])));
+	NEXT();
+
+op_fadd_d:
+	SET_VD(fromDouble(asDouble(V[ip->n][0]) + asDouble(V[ip->m][0])));
+	NEXT();
+
+op_fsub_d:
+	SET_VD(fromDouble(asDouble(V[ip->n][0]) - asDouble(V[ip->m][0])));
+	NEXT();
+
+op_fmul_d:
+	SET_VD(fromDouble(asDouble(V[ip->n][0]) * asDouble(V[ip->m][0])));
+	NEXT();
+
+op_fdiv_d:
+	SET_VD(fromDouble(asDouble(V[ip->n][0]) / asDouble(V[ip->m][0])));
+	NEXT();
+
+op_fmov_s:
+	SET_VD((uint32_t)V[ip->n][0]);
+	NEXT();
+
+op_fneg_s:
+	SET_VD((uint32_t)V[ip->n][0] ^ 0x80000000);
+	NEXT();
+
+op_fabs_s:
+	SET_VD((uint32_t)V[ip->n][0] & 0x7FFFFFFF);
+	NEXT();
+
+op_fmov_d:
+	SET_VD(V[ip->n][0]);
+	NEXT();
+
+op_fneg_d:
+	SET_VD(V[ip->n][0] ^ 0x8000000000000000);
+	NEXT();
+
+op_fabs_d:
+	SET_VD(V[ip->n][0] & 0x7FFFFFFFFFFFFFFF);
+	NEXT();
+
+op_fmov_imm:
+	SET_VD(ip->imm);
+	NEXT();
+
+	/*
+	 * Data Processing -- Advanced SIMD
+	 */
+	// Vd = op(Vn, Vm) com elementos do tipo type (ver Simd)
+#define SIMD(op, type) do { \
+		Simd::op<type>(V[ip->d], V[ip->n], V[ip->m]); \
+		if (!ip->ext) V[ip->d][1] = 0; \
+		NEXT(); \
+	} while (0)
+
+op_add_16b:	SIMD(add, uint8_t);
+op_add_8h:	SIMD(add, uint16_t);
+op_add_4s:	SIMD(add, uint32_t);
+op_add_2d:	SIMD(add, uint64_t);
+op_sub_16b:	SIMD(sub, uint8_t);
+op_sub_8h:	SIMD(sub, uint16_t);
+op_sub_4s:	SIMD(sub, uint32_t);
+op_sub_2d:	SIMD(sub, uint64_t);
+op_mul_16b:	SIMD(mul, uint8_t);
+op_mul_8h:	SIMD(mul, uint16_t);
+op_mul_4s:	SIMD(mul, uint32_t);
+op_fadd_4s:	SIMD(fadd, float);
+op_fadd_2d:	SIMD(fadd, double);
+op_fsub_4s:	SIMD(fsub, float);
+op_fsub_2d:	SIMD(fsub, double);
+op_fmul_4s:	SIMD(fmul, float);
+op_fmul_2d:	SIMD(fmul, double);
+op_fmla_4s:	SIMD(fmla, float);
+op_fmla_2d:	SIMD(fmla, double);
+
+	/*
+	 * Pares fundidos (ver fuse): ip[1] é a segunda instrução
+	 */
+op_adrp_add:
+	X[ip->d] = (CURRENT_PC() & ~(uint64_t)0xFFF) + ip->imm + ip[1].imm;
+	ip += 2;
+	DISPATCH();
+
+op_ldr_w_add:
+	X[ip->d] = (uint32_t)(readData32(memory, ADDR_IMM()) + ip[1].imm);
+	ip += 2;
+	DISPATCH();
+
+op_ldr_x_add:
+	X[ip->d] = readData64(memory, ADDR_IMM()) + ip[1].imm;
+	ip += 2;
+	DISPATCH();
+
+	// SUBS de a e b seguido do B.cond em ip[1]; as flags só são escritas
+	// se puderem ser lidas na saída tomada, ou se a execução pode parar
+	// antes de serem reescritas
+#define SUBS_BCOND(type, a, b) do { \
+		type a_ = (a), b_ = (b), r_ = a_ - b_; \
+		X[ip->d] = r_; \
+		ip++; \
+		bool taken = Flags::subCondition<type>(a_, b_, r_, ip->ext); \
+		if ((ip->liveFlags | forceFlags) & (taken ? LIVE_TAKEN : LIVE_NOT_TAKEN)) { \
+			flags.setSub<type>(a_, b_, r_); \
+		} \
+		if (taken) { \
+			TAKEN(); \
+		} \
+		NOT_TAKEN(); \
+	} while (0)
+
+op_subs_x_imm_bcond:
+	SUBS_BCOND(uint64_t, X[ip->n], ip->imm);
+
+op_subs_w_imm_bcond:
+	SUBS_BCOND(uint32_t, X[ip->n], ip->imm);
+
+op_subs_x_reg_bcond:
+	SUBS_BCOND(uint64_t, X[ip->n], shiftX(X[ip->m], ip->ext, ip->amount));
+
+op_subs_w_reg_bcond:
+	SUBS_BCOND(uint32_t, X[ip->n], shiftW(X[ip->m], ip->ext, ip->amount));
+
+done:
+#undef CURRENT_PC
+#undef DISPATCH
+#undef NEXT
+#undef CHAIN
+#undef JUMP
+#undef BRANCH
+#undef TAKEN
+#undef NOT_TAKEN
+#undef SUBS_BCOND
+#undef ADDR_IMM
+#undef ADDR_REG
+#undef SET_VD
+#undef LOAD_Q
+#undef STORE_Q
+#undef SIMD
+
+	if (cpuError) {
+		result.reason = EXIT_ERROR;
+	} else if (processFinished) {
+		result.reason = EXIT_FINISHED;
+	}
+	result.PC = PC;
+	retiredTotal += result.retired;
+	return result;
+}
+
+BranchPredictor::BranchType FastCPU::branchType(uint8_t op)
+{
+	switch (op) {
+		case OP_B:
+			return BranchPredictor::BRANCH_DIRECT;
+		case OP_BL:
+		case OP_BLR:
+			return BranchPredictor::BRANCH_CALL;
+		case OP_BR:
+			return BranchPredictor::BRANCH_INDIRECT;
+		case OP_RET:
+			return BranchPredictor::BRANCH_RETURN;
+		default:
+			return BranchPredictor::BRANCH_CONDITIONAL;
+	}
+}
+
+/**
+ * Decodificação
+ *
+ * Os grupos seguem a mesma divisão de BasicCPU::ID().
+ */
+FastCPU::Op FastCPU::decode(uint32_t ir, Instruction *inst)
+{
+	switch (ir & 0x1E000000) // bits 28-25
+	{
+		//100x Data Processing -- Immediate
+		case 0x10000000:
+		case 0x12000000:
+			return decodeDataProcImm(ir, inst);
+
+		// x101 Data Processing -- Register
+		case 0x0A000000:
+		case 0x1A000000:
+			return decodeDataProcReg(ir, inst);
+
+		// x111 Data Processing -- Scalar Floating-Point and Advanced SIMD
+		case 0x0E000000:
+		case 0x1E000000:
+			return decodeDataProcFloat(ir, inst);
+
+		// x1x0 Loads and Stores
+		case 0x08000000:
+		case 0x0C000000:
+		case 0x18000000:
+		case 0x1C000000:
+			return decodeLoadStore(ir, inst);
+
+		// 101x Branches, Exception Generating and System instructions
+		case 0x14000000:
+		case 0x16000000:
+			return decodeBranches(ir, inst);
+
+		default:
+			return OP_UNDEFINED;
+	}
+}
+
+/**
+ * 100x Data Processing -- Immediate
+ */
+FastCPU::Op FastCPU::decodeDataProcImm(uint32_t ir, Instruction *inst)
+{
+	uint32_t n = (ir & 0x000003E0) >> 5;
+	uint32_t d = ir & 0x0000001F;
+
+	// C4.1.2 PC-rel. addressing: ADR, ADRP
+	if ((ir & 0x1F000000) == 0x10000000) {
+		int64_t imm = signExtend(((ir >> 3) & 0x1FFFFC) | ((ir >> 29) & 3), 21);
+		inst->d = regZRdest(d);
+		if (ir & 0x80000000) {
+			inst->imm = imm << 12;
+			return OP_ADRP;
+		}
+		inst->imm = imm;
+		return OP_ADR;
+	}
+
+	// C4.1.2 Add/subtract (immediate)
+	if ((ir & 0x1F800000) == 0x11000000) {
+		bool sf = ir & 0x80000000;
+		bool sub = ir & 0x40000000;
+		bool setFlags = ir & 0x20000000;
+		int64_t imm = (ir & 0x003FFC00) >> 10;
+		if (ir & 0x00400000) imm <<= 12; // sh = 1
+
+		inst->n = regSP(n);
+		if (setFlags) {
+			// ADDS, SUBS, CMN, CMP
+			inst->d = regZRdest(d);
+			inst->imm = imm;
+			if (sub) return sf ? OP_SUBS_X_IMM : OP_SUBS_W_IMM;
+			return sf ? OP_ADDS_X_IMM : OP_ADDS_W_IMM;
+		}
+		// ADD, SUB, MOV (to/from SP)
+		inst->d = regSP(d);
+		inst->imm = sub ? -imm : imm;
+		return sf ? OP_ADD_X_IMM : OP_ADD_W_IMM;
+	}
+
+	return OP_UNDEFINED;
+}
+
+/**
+ * x101 Data Processing -- Register
+ */
+FastCPU::Op FastCPU::decodeDataProcReg(uint32_t ir, Instruction *inst)
+{
+	// C4.1.5 Add/subtract (shifted register)
+	if ((ir & 0x1F200000) == 0x0B000000) {
+		bool sf = ir & 0x80000000;
+		bool sub = ir & 0x40000000;
+		bool setFlags = ir & 0x20000000;
+		uint32_t shift = (ir & 0x00C00000) >> 22;
+		uint32_t imm6 = (ir & 0x0000FC00) >> 10;
+
+		if (shift == 3) return OP_UNDEFINED;	// reservado
+		if (!sf && imm6 >= 32) return OP_UNDEFINED;
+
+		inst->n = regZR((ir & 0x000003E0) >> 5);
+		inst->m = regZR((ir & 0x001F0000) >> 16);
+		inst->d = regZRdest(ir & 0x0000001F);
+		inst->ext = shift;
+		inst->amount = imm6;
+
+		if (setFlags) {
+			if (sub) return sf ? OP_SUBS_X_REG : OP_SUBS_W_REG;
+			return sf ? OP_ADDS_X_REG : OP_ADDS_W_REG;
+		}
+		if (sub) return sf ? OP_SUB_X_REG : OP_SUB_W_REG;
+		return sf ? OP_ADD_X_REG : OP_ADD_W_REG;
+	}
+
+	return OP_UNDEFINED;
+}
+
+/**
+ * x1x0 Loads and Stores
+ */
+FastCPU::Op FastCPU::decodeLoadStore(uint32_t ir, Instruction *inst)
+{
+	uint32_t size = ir >> 30;
+	bool simd = ir & 0x04000000;
+	uint32_t opc = (ir & 0x00C00000) >> 22;
+	uint32_t t = ir & 0x0000001F;
+
+	inst->n = regSP((ir & 0x000003E0) >> 5);
+
+	// tamanho do acesso: 1 << scale bytes (Q: size = 00, opc = 1x)
+	uint32_t scale = simd && size == 0 && (opc & 2) ? 4 : size;
+
+	// C4.1.4 Load/store register (unsigned immediate)
+	if ((ir & 0x3B000000) == 0x39000000) {
+		inst->imm = ((ir & 0x003FFC00) >> 10) << scale;
+	}
+	// C4.1.4 Load/store register (unscaled immediate): LDUR, STUR
+	else if ((ir & 0x3B200C00) == 0x38000000) {
+		inst->imm = signExtend((ir & 0x001FF000) >> 12, 9);
+	}
+	// C4.1.4 Load/store register (register offset)
+	else if ((ir & 0x3B200C00) == 0x38200800) {
+		uint32_t option = (ir & 0x0000E000) >> 13;
+		if (!(option & 2)) return OP_UNDEFINED; // reservado
+		inst->m = regZR((ir & 0x001F0000) >> 16);
+		inst->ext = option;
+		inst->amount = (ir & 0x00001000) ? scale : 0;
+		inst->imm = 0;
+	}
+	else {
+		return OP_UNDEFINED;
+	}
+
+	bool registerOffset = (ir & 0x3B200C00) == 0x38200800;
+
+	if (simd) {
+		inst->d = t;
+		switch ((size << 2) | opc) {
+			case 0x8: return registerOffset ? OP_STR_S_REG : OP_STR_S;	// 10 00
+			case 0x9: return registerOffset ? OP_LDR_S_REG : OP_LDR_S;	// 10 01
+			case 0xC: return registerOffset ? OP_STR_D_REG : OP_STR_D;	// 11 00
+			case 0xD: return registerOffset ? OP_LDR_D_REG : OP_LDR_D;	// 11 01
+			case 0x2: return registerOffset ? OP_STR_Q_REG : OP_STR_Q;	// 00 10
+			case 0x3: return registerOffset ? OP_LDR_Q_REG : OP_LDR_Q;	// 00 11
+			default: return OP_UNDEFINED;
+		}
+	}
+
+	switch ((size << 2) | opc) {
+		case 0x8:	// 10 00 STR (32 bits)
+			inst->d = regZR(t);
+			return registerOffset ? OP_STR_W_REG : OP_STR_W;
+		case 0x9:	// 10 01 LDR (32 bits)
+			inst->d = regZRdest(t);
+			return registerOffset ? OP_LDR_W_REG : OP_LDR_W;
+		case 0xA:	// 10 10 LDRSW
+			inst->d = regZRdest(t);
+			return registerOffset ? OP_LDRSW_REG : OP_LDRSW;
+		case 0xC:	// 11 00 STR (64 bits)
+			inst->d = regZR(t);
+			return registerOffset ? OP_STR_X_REG : OP_STR_X;
+		case 0xD:	// 11 01 LDR (64 bits)
+			inst->d = regZRdest(t);
+			return registerOffset ? OP_LDR_X_REG : OP_LDR_X;
+		default:
+			return OP_UNDEFINED;
+	}
+}
+
+/**
+ * 101x Branches, Exception Generating and System instructions
+ */
+FastCPU::Op FastCPU::decodeBranches(uint32_t ir, Instruction *inst)
+{
+	// C6.2.26 B, C6.2.33 BL
+	if ((ir & 0x7C000000) == 0x14000000) {
+		inst->imm = signExtend(ir & 0x03FFFFFF, 26) << 2;
+		return (ir & 0x80000000) ? OP_BL : OP_B;
+	}
+
+	// C6.2.25 B.cond
+	if ((ir & 0xFF000010) == 0x54000000) {
+		inst->ext = ir & 0x0000000F;
+		inst->imm = signExtend((ir & 0x00FFFFE0) >> 5, 19) << 2;
+		return OP_BCOND;
+	}
+
+	// C6.2.47 CBZ, C6.2.46 CBNZ
+	if ((ir & 0x7E000000) == 0x34000000) {
+		bool sf = ir & 0x80000000;
+		inst->d = regZR(ir & 0x0000001F);
+		inst->imm = signExtend((ir & 0x00FFFFE0) >> 5, 19) << 2;
+		if (ir & 0x01000000) return sf ? OP_CBNZ_X : OP_CBNZ_W;
+		return sf ? OP_CBZ_X : OP_CBZ_W;
+	}
+
+	// C6.2.37 BR, C6.2.35 BLR, C6.2.207 RET
+	inst->n = regZR((ir & 0x000003E0) >> 5);
+	switch (ir & 0xFFFFFC1F) {
+		case 0xD61F0000: return OP_BR;
+		case 0xD63F0000: return OP_BLR;
+		case 0xD65F0000: return OP_RET;
+	}
+
+	// C6.2.203 NOP
+	if (ir == 0xD503201F) {
+		return OP_NOP;
+	}
+
+	return OP_UNDEFINED;
+}
+
+/**
+ * x111 Data Processing -- Scalar Floating-Point and Advanced SIMD
+ */
+FastCPU::Op FastCPU::decodeDataProcFloat(uint32_t ir, Instruction *inst)
+{
+	// C4.1.5 Advanced SIMD three same
+	if ((ir & 0x9F200400) == 0x0E200400) {
+		return decodeSIMDThreeSame(ir, inst);
+	}
+
+	uint32_t ftype = (ir & 0x00C00000) >> 22;
+	if (ftype > 1) return OP_UNDEFINED; // apenas S (00) e D (01)
+	bool isDouble = ftype == 1;
+
+	inst->d = ir & 0x0000001F;
+	inst->n = (ir & 0x000003E0) >> 5;
+	inst->m = (ir & 0x001F0000) >> 16;
+
+	// C4.1.6 Floating-point data-processing (2 source)
+	if ((ir & 0xFF200C00) == 0x1E200800) {
+		switch ((ir & 0x0000F000) >> 12) {
+			case 0: return isDouble ? OP_FMUL_D : OP_FMUL_S;
+			case 1: return isDouble ? OP_FDIV_D : OP_FDIV_S;
+			case 2: return isDouble ? OP_FADD_D : OP_FADD_S;
+			case 3: return isDouble ? OP_FSUB_D : OP_FSUB_S;
+			default: return OP_UNDEFINED;
+		}
+	}
+
+	// C4.1.6 Floating-point data-processing (1 source)
+	if ((ir & 0xFF207C00) == 0x1E204000) {
+		switch ((ir & 0x001F8000) >> 15) {
+			case 0: return isDouble ? OP_FMOV_D : OP_FMOV_S;
+			case 1: return isDouble ? OP_FABS_D : OP_FABS_S;
+			case 2: return isDouble ? OP_FNEG_D : OP_FNEG_S;
+			default: return OP_UNDEFINED;
+		}
+	}
+
+	// C4.1.6 Floating-point immediate: FMOV (scalar, immediate)
+	if ((ir & 0xFF201FE0) == 0x1E201000) {
+		inst->imm = expandFPImm((ir & 0x001FE000) >> 13, isDouble);
+		return OP_FMOV_IMM;
+	}
+
+	return OP_UNDEFINED;
+}
+
+/**
+ * Decodifica Advanced SIMD three same (C4.1.5): ADD, SUB, MUL (inteiros) e
+ * FADD, FSUB, FMUL, FMLA (S e D). O arranjo de 64 bits (Q = 0) usa o mesmo
+ * código do de 128 bits, com ext = Q indicando que 127-64 devem ser zerados.
+ */
+FastCPU::Op FastCPU::decodeSIMDThreeSame(uint32_t ir, Instruction *inst)
+{
+	bool q = ir & 0x40000000;
+	bool u = ir & 0x20000000;
+	uint32_t size = (ir & 0x00C00000) >> 22;
+	bool sz = size & 1;	// FP: 0 = S, 1 = D
+
+	inst->d = ir & 0x0000001F;
+	inst->n = (ir & 0x000003E0) >> 5;
+	inst->m = (ir & 0x001F0000) >> 16;
+	inst->ext = q;
+
+	switch ((ir & 0x0000F800) >> 11) {
+		case 0x10:	// ADD, SUB
+			if (size == 3 && !q) return OP_UNDEFINED;
+			return (Op) ((u ? OP_SUB_16B : OP_ADD_16B) + size);
+		case 0x13:	// MUL
+			if (u || size == 3) return OP_UNDEFINED;
+			return (Op) (OP_MUL_16B + size);
+	}
+
+	// FP: bit 23 seleciona a variante, sz = 1 exige Q = 1
+	if (sz && !q) return OP_UNDEFINED;
+	bool high = size & 2;
+	switch ((ir & 0x0000F800) >> 11) {
+		case 0x1A:	// FADD, FSUB
+			if (u) return OP_UNDEFINED;
+			return high ? (sz ? OP_FSUB_2D : OP_FSUB_4S) : (sz ? OP_FADD_2D : OP_FADD_4S);
+		case 0x1B:	// FMUL
+			if (!u || high) return OP_UNDEFINED;
+			return sz ? OP_FMUL_2D : OP_FMUL_4S;
+		case 0x19:	// FMLA
+			if (u || high) return OP_UNDEFINED;
+			return sz ? OP_FMLA_2D : OP_FMLA_4S;
+		default:
+			return OP_UNDEFINED;
+	}
+}
+
+/**
+ * Instanciações de execute()
+ */
+template int FastCPU::execute<Memory>(Memory *memory, uint64_t startAddress);
+
+#ifdef STATIC_MEM_IMPL
+#include STATIC_MEM_HEADER
+template int FastCPU::execute<STATIC_MEM_IMPL>(STATIC_MEM_IMPL *memory, uint64_t startAddress);
+#endif
@@ -0,0 +1,476 @@
+/* ----------------------------------------------------------------------------
+
+    (EN) FastCPU - a CPU for production runs, with the following characteristics:
+		- AArch64 ISA (limited), from ARMv8
+		- direct-threaded interpreter over predecoded instructions
+		- basic-block translation cache with block chaining
+		
+	armethyst - A simple ARM Simulator written in C++ for Computer Architecture
+    teaching purposes. Free software licensed under the MIT License (see license
+    below).
+
+    (PT) FastCPU - uma CPU para execuções longas, com as seguintes características:
+		- AArch64 ISA (limitado), do ARMv8
+		- interpretador com código encadeado (direct threading) sobre
+		  instruções pré-decodificadas
+		- cache de blocos básicos traduzidos, com encadeamento de blocos
+    
+	armethyst - Um simulador ARM simples escrito em C++ para o ensino de
+    Arquitetura de Computadores. Software livre licenciado pela MIT License
+    (veja a licença, em inglês, abaixo).
+
+    (EN) MIT LICENSE:
+
+    Copyright 2020 André Vital Saúde
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+   ----------------------------------------------------------------------------
+*/
+
+#pragma once
+
+#include "config.h"
+#include "CPU.h"
+#include "Flags.h"
+
+#include <unordered_map>
+#include <vector>
+#include <cstring>
+#include <atomic>
+#include <mutex>
+#include <exception>
+
+#define TLB_ENTRIES (1 << TLB_BITS)
+
+// etiqueta da TLB que não corresponde a nenhum acesso
+#define TLB_INVALID (~(uint64_t)0)
+
+// marca, na etiqueta da TLB, de página consultada que a memória não
+// permite acessar diretamente (acima dos bits de alinhamento)
+#define TLB_NO_HOST ((uint64_t)1 << (HOST_PAGE_BITS - 1))
+
+/**
+ * FastCPU
+ *
+ * Diferentemente da BasicCPU, que é o modelo didático com um método por
+ * estágio do caminho de dados, a FastCPU não tem registradores auxiliares
+ * entre estágios (IR, A, B, ALUout, MDR). Cada instrução é decodificada
+ * uma única vez para um registro Instruction, que guarda o endereço do
+ * seu tratador no laço do interpretador (computed goto, extensão do GCC),
+ * e os tratadores executam a instrução inteira diretamente sobre o banco
+ * de registradores.
+ *
+ * As instruções são traduzidas em blocos básicos: sequências de
+ * instruções terminadas por um desvio (B, BL, B.cond, CBZ, CBNZ, BR,
+ * BLR, RET). Cada bloco guarda ponteiros para seus sucessores, preenchidos
+ * na primeira vez em que cada saída é tomada, de forma que um laço quente
+ * executa de bloco em bloco sem consultar a cache de blocos.
+ *
+ * Pares de instruções frequentes no código do compilador (ADRP + ADD,
+ * LDR + ADD, CMP + B.cond) são executados por um único tratador (ver
+ * fuse), e o CMP fundido só escreve as flags NZCV se elas forem lidas
+ * depois do desvio ou se a execução puder parar antes de serem
+ * reescritas.
+ *
+ * Loads e stores acessam diretamente, pela TLB de software, as páginas
+ * que a memória entrega (Memory::getHostPage), e só chamam a memória
+ * nas faltas.
+ */
+class FastCPU: public CPU, public MemoryListener
+{
+	public:
+		FastCPU(Memory *memory);
+		virtual ~FastCPU();
+
+		/**
+		 * Métodos herdados de CPU
+		 */
+		int run(uint64_t startAddress);
+		void start(uint64_t startAddress);
+		RunResult runFor(uint64_t maxInstructions);
+		RunResult runUntil(uint64_t address);
+		void setSP(uint64_t address);
+		void save(CheckpointWriter &checkpoint);
+		void restore(CheckpointReader &checkpoint);
+		void getState(CPUState &state);
+		void setState(const CPUState &state);
+
+		/**
+		 * Como run(), com os acessos à memória feitos pelo tipo
+		 * MemoryType. run() usa Memory, com chamadas virtuais;
+		 * StaticProcessor usa a memória concreta (ex.: FlatMemory, que é
+		 * final), e os acessos são expandidos em linha no laço.
+		 *
+		 * Instanciado em FastCPU.cpp para Memory e, no build estático,
+		 * para STATIC_MEM_IMPL (ver makefile).
+		 */
+		template <class MemoryType>
+		int execute(MemoryType *memory, uint64_t startAddress);
+
+		/**
+		 * Métodos herdados de MemoryListener
+		 */
+		void codeModified(uint64_t address, uint64_t size);
+		void hostPagesChanged();
+
+	protected:
+		/**
+		 * Operações do interpretador. Cada operação tem um tratador
+		 * (rótulo) em run(), na mesma ordem.
+		 */
+		enum Op {
+			OP_END_BLOCK,	// sentinela no fim de blocos sem desvio
+			OP_UNDEFINED,	// instrução não implementada
+			OP_NOP,
+			// Data Processing -- Immediate
+			OP_ADD_X_IMM, OP_ADD_W_IMM,		// ADD e SUB (imm negativo)
+			OP_ADDS_X_IMM, OP_ADDS_W_IMM,
+			OP_SUBS_X_IMM, OP_SUBS_W_IMM,	// SUBS e CMP
+			OP_ADR, OP_ADRP,
+			// Data Processing -- Register
+			OP_ADD_X_REG, OP_ADD_W_REG,
+			OP_SUB_X_REG, OP_SUB_W_REG,
+			OP_ADDS_X_REG, OP_ADDS_W_REG,
+			OP_SUBS_X_REG, OP_SUBS_W_REG,
+			// Loads and Stores
+			OP_LDR_W, OP_LDR_X, OP_LDRSW, OP_STR_W, OP_STR_X,
+			OP_LDR_S, OP_LDR_D, OP_STR_S, OP_STR_D, OP_LDR_Q, OP_STR_Q,
+			OP_LDR_W_REG, OP_LDR_X_REG, OP_LDRSW_REG, OP_STR_W_REG, OP_STR_X_REG,
+			OP_LDR_S_REG, OP_LDR_D_REG, OP_STR_S_REG, OP_STR_D_REG,
+			OP_LDR_Q_REG, OP_STR_Q_REG,
+			// Branches
+			OP_B, OP_BL, OP_BCOND, OP_CBZ_X, OP_CBZ_W, OP_CBNZ_X, OP_CBNZ_W,
+			OP_BR, OP_BLR, OP_RET,
+			// Data Processing -- Scalar Floating-Point
+			OP_FADD_S, OP_FSUB_S, OP_FMUL_S, OP_FDIV_S,
+			OP_FADD_D, OP_FSUB_D, OP_FMUL_D, OP_FDIV_D,
+			OP_FMOV_S, OP_FNEG_S, OP_FABS_S,
+			OP_FMOV_D, OP_FNEG_D, OP_FABS_D,
+			OP_FMOV_IMM,
+			// Data Processing -- Advanced SIMD (three same), pelo arranjo de
+			// 128 bits; ext = Q, e os de 64 bits (8B, 4H, 2S) zeram 127-64
+			OP_ADD_16B, OP_ADD_8H, OP_ADD_4S, OP_ADD_2D,
+			OP_SUB_16B, OP_SUB_8H, OP_SUB_4S, OP_SUB_2D,
+			OP_MUL_16B, OP_MUL_8H, OP_MUL_4S,
+			OP_FADD_4S, OP_FADD_2D, OP_FSUB_4S, OP_FSUB_2D,
+			OP_FMUL_4S, OP_FMUL_2D, OP_FMLA_4S, OP_FMLA_2D,
+			// Pares fundidos (ver fuse), executam também a instrução seguinte
+			OP_ADRP_ADD,					// ADRP Xd + ADD Xd, Xd, #imm
+			OP_LDR_W_ADD, OP_LDR_X_ADD,		// LDR Rd + ADD Rd, Rd, #imm
+			OP_SUBS_X_IMM_BCOND, OP_SUBS_W_IMM_BCOND,	// SUBS/CMP + B.cond
+			OP_SUBS_X_REG_BCOND, OP_SUBS_W_REG_BCOND,
+			OP_COUNT
+		};
+
+		/**
+		 * Instrução pré-decodificada.
+		 *
+		 * Índices de registradores inteiros já consideram o papel do
+		 * registrador 31 (SP ou ZR) na instrução: ver X.
+		 */
+		struct Instruction {
+			const void *handler;	// tratador em run()
+			uint8_t op;				// operação (Op)
+			uint8_t d, n, m;		// registradores destino e fonte
+			uint8_t ext;			// condição, shift, extend ou Q
+			uint8_t amount;			// deslocamento de Rm
+			uint8_t liveFlags;		// B.cond fundido: LIVE_TAKEN, LIVE_NOT_TAKEN
+			int64_t imm;			// imediato, já estendido e deslocado
+		};
+
+		/**
+		 * Saídas de um B.cond fundido após as quais as flags NZCV podem
+		 * ser lidas (ver flagsLive).
+		 */
+		enum LiveFlags {
+			LIVE_TAKEN = 1,
+			LIVE_NOT_TAKEN = 2,
+		};
+
+		/**
+		 * Código nativo de um bloco (ver onHotBlock).
+		 *
+		 * Recebe o banco X e executa as instruções do bloco até uma
+		 * saída, retornando (índice << 2) | NativeExit, onde índice é a
+		 * posição em code da instrução em que parou.
+		 */
+		typedef uint64_t (*NativeCode)(uint64_t *X);
+
+		enum NativeExit {
+			NATIVE_INTERPRET,	// continua interpretando a partir do índice
+			NATIVE_TAKEN,		// o desvio no índice foi tomado
+			NATIVE_NOT_TAKEN,	// o desvio no índice não foi tomado
+		};
+
+		/**
+		 * Bloco básico traduzido.
+		 *
+		 * code termina com um desvio ou, se o bloco atingiu o tamanho
+		 * máximo (BLOCK_MAX_SIZE instruções, ou menos em blocos
+		 * truncados por interpret), com a sentinela OP_END_BLOCK, que
+		 * segue para o sucessor fallthrough.
+		 */
+		struct Block {
+			uint64_t address;			// endereço da primeira instrução
+			std::vector<Instruction> code;
+			uint64_t size;				// instruções, sem a sentinela
+			Block *taken;				// sucessor do desvio tomado
+			Block *fallthrough;			// sucessor sequencial
+			uint64_t execCount;			// número de execuções do bloco
+			NativeCode native;			// código nativo, se houver
+
+			// intervalo do código lido para traduzir o bloco, incluindo
+			// o examinado por flagsLive
+			uint64_t scanStart, scanEnd;
+		};
+
+		/**
+		 * Estatísticas da cache de blocos, reiniciadas a cada run().
+		 */
+		struct BlockStats {
+			uint64_t entries;		// blocos executados
+			uint64_t chained;		// ... alcançados por encadeamento
+			uint64_t translated;	// ... que precisaram ser traduzidos
+		};
+
+		/**
+		 * Registradores da CPU.
+		 */
+
+		// Registrador PC, atualizado apenas ao sair de run()
+		uint64_t PC;
+
+		// Banco de registradores inteiros
+		//		X[0..30]: R0-R30
+		//		X[31]: SP
+		//		X[32]: ZR, sempre 0 (leitura do registrador 31 como XZR/WZR)
+		//		X[33]: descarte (escrita no registrador 31 como XZR/WZR)
+		uint64_t X[34];
+
+		// Banco de registradores vetoriais V0-V31, de 128 bits: [0] com os
+		// bits 63-0 (D0-D31 e S0-S31) e [1] com os bits 127-64. Escritas
+		// escalares zeram [1].
+		alignas(16) uint64_t V[32][2];
+
+		// flags NZCV, avaliadas só quando lidas (ver Flags)
+		Flags flags;
+
+		/**
+		 * TLB de software: páginas de dados de HOST_PAGE_SIZE bytes
+		 * acessadas diretamente no hospedeiro, indexadas pelo número da
+		 * página com os bits acima do índice dobrados por xor (vetores
+		 * separados por potências de 2 não disputam a mesma entrada).
+		 *
+		 * readTag e writeTag guardam o endereço da página se ela pode ser
+		 * lida (escrita) por host. Um acesso de size bytes acerta se o
+		 * endereço, mantidos apenas os bits da página e os size - 1 bits
+		 * inferiores, é igual à etiqueta: a mesma comparação exige o
+		 * alinhamento, e acessos desalinhados seguem pela memória, com a
+		 * semântica dela. Páginas que a memória não entrega ficam com a
+		 * marca TLB_NO_HOST, para não serem consultadas a cada acesso.
+		 */
+		struct TLBEntry {
+			uint64_t readTag;
+			uint64_t writeTag;
+			uint8_t *host;			// página no hospedeiro
+			uint64_t reserved;		// entradas de 32 bytes (ver JITCPU)
+		};
+		TLBEntry tlb[TLB_ENTRIES];
+
+		static unsigned tlbIndex(uint64_t address)
+		{
+			uint64_t page = address >> HOST_PAGE_BITS;
+			return (page ^ (page >> TLB_BITS)) & (TLB_ENTRIES - 1);
+		}
+
+		/**
+		 * Cache de blocos, por endereço da primeira instrução.
+		 */
+		std::unordered_map<uint64_t, Block*> blocks;
+
+		// blocos invalidados durante run(), liberados no próximo run()
+		std::vector<Block*> retiredBlocks;
+
+		// avisos da memória, que podem vir da thread de outro núcleo
+		// (MultiCoreProcessor): codeModified e hostPagesChanged só os
+		// guardam, e o interpretador os aplica antes de entrar no
+		// próximo bloco (ver applyMemoryEvents)
+		std::mutex eventLock;
+		std::atomic<bool> memoryEvents;
+		std::vector<std::pair<uint64_t, uint64_t>> modifiedRanges;
+		bool pagesChanged;
+
+		BlockStats blockStats;
+
+		// número de execuções a partir do qual um bloco é quente
+		// (ver onHotBlock), 0 se não há tratamento de blocos quentes
+		uint64_t hotThreshold = 0;
+
+		// exceção de uma chamada feita pelo código nativo (ex.: acesso
+		// fora da memória), que não pode atravessá-lo: a subclasse a
+		// guarda aqui, o bloco segue até a saída e interpret a relança
+		std::exception_ptr nativeFault;
+
+		/**
+		 * Chamado quando block atinge hotThreshold execuções.
+		 * Subclasses podem preencher block->native, que passa a ser
+		 * executado no lugar do interpretador.
+		 */
+		virtual void onHotBlock(Block * /*block*/) {}
+
+		// tratadores de interpret(), indexados por Op
+		const void * const *handlers = nullptr;
+
+		/**
+		 * Acessos a dados dos tratadores: pela TLB quando a memória é
+		 * acessada por Memory (chamadas virtuais), ou diretamente pela
+		 * memória concreta (StaticProcessor), já expandida em linha.
+		 */
+		template <class MemoryType>
+		uint32_t readData32(MemoryType *memory, uint64_t address) { return memory->readData32(address); }
+		template <class MemoryType>
+		uint64_t readData64(MemoryType *memory, uint64_t address) { return memory->readData64(address); }
+		template <class MemoryType>
+		void writeData32(MemoryType *memory, uint64_t address, uint32_t value) { memory->writeData32(address, value); }
+		template <class MemoryType>
+		void writeData64(MemoryType *memory, uint64_t address, uint64_t value) { memory->writeData64(address, value); }
+
+		uint32_t readData32(Memory *memory, uint64_t address) { return tlbRead<uint32_t>(memory, address); }
+		uint64_t readData64(Memory *memory, uint64_t address) { return tlbRead<uint64_t>(memory, address); }
+		void writeData32(Memory *memory, uint64_t address, uint32_t value) { tlbWrite<uint32_t>(memory, address, value); }
+		void writeData64(Memory *memory, uint64_t address, uint64_t value) { tlbWrite<uint64_t>(memory, address, value); }
+
+		template <class T>
+		T tlbRead(Memory *memory, uint64_t address)
+		{
+			TLBEntry &entry = tlb[tlbIndex(address)];
+			if (entry.readTag == (address & (~(HOST_PAGE_SIZE - 1) | (sizeof(T) - 1)))) {
+				T value;
+				memcpy(&value, entry.host + (address & (HOST_PAGE_SIZE - 1)), sizeof(T));
+				return value;
+			}
+			return (T)readMiss(memory, address, sizeof(T));
+		}
+
+		template <class T>
+		void tlbWrite(Memory *memory, uint64_t address, T value)
+		{
+			TLBEntry &entry = tlb[tlbIndex(address)];
+			if (entry.writeTag == (address & (~(HOST_PAGE_SIZE - 1) | (sizeof(T) - 1)))) {
+				memcpy(entry.host + (address & (HOST_PAGE_SIZE - 1)), &value, sizeof(T));
+				return;
+			}
+			writeMiss(memory, address, sizeof(T), value);
+		}
+
+		/**
+		 * Faltas da TLB: consulta a página na memória, se ainda não
+		 * consultada, e faz o acesso de size (4 ou 8) bytes diretamente
+		 * ou, se a página não é entregue ou o acesso é desalinhado, pela
+		 * memória.
+		 */
+		uint64_t readMiss(Memory *memory, uint64_t address, unsigned size);
+		void writeMiss(Memory *memory, uint64_t address, unsigned size, uint64_t value);
+
+		/**
+		 * Invalida todas as entradas da TLB.
+		 */
+		void flushTLB();
+
+		/**
+		 * Aplica os avisos da memória guardados: invalida a TLB e os
+		 * blocos com instruções alteradas.
+		 */
+		void applyMemoryEvents();
+
+		/**
+		 * Retira da cache os blocos com instruções em
+		 * [address, address + size).
+		 */
+		void invalidateBlocks(uint64_t address, uint64_t size);
+
+		/**
+		 * Retorna o bloco que começa em address, traduzindo-o se
+		 * necessário.
+		 */
+		Block *getBlock(uint64_t address);
+
+		/**
+		 * Traduz o bloco básico que começa em address, com no máximo
+		 * maxSize instruções.
+		 */
+		Block *translate(uint64_t address, uint64_t maxSize = BLOCK_MAX_SIZE);
+
+		/**
+		 * Laço do interpretador: executa a partir de PC até o fim do
+		 * programa, um erro, maxInstructions instruções ou o endereço
+		 * stopAddress (ver CPU::runFor e CPU::runUntil).
+		 */
+		template <class MemoryType>
+		RunResult interpret(MemoryType *memory, uint64_t maxInstructions,
+							uint64_t stopAddress);
+
+		/**
+		 * Troca o tratador da primeira instrução de cada par fundível de
+		 * block pelo do par (MACRO_FUSION). op e os demais campos das
+		 * instruções não mudam.
+		 */
+		void fuse(Block *block);
+
+		/**
+		 * Se as flags NZCV podem ser lidas a partir de address antes de
+		 * serem reescritas. Examina até FUSION_SCAN instruções, seguindo
+		 * desvios diretos (os dois caminhos de CBZ e CBNZ até depth
+		 * vezes); chamadas, retornos e desvios indiretos contam como
+		 * leitura.
+		 */
+		bool flagsLive(uint64_t address, int depth, Block *block);
+
+		/**
+		 * Desfaz todo encadeamento entre blocos.
+		 */
+		void unchainBlocks();
+
+		/**
+		 * Imprime as estatísticas da cache de blocos.
+		 */
+		virtual void printBlockStats();
+
+		/**
+		 * Decodifica ir, escrevendo os campos de inst.
+		 *
+		 * Retorna a operação correspondente ou OP_UNDEFINED, se a
+		 * instrução não estiver implementada.
+		 */
+		Op decode(uint32_t ir, Instruction *inst);
+
+		/**
+		 * Tipo, para os modelos de previsão, do desvio da operação op.
+		 */
+		static BranchPredictor::BranchType branchType(uint8_t op);
+
+	private:
+		Op decodeDataProcImm(uint32_t ir, Instruction *inst);
+		Op decodeDataProcReg(uint32_t ir, Instruction *inst);
+		Op decodeLoadStore(uint32_t ir, Instruction *inst);
+		Op decodeBranches(uint32_t ir, Instruction *inst);
+		Op decodeDataProcFloat(uint32_t ir, Instruction *inst);
+		Op decodeSIMDThreeSame(uint32_t ir, Instruction *inst);
+};
@@ -0,0 +1,131 @@
+/* ----------------------------------------------------------------------------
+
+    (EN) armethyst - A simple ARM Simulator written in C++ for Computer Architecture
+    teaching purposes. Free software licensed under the MIT License (see license
+    below).
+
+    (PT) armethyst - Um simulador ARM simples escrito em C++ para o ensino de
+    Arquitetura de Computadores. Software livre licenciado pela MIT License
+    (veja a licença, em inglês, abaixo).
+
+    (EN) MIT LICENSE:
+
+    Copyright 2020 André Vital Saúde
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+   ----------------------------------------------------------------------------
+*/
+
+#include "FastCPUCheck.h"
+#include "Check.h"
+#include "BasicCPU.h"
+#include "FastCPU.h"
+
+using namespace std;
+
+#define CHECK_N 1000
+
+/**
+ * A FastCPU, sobre memory, chega aos mesmos estados que a BasicCPU em
+ * fatias de runFor de vários tamanhos, que param no meio dos blocos e
+ * entre as instruções de pares fundidos, e termina com os mesmos
+ * resultados na memória.
+ */
+static void checkSlicesAgainstBasicCPU(int memImpl)
+{
+	string name = "FastCPU runFor slices against BasicCPU on " + memoryName(memImpl);
+	beginCheck(name);
+
+	Memory *refMemory = createMemory(MEM_IMPL_BASIC);
+	Memory *memory = createMemory(memImpl);
+	CheckProgram program = assembleCheckProgram(refMemory, CHECK_N);
+	assembleCheckProgram(memory, CHECK_N);
+	BasicCPU *ref = new BasicCPU(refMemory);
+	FastCPU *cpu = new FastCPU(memory);
+	startCheckProgram(ref, program);
+	startCheckProgram(cpu, program);
+
+	static const uint64_t slices[] = {1, 2, 3, 5, 7, 11, 64, 1000};
+	uint64_t retired = checkSlices(ref, cpu, slices, 8, CPU::NO_LIMIT);
+	cout << "	" << retired << " instructions" << endl;
+
+	CHECK(memory->readData32(program.result) == checkProgramSum(CHECK_N));
+	CHECK(memory->readData32(program.result + 8) == checkProgramThirds(CHECK_N));
+	CHECK(memory->readData32(program.result + 12) == checkProgramSum(CHECK_N));
+	checkSameMemory(refMemory, memory, program.result, 16 + 4 * CHECK_N);
+
+	delete cpu;
+	delete ref;
+	delete memory;
+	delete refMemory;
+	endCheck(name);
+}
+
+/**
+ * runUntil para no mesmo estado que na BasicCPU a cada volta do laço, e
+ * uma execução inteira (run) chega aos mesmos resultados.
+ */
+static void checkRunUntil()
+{
+	string name = "FastCPU runUntil against BasicCPU";
+	beginCheck(name);
+
+	Memory *refMemory = createMemory(MEM_IMPL_BASIC);
+	Memory *memory = createMemory(MEM_IMPL_BASIC);
+	CheckProgram program = assembleCheckProgram(refMemory, CHECK_N);
+	assembleCheckProgram(memory, CHECK_N);
+	BasicCPU *ref = new BasicCPU(refMemory);
+	FastCPU *cpu = new FastCPU(memory);
+	startCheckProgram(ref, program);
+	startCheckProgram(cpu, program);
+
+	CPUState refState, cpuState;
+	for (int i = 0; i < 100; i++) {
+		CPU::RunResult expected = ref->runUntil(program.loop);
+		CPU::RunResult result = cpu->runUntil(program.loop);
+		CHECK(result.reason == CPU::EXIT_ADDRESS);
+		CHECK(result.PC == program.loop);
+		CHECK(result.retired == expected.retired);
+		ref->getState(refState);
+		cpu->getState(cpuState);
+		CHECK(sameState(refState, cpuState));
+	}
+
+	CPU::RunResult result = cpu->runUntil(CPU::NO_ADDRESS);
+	ref->runUntil(CPU::NO_ADDRESS);
+	CHECK(result.reason == CPU::EXIT_FINISHED);
+	ref->getState(refState);
+	cpu->getState(cpuState);
+	CHECK(sameState(refState, cpuState));
+	checkSameMemory(refMemory, memory, program.result, 16);
+
+	delete cpu;
+	delete ref;
+	delete memory;
+	delete refMemory;
+	endCheck(name);
+}
+
+void checkFastCPU()
+{
+	checkSlicesAgainstBasicCPU(MEM_IMPL_BASIC);
+	checkSlicesAgainstBasicCPU(MEM_IMPL_SPARSE);
+	checkRunUntil();
+}
@@ -0,0 +1,105 @@
+/* ----------------------------------------------------------------------------
+
+    (EN) armethyst - A simple ARM Simulator written in C++ for Computer Architecture
+    teaching purposes. Free software licensed under the MIT License (see license
+    below).
+
+    (PT) armethyst - Um simulador ARM simples escrito em C++ para o ensino de
+    Arquitetura de Computadores. Software livre licenciado pela MIT License
+    (veja a licença, em inglês, abaixo).
+
+    (EN) MIT LICENSE:
+
+    Copyright 2020 André Vital Saúde
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+   ----------------------------------------------------------------------------
+*/
+
+#include "FaultCheck.h"
+#include "Check.h"
+#include "Assembler.h"
+#include "SimulatorError.h"
+
+using namespace std;
+
+// voltas do laço até sair da memória, acima de JIT_THRESHOLD para que a
+// JITCPU o compile antes
+#define FAULT_LOOPS (JIT_THRESHOLD + 10)
+#define FAULT_STRIDE 1024
+
+/**
+ * Um laço sem fim lê (ou escreve, se write) palavras a cada FAULT_STRIDE
+ * bytes, descendo até passar do endereço 0, além do fim da memória em
+ * 64 bits (e de ADDRESS_BITS, na SparseMemory): o acesso fora dela lança
+ * SimulatorError de runFor, mesmo a partir do código nativo da JITCPU,
+ * em vez de encerrar o simulador ou acessar fora do buffer.
+ */
+static void checkOutOfRange(int cpuImpl, int memImpl, bool write)
+{
+	string name = string(write ? "store" : "load") + " out of range on "
+					+ cpuName(cpuImpl) + " (" + memoryName(memImpl) + ")";
+	beginCheck(name);
+
+	Memory *memory = createMemory(memImpl);
+	Assembler as(memory);
+	Assembler::Label loop;
+	uint64_t entry = as.here();
+	as.bind(loop);
+	if (write) {
+		as.str(W(2), X(1));
+	} else {
+		as.ldr(W(2), X(1));
+	}
+	as.sub(X(1), X(1), FAULT_STRIDE);
+	as.b(loop);
+	as.finish();
+
+	CPU *cpu = createCPU(cpuImpl, memory);
+	cpu->start(entry);
+	CPUState state;
+	cpu->getState(state);
+	state.R[1] = (FAULT_LOOPS - 1) * FAULT_STRIDE + FAULT_STRIDE / 2;
+	cpu->setState(state);
+
+	string message;
+	try {
+		cpu->runFor(CPU::NO_LIMIT);
+	} catch (const SimulatorError &error) {
+		message = error.what();
+	}
+	cout << "	" << message << endl;
+	CHECK(message.find("out of range") != string::npos);
+
+	delete cpu;
+	delete memory;
+	endCheck(name);
+}
+
+void checkFaults()
+{
+	static const int cpus[] = {CPU_IMPL_BASIC, CPU_IMPL_FAST, CPU_IMPL_JIT};
+	for (int cpuImpl : cpus) {
+		checkOutOfRange(cpuImpl, MEM_IMPL_BASIC, false);
+		checkOutOfRange(cpuImpl, MEM_IMPL_BASIC, true);
+		checkOutOfRange(cpuImpl, MEM_IMPL_SPARSE, false);
+		checkOutOfRange(cpuImpl, MEM_IMPL_SPARSE, true);
+	}
+}
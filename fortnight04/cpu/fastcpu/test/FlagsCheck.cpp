@@ -0,0 +1,344 @@
+/* ----------------------------------------------------------------------------
+
+    (EN) armethyst - A simple ARM Simulator written in C++ for Computer Architecture
+    teaching purposes. Free software licensed under the MIT License (see license
+    below).
+
+    (PT) armethyst - Um simulador ARM simples escrito em C++ para o ensino de
+    Arquitetura de Computadores. Software livre licenciado pela MIT License
+    (veja a licença, em inglês, abaixo).
+
+    (EN) MIT LICENSE:
+
+    Copyright 2020 André Vital Saúde
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+   ----------------------------------------------------------------------------
+*/
+
+#include "FlagsCheck.h"
+#include "Check.h"
+#include "Assembler.h"
+#include "Flags.h"
+
+#include <iomanip>
+#include <vector>
+
+using namespace std;
+
+// passadas por todos os pares de operandos: cada programa de forma
+// imediata roda 10 vezes por passada, e precisa passar de JIT_THRESHOLD
+// para que a JITCPU também o execute nativamente
+#define FLAGS_PASSES (JIT_THRESHOLD / 10 + 1)
+
+// registradores X11-X26 recebem, cada um, se a condição 0-15 foi satisfeita
+#define FLAGS_FIRST_REG 11
+
+/**
+ * Operandos de fronteira: zero, um, os extremos com e sem sinal de 32 e
+ * 64 bits e valores cujos 32 bits baixos diferem dos 64 bits, para que as
+ * operações de 32 bits (que só leem Wn) passem pelo estouro de 32 bits.
+ */
+static const uint64_t operands[] = {
+	0, 1, 0x7FFFFFFF, 0x80000000, 0xFFFFFFFF, 0x100000000,
+	0x7FFFFFFFFFFFFFFF, 0x8000000000000000, 0xFFFFFFFFFFFFFFFF,
+	0xFFFFFFFF80000000,
+};
+
+// imediatos de 12 bits das formas ADDS/SUBS (imm)
+static const uint64_t immediates[] = {0, 1, 4095};
+
+/**
+ * Uma das formas de instrução que escrevem as flags.
+ */
+struct FlagsForm {
+	const char *name;
+	bool sub;		// SUBS, CMP (senão ADDS, CMN)
+	bool discard;	// CMP, CMN: destino XZR/WZR
+	bool sf;		// 64 bits
+	bool imm;		// segundo operando imediato (senão X1/W1)
+};
+
+static const FlagsForm forms[] = {
+	{"cmp w, #imm", true, true, false, true},
+	{"cmp x, #imm", true, true, true, true},
+	{"cmp w, w", true, true, false, false},
+	{"cmp x, x", true, true, true, false},
+	{"cmn w, #imm", false, true, false, true},
+	{"cmn x, #imm", false, true, true, true},
+	{"cmn w, w", false, true, false, false},
+	{"cmn x, x", false, true, true, false},
+	{"subs w, w, #imm", true, false, false, true},
+	{"subs x, x, #imm", true, false, true, true},
+	{"subs w, w, w", true, false, false, false},
+	{"subs x, x, x", true, false, true, false},
+	{"adds w, w, #imm", false, false, false, true},
+	{"adds x, x, #imm", false, false, true, true},
+	{"adds w, w, w", false, false, false, false},
+	{"adds x, x, x", false, false, true, false},
+};
+
+static __int128 signExtend(uint64_t value, bool sf)
+{
+	return sf ? (__int128)(int64_t)value : (__int128)(int32_t)value;
+}
+
+/**
+ * NZCV calculado imediatamente, como AddWithCarry do manual da
+ * arquitetura: a subtração a - b é a + ~b + 1. Devolve também o resultado
+ * (estendido com zeros, nas operações de 32 bits).
+ */
+static uint32_t referenceNZCV(uint64_t a, uint64_t b, bool sub, bool sf,
+								uint64_t &result)
+{
+	uint64_t mask = sf ? ~(uint64_t)0 : 0xFFFFFFFF;
+	uint64_t x = a & mask;
+	uint64_t y = (sub ? ~b : b) & mask;
+	unsigned __int128 usum = (unsigned __int128)x + y + sub;
+	__int128 ssum = signExtend(x, sf) + signExtend(y, sf) + sub;
+	result = (uint64_t)usum & mask;
+
+	uint32_t n = result >> (sf ? 63 : 31);
+	uint32_t z = result == 0;
+	uint32_t c = usum != result;
+	uint32_t v = signExtend(result, sf) != ssum;
+	return n << 31 | z << 30 | c << 29 | v << 28;
+}
+
+/**
+ * ConditionHolds do manual da arquitetura, a partir de NZCV.
+ */
+static bool referenceCondition(uint32_t nzcv, int cond)
+{
+	bool n = nzcv >> 31 & 1;
+	bool z = nzcv >> 30 & 1;
+	bool c = nzcv >> 29 & 1;
+	bool v = nzcv >> 28 & 1;
+	bool result;
+	switch (cond >> 1) {
+		case 0: result = z; break;
+		case 1: result = c; break;
+		case 2: result = n; break;
+		case 3: result = v; break;
+		case 4: result = c && !z; break;
+		case 5: result = n == v; break;
+		case 6: result = n == v && !z; break;
+		default: result = true; break;
+	}
+	return (cond & 1) && cond != 15 ? !result : result;
+}
+
+static void printOperands(const FlagsForm &form, uint64_t a, uint64_t b)
+{
+	cout << "	" << form.name << ": a = 0x" << hex << a << ", b = 0x" << b
+			<< dec << endl;
+}
+
+/**
+ * Flags::getNZCV e Flags::condition, para as 16 condições, depois de
+ * setAdd e setSub (e de setNZCV com o resultado), contra a referência.
+ */
+static void checkLazyFlags()
+{
+	string name = "lazy flags against the NZCV reference";
+	beginCheck(name);
+
+	for (const FlagsForm &form : forms) {
+		if (form.imm) {
+			continue;
+		}
+		for (uint64_t a : operands) {
+			for (uint64_t b : operands) {
+				uint64_t r;
+				uint32_t expected = referenceNZCV(a, b, form.sub, form.sf, r);
+				Flags flags;
+				if (form.sf && form.sub) {
+					flags.setSub<uint64_t>(a, b, r);
+				} else if (form.sf) {
+					flags.setAdd<uint64_t>(a, b, r);
+				} else if (form.sub) {
+					flags.setSub<uint32_t>(a, b, r);
+				} else {
+					flags.setAdd<uint32_t>(a, b, r);
+				}
+				if (flags.getNZCV() != expected) {
+					printOperands(form, a, b);
+				}
+				CHECK(flags.getNZCV() == expected);
+				for (int cond = 0; cond < 16; cond++) {
+					if (flags.condition(cond) != referenceCondition(expected, cond)) {
+						printOperands(form, a, b);
+						cout << "	cond " << cond << endl;
+					}
+					CHECK(flags.condition(cond) == referenceCondition(expected, cond));
+				}
+
+				flags.setNZCV(expected);
+				CHECK(flags.getNZCV() == expected);
+				for (int cond = 0; cond < 16; cond++) {
+					CHECK(flags.condition(cond) == referenceCondition(expected, cond));
+				}
+			}
+		}
+	}
+
+	endCheck(name);
+}
+
+static void assembleFlagsOp(Assembler &as, const FlagsForm &form, uint64_t imm)
+{
+	Assembler::Reg n = form.sf ? X(0) : W(0);
+	Assembler::Reg m = form.sf ? X(1) : W(1);
+	Assembler::Reg d = form.discard ? (form.sf ? XZR : WZR)
+									: (form.sf ? X(2) : W(2));
+	if (form.imm && form.sub) {
+		as.subs(d, n, imm);
+	} else if (form.imm) {
+		as.adds(d, n, imm);
+	} else if (form.sub) {
+		as.subs(d, n, m);
+	} else {
+		as.adds(d, n, m);
+	}
+}
+
+/**
+ * Monta, para cada condição c de 0 a 15 (inclusive NV, que o Assembler
+ * não nomeia),
+ *
+ *		b.c taken
+ *		b next
+ *	taken:
+ *		sub x(11+c), x(11+c), #1
+ *	next:
+ *
+ * duas vezes: a primeira depois de uma única instrução de form, de modo
+ * que quase todo B.cond está em outro bloco e lê flags de operação
+ * desconhecida; a segunda com a instrução repetida antes de cada B.cond,
+ * no mesmo bloco (ou fundida a ele). Os operandos vêm de X0 e X1 (ou imm)
+ * e o resultado vai para X2, em SUBS e ADDS.
+ */
+static uint64_t assembleForm(Assembler &as, const FlagsForm &form, uint64_t imm)
+{
+	uint64_t entry = as.here();
+	assembleFlagsOp(as, form, imm);
+	for (int repeat = 0; repeat < 2; repeat++) {
+		for (int cond = 0; cond < 16; cond++) {
+			Assembler::Label taken, next;
+			if (repeat) {
+				assembleFlagsOp(as, form, imm);
+			}
+			as.b((Assembler::Cond)cond, taken);
+			as.b(next);
+			as.bind(taken);
+			as.sub(X(FLAGS_FIRST_REG + cond), X(FLAGS_FIRST_REG + cond), 1);
+			as.bind(next);
+		}
+	}
+	as.ret();
+	return entry;
+}
+
+/**
+ * Executa cada forma, na CPU cpuImpl, para todos os pares de operandos
+ * de fronteira, e compara NZCV, o resultado e as condições satisfeitas
+ * pelos B.cond com a referência. A BasicCPU só decodifica CMP (imm) de
+ * 32 bits.
+ */
+static void checkCPUFlags(int cpuImpl)
+{
+	string name = "flags on " + cpuName(cpuImpl);
+	beginCheck(name);
+
+	Memory *memory = createMemory(MEM_IMPL_BASIC);
+	Assembler as(memory);
+	uint64_t entries[sizeof(forms) / sizeof(forms[0])][3];
+	for (unsigned f = 0; f < sizeof(forms) / sizeof(forms[0]); f++) {
+		for (unsigned i = 0; i < (forms[f].imm ? 3 : 1); i++) {
+			entries[f][i] = assembleForm(as, forms[f], immediates[i]);
+		}
+	}
+	as.finish();
+
+	CPU *cpu = createCPU(cpuImpl, memory);
+	for (int pass = 0; pass < FLAGS_PASSES; pass++) {
+		for (unsigned f = 0; f < sizeof(forms) / sizeof(forms[0]); f++) {
+			const FlagsForm &form = forms[f];
+			if (cpuImpl == CPU_IMPL_BASIC && (!form.imm || form.sf || !form.discard || !form.sub)) {
+				continue;
+			}
+			for (unsigned i = 0; i < (form.imm ? 3 : 1); i++) {
+				vector<uint64_t> bs(operands, operands + sizeof(operands) / sizeof(operands[0]));
+				if (form.imm) {
+					bs.assign(1, immediates[i]);
+				}
+				for (uint64_t a : operands) {
+					for (uint64_t b : bs) {
+						uint64_t r;
+						uint32_t expected = referenceNZCV(a, b, form.sub, form.sf, r);
+
+						cpu->start(entries[f][i]);
+						CPUState state;
+						cpu->getState(state);
+						state.R[0] = a;
+						state.R[1] = b;
+						state.R[2] = 0;
+						for (int cond = 0; cond < 16; cond++) {
+							state.R[FLAGS_FIRST_REG + cond] = 0;
+						}
+						cpu->setState(state);
+						CHECK(cpu->runFor(CPU::NO_LIMIT).reason == CPU::EXIT_FINISHED);
+						cpu->getState(state);
+
+						if (state.NZCV != expected) {
+							printOperands(form, a, b);
+							cout << "	NZCV 0x" << hex << state.NZCV << ", expected 0x"
+									<< expected << dec << endl;
+						}
+						CHECK(state.NZCV == expected);
+						CHECK(state.R[2] == (form.discard ? 0 : r));
+						for (int cond = 0; cond < 16; cond++) {
+							// -2 se as duas vezes desviaram, 0 se nenhuma
+							uint64_t taken = referenceCondition(expected, cond) ? -2 : 0;
+							if (state.R[FLAGS_FIRST_REG + cond] != taken) {
+								printOperands(form, a, b);
+								cout << "	cond " << cond << ": "
+										<< (int64_t)state.R[FLAGS_FIRST_REG + cond] << endl;
+							}
+							CHECK(state.R[FLAGS_FIRST_REG + cond] == taken);
+						}
+					}
+				}
+			}
+		}
+	}
+
+	delete cpu;
+	delete memory;
+	endCheck(name);
+}
+
+void checkFlags()
+{
+	checkLazyFlags();
+	checkCPUFlags(CPU_IMPL_BASIC);
+	checkCPUFlags(CPU_IMPL_FAST);
+	checkCPUFlags(CPU_IMPL_JIT);
+}
@@ -0,0 +1,260 @@
+/* ----------------------------------------------------------------------------
+
+    (EN) armethyst - A simple ARM Simulator written in C++ for Computer Architecture
+    teaching purposes. Free software licensed under the MIT License (see license
+    below).
+
+    (PT) armethyst - Um simulador ARM simples escrito em C++ para o ensino de
+    Arquitetura de Computadores. Software livre licenciado pela MIT License
+    (veja a licença, em inglês, abaixo).
+
+    (EN) MIT LICENSE:
+
+    Copyright 2020 André Vital Saúde
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+   ----------------------------------------------------------------------------
+*/
+
+#include "FusionCheck.h"
+#include "Check.h"
+#include "Assembler.h"
+#include "ElfLoader.h"
+#include "FastCPU.h"
+#include "JITCPU.h"
+
+using namespace std;
+
+#define CHECK_N 1000
+
+/**
+ * FastCPU ou JITCPU que informa quais pares fundidos (ver
+ * FastCPU::fuse) há nos blocos traduzidos.
+ */
+template <class Base>
+class FusionCheckCPU: public Base
+{
+	public:
+		FusionCheckCPU(Memory *memory) : Base(memory) {}
+
+		int fusedKinds()
+		{
+			int kinds = 0;
+			for (int op = Base::OP_ADRP_ADD; op < Base::OP_COUNT; op++) {
+				bool seen = false;
+				for (auto &entry : this->blocks) {
+					for (auto &inst : entry.second->code) {
+						seen = seen || inst.handler == this->handlers[op];
+					}
+				}
+				kinds += seen;
+			}
+			return kinds;
+		}
+
+		static const int ALL_KINDS = Base::OP_COUNT - Base::OP_ADRP_ADD;
+};
+
+/**
+ * Um laço com os sete pares fundíveis. As flags dos CMP fundidos são
+ * lidas depois do desvio por B.cond, inclusive além de um CBZ, ou
+ * reescritas antes de serem lidas.
+ */
+struct FusionProgram {
+	uint64_t entry;
+	uint64_t data;		// contador (w), n, acumulador, limites
+};
+
+static FusionProgram assembleFusionProgram(Memory *memory)
+{
+	Assembler as(memory);
+	Assembler::Label loop, skip, low, lowOrEq, above, next, carry, data;
+	FusionProgram program;
+	program.entry = as.here();
+
+	as.addressOf(X(0), data);
+	as.ldr(X(9), X(0), 8);
+	as.ldr(W(4), X(0), 24);
+	as.ldr(X(10), X(0), 32);
+	as.bind(loop);
+	as.ldr(W(1), X(0));
+	as.add(W(1), W(1), 1);
+	as.str(W(1), X(0));
+	as.ldr(X(2), X(0), 16);
+	as.add(X(2), X(2), 3);
+	as.str(X(2), X(0), 16);
+	as.cmp(W(1), 7);
+	as.b(Assembler::NE, skip);
+	as.add(X(3), X(3), 1);
+	as.bind(skip);
+	as.cmp(W(1), W(4));
+	as.b(Assembler::LT, low);
+	as.add(X(5), X(5), 1);
+	as.bind(low);
+	as.b(Assembler::LE, lowOrEq);
+	as.add(X(6), X(6), 1);
+	as.bind(lowOrEq);
+	as.cmp(X(1), X(10));
+	as.b(Assembler::HI, above);
+	as.add(X(7), X(7), 1);
+	as.bind(above);
+	as.cbz(X(11), next);
+	as.nop();
+	as.bind(next);
+	as.b(Assembler::CS, carry);
+	as.add(X(8), X(8), 1);
+	as.bind(carry);
+	as.subs(X(9), X(9), 1);
+	as.b(Assembler::NE, loop);
+	as.addressOf(X(13), data);
+	as.ret();
+
+	as.align(HOST_PAGE_SIZE);
+	as.bind(data);
+	as.word(0);
+	as.word(0);
+	as.dword(CHECK_N);
+	as.dword(0);
+	as.word(CHECK_N / 2);
+	as.word(0);
+	as.dword(7 * CHECK_N / 10);
+	as.finish();
+
+	program.data = data.getAddress();
+	return program;
+}
+
+/**
+ * Compara cpu, em fatias de runFor, com ref executando uma instrução por
+ * runFor: as fatias param no meio de pares e de blocos nativos, e o
+ * estado, inclusive NZCV, deve ser o da execução sem fusão.
+ */
+static uint64_t checkAgainstSteps(CPU *ref, CPU *cpu)
+{
+	static const uint64_t slices[] = {1, 2, 3, 5, 7, 11, 13, 64, 1000};
+	CPUState refState, cpuState;
+	uint64_t total = 0;
+	for (int i = 0; ; i++) {
+		uint64_t slice = slices[i % 9];
+		CPU::RunResult result = cpu->runFor(slice);
+		for (uint64_t j = 0; j < result.retired; j++) {
+			CHECK(ref->runFor(1).retired == 1);
+		}
+		total += result.retired;
+
+		ref->getState(refState);
+		cpu->getState(cpuState);
+		if (!sameState(refState, cpuState)) {
+			cout << "	after runFor(" << slice << "), " << total << " instructions:" << endl;
+			printStateDiff(refState, cpuState);
+		}
+		CHECK(sameState(refState, cpuState));
+		if (result.reason != CPU::EXIT_LIMIT) {
+			CHECK(result.reason == CPU::EXIT_FINISHED);
+			return total;
+		}
+	}
+}
+
+template <class CPUType>
+static void checkFusionProgram(string cpuName)
+{
+	string name = "fused pairs on " + cpuName + " against single steps";
+	beginCheck(name);
+
+	Memory *refMemory = createMemory(MEM_IMPL_BASIC);
+	Memory *memory = createMemory(MEM_IMPL_BASIC);
+	FusionProgram program = assembleFusionProgram(refMemory);
+	assembleFusionProgram(memory);
+	FastCPU *ref = new FastCPU(refMemory);
+	FusionCheckCPU<CPUType> *cpu = new FusionCheckCPU<CPUType>(memory);
+	ref->start(program.entry);
+	cpu->start(program.entry);
+
+	uint64_t retired = checkAgainstSteps(ref, cpu);
+	int kinds = cpu->fusedKinds();
+	cout << "	" << retired << " instructions, " << kinds << " kinds of fused pairs" << endl;
+	if (MACRO_FUSION) {
+		CHECK(kinds == FusionCheckCPU<CPUType>::ALL_KINDS);
+	}
+
+	// contagens de cada caminho do laço, para w1 = 1..n
+	CPUState state;
+	cpu->getState(state);
+	CHECK(state.R[3] == 1);
+	CHECK(state.R[5] == CHECK_N / 2 + 1);
+	CHECK(state.R[6] == CHECK_N / 2);
+	CHECK(state.R[7] == 7 * CHECK_N / 10);
+	CHECK(state.R[8] == 7 * CHECK_N / 10 - 1);
+	CHECK(state.R[13] == program.data);
+	CHECK(memory->readData32(program.data) == CHECK_N);
+	CHECK(memory->readData64(program.data + 16) == 3 * CHECK_N);
+	checkSameMemory(refMemory, memory, program.data, 40);
+
+	delete cpu;
+	delete ref;
+	delete memory;
+	delete refMemory;
+	endCheck(name);
+}
+
+/**
+ * isummation.o, código do compilador com ADRP + ADD, LDR + ADD e CMP +
+ * B.cond.
+ */
+static void checkCompiledProgram()
+{
+	string name = "fused pairs on isummation.o against single steps";
+	beginCheck(name);
+
+	Memory *refMemory = createMemory(MEM_IMPL_BASIC);
+	Memory *memory = createMemory(MEM_IMPL_BASIC);
+	ElfLoader refLoader(refMemory);
+	ElfLoader loader(memory);
+	uint64_t entry = refLoader.load("isummation.o");
+	loader.load("isummation.o");
+	FastCPU *ref = new FastCPU(refMemory);
+	FusionCheckCPU<FastCPU> *cpu = new FusionCheckCPU<FastCPU>(memory);
+	ref->setSP(MEMORY_SIZE);
+	cpu->setSP(MEMORY_SIZE);
+	ref->start(entry);
+	cpu->start(entry);
+
+	uint64_t retired = checkAgainstSteps(ref, cpu);
+	int kinds = cpu->fusedKinds();
+	cout << "	" << retired << " instructions, " << kinds << " kinds of fused pairs" << endl;
+	if (MACRO_FUSION) {
+		CHECK(kinds >= 3);
+	}
+	CHECK(memory->readData32(loader.findSymbol("summ")) == 55);
+
+	delete cpu;
+	delete ref;
+	delete memory;
+	delete refMemory;
+	endCheck(name);
+}
+
+void checkFusion()
+{
+	checkFusionProgram<FastCPU>("FastCPU");
+	checkFusionProgram<JITCPU>("JITCPU");
+	checkCompiledProgram();
+}
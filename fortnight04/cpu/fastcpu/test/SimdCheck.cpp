@@ -0,0 +1,224 @@
+/* ----------------------------------------------------------------------------
+
+    (EN) armethyst - A simple ARM Simulator written in C++ for Computer Architecture
+    teaching purposes. Free software licensed under the MIT License (see license
+    below).
+
+    (PT) armethyst - Um simulador ARM simples escrito em C++ para o ensino de
+    Arquitetura de Computadores. Software livre licenciado pela MIT License
+    (veja a licença, em inglês, abaixo).
+
+    (EN) MIT LICENSE:
+
+    Copyright 2020 André Vital Saúde
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+   ----------------------------------------------------------------------------
+*/
+
+#include "SimdCheck.h"
+#include "Check.h"
+#include "Assembler.h"
+
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+
+using namespace std;
+
+// vezes que o programa é executado, para que a JITCPU compile o bloco
+#define SIMD_RUNS (2 * JIT_THRESHOLD)
+
+/**
+ * Dados do programa, em registradores Q de 128 bits: [0] com os bits
+ * 63-0 e [1] com os bits 127-64, como em CPUState::V.
+ */
+struct SimdData {
+	uint64_t a[2], b[2], c[2];	// 4S de ponto flutuante (ou 2D)
+	uint64_t p[2], q[2], r[2];	// inteiros
+	uint64_t out[2][2];			// gravados por STR Q
+};
+
+/**
+ * Valor esperado de cada elemento: f(n[i], m[i], d[i]), calculado pelo
+ * hospedeiro elemento a elemento. Com half, só a metade inferior (8B,
+ * 4H, 2S), e a superior fica nula.
+ */
+template <class T, class F>
+static void expected(uint64_t d[2], const uint64_t n[2], const uint64_t m[2], F f,
+						bool half = false)
+{
+	const int count = 16 / sizeof(T);
+	T a[count], b[count], c[count];
+	memcpy(a, n, 16);
+	memcpy(b, m, 16);
+	memcpy(c, d, 16);
+	for (int i = 0; i < count; i++) {
+		c[i] = f(a[i], b[i], c[i]);
+	}
+	memcpy(d, c, 16);
+	if (half) {
+		d[1] = 0;
+	}
+}
+
+static void checkVector(CPUState &state, int v, const uint64_t value[2], string text)
+{
+	if (state.V[v][0] != value[0] || state.V[v][1] != value[1]) {
+		cout << hex << setfill('0') << "	" << text << ": V" << dec << v << hex
+				<< "=0x" << setw(16) << state.V[v][1] << setw(16) << state.V[v][0]
+				<< ";  Expected 0x" << setw(16) << value[1] << setw(16) << value[0]
+				<< dec << setfill(' ') << endl;
+	}
+	CHECK(state.V[v][0] == value[0] && state.V[v][1] == value[1]);
+}
+
+/**
+ * Instruções vetoriais (palavras do llvm-mc, montadas por emit), sobre
+ * dados lidos e gravados por LDR e STR Q; V7, V13 e V14, escritos em
+ * arranjos de 64 bits ou por uma instrução escalar, começam com a metade
+ * superior não nula, que deve ser zerada.
+ */
+static void checkVectorOps(int cpuImpl)
+{
+	string name = "Advanced SIMD arithmetic on " + cpuName(cpuImpl);
+	beginCheck(name);
+
+	Memory *memory = createMemory(MEM_IMPL_BASIC);
+	Assembler as(memory);
+	Assembler::Label data;
+	uint64_t entry = as.here();
+	as.addressOf(X(0), data);
+	as.emit(0x3dc00000);	// ldr q0, [x0]
+	as.emit(0x3dc00401);	// ldr q1, [x0, #16]
+	as.emit(0x3dc00802);	// ldr q2, [x0, #32]
+	as.emit(0x3dc00c10);	// ldr q16, [x0, #48]
+	as.emit(0x3dc01011);	// ldr q17, [x0, #64]
+	as.emit(0x3ce17812);	// ldr q18, [x0, x1, lsl #4]
+	as.emit(0x4e21d403);	// fadd v3.4s, v0.4s, v1.4s
+	as.emit(0x4ea1d404);	// fsub v4.4s, v0.4s, v1.4s
+	as.emit(0x6e21dc05);	// fmul v5.4s, v0.4s, v1.4s
+	as.emit(0x4e21cc02);	// fmla v2.4s, v0.4s, v1.4s
+	as.emit(0x4e61d406);	// fadd v6.2d, v0.2d, v1.2d
+	as.emit(0x0e21d407);	// fadd v7.2s, v0.2s, v1.2s
+	as.emit(0x4e318608);	// add v8.16b, v16.16b, v17.16b
+	as.emit(0x6e718609);	// sub v9.8h, v16.8h, v17.8h
+	as.emit(0x4eb19e0a);	// mul v10.4s, v16.4s, v17.4s
+	as.emit(0x4ef1860b);	// add v11.2d, v16.2d, v17.2d
+	as.emit(0x4e319e0c);	// mul v12.16b, v16.16b, v17.16b
+	as.emit(0x0e719e0d);	// mul v13.4h, v16.4h, v17.4h
+	as.emit(0x1e21280e);	// fadd s14, s0, s1
+	as.emit(0x3d801803);	// str q3, [x0, #96]
+	as.emit(0x3ca27808);	// str q8, [x0, x2, lsl #4]
+	as.ret();
+
+	as.align(HOST_PAGE_SIZE);
+	as.bind(data);
+	SimdData in;
+	float a[4] = {1.5f, -2.25f, 1e30f, 0.1f};
+	float b[4] = {0.5f, 4.0f, 1e30f, 0.2f};
+	float c[4] = {10.0f, -1.0f, 0.0f, 3.0f};
+	memcpy(in.a, a, 16);
+	memcpy(in.b, b, 16);
+	memcpy(in.c, c, 16);
+	in.p[0] = 0x8070605004030201ULL;
+	in.p[1] = 0xfffefdfc7fff0001ULL;
+	in.q[0] = 0x90a0b0c0ffeeddccULL;
+	in.q[1] = 0x00010203ffff8000ULL;
+	in.r[0] = 0x0123456789abcdefULL;
+	in.r[1] = 0xfedcba9876543210ULL;
+	memset(in.out, 0, sizeof(in.out));
+	for (uint64_t *word = in.a; word < in.a + sizeof(in) / 8; word++) {
+		as.dword(*word);
+	}
+	as.finish();
+	uint64_t base = data.getAddress();
+
+	CPU *cpu = createCPU(cpuImpl, memory);
+	CPUState state;
+	for (int run = 0; run < SIMD_RUNS; run++) {
+		cpu->start(entry);
+		cpu->getState(state);
+		state.R[1] = 5;		// q18 = r
+		state.R[2] = 7;		// out[1]
+		for (int v : {7, 13, 14}) {
+			state.V[v][1] = 0x5555555555555555ULL;
+		}
+		cpu->setState(state);
+		CHECK(cpu->runFor(CPU::NO_LIMIT).reason == CPU::EXIT_FINISHED);
+	}
+	cpu->getState(state);
+
+	uint64_t value[2];
+	auto fadd = [](auto x, auto y, auto) { return x + y; };
+	auto fsub = [](auto x, auto y, auto) { return x - y; };
+	auto fmul = [](auto x, auto y, auto) { return x * y; };
+	auto fmla = [](auto x, auto y, auto z) { return std::fma(x, y, z); };
+	auto add = [](auto x, auto y, auto) { return (decltype(x))(x + y); };
+	auto sub = [](auto x, auto y, auto) { return (decltype(x))(x - y); };
+	auto mul = [](auto x, auto y, auto) { return (decltype(x))(x * y); };
+
+	checkVector(state, 0, in.a, "ldr q0");
+	checkVector(state, 18, in.r, "ldr q18, [x0, x1, lsl #4]");
+	expected<float>(value, in.a, in.b, fadd);
+	checkVector(state, 3, value, "fadd v3.4s");
+	CHECK(memory->readData64(base + 96) == value[0]);
+	CHECK(memory->readData64(base + 104) == value[1]);
+	expected<float>(value, in.a, in.b, fsub);
+	checkVector(state, 4, value, "fsub v4.4s");
+	expected<float>(value, in.a, in.b, fmul);
+	checkVector(state, 5, value, "fmul v5.4s");
+	memcpy(value, in.c, 16);
+	expected<float>(value, in.a, in.b, fmla);
+	checkVector(state, 2, value, "fmla v2.4s");
+	expected<double>(value, in.a, in.b, fadd);
+	checkVector(state, 6, value, "fadd v6.2d");
+	expected<float>(value, in.a, in.b, fadd, true);
+	checkVector(state, 7, value, "fadd v7.2s");
+	expected<uint8_t>(value, in.p, in.q, add);
+	checkVector(state, 8, value, "add v8.16b");
+	CHECK(memory->readData64(base + 112) == value[0]);
+	CHECK(memory->readData64(base + 120) == value[1]);
+	expected<uint16_t>(value, in.p, in.q, sub);
+	checkVector(state, 9, value, "sub v9.8h");
+	expected<uint32_t>(value, in.p, in.q, mul);
+	checkVector(state, 10, value, "mul v10.4s");
+	expected<uint64_t>(value, in.p, in.q, add);
+	checkVector(state, 11, value, "add v11.2d");
+	expected<uint8_t>(value, in.p, in.q, mul);
+	checkVector(state, 12, value, "mul v12.16b");
+	expected<uint16_t>(value, in.p, in.q, mul, true);
+	checkVector(state, 13, value, "mul v13.4h");
+	float s = a[0] + b[0];
+	value[0] = 0;
+	memcpy(value, &s, 4);
+	value[1] = 0;
+	checkVector(state, 14, value, "fadd s14");
+
+	delete cpu;
+	delete memory;
+	endCheck(name);
+}
+
+void checkSimd()
+{
+	checkVectorOps(CPU_IMPL_FAST);
+	checkVectorOps(CPU_IMPL_JIT);
+}
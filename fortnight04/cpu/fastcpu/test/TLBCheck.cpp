@@ -0,0 +1,224 @@
+/* ----------------------------------------------------------------------------
+
+    (EN) armethyst - A simple ARM Simulator written in C++ for Computer Architecture
+    teaching purposes. Free software licensed under the MIT License (see license
+    below).
+
+    (PT) armethyst - Um simulador ARM simples escrito em C++ para o ensino de
+    Arquitetura de Computadores. Software livre licenciado pela MIT License
+    (veja a licença, em inglês, abaixo).
+
+    (EN) MIT LICENSE:
+
+    Copyright 2020 André Vital Saúde
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+   ----------------------------------------------------------------------------
+*/
+
+#include "TLBCheck.h"
+#include "Check.h"
+#include "Assembler.h"
+
+#include <cstdio>
+
+using namespace std;
+
+// voltas dos laços, acima de JIT_THRESHOLD para que a JITCPU os compile
+#define TLB_LOOPS (4 * JIT_THRESHOLD)
+
+// página de dados e outra com a mesma entrada na TLB (ver tlbIndex)
+#define DATA_PAGE 3
+#define CONFLICT_PAGE (((uint64_t)1 << TLB_BITS) | (DATA_PAGE ^ 1))
+
+#define CHECKPOINT_FILE "runcheck.ckpt"
+
+/**
+ * Em cada volta, incrementa um contador de 64 bits em duas páginas que
+ * disputam a mesma entrada da TLB e um terceiro, desalinhado, no limite
+ * entre duas páginas, que deve seguir pela memória (SparseMemory).
+ */
+static void checkConflicts(int cpuImpl)
+{
+	string name = "TLB conflicts and page-crossing accesses on " + cpuName(cpuImpl);
+	beginCheck(name);
+
+	Memory *memory = createMemory(MEM_IMPL_SPARSE);
+	Assembler as(memory);
+	Assembler::Label loop;
+	uint64_t entry = as.here();
+	as.bind(loop);
+	as.ldr(X(2), X(0));
+	as.add(X(2), X(2), 1);
+	as.str(X(2), X(0));
+	as.ldr(X(3), X(1));
+	as.add(X(3), X(3), 2);
+	as.str(X(3), X(1));
+	as.ldr(X(4), X(6));
+	as.add(X(4), X(4), 3);
+	as.str(X(4), X(6));
+	as.subs(X(9), X(9), 1);
+	as.b(Assembler::NE, loop);
+	as.ret();
+	as.finish();
+
+	uint64_t a = DATA_PAGE << HOST_PAGE_BITS;
+	uint64_t b = CONFLICT_PAGE << HOST_PAGE_BITS;
+	uint64_t crossing = a + HOST_PAGE_SIZE - 4;
+	memory->writeData64(a + 8, 0x5555555555555555ULL);
+	memory->writeData64(b + 8, 0x6666666666666666ULL);
+
+	CPU *cpu = createCPU(cpuImpl, memory);
+	cpu->start(entry);
+	CPUState state;
+	cpu->getState(state);
+	state.R[0] = a;
+	state.R[1] = b;
+	state.R[6] = crossing;
+	state.R[9] = TLB_LOOPS;
+	cpu->setState(state);
+	CHECK(cpu->runFor(CPU::NO_LIMIT).reason == CPU::EXIT_FINISHED);
+
+	CHECK(memory->readData64(a) == TLB_LOOPS);
+	CHECK(memory->readData64(b) == 2 * TLB_LOOPS);
+	CHECK(memory->readData64(crossing) == 3 * TLB_LOOPS);
+	CHECK(memory->readData32(a + HOST_PAGE_SIZE) == 0);
+	CHECK(memory->readData64(a + 8) == 0x5555555555555555ULL);
+	CHECK(memory->readData64(b + 8) == 0x6666666666666666ULL);
+
+	delete cpu;
+	delete memory;
+	endCheck(name);
+}
+
+/**
+ * O programa escreve, com stores, uma sub-rotina em uma página que a TLB
+ * já entregou para escrita, a executa, a reescreve e a executa de novo:
+ * a página passa a ter instruções lidas, e a segunda escrita deve
+ * seguir pela memória e descartar o bloco traduzido.
+ */
+static void checkCodeWrites(int cpuImpl, int memImpl)
+{
+	string name = "TLB writes to code pages on " + cpuName(cpuImpl)
+					+ " (" + memoryName(memImpl) + ")";
+	beginCheck(name);
+
+	Memory *memory = createMemory(memImpl);
+	Assembler as(memory);
+	Assembler::Label loop, words, stub;
+	uint64_t entry = as.here();
+	as.add(X(19), X(30), 0);
+	as.addressOf(X(1), stub);
+	as.addressOf(X(2), words);
+	as.ldr(W(3), X(2));
+	as.ldr(W(4), X(2), 4);
+	as.ldr(W(5), X(2), 8);
+	as.str(W(3), X(1));
+	as.str(W(4), X(1), 4);
+	as.blr(X(1));
+	as.str(W(5), X(1));
+	as.blr(X(1));
+	as.ret(X(19));
+	as.bind(words);
+	as.word(0x91000400);	// add x0, x0, #1
+	as.word(0xd65f03c0);	// ret
+	as.word(0x91019000);	// add x0, x0, #100
+
+	// a sub-rotina, sozinha em outra página, com dados antes dela
+	as.align(HOST_PAGE_SIZE);
+	as.dword(0x7777777777777777ULL);
+	as.bind(stub);
+	as.reserve(8);
+	as.finish();
+
+	CPU *cpu = createCPU(cpuImpl, memory);
+	cpu->start(entry);
+	CHECK(cpu->runFor(CPU::NO_LIMIT).reason == CPU::EXIT_FINISHED);
+	CPUState state;
+	cpu->getState(state);
+	cout << "	x0=" << state.R[0] << ";  Expected x0=101" << endl;
+	CHECK(state.R[0] == 101);
+	CHECK(memory->readInstruction32(stub.getAddress()) == 0x91019000);
+	CHECK(memory->readData64(stub.getAddress() - 8) == 0x7777777777777777ULL);
+
+	delete cpu;
+	delete memory;
+	endCheck(name);
+}
+
+/**
+ * Restaurar um checkpoint no mesmo processador, depois de a CPU ter
+ * escrito pela TLB em páginas que a restauração substitui, reproduz a
+ * execução a partir do checkpoint.
+ */
+static void checkRestoreInPlace(int cpuImpl, int memImpl)
+{
+	string name = "TLB after restoring in place on " + cpuName(cpuImpl)
+					+ " (" + memoryName(memImpl) + ")";
+	beginCheck(name);
+
+	const uint64_t n = 1000;
+	Memory *memory = createMemory(memImpl);
+	CheckProgram program = assembleCheckProgram(memory, n);
+	CheckProcessor *processor = new CheckProcessor(cpuImpl, memory);
+	CPU *cpu = processor->getCPU();
+	startCheckProgram(cpu, program);
+
+	// no preenchimento de v: metade escrita
+	CHECK(cpu->runFor(3000).retired == 3000);
+	CPUState saved;
+	cpu->getState(saved);
+	processor->save(CHECKPOINT_FILE);
+	CHECK(cpu->runFor(CPU::NO_LIMIT).reason == CPU::EXIT_FINISHED);
+	CPUState expected;
+	cpu->getState(expected);
+
+	// páginas alteradas depois de terminar, que a restauração desfaz
+	memory->writeData32(program.result, 0xdeadbeef);
+	memory->writeData32(program.v + 4 * (n - 1), 0xdeadbeef);
+
+	processor->restore(CHECKPOINT_FILE);
+	CPUState state;
+	cpu->getState(state);
+	CHECK(sameState(saved, state));
+	CHECK(memory->readData32(program.v + 4 * (n - 1)) == 0);
+	CHECK(cpu->runFor(CPU::NO_LIMIT).reason == CPU::EXIT_FINISHED);
+	cpu->getState(state);
+	CHECK(sameState(expected, state));
+	CHECK(memory->readData32(program.result) == checkProgramSum(n));
+	CHECK(memory->readData32(program.result + 8) == checkProgramThirds(n));
+
+	delete processor;
+	delete memory;
+	remove(CHECKPOINT_FILE);
+	endCheck(name);
+}
+
+void checkTLB()
+{
+	checkConflicts(CPU_IMPL_FAST);
+	checkConflicts(CPU_IMPL_JIT);
+	checkCodeWrites(CPU_IMPL_FAST, MEM_IMPL_BASIC);
+	checkCodeWrites(CPU_IMPL_FAST, MEM_IMPL_SPARSE);
+	checkCodeWrites(CPU_IMPL_JIT, MEM_IMPL_SPARSE);
+	checkRestoreInPlace(CPU_IMPL_FAST, MEM_IMPL_BASIC);
+	checkRestoreInPlace(CPU_IMPL_FAST, MEM_IMPL_SPARSE);
+	checkRestoreInPlace(CPU_IMPL_JIT, MEM_IMPL_SPARSE);
+}
@@ -0,0 +1,775 @@
+/* ----------------------------------------------------------------------------
+
+    (EN) JITCPU - a FastCPU that compiles hot basic blocks to native x86-64 code
+		
+	armethyst - A simple ARM Simulator written in C++ for Computer Architecture
+    teaching purposes. Free software licensed under the MIT License (see license
+    below).
+
+    (PT) JITCPU - uma FastCPU que compila blocos básicos quentes para código nativo
+		  x86-64
+    
+	armethyst - Um simulador ARM simples escrito em C++ para o ensino de
+    Arquitetura de Computadores. Software livre licenciado pela MIT License
+    (veja a licença, em inglês, abaixo).
+
+    (EN) MIT LICENSE:
+
+    Copyright 2020 André Vital Saúde
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+   ----------------------------------------------------------------------------
+*/
+
+#include "config.h"
+#include "JITCPU.h"
+
+#include <iostream>
+#include <cstddef>
+#include <sys/mman.h>
+
+#if !defined(__x86_64__)
+#error "JITCPU requires an x86-64 host"
+#endif
+
+using namespace std;
+
+/**
+ * Registradores x86-64 usados pelo código gerado.
+ *
+ * RBX guarda o endereço do banco X durante todo o bloco; RAX, RCX e RDX
+ * são temporários; RDI, RSI e RDX também passam argumentos às funções
+ * auxiliares de acesso à memória.
+ */
+enum HostReg { RAX = 0, RCX = 1, RDX = 2, RBX = 3, RSI = 6, RDI = 7 };
+
+// extensão de opcode (campo reg de ModRM) de 81 /n e C1 /n
+enum HostALU { ALU_ADD = 0, ALU_AND = 4, ALU_SUB = 5, ALU_XOR = 6,
+				SHIFT_SHL = 4, SHIFT_SHR = 5, SHIFT_SAR = 7 };
+
+// opcodes 'op r/m, r'
+enum HostOp { X86_ADD = 0x01, X86_SUB = 0x29, X86_AND = 0x21, X86_XOR = 0x31,
+				X86_CMP = 0x39, X86_TEST = 0x85, X86_MOV = 0x89 };
+
+// opcodes 'op r, r/m'
+enum HostLoadOp { X86_CMP_LOAD = 0x3B, X86_MOV_LOAD = 0x8B };
+
+// condições (tttn) de SETcc e CMOVcc; o bit 0 inverte a condição
+enum HostCond { CC_O = 0x0, CC_B = 0x2, CC_AE = 0x3, CC_E = 0x4, CC_NE = 0x5,
+				CC_A = 0x7, CC_S = 0x8, CC_GE = 0xD, CC_G = 0xF };
+
+/**
+ * Gerador de código x86-64, com apenas as instruções usadas pela JITCPU.
+ *
+ * Operandos em memória são [RBX + disp32], [RBX + índice + disp32] ou,
+ * nos acessos às páginas da TLB, [base + índice]. O emissor nunca
+ * escreve além do fim do buffer, mas continua contando bytes, de forma
+ * que size() indica o tamanho que o código teria.
+ */
+class X86Emitter
+{
+	public:
+		X86Emitter(uint8_t *code, uint64_t capacity)
+			: code(code), capacity(capacity), used(0) {}
+
+		uint64_t size() { return used; }
+
+		void byte(uint8_t b)
+		{
+			if (used < capacity) code[used] = b;
+			used++;
+		}
+
+		void dword(uint32_t v)
+		{
+			for (int i = 0; i < 4; i++) byte(v >> (8 * i));
+		}
+
+		void qword(uint64_t v)
+		{
+			for (int i = 0; i < 8; i++) byte(v >> (8 * i));
+		}
+
+		// ModRM para [RBX + disp32]
+		void rbx(uint8_t reg, int32_t disp)
+		{
+			byte(0x80 | (reg << 3) | RBX);
+			dword(disp);
+		}
+
+		// mov reg, [RBX + disp] (32 bits zera a parte alta)
+		void load(bool sf, uint8_t reg, int32_t disp)
+		{
+			if (sf) byte(0x48);
+			byte(0x8B);
+			rbx(reg, disp);
+		}
+
+		// mov [RBX + disp], reg (64 bits)
+		void store(int32_t disp, uint8_t reg)
+		{
+			byte(0x48);
+			byte(0x89);
+			rbx(reg, disp);
+		}
+
+		// op reg, [RBX + index + disp] (HostLoadOp)
+		void loadIndexed(bool sf, uint8_t op, uint8_t reg, uint8_t index, int32_t disp)
+		{
+			if (sf) byte(0x48);
+			byte(op);
+			byte(0x84 | (reg << 3));
+			byte((index << 3) | RBX);
+			dword(disp);
+		}
+
+		// mov reg, [base + index] (32 bits zera a parte alta)
+		void loadHost(bool sf, uint8_t reg, uint8_t base, uint8_t index)
+		{
+			if (sf) byte(0x48);
+			byte(0x8B);
+			byte(0x04 | (reg << 3));
+			byte((index << 3) | base);
+		}
+
+		// mov [base + index], reg
+		void storeHost(bool sf, uint8_t base, uint8_t index, uint8_t reg)
+		{
+			if (sf) byte(0x48);
+			byte(0x89);
+			byte(0x04 | (reg << 3));
+			byte((index << 3) | base);
+		}
+
+		// jcc rel32 / jmp rel32 para adiante; retorna a posição do
+		// deslocamento, a ser preenchido por target
+		uint64_t jcc(uint8_t cc)
+		{
+			byte(0x0F);
+			byte(0x80 | cc);
+			dword(0);
+			return used - 4;
+		}
+
+		uint64_t jmp()
+		{
+			byte(0xE9);
+			dword(0);
+			return used - 4;
+		}
+
+		// o salto em jump segue para a posição atual
+		void target(uint64_t jump)
+		{
+			uint32_t rel = used - (jump + 4);
+			for (int i = 0; i < 4; i++) {
+				if (jump + i < capacity) code[jump + i] = rel >> (8 * i);
+			}
+		}
+
+		// mov byte [RBX + disp], imm8
+		void storeByte(int32_t disp, uint8_t imm)
+		{
+			byte(0xC6);
+			rbx(0, disp);
+			byte(imm);
+		}
+
+		// setcc reg8; movzx reg, reg8
+		void setccReg(uint8_t cc, uint8_t reg)
+		{
+			byte(0x0F);
+			byte(0x90 | cc);
+			byte(0xC0 | reg);
+			byte(0x0F);
+			byte(0xB6);
+			byte(0xC0 | (reg << 3) | reg);
+		}
+
+		// op dst, imm32 (81 /ext)
+		void aluImm(bool sf, uint8_t ext, uint8_t dst, int32_t imm)
+		{
+			if (sf) byte(0x48);
+			byte(0x81);
+			byte(0xC0 | (ext << 3) | dst);
+			dword(imm);
+		}
+
+		// op dst, src (HostOp)
+		void aluReg(bool sf, uint8_t op, uint8_t dst, uint8_t src)
+		{
+			if (sf) byte(0x48);
+			byte(op);
+			byte(0xC0 | (src << 3) | dst);
+		}
+
+		// shl/shr/sar reg, amount (C1 /ext)
+		void shiftImm(bool sf, uint8_t ext, uint8_t reg, uint8_t amount)
+		{
+			if (sf) byte(0x48);
+			byte(0xC1);
+			byte(0xC0 | (ext << 3) | reg);
+			byte(amount);
+		}
+
+		// mov reg, imm64
+		void movImm64(uint8_t reg, uint64_t imm)
+		{
+			byte(0x48);
+			byte(0xB8 | reg);
+			qword(imm);
+		}
+
+		// mov reg, imm32
+		void movImm32(uint8_t reg, uint32_t imm)
+		{
+			byte(0xB8 | reg);
+			dword(imm);
+		}
+
+		// movsxd dst, src32
+		void movsxd(uint8_t dst, uint8_t src)
+		{
+			byte(0x48);
+			byte(0x63);
+			byte(0xC0 | (dst << 3) | src);
+		}
+
+		// cmovcc dst, src (32 bits)
+		void cmov(uint8_t cc, uint8_t dst, uint8_t src)
+		{
+			byte(0x0F);
+			byte(0x40 | cc);
+			byte(0xC0 | (dst << 3) | src);
+		}
+
+		// mov rax, function; call rax
+		void call(const void *function)
+		{
+			movImm64(RAX, (uint64_t)function);
+			byte(0xFF);
+			byte(0xD0);
+		}
+
+		void push(uint8_t reg) { byte(0x50 | reg); }
+		void pop(uint8_t reg) { byte(0x58 | reg); }
+		void ret() { byte(0xC3); }
+
+		// instrução SSE 'prefix 0F op xmm, [RBX + disp]'
+		void sse(uint8_t prefix, uint8_t op, uint8_t xmm, int32_t disp)
+		{
+			byte(prefix);
+			byte(0x0F);
+			byte(op);
+			rbx(xmm, disp);
+		}
+
+		// movd/movq reg, xmm (zera a parte alta em 32 bits)
+		void movFromXmm(bool sf, uint8_t reg, uint8_t xmm)
+		{
+			byte(0x66);
+			if (sf) byte(0x48);
+			byte(0x0F);
+			byte(0x7E);
+			byte(0xC0 | (xmm << 3) | reg);
+		}
+
+	private:
+		uint8_t *code;
+		uint64_t capacity;
+		uint64_t used;
+};
+
+/**
+ * Acesso à memória a partir do código nativo, nas faltas da TLB. Uma
+ * exceção (SimulatorError de um acesso fora da memória) não pode
+ * atravessar o código nativo, que não tem informação de desempilhamento:
+ * a primeira é guardada em nativeFault, a leitura retorna 0 e interpret
+ * a relança quando o bloco sai.
+ */
+uint64_t JITCPU::readMiss32(JITCPU *cpu, uint64_t address)
+{
+	try {
+		return cpu->readMiss(cpu->memory, address, 4);
+	} catch (...) {
+		cpu->fault();
+		return 0;
+	}
+}
+
+uint64_t JITCPU::readMiss64(JITCPU *cpu, uint64_t address)
+{
+	try {
+		return cpu->readMiss(cpu->memory, address, 8);
+	} catch (...) {
+		cpu->fault();
+		return 0;
+	}
+}
+
+void JITCPU::writeMiss32(JITCPU *cpu, uint64_t address, uint64_t value)
+{
+	try {
+		cpu->writeMiss(cpu->memory, address, 4, value);
+	} catch (...) {
+		cpu->fault();
+	}
+}
+
+void JITCPU::writeMiss64(JITCPU *cpu, uint64_t address, uint64_t value)
+{
+	try {
+		cpu->writeMiss(cpu->memory, address, 8, value);
+	} catch (...) {
+		cpu->fault();
+	}
+}
+
+void JITCPU::fault()
+{
+	if (!nativeFault) {
+		nativeFault = current_exception();
+	}
+}
+
+/**
+ * Condição de B.cond quando a operação que escreveu as flags não é
+ * conhecida na compilação.
+ */
+static uint64_t jitCondition(const Flags *flags, uint64_t cond)
+{
+	return flags->condition(cond);
+}
+
+JITCPU::JITCPU(Memory *memory, uint64_t bufferSize) : FastCPU(memory), bufferSize(bufferSize)
+{
+	bufferUsed = 0;
+	compiledCount = 0;
+	flushCount = 0;
+
+	void *map = mmap(nullptr, bufferSize, PROT_READ | PROT_EXEC,
+						MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (map == MAP_FAILED) {
+		cout << "JIT: unable to allocate code buffer, interpreting only" << endl;
+		buffer = nullptr;
+		return;
+	}
+	buffer = (uint8_t *)map;
+	hotThreshold = JIT_THRESHOLD;
+}
+
+JITCPU::~JITCPU()
+{
+	if (buffer) {
+		munmap(buffer, bufferSize);
+	}
+}
+
+/**
+ * Métodos herdados de FastCPU
+ *
+ * O buffer só é gravável durante a compilação. Quando enche, todo código
+ * nativo é descartado e as contagens de execução recomeçam: os blocos
+ * que continuarem quentes são compilados novamente.
+ */
+void JITCPU::onHotBlock(Block *block)
+{
+	mprotect(buffer, bufferSize, PROT_READ | PROT_WRITE);
+
+	uint64_t available = bufferSize - bufferUsed;
+	uint64_t size = compile(block, buffer + bufferUsed, available);
+	if (size > available) {
+		flush();
+		size = compile(block, buffer, bufferSize);
+		if (size > bufferSize) size = 0;
+	}
+
+	if (size) {
+		block->native = (NativeCode)(buffer + bufferUsed);
+		bufferUsed += size;
+		compiledCount++;
+	}
+
+	mprotect(buffer, bufferSize, PROT_READ | PROT_EXEC);
+}
+
+void JITCPU::flush()
+{
+	for (auto &entry : blocks) {
+		entry.second->native = nullptr;
+		entry.second->execCount = 0;
+	}
+	for (Block *block : retiredBlocks) {
+		block->native = nullptr;
+		block->execCount = 0;
+	}
+	bufferUsed = 0;
+	flushCount++;
+}
+
+void JITCPU::printBlockStats()
+{
+	FastCPU::printBlockStats();
+	cout << "JIT: " << compiledCount << " blocks compiled, "
+			<< bufferUsed << " bytes of native code, "
+			<< flushCount << " buffer flushes" << endl;
+}
+
+/**
+ * Compilação
+ *
+ * Cada instrução lê seus operandos de X/V, calcula em RAX/RCX (ou XMM0)
+ * e escreve o resultado de volta. Não há alocação de registradores entre
+ * instruções.
+ */
+uint64_t JITCPU::compile(Block *block, uint8_t *code, uint64_t size)
+{
+	X86Emitter e(code, size);
+
+	// deslocamentos, a partir de X, dos demais registradores
+	const int32_t vBase = (uint8_t *)V - (uint8_t *)X;
+	const int32_t flagsA = (uint8_t *)&flags.a - (uint8_t *)X;
+	const int32_t flagsB = (uint8_t *)&flags.b - (uint8_t *)X;
+	const int32_t flagsR = (uint8_t *)&flags.r - (uint8_t *)X;
+	const int32_t flagsOp = (uint8_t *)&flags.op - (uint8_t *)X;
+#define XREG(r) ((int32_t)(r) * 8)
+#define VREG(r) (vBase + (int32_t)(r) * 16)
+
+	// prólogo: RBX = X (o push também alinha a pilha para as chamadas)
+	e.push(RBX);
+	e.aluReg(true, X86_MOV, RBX, RDI);
+
+	// saída do bloco com o código exit
+	auto exitWith = [&](uint32_t exit) {
+		e.movImm32(RAX, exit);
+		e.pop(RBX);
+		e.ret();
+	};
+
+	// saída de desvio condicional, tomado se EAX != 0
+	auto exitCond = [&](uint32_t index) {
+		e.movImm32(RCX, (index << 2) | NATIVE_NOT_TAKEN);
+		e.movImm32(RDX, (index << 2) | NATIVE_TAKEN);
+		e.aluReg(false, X86_TEST, RAX, RAX);
+		e.cmov(CC_NE, RCX, RDX);
+		e.aluReg(false, X86_MOV, RAX, RCX);
+		e.pop(RBX);
+		e.ret();
+	};
+
+	// escrita escalar de RAX em Vd, que zera os bits 127-64
+	auto setV = [&](uint8_t d) {
+		e.store(VREG(d), RAX);
+		e.aluReg(false, X86_XOR, RCX, RCX);
+		e.store(VREG(d) + 8, RCX);
+	};
+
+	// última operação que escreveu as flags neste bloco (-1: anterior
+	// ao bloco, desconhecida)
+	int lastFlags = -1;
+
+	// ADDS/SUBS de RAX e RCX em RAX, registrando a operação em flags
+	// (NZCV só é calculada quando lida; ver Flags)
+	auto flagSetting = [&](bool sf, bool sub) {
+		e.store(flagsA, RAX);
+		e.store(flagsB, RCX);
+		e.aluReg(sf, sub ? X86_SUB : X86_ADD, RAX, RCX);
+		e.store(flagsR, RAX);
+		lastFlags = sub ? (sf ? Flags::FLAGS_SUB_X : Flags::FLAGS_SUB_W)
+						: (sf ? Flags::FLAGS_ADD_X : Flags::FLAGS_ADD_W);
+		e.storeByte(flagsOp, lastFlags);
+	};
+
+	// Rm deslocado (add/sub shifted register) em RCX
+	auto shiftedRm = [&](bool sf, Instruction *inst) {
+		static const uint8_t shifts[] = { SHIFT_SHL, SHIFT_SHR, SHIFT_SAR };
+		e.load(sf, RCX, XREG(inst->m));
+		if (inst->amount) {
+			e.shiftImm(sf, shifts[inst->ext], RCX, inst->amount);
+		}
+	};
+
+	// endereço de load/store em RSI
+	auto address = [&](Instruction *inst, bool registerOffset) {
+		e.load(true, RSI, XREG(inst->n));
+		if (registerOffset) {
+			e.load(true, RCX, XREG(inst->m));
+			if (inst->ext == 2) e.aluReg(false, X86_MOV, RCX, RCX);	// UXTW
+			if (inst->ext == 6) e.movsxd(RCX, RCX);					// SXTW
+			if (inst->amount) e.shiftImm(true, SHIFT_SHL, RCX, inst->amount);
+			e.aluReg(true, X86_ADD, RSI, RCX);
+		} else if (inst->imm) {
+			e.aluImm(true, ALU_ADD, RSI, inst->imm);
+		}
+	};
+
+	// acesso de 4 ou 8 bytes (sf) ao endereço em RSI pela TLB: se a
+	// entrada acerta, lê para RAX ou escreve RDX diretamente na página
+	// do hospedeiro; senão chama miss(this, RSI, RDX)
+	static_assert(sizeof(TLBEntry) == 32, "JITCPU: TLB entries must have 32 bytes");
+	const int32_t tlbBase = (uint8_t *)tlb - (uint8_t *)X;
+	auto memoryAccess = [&](bool sf, bool write, const void *miss) {
+		int32_t tag = write ? offsetof(TLBEntry, writeTag) : offsetof(TLBEntry, readTag);
+		e.aluReg(true, X86_MOV, RAX, RSI);
+		e.shiftImm(true, SHIFT_SHR, RAX, HOST_PAGE_BITS + TLB_BITS);
+		e.aluReg(true, X86_MOV, RCX, RSI);
+		e.shiftImm(true, SHIFT_SHR, RCX, HOST_PAGE_BITS);
+		e.aluReg(false, X86_XOR, RCX, RAX);
+		e.aluImm(false, ALU_AND, RCX, TLB_ENTRIES - 1);
+		e.shiftImm(false, SHIFT_SHL, RCX, 5);			// tlbIndex * 32
+		e.aluReg(true, X86_MOV, RAX, RSI);
+		e.aluImm(true, ALU_AND, RAX, (int32_t)(~(HOST_PAGE_SIZE - 1) | (sf ? 7 : 3)));
+		e.loadIndexed(true, X86_CMP_LOAD, RAX, RCX, tlbBase + tag);
+		uint64_t missed = e.jcc(CC_NE);
+		e.loadIndexed(true, X86_MOV_LOAD, RAX, RCX, tlbBase + offsetof(TLBEntry, host));
+		e.aluReg(false, X86_MOV, RCX, RSI);
+		e.aluImm(false, ALU_AND, RCX, HOST_PAGE_SIZE - 1);
+		if (write) {
+			e.storeHost(sf, RAX, RCX, RDX);
+		} else {
+			e.loadHost(sf, RAX, RAX, RCX);
+		}
+		uint64_t done = e.jmp();
+		e.target(missed);
+		e.movImm64(RDI, (uint64_t)this);
+		e.call(miss);
+		e.target(done);
+	};
+
+	uint64_t pc = block->address;
+	for (uint32_t i = 0; i < block->code.size(); i++, pc += 4) {
+		Instruction *inst = &block->code[i];
+		bool sf;
+
+		switch (inst->op) {
+			case OP_NOP:
+				break;
+
+			/*
+			 * Data Processing -- Immediate
+			 */
+			case OP_ADD_X_IMM:
+			case OP_ADD_W_IMM:
+				sf = inst->op == OP_ADD_X_IMM;
+				e.load(sf, RAX, XREG(inst->n));
+				e.aluImm(sf, ALU_ADD, RAX, inst->imm);
+				e.store(XREG(inst->d), RAX);
+				break;
+
+			case OP_ADDS_X_IMM:
+			case OP_ADDS_W_IMM:
+			case OP_SUBS_X_IMM:
+			case OP_SUBS_W_IMM:
+				sf = inst->op == OP_ADDS_X_IMM || inst->op == OP_SUBS_X_IMM;
+				e.load(sf, RAX, XREG(inst->n));
+				e.movImm32(RCX, inst->imm);
+				flagSetting(sf, inst->op == OP_SUBS_X_IMM || inst->op == OP_SUBS_W_IMM);
+				e.store(XREG(inst->d), RAX);
+				break;
+
+			case OP_ADR:
+				e.movImm64(RAX, pc + inst->imm);
+				e.store(XREG(inst->d), RAX);
+				break;
+
+			case OP_ADRP:
+				e.movImm64(RAX, (pc & ~(uint64_t)0xFFF) + inst->imm);
+				e.store(XREG(inst->d), RAX);
+				break;
+
+			/*
+			 * Data Processing -- Register
+			 */
+			case OP_ADD_X_REG:
+			case OP_ADD_W_REG:
+			case OP_SUB_X_REG:
+			case OP_SUB_W_REG:
+			case OP_ADDS_X_REG:
+			case OP_ADDS_W_REG:
+			case OP_SUBS_X_REG:
+			case OP_SUBS_W_REG:
+				{
+					sf = inst->op == OP_ADD_X_REG || inst->op == OP_SUB_X_REG
+							|| inst->op == OP_ADDS_X_REG || inst->op == OP_SUBS_X_REG;
+					bool sub = inst->op == OP_SUB_X_REG || inst->op == OP_SUB_W_REG
+							|| inst->op == OP_SUBS_X_REG || inst->op == OP_SUBS_W_REG;
+					bool setsFlags = inst->op >= OP_ADDS_X_REG;
+					e.load(sf, RAX, XREG(inst->n));
+					shiftedRm(sf, inst);
+					if (setsFlags) {
+						flagSetting(sf, sub);
+					} else {
+						e.aluReg(sf, sub ? X86_SUB : X86_ADD, RAX, RCX);
+					}
+					e.store(XREG(inst->d), RAX);
+				}
+				break;
+
+			/*
+			 * Loads and Stores
+			 */
+			case OP_LDR_W:
+			case OP_LDR_W_REG:
+			case OP_LDRSW:
+			case OP_LDRSW_REG:
+				address(inst, inst->op == OP_LDR_W_REG || inst->op == OP_LDRSW_REG);
+				memoryAccess(false, false, (const void *)readMiss32);
+				if (inst->op == OP_LDRSW || inst->op == OP_LDRSW_REG) {
+					e.movsxd(RAX, RAX);
+				}
+				e.store(XREG(inst->d), RAX);
+				break;
+
+			case OP_LDR_X:
+			case OP_LDR_X_REG:
+				address(inst, inst->op == OP_LDR_X_REG);
+				memoryAccess(true, false, (const void *)readMiss64);
+				e.store(XREG(inst->d), RAX);
+				break;
+
+			case OP_LDR_S:
+			case OP_LDR_S_REG:
+				address(inst, inst->op == OP_LDR_S_REG);
+				memoryAccess(false, false, (const void *)readMiss32);
+				setV(inst->d);
+				break;
+
+			case OP_LDR_D:
+			case OP_LDR_D_REG:
+				address(inst, inst->op == OP_LDR_D_REG);
+				memoryAccess(true, false, (const void *)readMiss64);
+				setV(inst->d);
+				break;
+
+			case OP_STR_W:
+			case OP_STR_W_REG:
+				address(inst, inst->op == OP_STR_W_REG);
+				e.load(true, RDX, XREG(inst->d));
+				memoryAccess(false, true, (const void *)writeMiss32);
+				break;
+
+			case OP_STR_X:
+			case OP_STR_X_REG:
+				address(inst, inst->op == OP_STR_X_REG);
+				e.load(true, RDX, XREG(inst->d));
+				memoryAccess(true, true, (const void *)writeMiss64);
+				break;
+
+			case OP_STR_S:
+			case OP_STR_S_REG:
+				address(inst, inst->op == OP_STR_S_REG);
+				e.load(true, RDX, VREG(inst->d));
+				memoryAccess(false, true, (const void *)writeMiss32);
+				break;
+
+			case OP_STR_D:
+			case OP_STR_D_REG:
+				address(inst, inst->op == OP_STR_D_REG);
+				e.load(true, RDX, VREG(inst->d));
+				memoryAccess(true, true, (const void *)writeMiss64);
+				break;
+
+			/*
+			 * Branches
+			 */
+			case OP_B:
+				exitWith((i << 2) | NATIVE_TAKEN);
+				break;
+
+			case OP_BL:
+				e.movImm64(RAX, pc + 4);
+				e.store(XREG(30), RAX);
+				exitWith((i << 2) | NATIVE_TAKEN);
+				break;
+
+			case OP_BCOND:
+				// resultado da condição em EAX
+				if ((inst->ext >> 1) == 7) {
+					e.movImm32(RAX, 1);									// AL
+				} else if (lastFlags == Flags::FLAGS_SUB_X
+						|| lastFlags == Flags::FLAGS_SUB_W) {
+					// após SUBS, as condições do x86 para 'cmp a, b' são
+					// as do ARM (CS é a ausência de borrow)
+					static const uint8_t conds[] = { CC_E, CC_AE, CC_S, CC_O,
+														CC_A, CC_GE, CC_G };
+					sf = lastFlags == Flags::FLAGS_SUB_X;
+					e.load(sf, RAX, flagsA);
+					e.load(sf, RCX, flagsB);
+					e.aluReg(sf, X86_CMP, RAX, RCX);
+					e.setccReg(conds[inst->ext >> 1] ^ (inst->ext & 1), RAX);
+				} else {
+					e.movImm64(RDI, (uint64_t)&flags);
+					e.movImm32(RSI, inst->ext);
+					e.call((const void *)jitCondition);
+				}
+				exitCond(i);
+				break;
+
+			case OP_CBZ_X:
+			case OP_CBZ_W:
+			case OP_CBNZ_X:
+			case OP_CBNZ_W:
+				sf = inst->op == OP_CBZ_X || inst->op == OP_CBNZ_X;
+				e.load(sf, RAX, XREG(inst->d));
+				e.aluReg(sf, X86_TEST, RAX, RAX);
+				e.setccReg(inst->op == OP_CBZ_X || inst->op == OP_CBZ_W ? CC_E : CC_NE, RAX);
+				exitCond(i);
+				break;
+
+			/*
+			 * Data Processing -- Scalar Floating-Point
+			 */
+			case OP_FADD_S: case OP_FSUB_S: case OP_FMUL_S: case OP_FDIV_S:
+			case OP_FADD_D: case OP_FSUB_D: case OP_FMUL_D: case OP_FDIV_D:
+				{
+					// ordem de Op: ADD, SUB, MUL, DIV
+					static const uint8_t sseOps[] = { 0x58, 0x5C, 0x59, 0x5E };
+					sf = inst->op >= OP_FADD_D;
+					uint8_t prefix = sf ? 0xF2 : 0xF3;	// SD : SS
+					int k = (inst->op - OP_FADD_S) & 3;
+					e.sse(prefix, 0x10, 0, VREG(inst->n));	// movss/movsd xmm0
+					e.sse(prefix, sseOps[k], 0, VREG(inst->m));
+					e.movFromXmm(sf, RAX, 0);
+					setV(inst->d);
+				}
+				break;
+
+			/*
+			 * Demais instruções (BR, BLR, RET, não implementadas e fim de
+			 * bloco sem desvio) seguem no interpretador.
+			 */
+			default:
+				if (i == 0) {
+					return 0;
+				}
+				exitWith((i << 2) | NATIVE_INTERPRET);
+				return e.size();
+		}
+
+		if (inst->op >= OP_B && inst->op <= OP_CBNZ_W) {
+			break;
+		}
+	}
+
+#undef XREG
+#undef VREG
+
+	return e.size();
+}
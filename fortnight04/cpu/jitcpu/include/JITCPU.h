@@ -0,0 +1,114 @@
+/* ----------------------------------------------------------------------------
+
+    (EN) JITCPU - a FastCPU that compiles hot basic blocks to native x86-64 code
+		
+	armethyst - A simple ARM Simulator written in C++ for Computer Architecture
+    teaching purposes. Free software licensed under the MIT License (see license
+    below).
+
+    (PT) JITCPU - uma FastCPU que compila blocos básicos quentes para código nativo
+		  x86-64
+    
+	armethyst - Um simulador ARM simples escrito em C++ para o ensino de
+    Arquitetura de Computadores. Software livre licenciado pela MIT License
+    (veja a licença, em inglês, abaixo).
+
+    (EN) MIT LICENSE:
+
+    Copyright 2020 André Vital Saúde
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+   ----------------------------------------------------------------------------
+*/
+
+#pragma once
+
+#include "FastCPU.h"
+
+/**
+ * JITCPU
+ *
+ * Blocos da FastCPU que atingem JIT_THRESHOLD execuções são compilados
+ * para código x86-64 em um buffer executável (mmap). O código nativo
+ * opera diretamente sobre os registradores da FastCPU (X, V e flags) e
+ * acessa a memória pela TLB da FastCPU, com a busca na TLB gerada em
+ * linha; só as faltas chamam funções auxiliares. Instruções sem tradução
+ * nativa encerram o código nativo, e o bloco segue no interpretador a
+ * partir delas.
+ *
+ * Instruções compiladas: ADD, SUB, ADDS, SUBS/CMP (imediato e
+ * registrador), ADR, ADRP, LDR, STR, LDRSW (inteiros, S e D), B, BL,
+ * B.cond, CBZ, CBNZ, FADD, FSUB, FMUL, FDIV (S e D) e NOP.
+ */
+class JITCPU: public FastCPU
+{
+	public:
+		/**
+		 * bufferSize: tamanho em bytes do buffer de código nativo.
+		 */
+		JITCPU(Memory *memory, uint64_t bufferSize = JIT_BUFFER_SIZE);
+		~JITCPU();
+
+	protected:
+		/**
+		 * Métodos herdados de FastCPU
+		 */
+		void onHotBlock(Block *block);
+		void printBlockStats();
+
+	private:
+		// buffer de código nativo
+		uint8_t *buffer;
+		uint64_t bufferSize;
+		uint64_t bufferUsed;
+
+		// total de blocos compilados e de esvaziamentos do buffer
+		uint64_t compiledCount;
+		uint64_t flushCount;
+
+		/**
+		 * Compila block em code, com no máximo size bytes.
+		 *
+		 * Retorna o tamanho do código gerado, maior que size se o
+		 * código não coube, ou 0 se block não começa com uma instrução
+		 * compilável.
+		 */
+		uint64_t compile(Block *block, uint8_t *code, uint64_t size);
+
+		/**
+		 * Descarta todo código nativo.
+		 */
+		void flush();
+
+		/**
+		 * Faltas da TLB no código nativo (ver FastCPU::readMiss e
+		 * FastCPU::writeMiss).
+		 */
+		static uint64_t readMiss32(JITCPU *cpu, uint64_t address);
+		static uint64_t readMiss64(JITCPU *cpu, uint64_t address);
+		static void writeMiss32(JITCPU *cpu, uint64_t address, uint64_t value);
+		static void writeMiss64(JITCPU *cpu, uint64_t address, uint64_t value);
+
+		/**
+		 * Guarda em nativeFault a exceção sendo tratada, se não houver
+		 * outra pendente.
+		 */
+		void fault();
+};
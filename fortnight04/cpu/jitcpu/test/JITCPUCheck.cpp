@@ -0,0 +1,209 @@
+/* ----------------------------------------------------------------------------
+
+    (EN) armethyst - A simple ARM Simulator written in C++ for Computer Architecture
+    teaching purposes. Free software licensed under the MIT License (see license
+    below).
+
+    (PT) armethyst - Um simulador ARM simples escrito em C++ para o ensino de
+    Arquitetura de Computadores. Software livre licenciado pela MIT License
+    (veja a licença, em inglês, abaixo).
+
+    (EN) MIT LICENSE:
+
+    Copyright 2020 André Vital Saúde
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+   ----------------------------------------------------------------------------
+*/
+
+#include "JITCPUCheck.h"
+#include "Check.h"
+#include "Assembler.h"
+#include "BasicCPU.h"
+#include "JITCPU.h"
+
+#include <set>
+
+using namespace std;
+
+#define CHECK_N 1000
+
+// voltas de cada laço do programa automodificável, acima de JIT_THRESHOLD
+#define SMC_LOOPS (4 * JIT_THRESHOLD)
+
+// buffer de código nativo em que não cabem todos os laços do programa
+// de verificação
+#define SMALL_BUFFER 400
+
+/**
+ * JITCPU que conta os blocos quentes compilados para código nativo e,
+ * entre eles, os que já tinham sido compilados antes (depois de o
+ * buffer encher e ser esvaziado).
+ */
+class JITCPUCheck: public JITCPU
+{
+	public:
+		JITCPUCheck(Memory *memory, uint64_t bufferSize = JIT_BUFFER_SIZE)
+			: JITCPU(memory, bufferSize) {}
+
+		uint64_t compiled = 0;
+		uint64_t recompiled = 0;
+
+	protected:
+		void onHotBlock(Block *block)
+		{
+			JITCPU::onHotBlock(block);
+			if (block->native) {
+				compiled++;
+				recompiled += !addresses.insert(block->address).second;
+			}
+		}
+
+	private:
+		std::set<uint64_t> addresses;
+};
+
+/**
+ * Com os laços do programa de verificação compilados, a JITCPU chega
+ * aos mesmos estados que a BasicCPU em fatias de runFor, inclusive as
+ * que param no meio de um bloco nativo.
+ */
+static void checkSlicesAgainstBasicCPU(int memImpl)
+{
+	string name = "JITCPU runFor slices against BasicCPU on " + memoryName(memImpl);
+	beginCheck(name);
+
+	Memory *refMemory = createMemory(MEM_IMPL_BASIC);
+	Memory *memory = createMemory(memImpl);
+	CheckProgram program = assembleCheckProgram(refMemory, CHECK_N);
+	assembleCheckProgram(memory, CHECK_N);
+	BasicCPU *ref = new BasicCPU(refMemory);
+	JITCPUCheck *cpu = new JITCPUCheck(memory);
+	startCheckProgram(ref, program);
+	startCheckProgram(cpu, program);
+
+	static const uint64_t slices[] = {1000, 3, 64, 7, 500, 1};
+	uint64_t retired = checkSlices(ref, cpu, slices, 6, CPU::NO_LIMIT);
+	cout << "	" << retired << " instructions, " << cpu->compiled
+			<< " compiled blocks" << endl;
+	CHECK(cpu->compiled > 0);
+
+	CHECK(memory->readData32(program.result) == checkProgramSum(CHECK_N));
+	checkSameMemory(refMemory, memory, program.result, 16 + 4 * CHECK_N);
+
+	delete cpu;
+	delete ref;
+	delete memory;
+	delete refMemory;
+	endCheck(name);
+}
+
+/**
+ * Um laço quente, já compilado, reescreve a sua própria instrução
+ * 'add x0, x0, #1' como 'add x0, x0, #100' e volta a executar: o
+ * código nativo antigo deve ser descartado.
+ */
+static void checkSelfModifyingCode(int memImpl)
+{
+	string name = "JITCPU self-modifying hot loop on " + memoryName(memImpl);
+	beginCheck(name);
+
+	Memory *memory = createMemory(memImpl);
+	JITCPUCheck *cpu = new JITCPUCheck(memory);
+
+	Assembler as(memory);
+	Assembler::Label loop, end, replacement;
+	uint64_t entry = as.here();
+	as.adr(X(1), loop);
+	as.adr(X(3), replacement);
+	as.ldr(W(2), X(3));
+	// x5 é nulo no início e ao fim de cada laço
+	as.add(X(5), X(5), SMC_LOOPS);
+	as.bind(loop);
+	as.add(X(0), X(0), 1);
+	as.sub(X(5), X(5), 1);
+	as.cbnz(X(5), loop);
+	as.cbnz(X(6), end);
+	as.add(X(6), X(6), 1);
+	as.str(W(2), X(1));
+	as.add(X(5), X(5), SMC_LOOPS);
+	as.b(loop);
+	as.bind(end);
+	as.ret();
+	as.bind(replacement);
+	as.word(0x91019000);	// add x0, x0, #100
+	as.finish();
+
+	cpu->start(entry);
+	CPU::RunResult result = cpu->runFor(CPU::NO_LIMIT);
+	CPUState state;
+	cpu->getState(state);
+	cout << "	x0=" << state.R[0] << ";  Expected x0=" << SMC_LOOPS * 101
+			<< ", " << cpu->compiled << " compiled blocks" << endl;
+	CHECK(result.reason == CPU::EXIT_FINISHED);
+	CHECK(state.R[0] == SMC_LOOPS * 101);
+	CHECK(cpu->compiled > 0);
+
+	delete cpu;
+	delete memory;
+	endCheck(name);
+}
+
+/**
+ * Com um buffer pequeno, compilar o último laço esvazia o buffer: os
+ * laços que continuam quentes devem ser compilados de novo, e o
+ * resultado é o da BasicCPU.
+ */
+static void checkBufferFlush()
+{
+	string name = "JITCPU recompilation after a buffer flush";
+	beginCheck(name);
+
+	Memory *refMemory = createMemory(MEM_IMPL_BASIC);
+	Memory *memory = createMemory(MEM_IMPL_BASIC);
+	CheckProgram program = assembleCheckProgram(refMemory, CHECK_N);
+	assembleCheckProgram(memory, CHECK_N);
+	BasicCPU *ref = new BasicCPU(refMemory);
+	JITCPUCheck *cpu = new JITCPUCheck(memory, SMALL_BUFFER);
+	startCheckProgram(ref, program);
+	startCheckProgram(cpu, program);
+
+	static const uint64_t slices[] = {CPU::NO_LIMIT};
+	uint64_t retired = checkSlices(ref, cpu, slices, 1, CPU::NO_LIMIT);
+	cout << "	" << retired << " instructions, " << cpu->compiled << " compiled blocks, "
+			<< cpu->recompiled << " recompiled" << endl;
+	CHECK(cpu->recompiled > 0);
+	checkSameMemory(refMemory, memory, program.result, 16 + 4 * CHECK_N);
+
+	delete cpu;
+	delete ref;
+	delete memory;
+	delete refMemory;
+	endCheck(name);
+}
+
+void checkJITCPU()
+{
+	checkSlicesAgainstBasicCPU(MEM_IMPL_BASIC);
+	checkSlicesAgainstBasicCPU(MEM_IMPL_SPARSE);
+	checkSelfModifyingCode(MEM_IMPL_BASIC);
+	checkSelfModifyingCode(MEM_IMPL_SPARSE);
+	checkBufferFlush();
+}
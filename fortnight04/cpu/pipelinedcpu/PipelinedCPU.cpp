@@ -0,0 +1,390 @@
+/* ----------------------------------------------------------------------------
+
+    (EN) PipelinedCPU - 5-stage pipelined CPU. Part of armethyst project.
+		
+	armethyst - A simple ARM Simulator written in C++ for Computer Architecture
+    teaching purposes. Free software licensed under the MIT License (see license
+    below).
+
+    (PT) PipelinedCPU - CPU com pipeline de 5 estágios. Parte do projeto
+	armethyst.
+    
+	armethyst - Um simulador ARM simples escrito em C++ para o ensino de
+    Arquitetura de Computadores. Software livre licenciado pela MIT License
+    (veja a licença, em inglês, abaixo).
+
+    (EN) MIT LICENSE:
+
+    Copyright 2020 André Vital Saúde
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+   ----------------------------------------------------------------------------
+*/
+
+#include "config.h"
+#include "PipelinedCPU.h"
+
+#include <iostream>
+#include <iomanip>
+
+using namespace std;
+
+PipelinedCPU::PipelinedCPU(Memory *memory) : BasicCPU(memory)
+{
+	squash(ifid, BUBBLE_EMPTY);
+	squash(idex, BUBBLE_EMPTY);
+	squash(exmem, BUBBLE_EMPTY);
+	squash(memwb, BUBBLE_EMPTY);
+	fetchPC = 0;
+	stats = PipelineStats();
+}
+
+/**
+ * Métodos herdados de CPU
+ */
+int PipelinedCPU::run(uint64_t startAddress)
+{
+	start(startAddress);
+	execute(NO_LIMIT, NO_ADDRESS);
+	printPipelineStats();
+
+	if (cpuError) {
+		return 1;
+	}
+	return 0;
+}
+
+void PipelinedCPU::start(uint64_t startAddress)
+{
+	BasicCPU::start(startAddress);
+	stats = PipelineStats();
+}
+
+CPU::RunResult PipelinedCPU::runFor(uint64_t maxInstructions)
+{
+	return execute(maxInstructions, NO_ADDRESS);
+}
+
+CPU::RunResult PipelinedCPU::runUntil(uint64_t address)
+{
+	return execute(NO_LIMIT, address);
+}
+
+void PipelinedCPU::printPipelineStats()
+{
+	streamsize precision = cout.precision();
+	cout << "Pipeline: " << stats.cycles << " cycles, " << stats.instructions
+			<< " instructions, CPI ";
+	if (stats.instructions) {
+		cout << fixed << setprecision(2)
+				<< (double)stats.cycles / stats.instructions << endl;
+		cout.unsetf(ios::floatfield);
+		cout.precision(precision);
+	} else {
+		cout << "-" << endl;
+	}
+	cout << "Pipeline bubbles: " << stats.bubbles[BUBBLE_RAW] << " RAW, "
+			<< stats.bubbles[BUBBLE_LOAD_USE] << " load-use, "
+			<< stats.bubbles[BUBBLE_FLUSH] << " branch flush, "
+			<< stats.bubbles[BUBBLE_EMPTY] << " fill/drain" << endl;
+}
+
+CPU::RunResult PipelinedCPU::execute(uint64_t maxInstructions, uint64_t stopAddress)
+{
+	RunResult result = {0, EXIT_LIMIT, PC};
+	this->maxInstructions = maxInstructions;
+	this->stopAddress = stopAddress;
+	retired = 0;
+	fetchPC = PC;
+
+	// ciclo da máquina, até não haver o que buscar e o pipeline esvaziar
+	if (cpuError == CPUerrorCode::NONE && !processFinished) {
+		while (ifid.valid || idex.valid || exmem.valid || memwb.valid || canFetch()) {
+			cycle();
+		}
+	}
+	PC = fetchPC;
+
+	// retorno de main: fim do processo
+	if (!cpuError && PC == EXITADDRESS) {
+		processFinished = true;
+	}
+
+	result.retired = retired;
+	stats.instructions += retired;
+	retiredTotal += retired;
+	if (cpuError) {
+		result.reason = EXIT_ERROR;
+	} else if (processFinished) {
+		result.reason = EXIT_FINISHED;
+	} else if (retired != maxInstructions && PC == stopAddress) {
+		result.reason = EXIT_ADDRESS;
+	}
+	result.PC = PC;
+	return result;
+}
+
+void PipelinedCPU::cycle()
+{
+	bool redirected = false;
+	bool stalled = false;
+	stats.cycles++;
+
+	// WB: completa a instrução de MEM/WB (desvios já foram resolvidos
+	// em EX)
+	if (memwb.valid) {
+		load(memwb);
+		if (!memwb.branch && WB()) {
+			fail(memwb);
+			return;
+		}
+		retired++;
+		if (profiler) {
+			profiler->count(memwb.PC, 1, 1);
+		}
+	}
+
+	// MEM: EX/MEM -> MEM/WB
+	memwb = exmem;
+	squash(exmem, BUBBLE_EMPTY);
+	if (memwb.valid) {
+		load(memwb);
+		if (MEM()) {
+			fail(memwb);
+			return;
+		}
+		store(memwb);
+	}
+
+	// EX: ID/EX -> EX/MEM
+	exmem = idex;
+	squash(idex, BUBBLE_EMPTY);
+	if (exmem.valid) {
+		load(exmem);
+		if (exmem.undefined
+				|| (fpOp == FPOpFlag::FP_UNDEF ? EXI() : EXF())) {
+			fail(exmem);
+			return;
+		}
+		store(exmem);
+
+		// desvio previsto não tomado: se tomado, descarta a instrução
+		// em IF/ID e a que seria buscada neste ciclo
+		if (exmem.branch) {
+			if (observingBranches()) {
+				resolveBranch(exmem.PC, exmem.type, taken, ALUout);
+			}
+			if (ALUout != exmem.PC + 4) {
+				fetchPC = ALUout;
+				squash(ifid, BUBBLE_FLUSH);
+				redirected = true;
+			}
+		}
+	}
+
+	// ID: IF/ID -> ID/EX
+	if (!ifid.valid) {
+		squash(idex, ifid.bubble);
+	} else {
+		if (PIPELINE_FORWARDING) {
+			forward();
+		}
+		load(ifid);
+		if (ID()) {
+			// instrução não implementada, ou de um caminho que será
+			// descartado: o erro só ocorre se ela chegar a EX
+			idex = ifid;
+			idex.undefined = true;
+		} else {
+			Bubble bubble = hazard(DI);
+			if (bubble != BUBBLE_EMPTY) {
+				squash(idex, bubble);
+				stalled = true;
+			} else {
+				idex = ifid;
+				store(idex);
+				idex.branch = WBctrl == WBctrlFlag::RegWrite && Rd == &PC;
+				idex.type = branchType(DI);
+			}
+		}
+		if (!stalled) {
+			squash(ifid, BUBBLE_EMPTY);
+		}
+	}
+	if (!idex.valid) {
+		stats.bubbles[idex.bubble]++;
+	}
+
+	// IF: busca em fetchPC, exceto se ID está parado
+	if (!stalled) {
+		if (redirected) {
+			squash(ifid, BUBBLE_FLUSH);
+		} else if (canFetch()) {
+			PC = fetchPC;
+			IF();
+			ifid = Latch();
+			ifid.valid = true;
+			ifid.PC = PC;
+			ifid.IR = IR;
+			ifid.DI = DI;
+			fetchPC += 4;
+		} else {
+			squash(ifid, BUBBLE_EMPTY);
+		}
+	}
+}
+
+bool PipelinedCPU::canFetch()
+{
+	uint64_t inFlight = ifid.valid + idex.valid + exmem.valid + memwb.valid;
+	return cpuError == CPUerrorCode::NONE
+			&& fetchPC != EXITADDRESS
+			&& retired + inFlight < maxInstructions
+			&& !(fetchPC == stopAddress && retired + inFlight > 0);
+}
+
+void PipelinedCPU::load(const Latch &latch)
+{
+	PC = latch.PC;
+	IR = latch.IR;
+	DI = latch.DI;
+	A = latch.A;
+	B = latch.B;
+	ALUout = latch.ALUout;
+	MDR = latch.MDR;
+	Rd = latch.Rd;
+	fpOp = latch.fpOp;
+	ALUctrl = latch.ALUctrl;
+	FlagsCtrl = latch.FlagsCtrl;
+	MEMctrl = latch.MEMctrl;
+	WBctrl = latch.WBctrl;
+	MemtoReg = latch.MemtoReg;
+	taken = latch.taken;
+}
+
+void PipelinedCPU::store(Latch &latch)
+{
+	latch.A = A;
+	latch.B = B;
+	latch.ALUout = ALUout;
+	latch.MDR = MDR;
+	latch.Rd = Rd;
+	latch.fpOp = fpOp;
+	latch.ALUctrl = ALUctrl;
+	latch.FlagsCtrl = FlagsCtrl;
+	latch.MEMctrl = MEMctrl;
+	latch.WBctrl = WBctrl;
+	latch.MemtoReg = MemtoReg;
+	latch.taken = taken;
+}
+
+void PipelinedCPU::squash(Latch &latch, Bubble bubble)
+{
+	latch.valid = false;
+	latch.bubble = bubble;
+}
+
+bool PipelinedCPU::writes(const Latch &latch, const uint64_t *reg)
+{
+	return latch.valid && !latch.branch
+			&& latch.WBctrl == WBctrlFlag::RegWrite && latch.Rd == reg;
+}
+
+/**
+ * As instruções mais novas que a de latch estão nos latches anteriores
+ * a ele (EX/MEM, se latch é MEM/WB, ID/EX e IF/ID); as mais antigas
+ * seguem até WB e o pipeline esvazia.
+ */
+void PipelinedCPU::fail(Latch &latch)
+{
+	cout << "Instruction not implemented: 0x" << hex << latch.IR
+			<< " at 0x" << latch.PC << dec << endl;
+	cpuError = CPUerrorCode::UNDEFINED_INSTRUCTION;
+	fetchPC = latch.PC;
+
+	squash(latch, BUBBLE_EMPTY);
+	squash(exmem, BUBBLE_EMPTY);
+	squash(idex, BUBBLE_EMPTY);
+	squash(ifid, BUBBLE_EMPTY);
+}
+
+/**
+ * O valor de um load em EX/MEM ainda não foi lido da memória: a
+ * instrução dependente espera (ver hazard).
+ */
+void PipelinedCPU::forward()
+{
+	if (writes(memwb, memwb.Rd)) {
+		*memwb.Rd = memwb.MemtoReg ? memwb.MDR : memwb.ALUout;
+	}
+	if (writes(exmem, exmem.Rd) && !exmem.MemtoReg) {
+		*exmem.Rd = exmem.ALUout;
+	}
+}
+
+PipelinedCPU::Bubble PipelinedCPU::hazard(DecodedInstruction *di)
+{
+	const uint64_t *src[3];
+	int count = sources(di, src);
+	for (int i = 0; i < count; i++) {
+		if (writes(exmem, src[i])) {
+			if (!PIPELINE_FORWARDING) {
+				return BUBBLE_RAW;
+			}
+			if (exmem.MemtoReg) {
+				return BUBBLE_LOAD_USE;
+			}
+		}
+		if (!PIPELINE_FORWARDING && writes(memwb, src[i])) {
+			return BUBBLE_RAW;
+		}
+	}
+	return BUBBLE_EMPTY;
+}
+
+/**
+ * Segue as rotinas readOperands da BasicCPU. O dado de um store é lido
+ * em MEM, quando a instrução anterior já passou por WB; sem
+ * adiantamento, ele é lido em ID, como os demais.
+ */
+int PipelinedCPU::sources(DecodedInstruction *di, const uint64_t *src[3])
+{
+	int count = 0;
+	if (di->readOperands == &PipelinedCPU::readImmediate) {
+		src[count++] = di->n == 31 ? &SP : &R[di->n];
+	} else if (di->readOperands == &PipelinedCPU::readShiftedRegister) {
+		if (di->n < 31) src[count++] = &R[di->n];
+		if (di->m < 31) src[count++] = &R[di->m];
+	} else if (di->readOperands == &PipelinedCPU::readRegisterOffset) {
+		src[count++] = di->n == 31 ? &SP : &R[di->n];
+		src[count++] = di->m == 31 ? &SP : &R[di->m];
+	} else if (di->readOperands == &PipelinedCPU::readReturn) {
+		src[count++] = &R[di->n];
+	} else if (di->readOperands == &PipelinedCPU::readFloat32) {
+		src[count++] = &V[di->n];
+		src[count++] = &V[di->m];
+	}
+
+	if (!PIPELINE_FORWARDING
+			&& (di->MEMctrl == MEMctrlFlag::WRITE32 || di->MEMctrl == MEMctrlFlag::WRITE64)) {
+		src[count++] = di->Rd;
+	}
+	return count;
+}
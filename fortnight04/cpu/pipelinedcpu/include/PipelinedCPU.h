@@ -0,0 +1,207 @@
+/* ----------------------------------------------------------------------------
+
+    (EN) PipelinedCPU - 5-stage pipelined CPU. Part of armethyst project.
+		
+	armethyst - A simple ARM Simulator written in C++ for Computer Architecture
+    teaching purposes. Free software licensed under the MIT License (see license
+    below).
+
+    (PT) PipelinedCPU - CPU com pipeline de 5 estágios. Parte do projeto
+	armethyst.
+    
+	armethyst - Um simulador ARM simples escrito em C++ para o ensino de
+    Arquitetura de Computadores. Software livre licenciado pela MIT License
+    (veja a licença, em inglês, abaixo).
+
+    (EN) MIT LICENSE:
+
+    Copyright 2020 André Vital Saúde
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+   ----------------------------------------------------------------------------
+*/
+
+#pragma once
+
+#include "BasicCPU.h"
+
+/**
+ * PipelinedCPU
+ *
+ * Pipeline de 5 estágios (IF, ID, EX, MEM e WB) sobre o caminho de
+ * dados da BasicCPU. Cada estágio tem uma instrução diferente, guardada
+ * no registrador de pipeline (Latch) que o alimenta; a cada ciclo os
+ * métodos de estágio da BasicCPU são executados, de WB para IF, sobre a
+ * instrução de cada estágio, que é carregada nos registradores
+ * auxiliares da BasicCPU antes e salva no latch seguinte depois.
+ *
+ * Conflitos modelados:
+ *	- dados (RAW): com PIPELINE_FORWARDING, os resultados em EX/MEM e
+ *	  MEM/WB são adiantados para a instrução em ID; sem adiantamento, a
+ *	  instrução espera em ID até a escrita do registrador em WB (escrita
+ *	  na primeira metade do ciclo, leitura na segunda);
+ *	- load-use: o valor lido por um load só existe ao fim de MEM, e a
+ *	  instrução dependente espera um ciclo mesmo com adiantamento;
+ *	- desvios: previstos não tomados e resolvidos em EX; um desvio
+ *	  tomado descarta as duas instruções buscadas depois dele.
+ *
+ * As flags NZCV são escritas em EX e estão sempre disponíveis para o
+ * B.cond seguinte. Cada chamada de run, runFor e runUntil esvazia o
+ * pipeline ao terminar, de forma que o estado arquitetural entre
+ * chamadas é sempre o da última instrução completada.
+ *
+ * Contam-se os ciclos e, em cada ciclo sem instrução entrando em EX, a
+ * causa da bolha.
+ */
+class PipelinedCPU: public BasicCPU
+{
+	public:
+		PipelinedCPU(Memory *memory);
+
+		/**
+		 * Métodos herdados de CPU
+		 */
+		int run(uint64_t startAddress);
+		void start(uint64_t startAddress);
+		RunResult runFor(uint64_t maxInstructions);
+		RunResult runUntil(uint64_t address);
+
+		/**
+		 * Imprime ciclos, CPI e bolhas por causa desde start.
+		 */
+		void printPipelineStats();
+
+	protected:
+		/**
+		 * Causas de bolha (ciclo sem instrução entrando em EX).
+		 */
+		enum Bubble {
+			BUBBLE_EMPTY,		// enchimento e esvaziamento do pipeline
+			BUBBLE_RAW,			// dependência de dados sem adiantamento
+			BUBBLE_LOAD_USE,	// dependência de um load em EX
+			BUBBLE_FLUSH,		// instrução descartada por desvio tomado
+			BUBBLE_COUNT
+		};
+
+		/**
+		 * Registrador de pipeline: a instrução e os registradores
+		 * auxiliares da BasicCPU que ela leva ao estágio seguinte.
+		 */
+		struct Latch {
+			bool valid;
+			Bubble bubble;				// causa, se não é válido
+
+			uint64_t PC;				// endereço da instrução
+			uint32_t IR;
+			DecodedInstruction *DI;		// até ID
+			bool undefined;				// ID falhou: erro se chegar a EX
+
+			uint64_t A, B, ALUout, MDR;
+			uint64_t *Rd;
+			FPOpFlag fpOp;
+			ALUctrlFlag ALUctrl;
+			FlagsCtrlFlag FlagsCtrl;
+			MEMctrlFlag MEMctrl;
+			WBctrlFlag WBctrl;
+			bool MemtoReg;
+			bool taken;
+
+			bool branch;				// escreve PC (resolvido em EX)
+			BranchPredictor::BranchType type;
+		};
+
+		// IF/ID, ID/EX, EX/MEM e MEM/WB
+		Latch ifid, idex, exmem, memwb;
+
+		// próxima instrução a buscar
+		uint64_t fetchPC;
+
+		struct PipelineStats {
+			uint64_t cycles;
+			uint64_t instructions;			// completadas
+			uint64_t bubbles[BUBBLE_COUNT];
+		} stats;
+
+	private:
+		// limites e instruções completadas da execução corrente
+		uint64_t maxInstructions;
+		uint64_t stopAddress;
+		uint64_t retired;
+
+		/**
+		 * Ciclos da máquina, a partir de PC, até o fim do programa, um
+		 * erro, maxInstructions instruções ou o endereço stopAddress, e
+		 * até o pipeline esvaziar.
+		 */
+		RunResult execute(uint64_t maxInstructions, uint64_t stopAddress);
+
+		/**
+		 * Um ciclo: cada estágio processa a instrução do seu latch.
+		 */
+		void cycle();
+
+		/**
+		 * Se a próxima instrução pode ser buscada: o programa não
+		 * terminou e ela não passa dos limites da execução corrente.
+		 */
+		bool canFetch();
+
+		/**
+		 * Carrega os registradores auxiliares com os de latch, e vice
+		 * versa.
+		 */
+		void load(const Latch &latch);
+		void store(Latch &latch);
+
+		/**
+		 * Esvazia latch, com a causa de bolha bubble.
+		 */
+		static void squash(Latch &latch, Bubble bubble);
+
+		/**
+		 * Se a instrução em latch escreve o registrador reg em WB.
+		 */
+		static bool writes(const Latch &latch, const uint64_t *reg);
+
+		/**
+		 * Erro na instrução de latch: descarta as instruções mais novas
+		 * e deixa as mais antigas completarem.
+		 */
+		void fail(Latch &latch);
+
+		/**
+		 * Adiantamento: escreve no banco de registradores os resultados
+		 * já calculados em MEM/WB e EX/MEM. As instruções mais antigas
+		 * sempre completam, e o WB de cada uma escreve o mesmo valor.
+		 */
+		void forward();
+
+		/**
+		 * Conflito de dados da instrução decodificada em di com as
+		 * instruções em EX/MEM e MEM/WB; BUBBLE_EMPTY se não há.
+		 */
+		Bubble hazard(DecodedInstruction *di);
+
+		/**
+		 * Escreve em src os registradores lidos pela instrução di e
+		 * retorna quantos são.
+		 */
+		int sources(DecodedInstruction *di, const uint64_t *src[3]);
+};
@@ -0,0 +1,249 @@
+/* ----------------------------------------------------------------------------
+
+    (EN) armethyst - A simple ARM Simulator written in C++ for Computer Architecture
+    teaching purposes. Free software licensed under the MIT License (see license
+    below).
+
+    (PT) armethyst - Um simulador ARM simples escrito em C++ para o ensino de
+    Arquitetura de Computadores. Software livre licenciado pela MIT License
+    (veja a licença, em inglês, abaixo).
+
+    (EN) MIT LICENSE:
+
+    Copyright 2020 André Vital Saúde
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+   ----------------------------------------------------------------------------
+*/
+
+#include "PipelinedCPUCheck.h"
+#include "Check.h"
+#include "Assembler.h"
+#include "BasicCPU.h"
+#include "PipelinedCPU.h"
+
+using namespace std;
+
+#define CHECK_N 1000
+
+/**
+ * PipelinedCPU que expõe a contagem de ciclos e de bolhas.
+ */
+class PipelinedCPUCheck: public PipelinedCPU
+{
+	public:
+		PipelinedCPUCheck(Memory *memory) : PipelinedCPU(memory) {}
+
+		uint64_t cycles() { return stats.cycles; }
+		uint64_t instructions() { return stats.instructions; }
+		uint64_t bubbles(int bubble) { return stats.bubbles[bubble]; }
+
+		uint64_t allBubbles()
+		{
+			uint64_t total = 0;
+			for (int i = 0; i < BUBBLE_COUNT; i++) {
+				total += stats.bubbles[i];
+			}
+			return total;
+		}
+
+		// cada ciclo tem uma instrução ou uma bolha entrando em EX
+		void report(string title)
+		{
+			cout << "	" << title << ": " << cycles() << " cycles, "
+					<< instructions() << " instructions, "
+					<< bubbles(BUBBLE_RAW) << " RAW, "
+					<< bubbles(BUBBLE_LOAD_USE) << " load-use, "
+					<< bubbles(BUBBLE_FLUSH) << " flush, "
+					<< bubbles(BUBBLE_EMPTY) << " fill/drain" << endl;
+			CHECK(cycles() == instructions() + allBubbles());
+		}
+
+		static const int RAW = BUBBLE_RAW;
+		static const int LOAD_USE = BUBBLE_LOAD_USE;
+		static const int FLUSH = BUBBLE_FLUSH;
+		static const int EMPTY = BUBBLE_EMPTY;
+};
+
+/**
+ * Fatias de runFor, cada uma esvaziando o pipeline, chegam aos mesmos
+ * estados que a BasicCPU.
+ */
+static void checkSlicesAgainstBasicCPU()
+{
+	string name = "PipelinedCPU runFor slices against BasicCPU";
+	beginCheck(name);
+
+	Memory *refMemory = createMemory(MEM_IMPL_BASIC);
+	Memory *memory = createMemory(MEM_IMPL_BASIC);
+	CheckProgram program = assembleCheckProgram(refMemory, CHECK_N);
+	assembleCheckProgram(memory, CHECK_N);
+	BasicCPU *ref = new BasicCPU(refMemory);
+	PipelinedCPUCheck *cpu = new PipelinedCPUCheck(memory);
+	startCheckProgram(ref, program);
+	startCheckProgram(cpu, program);
+
+	static const uint64_t slices[] = {1, 2, 3, 4, 5, 6, 7, 64, 1000};
+	uint64_t retired = checkSlices(ref, cpu, slices, 9, CPU::NO_LIMIT);
+	cout << "	" << retired << " instructions" << endl;
+	CHECK(cpu->instructions() == retired);
+
+	checkSameMemory(refMemory, memory, program.result, 16 + 4 * CHECK_N);
+
+	delete cpu;
+	delete ref;
+	delete memory;
+	delete refMemory;
+	endCheck(name);
+}
+
+/**
+ * Trechos curtos, cada um terminado por ret, com um só tipo de
+ * conflito; comparados a instruções independentes. x10 aponta para um
+ * dado.
+ */
+enum Hazard { NO_HAZARD, DEPENDENT, LOAD_USE, TAKEN_BRANCH };
+
+static PipelinedCPUCheck *runHazard(Memory *memory, Hazard hazard, string title)
+{
+	PipelinedCPUCheck *cpu = new PipelinedCPUCheck(memory);
+	Assembler as(memory);
+	Assembler::Label data, over;
+	uint64_t entry = as.here();
+	for (int i = 1; i <= 8; i++) {
+		switch (hazard) {
+			case NO_HAZARD:
+				as.sub(X(i), X(i), 1);
+				break;
+			case DEPENDENT:
+				as.sub(X(1), X(1), 1);
+				break;
+			case LOAD_USE:
+				if (i % 2) {
+					as.ldr(W(i), X(10));
+				} else {
+					as.add(W(i), W(i - 1), W(i - 1));
+				}
+				break;
+			case TAKEN_BRANCH:
+				if (i == 4) {
+					as.b(over);
+					as.sub(X(20), X(20), 1);
+					as.bind(over);
+				} else {
+					as.sub(X(i), X(i), 1);
+				}
+				break;
+		}
+	}
+	as.ret();
+	as.bind(data);
+	as.word(21);
+	as.finish();
+
+	// a PipelinedCPU, como a BasicCPU, não decodifica ADR
+	cpu->start(entry);
+	CPUState state;
+	cpu->getState(state);
+	state.R[10] = data.getAddress();
+	cpu->setState(state);
+	CHECK(cpu->runFor(CPU::NO_LIMIT).reason == CPU::EXIT_FINISHED);
+	cpu->report(title);
+	return cpu;
+}
+
+static void checkHazards()
+{
+	string name = "PipelinedCPU hazard bubbles";
+	beginCheck(name);
+
+	Memory *memory = createMemory(MEM_IMPL_BASIC);
+	PipelinedCPUCheck *base = runHazard(memory, NO_HAZARD, "independent");
+	PipelinedCPUCheck *dependent = runHazard(memory, DEPENDENT, "dependent");
+	PipelinedCPUCheck *loadUse = runHazard(memory, LOAD_USE, "load-use");
+	PipelinedCPUCheck *branch = runHazard(memory, TAKEN_BRANCH, "taken branch");
+
+	// enchimento em ID e os dois ciclos descartados pelo ret
+	CHECK(base->instructions() == 9);
+	CHECK(base->bubbles(PipelinedCPUCheck::EMPTY) == 2);
+	CHECK(base->bubbles(PipelinedCPUCheck::FLUSH) == 2);
+	CHECK(base->cycles() == base->instructions() + 4);
+
+#if PIPELINE_FORWARDING
+	CHECK(dependent->cycles() == base->cycles());
+#else
+	CHECK(dependent->bubbles(PipelinedCPUCheck::RAW) > 0);
+#endif
+
+	// um ciclo por load, mesmo com adiantamento
+	CPUState state;
+	loadUse->getState(state);
+	CHECK(state.R[8] == 42);
+	CHECK(loadUse->bubbles(PipelinedCPUCheck::LOAD_USE) == 4);
+	CHECK(loadUse->cycles() == base->cycles() + 4);
+
+	CHECK(branch->bubbles(PipelinedCPUCheck::FLUSH) == 4);
+	CHECK(branch->cycles() == base->cycles() + 2);
+
+	delete branch;
+	delete loadUse;
+	delete dependent;
+	delete base;
+	delete memory;
+	endCheck(name);
+}
+
+/**
+ * No programa de verificação, cada desvio tomado descarta duas
+ * instruções e cada ldr do laço, seguido do add que usa o valor, espera
+ * um ciclo.
+ */
+static void checkProgramBubbles()
+{
+	string name = "PipelinedCPU bubbles on the check program";
+	beginCheck(name);
+
+	Memory *memory = createMemory(MEM_IMPL_BASIC);
+	CheckProgram program = assembleCheckProgram(memory, CHECK_N);
+	PipelinedCPUCheck *cpu = new PipelinedCPUCheck(memory);
+	startCheckProgram(cpu, program);
+	CHECK(cpu->runFor(CPU::NO_LIMIT).reason == CPU::EXIT_FINISHED);
+	cpu->report("check program");
+
+	// b e b.ne do preenchimento, b e b.ne do laço, b.ne que pula o
+	// terço e o ret
+	uint64_t taken = (1 + CHECK_N) + (1 + CHECK_N) + (CHECK_N - CHECK_N / 3) + 1;
+	CHECK(cpu->bubbles(PipelinedCPUCheck::FLUSH) == 2 * taken);
+	CHECK(cpu->bubbles(PipelinedCPUCheck::LOAD_USE) == CHECK_N);
+#if PIPELINE_FORWARDING
+	CHECK(cpu->bubbles(PipelinedCPUCheck::RAW) == 0);
+#endif
+
+	delete cpu;
+	delete memory;
+	endCheck(name);
+}
+
+void checkPipelinedCPU()
+{
+	checkSlicesAgainstBasicCPU();
+	checkProgramBubbles();
+	checkHazards();
+}
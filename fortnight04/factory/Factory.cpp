@@ -36,24 +36,128 @@
 #include "Factory.h"
 
 // Memory implementations
+#if MEM_IMPL == MEM_IMPL_BASIC
 #include "BasicMemory.h"
+#elif MEM_IMPL == MEM_IMPL_SPARSE
+#include "SparseMemory.h"
+#endif
+#include "CachedMemory.h"
 
 // Processor implementations
+#if PROC_IMPL == PROC_IMPL_BASIC
 #include "BasicProcessor.h"
+#elif PROC_IMPL == PROC_IMPL_MULTICORE
+#include "MultiCoreProcessor.h"
+#endif
 
-Memory* Factory::createMemory()
+// os ncleos acessariam a mesma CachedMemory de vrias threads
+#if CACHE_ENABLED && PROC_IMPL == PROC_IMPL_MULTICORE
+#error "CACHE_ENABLED is not supported with PROC_IMPL_MULTICORE (CachedMemory is not thread-safe)"
+#endif
+
+// CPU implementations
+#if CPU_IMPL == CPU_IMPL_BASIC
+#include "BasicCPU.h"
+#elif CPU_IMPL == CPU_IMPL_FAST
+#include "FastCPU.h"
+#elif CPU_IMPL == CPU_IMPL_JIT
+#include "JITCPU.h"
+#elif CPU_IMPL == CPU_IMPL_PIPELINED
+#include "PipelinedCPU.h"
+#endif
+
+/**
+ * Apenas a implementao de memria selecionada em MEM_IMPL  compilada
+ * (ver MemImpl no makefile). Com CACHE_ENABLED, a memria  decorada
+ * por uma CachedMemory.
+ */
+Memory* Factory::createMemory(uint64_t size)
 {
+	Memory* memory = nullptr;
 	switch (MEM_IMPL) {
+#if MEM_IMPL == MEM_IMPL_BASIC
 		case MEM_IMPL_BASIC:
-			return new BasicMemory(MEMORY_SIZE);
+			memory = new BasicMemory(size);
+			break;
+#elif MEM_IMPL == MEM_IMPL_SPARSE
+		case MEM_IMPL_SPARSE:
+			// todo o espao de endereamento, qualquer que seja size
+			(void)size;
+			memory = new SparseMemory();
+			break;
+#endif
 	}
+
+#if CACHE_ENABLED
+	memory = new CachedMemory(memory,
+			{L1I_SIZE, L1I_ASSOC, L1I_LINE, L1I_REPL, L1I_WRITE},
+			{L1D_SIZE, L1D_ASSOC, L1D_LINE, L1D_REPL, L1D_WRITE},
+			{L2_SIZE, L2_ASSOC, L2_LINE, L2_REPL, L2_WRITE});
+#endif
+	return memory;
 };
 
+/**
+ * Apenas a implementao de processador selecionada em PROC_IMPL 
+ * compilada (ver ProcImpl no makefile).
+ */
 Processor* Factory::createProcessor(Memory* memory)
 {
 	switch (PROC_IMPL) {
+#if PROC_IMPL == PROC_IMPL_BASIC
 		case PROC_IMPL_BASIC:
 			return new BasicProcessor(memory);
+#elif PROC_IMPL == PROC_IMPL_MULTICORE
+		case PROC_IMPL_MULTICORE:
+			return new MultiCoreProcessor(memory, PROC_CORES);
+#endif
+	}
+};
+
+/**
+ * Apenas a implementao de CPU selecionada em CPU_IMPL  compilada
+ * (ver CPUImpl no makefile). A CPU recebe os modelos de previso de
+ * desvios selecionados em BRANCH_PREDICTORS.
+ */
+CPU* Factory::createCPU(Memory* memory)
+{
+	CPU* cpu = nullptr;
+	switch (CPU_IMPL) {
+#if CPU_IMPL == CPU_IMPL_BASIC
+		case CPU_IMPL_BASIC:
+			cpu = new BasicCPU(memory);
+			break;
+#elif CPU_IMPL == CPU_IMPL_FAST
+		case CPU_IMPL_FAST:
+			cpu = new FastCPU(memory);
+			break;
+#elif CPU_IMPL == CPU_IMPL_JIT
+		case CPU_IMPL_JIT:
+			cpu = new JITCPU(memory);
+			break;
+#elif CPU_IMPL == CPU_IMPL_PIPELINED
+		case CPU_IMPL_PIPELINED:
+			cpu = new PipelinedCPU(memory);
+			break;
+#endif
+	}
+
+	if (BRANCH_PREDICTORS & BP_BIMODAL) {
+		cpu->addBranchPredictor(new BimodalPredictor(BP_COUNTER_BITS));
+	}
+	if (BRANCH_PREDICTORS & BP_GSHARE) {
+		cpu->addBranchPredictor(new GsharePredictor(BP_COUNTER_BITS, BP_HISTORY_BITS));
+	}
+	if (BRANCH_PREDICTORS & BP_TAGE) {
+		cpu->addBranchPredictor(new TagePredictor(BP_COUNTER_BITS, BP_TAGE_TABLES,
+				BP_TAGE_BITS, BP_TAGE_TAG_BITS));
+	}
+	if (BRANCH_PREDICTORS & BP_BTB) {
+		cpu->addBranchPredictor(new BTBPredictor(BP_BTB_ENTRIES, BP_BTB_ASSOC));
+	}
+	if (BRANCH_PREDICTORS & BP_RAS) {
+		cpu->addBranchPredictor(new RASPredictor(BP_RAS_DEPTH));
 	}
+	return cpu;
 };
 
@@ -43,15 +43,166 @@
 #pragma once
 
 #include "Memory.h"
+#include "BranchPredictor.h"
+#include "Profiler.h"
+
+#include <cstdint>
+#include <vector>
+
+class CheckpointWriter;
+class CheckpointReader;
+struct CPUState;
 
 class CPU
 {
 public:
-	enum CPUerrorCode {NONE}; // ATIVIDADE FUTURA: acrescentar erros
+	enum CPUerrorCode {NONE, UNDEFINED_INSTRUCTION, UNALIGNED_PC}; // ATIVIDADE FUTURA: acrescentar erros
+
+	/**
+	 * Motivo do fim de uma execução limitada (runFor, runUntil).
+	 */
+	enum ExitReason {
+		EXIT_FINISHED,	// o programa terminou (desvio para EXITADDRESS)
+		EXIT_ERROR,		// erro da CPU (ver CPUerrorCode)
+		EXIT_LIMIT,		// executou o número máximo de instruções
+		EXIT_ADDRESS,	// chegou ao endereço de parada
+	};
+
+	/**
+	 * Resultado de uma execução limitada.
+	 */
+	struct RunResult {
+		uint64_t retired;	// instruções executadas nesta chamada
+		ExitReason reason;
+		uint64_t PC;		// próxima instrução a executar
+	};
+
+	// sem limite de instruções, em runFor
+	static const uint64_t NO_LIMIT = ~(uint64_t)0;
+
+	// sem endereço de parada (não alinhado, nunca é um PC válido)
+	static const uint64_t NO_ADDRESS = ~(uint64_t)0;
+
+	/**
+	 * Escreve as estatísticas dos modelos de previsão de desvios e os
+	 * destrói.
+	 */
+	virtual ~CPU()
+	{
+		for (BranchPredictor *predictor : predictors) {
+			predictor->printStats(retiredTotal);
+			delete predictor;
+		}
+	}
+
+	/**
+	 * Executa o programa a partir de startAddress até o retorno de main
+	 * (desvio para EXITADDRESS, ver config.h) ou até um erro.
+	 *
+	 * Retorna 0: se executou corretamente e
+	 *		   1: em caso de erro.
+	 */
 	virtual int run(uint64_t startAddress) = 0;
+
+	/**
+	 * Prepara a execução a partir de startAddress (PC e X30 =
+	 * EXITADDRESS), sem executar instruções. A execução segue com
+	 * runFor e runUntil, que podem ser chamados repetidamente, cada um
+	 * continuando de onde o anterior parou.
+	 */
+	virtual void start(uint64_t startAddress) = 0;
+
+	/**
+	 * Executa no máximo maxInstructions instruções.
+	 */
+	virtual RunResult runFor(uint64_t maxInstructions) = 0;
+
+	/**
+	 * Executa até que a próxima instrução seja a do endereço address
+	 * (que não é executada), ou até o fim do programa ou um erro. A
+	 * primeira instrução é sempre executada, mesmo que esteja em
+	 * address: chamadas repetidas avançam de uma parada à seguinte.
+	 */
+	virtual RunResult runUntil(uint64_t address) = 0;
+
+	/**
+	 * Inicia o registrador SP (topo da pilha).
+	 */
+	virtual void setSP(uint64_t address) = 0;
+
+	/**
+	 * Grava o estado arquitetural da CPU (registradores, flags e estado
+	 * do processo) em checkpoint, como um CPUState.
+	 */
+	virtual void save(CheckpointWriter &checkpoint) = 0;
+
+	/**
+	 * Restaura o estado gravado por save, possivelmente por outra
+	 * implementação de CPU. A execução segue com runFor ou runUntil.
+	 */
+	virtual void restore(CheckpointReader &checkpoint) = 0;
+
+	/**
+	 * Estado arquitetural, o mesmo gravado por save, sem passar por um
+	 * arquivo: setState(state) em outra CPU, de qualquer implementação,
+	 * a faz continuar de onde esta parou (ver Processor::fork).
+	 */
+	virtual void getState(CPUState &state) = 0;
+	virtual void setState(const CPUState &state) = 0;
+
+	/**
+	 * Acrescenta um modelo de previsão de desvios, informado de cada
+	 * desvio executado. A CPU passa a ser dona do modelo.
+	 */
+	void addBranchPredictor(BranchPredictor *predictor)
+	{
+		predictors.push_back(predictor);
+	}
+
+	/**
+	 * Liga o profiler, informado de cada instrução executada e de cada
+	 * desvio tomado (nullptr desliga). A CPU não é dona do profiler.
+	 */
+	void setProfiler(Profiler *profiler)
+	{
+		this->profiler = profiler;
+	}
 	
 protected:
 	Memory *memory;
+
+	/**
+	 * Modelos de previsão de desvios e total de instruções executadas
+	 * (para a taxa de erros por mil instruções).
+	 */
+	std::vector<BranchPredictor *> predictors;
+	uint64_t retiredTotal = 0;
+
+	Profiler *profiler = nullptr;
+
+	/**
+	 * Se os desvios devem ser informados por resolveBranch.
+	 */
+	bool observingBranches()
+	{
+		return !predictors.empty() || profiler;
+	}
+
+	/**
+	 * Informa a todos os modelos o desvio resolvido no endereço pc, e
+	 * ao profiler os desvios diretos tomados (candidatos a laço).
+	 */
+	void resolveBranch(uint64_t pc, BranchPredictor::BranchType type, bool taken,
+						uint64_t target)
+	{
+		for (BranchPredictor *predictor : predictors) {
+			predictor->branch(pc, type, taken, target);
+		}
+		if (profiler && taken && (type == BranchPredictor::BRANCH_CONDITIONAL
+									|| type == BranchPredictor::BRANCH_DIRECT)) {
+			profiler->backEdge(pc, target);
+		}
+	}
 	
 	/**
 	 * Estado da CPU
@@ -38,11 +38,18 @@
 #include "config.h"
 #include "Memory.h"
 #include "Processor.h"
+#include "CPU.h"
 
 class Factory
 {
 	public:		
-		static Memory* createMemory();
+		/**
+		 * Memria da implementao selecionada; size  o tamanho das
+		 * memrias de tamanho fixo (BasicMemory). Lana SimulatorError
+		 * se a memria no puder ser alocada.
+		 */
+		static Memory* createMemory(uint64_t size = MEMORY_SIZE);
 		static Processor* createProcessor(Memory* memory);
+		static CPU* createCPU(Memory* memory);
 };
 
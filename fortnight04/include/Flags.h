@@ -0,0 +1,205 @@
+/* ----------------------------------------------------------------------------
+
+    (EN) Lazily evaluated NZCV condition flags.
+		
+	armethyst - A simple ARM Simulator written in C++ for Computer Architecture
+    teaching purposes. Free software licensed under the MIT License (see license
+    below).
+
+    (PT) Flags de condição NZCV com avaliação preguiçosa.
+    
+	armethyst - Um simulador ARM simples escrito em C++ para o ensino de
+    Arquitetura de Computadores. Software livre licenciado pela MIT License
+    (veja a licença, em inglês, abaixo).
+
+    (EN) MIT LICENSE:
+
+    Copyright 2020 André Vital Saúde
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+   ----------------------------------------------------------------------------
+*/
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+
+/**
+ * Flags de condição NZCV com avaliação preguiçosa.
+ *
+ * Em vez de calcular N, Z, C e V a cada instrução que escreve as flags,
+ * guarda-se apenas a última operação (op), seus operandos (a, b) e seu
+ * resultado (r). As flags só são derivadas quando alguém as consulta:
+ * um B.cond (condition) ou um checkpoint (getNZCV). Como quase toda
+ * escrita das flags é sobrescrita pela seguinte antes de ser lida, o
+ * custo por instrução cai para o de guardar três valores.
+ *
+ * Depois de uma subtração (SUBS, CMP), as 16 condições são avaliadas
+ * diretamente pela comparação de a e b, sem montar NZCV.
+ *
+ * Os campos são públicos porque o código gerado pela JITCPU os escreve
+ * diretamente.
+ */
+class Flags
+{
+	public:
+		/**
+		 * Operação que escreveu as flags por último. Em FLAGS_NZCV, as
+		 * flags estão materializadas nos bits 31-28 de a (após setNZCV).
+		 */
+		enum Op : uint8_t {
+			FLAGS_NZCV,
+			FLAGS_ADD_X,	// ADDS, CMN de 64 bits
+			FLAGS_ADD_W,	// ADDS, CMN de 32 bits
+			FLAGS_SUB_X,	// SUBS, CMP de 64 bits
+			FLAGS_SUB_W,	// SUBS, CMP de 32 bits
+		};
+
+		uint64_t a, b, r;
+		uint8_t op;
+
+		Flags() { setNZCV(0); }
+
+		/**
+		 * Registra a soma r = a + b (ADDS) de 32 ou 64 bits.
+		 */
+		template <class T>
+		void setAdd(T a, T b, T r)
+		{
+			this->a = a;
+			this->b = b;
+			this->r = r;
+			op = sizeof(T) == 8 ? FLAGS_ADD_X : FLAGS_ADD_W;
+		}
+
+		/**
+		 * Registra a subtração r = a - b (SUBS) de 32 ou 64 bits.
+		 */
+		template <class T>
+		void setSub(T a, T b, T r)
+		{
+			this->a = a;
+			this->b = b;
+			this->r = r;
+			op = sizeof(T) == 8 ? FLAGS_SUB_X : FLAGS_SUB_W;
+		}
+
+		/**
+		 * Atribui NZCV (bits 31-28), como em MSR NZCV ou na restauração
+		 * de um checkpoint.
+		 */
+		void setNZCV(uint32_t nzcv)
+		{
+			a = nzcv & 0xF0000000;
+			op = FLAGS_NZCV;
+		}
+
+		/**
+		 * NZCV nos bits 31 (N), 30 (Z), 29 (C) e 28 (V).
+		 */
+		uint32_t getNZCV() const
+		{
+			switch (op) {
+				case FLAGS_ADD_X: return nzcv<uint64_t>(false);
+				case FLAGS_ADD_W: return nzcv<uint32_t>(false);
+				case FLAGS_SUB_X: return nzcv<uint64_t>(true);
+				case FLAGS_SUB_W: return nzcv<uint32_t>(true);
+				default: return (uint32_t)a;
+			}
+		}
+
+		/**
+		 * Se a condição cond (campo cond de B.cond, 0 a 15) é verdadeira.
+		 */
+		bool condition(uint8_t cond) const
+		{
+			switch (op) {
+				case FLAGS_SUB_X:
+					return subCondition<uint64_t>(a, b, r, cond);
+				case FLAGS_SUB_W:
+					return subCondition<uint32_t>(a, b, r, cond);
+				default:
+					return nzcvCondition(getNZCV(), cond);
+			}
+		}
+
+		/**
+		 * Condição cond após a subtração r = a - b, calculada sem as
+		 * flags NZCV.
+		 */
+		template <class T>
+		static bool subCondition(T a, T b, T r, uint8_t cond)
+		{
+			typedef typename std::make_signed<T>::type S;
+			bool result;
+			switch (cond >> 1) {
+				case 0: result = a == b; break;							// EQ/NE
+				case 1: result = a >= b; break;							// CS/CC
+				case 2: result = (S)r < 0; break;						// MI/PL
+				case 3: result = (S)((a ^ b) & (a ^ r)) < 0; break;		// VS/VC
+				case 4: result = a > b; break;							// HI/LS
+				case 5: result = (S)a >= (S)b; break;					// GE/LT
+				case 6: result = (S)a > (S)b; break;					// GT/LE
+				default: result = true;									// AL
+			}
+			return invert(result, cond);
+		}
+
+		/**
+		 * Condição cond para as flags nzcv (bits 31-28).
+		 */
+		static bool nzcvCondition(uint32_t nzcv, uint8_t cond)
+		{
+			bool n = nzcv >> 31, z = (nzcv >> 30) & 1;
+			bool c = (nzcv >> 29) & 1, v = (nzcv >> 28) & 1;
+			bool result;
+			switch (cond >> 1) {
+				case 0: result = z; break;							// EQ/NE
+				case 1: result = c; break;							// CS/CC
+				case 2: result = n; break;							// MI/PL
+				case 3: result = v; break;							// VS/VC
+				case 4: result = c && !z; break;					// HI/LS
+				case 5: result = n == v; break;						// GE/LT
+				case 6: result = !z && n == v; break;				// GT/LE
+				default: result = true;								// AL
+			}
+			return invert(result, cond);
+		}
+
+	private:
+		// cond<0> inverte a condição, exceto em AL (1111)
+		static bool invert(bool result, uint8_t cond)
+		{
+			return (cond & 1) && cond != 15 ? !result : result;
+		}
+
+		// NZCV da operação registrada, de 32 ou 64 bits
+		template <class T>
+		uint32_t nzcv(bool sub) const
+		{
+			T a = this->a, b = this->b, r = this->r;
+			const int sign = sizeof(T) * 8 - 1;
+			uint32_t n = r >> sign;
+			uint32_t z = r == 0;
+			uint32_t c = sub ? a >= b : r < a;
+			uint32_t v = (T)((sub ? a ^ b : ~(a ^ b)) & (a ^ r)) >> sign;
+			return (n << 31) | (z << 30) | (c << 29) | (v << 28);
+		}
+};
@@ -35,22 +35,77 @@
 
 #pragma once
 
+#include "SimulatorError.h"
+
 #include <string>
+#include <vector>
+#include <algorithm>
+#include <iostream>
+#include <cstdlib>
+#include <unistd.h>
+
+// Tamanho das pginas entregues por Memory::getHostPage
+#define HOST_PAGE_BITS 12
+#define HOST_PAGE_SIZE ((uint64_t)1 << HOST_PAGE_BITS)
+
+/**
+ * Observador de alteraes no cdigo armazenado em uma memria.
+ *
+ * CPUs que guardam instrues j decodificadas se registram na memria
+ * (Memory::addListener) para serem avisadas quando instrues so
+ * reescritas e precisam ser buscadas e decodificadas novamente.
+ *
+ * Escritas de dados do programa simulado avisam da thread que as faz:
+ * com MultiCoreProcessor, um observador pode ser avisado enquanto sua
+ * CPU executa em outra thread.
+ */
+class MemoryListener
+{
+	public:
+		/**
+		 * As instrues no intervalo [address, address + size) foram
+		 * alteradas.
+		 */
+		virtual void codeModified(uint64_t address, uint64_t size) = 0;
+
+		/**
+		 * Pginas entregues por Memory::getHostPage deixaram de valer
+		 * (ou de poder ser escritas) e devem ser pedidas novamente.
+		 */
+		virtual void hostPagesChanged() {}
+};
+
+class CheckpointWriter;
+class CheckpointReader;
 
 class Memory
 {
 	public:
+		virtual ~Memory() {}
+
 		virtual void loadBinary(std::string filename) = 0;
 		virtual void writeBinaryAsText (std::string basename) = 0;
 
 		/**
 		 * L uma instruo de 32 bits considerando um endereamento
-		 * em bytes.
+		 * em bytes. As implementaes guardam quais instrues j foram
+		 * lidas, para avisar os observadores quando writeData32 ou
+		 * writeData64 as alterarem.
 		 */
 		virtual uint32_t readInstruction32(uint64_t address) = 0;
 
+		/**
+		 * Informa que a CPU buscou count instrues consecutivas a partir
+		 * de address para execut-las, inclusive as que ela guarda
+		 * decodificadas e no l de novo da memria. Usado por modelos
+		 * de caches (CachedMemory); as CPUs s o chamam com CACHE_ENABLED.
+		 */
+		virtual void fetchInstructions(uint64_t /*address*/, uint64_t /*count*/) {}
+
 		/**
 		 * L um dado de 32 bits considerando um endereamento em bytes.
+		 * Acessos fora da memria, nas leituras e escritas, lanam
+		 * SimulatorError.
 		 */
 		virtual uint32_t readData32(uint64_t address) = 0;
 		
@@ -75,6 +130,136 @@ class Memory
 		 */
 		virtual void writeData64(uint64_t address, uint64_t value) = 0;
 
+		/**
+		 * Copia size bytes de bytes para a memria, a partir de address.
+		 * Usado por carregadores de programas: os observadores so
+		 * avisados como em writeInstruction32.
+		 */
+		virtual void writeBytes(uint64_t address, const void *bytes, uint64_t size) = 0;
+
+		/**
+		 * Carrega size bytes do arquivo fd, a partir de offset, na
+		 * memria a partir de address. Implementaes que puderem
+		 * mapeiam o arquivo diretamente (mmap com MAP_PRIVATE), de modo
+		 * que as pginas so lidas sob demanda e s copiadas quando o
+		 * programa simulado as escreve. Esta verso apenas l o arquivo
+		 * e o copia com writeBytes.
+		 */
+		virtual void mapFile(uint64_t address, int fd, uint64_t offset, uint64_t size)
+		{
+			char buffer[4096];
+			while (size) {
+				uint64_t chunk = size < sizeof(buffer) ? size : sizeof(buffer);
+				ssize_t n = pread(fd, buffer, chunk, offset);
+				if (n <= 0) {
+					throw SimulatorError("Unable to read file at offset " + std::to_string(offset));
+				}
+				writeBytes(address, buffer, n);
+				address += n;
+				offset += n;
+				size -= n;
+			}
+		}
+
+		/**
+		 * Grava o contedo da memria em checkpoint: as pginas no
+		 * nulas, comprimidas (ver Checkpoint.h).
+		 */
+		virtual void save(CheckpointWriter &checkpoint) = 0;
+
+		/**
+		 * Grava apenas as pginas escritas desde o ltimo save,
+		 * saveIncremental ou restore (seo "MEMI", ver Checkpoint.h).
+		 * Esta verso, para implementaes que no registram as pginas
+		 * escritas, grava todo o contedo, como save.
+		 */
+		virtual void saveIncremental(CheckpointWriter &checkpoint)
+		{
+			save(checkpoint);
+		}
+
+		/**
+		 * Substitui o contedo da memria pelo gravado por save ou, se
+		 * gravado por saveIncremental, aplica as pginas gravadas sobre
+		 * o contedo atual, que deve ser o do checkpoint anterior. Os
+		 * observadores so avisados de que todo o cdigo foi alterado.
+		 */
+		virtual void restore(CheckpointReader &checkpoint) = 0;
+
+		/**
+		 * Cria uma cpia da memria (como o fork de um processo) que
+		 * compartilha com esta as pginas no alteradas: cada uma das
+		 * duas s copia uma pgina quando a escreve pela primeira vez
+		 * (copy-on-write), e criar a cpia custa apenas a duplicao das
+		 * tabelas de pginas. Implementaes sem tabela de pginas
+		 * (BasicMemory) copiam todo o contedo.
+		 *
+		 * A cpia  independente desta, pode ser destruda antes ou
+		 * depois dela, e no tem observadores. No  seguro chamar fork
+		 * durante a execuo (MultiCoreProcessor).
+		 */
+		virtual Memory *fork() = 0;
+
+		/**
+		 * Retorna o incio, no hospedeiro, da pgina de HOST_PAGE_SIZE
+		 * bytes que contm address, para que a CPU a acesse diretamente
+		 * (TLB de software), ou nullptr se ela s pode ser acessada
+		 * pelos mtodos acima. Com write, a pgina deve poder tambm ser
+		 * escrita diretamente. Escritas diretas no avisam os
+		 * observadores: pginas com instrues j lidas no so entregues
+		 * para escrita.
+		 *
+		 * A pgina vale at que os observadores sejam avisados com
+		 * hostPagesChanged. Esta verso no permite acesso direto.
+		 */
+		virtual uint8_t *getHostPage(uint64_t /*address*/, bool /*write*/)
+		{
+			return nullptr;
+		}
+
+		/**
+		 * Registra um observador de alteraes no cdigo.
+		 */
+		void addListener(MemoryListener *listener)
+		{
+			listeners.push_back(listener);
+		}
+
+		/**
+		 * Remove um observador registrado com addListener.
+		 */
+		void removeListener(MemoryListener *listener)
+		{
+			listeners.erase(std::remove(listeners.begin(), listeners.end(), listener),
+							listeners.end());
+		}
+
+	protected:
+		/**
+		 * Avisa os observadores que o intervalo [address, address + size)
+		 * foi alterado. Chamado pelas implementaes em writeInstruction32,
+		 * ao carregar um binrio e quando uma escrita de dados alcana
+		 * instrues j lidas.
+		 */
+		void notifyCodeModified(uint64_t address, uint64_t size)
+		{
+			for (MemoryListener *listener : listeners) {
+				listener->codeModified(address, size);
+			}
+		}
+
+		/**
+		 * Avisa os observadores que as pginas entregues por getHostPage
+		 * devem ser pedidas novamente.
+		 */
+		void notifyHostPagesChanged()
+		{
+			for (MemoryListener *listener : listeners) {
+				listener->hostPagesChanged();
+			}
+		}
 
+	private:
+		std::vector<MemoryListener*> listeners;
 };
 
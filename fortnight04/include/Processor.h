@@ -43,14 +43,158 @@
 
 #include "Memory.h"
 #include "CPU.h"
+#include "Checkpoint.h"
+#include "SimulatorError.h"
+
+#include <string>
+#include <cstdlib>
 
 class Processor
 {
 	public:
+		virtual ~Processor() {}
+
 		virtual int run(uint64_t startAddress) = 0;
 
+		/**
+		 * CPU do processador, para execuo limitada (CPU::start,
+		 * CPU::runFor, CPU::runUntil).
+		 */
+		CPU *getCPU() { return cpu; }
+
+		Memory *getMemory() { return memory; }
+
+		/**
+		 * Nmero de ncleos e CPU do ncleo core (ver MultiCoreProcessor).
+		 */
+		virtual int getCores() { return 1; }
+		virtual CPU *getCPU(int /*core*/) { return cpu; }
+
+		/**
+		 * Grava em filename o estado completo do processador: os
+		 * registradores de cada ncleo e o contedo da memria. Erros
+		 * de gravao lanam SimulatorError.
+		 */
+		void save(std::string filename)
+		{
+			CheckpointWriter checkpoint(filename);
+			saveCores(checkpoint);
+			memory->save(checkpoint);
+			lastCheckpoint = filename;
+		}
+
+		/**
+		 * Grava em filename um checkpoint incremental: os registradores
+		 * e apenas as pginas da memria escritas desde o ltimo
+		 * checkpoint gravado ou restaurado, que passa a ser a base deste
+		 * (ver Checkpoint.h) e deve ser mantido. Sem checkpoint anterior,
+		 * ou se filename for o prprio anterior, grava um completo.
+		 *
+		 * A base  gravada pelo nome, se estiver no mesmo diretrio que
+		 * filename (a cadeia pode ser movida inteira), seno pelo caminho
+		 * absoluto.
+		 */
+		void saveIncremental(std::string filename)
+		{
+			if (lastCheckpoint.empty() || lastCheckpoint == filename) {
+				save(filename);
+				return;
+			}
+			CheckpointWriter checkpoint(filename);
+			std::string base = lastCheckpoint;
+			std::string directory = directoryOf(filename);
+			if (directoryOf(base) == directory) {
+				base = base.substr(directory.size());
+			} else if (base[0] != '/') {
+				char *path = realpath(base.c_str(), nullptr);
+				if (path) {
+					base = path;
+					free(path);
+				}
+			}
+			checkpoint.section("BASE");
+			checkpoint.writeString(base);
+			saveCores(checkpoint);
+			memory->saveIncremental(checkpoint);
+			lastCheckpoint = filename;
+		}
+
+		/**
+		 * Restaura o estado gravado por save ou, restaurando antes a
+		 * sua base, por saveIncremental. A execuo segue pela CPU
+		 * (getCPU()->runFor ou runUntil), sem passar por run. Uma base
+		 * de caminho relativo  procurada no diretrio de filename.
+		 *
+		 * Um checkpoint inexistente, invlido ou de outro nmero de
+		 * ncleos lana SimulatorError.
+		 */
+		void restore(std::string filename)
+		{
+			CheckpointReader checkpoint(filename);
+			if (checkpoint.section("PROC", "BASE")) {
+				std::string base = checkpoint.readString();
+				if (!base.empty() && base[0] != '/') {
+					base = directoryOf(filename) + base;
+				}
+				restore(base);
+				checkpoint.section("PROC");
+			}
+			if (checkpoint.readUint64() != (uint64_t)getCores()) {
+				throw SimulatorError(filename + ": checkpoint of another number of cores");
+			}
+			for (int i = 0; i < getCores(); i++) {
+				getCPU(i)->restore(checkpoint);
+			}
+			memory->restore(checkpoint);
+			lastCheckpoint = filename;
+		}
+
+		/**
+		 * Cria uma cpia do processador, que continua a execuo a partir
+		 * do estado atual independentemente deste (ex.: variantes de um
+		 * mesmo estado inicial, com entradas diferentes). A memria 
+		 * copiada com Memory::fork, sob escrita, e cada ncleo recebe o
+		 * estado do ncleo correspondente (CPU::getState). Os modelos de
+		 * previso de desvios da cpia comeam vazios; seu primeiro
+		 * checkpoint incremental tem a mesma base que teria o deste.
+		 *
+		 * A cpia e sua memria (getMemory()) passam a ser do chamador,
+		 * que destri a memria depois do processador.
+		 */
+		virtual Processor *fork()
+		{
+			std::cout << "Processor does not support fork" << std::endl;
+			std::cout << "Aborting... " << std::endl;
+			exit(1);
+		}
+
 	protected:
 		Memory *memory;
 		CPU *cpu;
+
+		// ltimo checkpoint gravado ou restaurado: base do prximo
+		// checkpoint incremental
+		std::string lastCheckpoint;
+
+		/**
+		 * Diretrio de path, com a barra final, ou vazio se path no
+		 * indicar diretrio.
+		 */
+		static std::string directoryOf(const std::string &path)
+		{
+			return path.substr(0, path.rfind('/') + 1);
+		}
+
+		/**
+		 * Seo "PROC" e os registradores de cada ncleo.
+		 */
+		void saveCores(CheckpointWriter &checkpoint)
+		{
+			checkpoint.section("PROC");
+			checkpoint.writeUint64(getCores());
+			for (int i = 0; i < getCores(); i++) {
+				getCPU(i)->save(checkpoint);
+			}
+		}
 };
 
@@ -0,0 +1,199 @@
+/* ----------------------------------------------------------------------------
+
+    (EN) Lane arithmetic of Advanced SIMD (NEON) instructions on host SIMD.
+		
+	armethyst - A simple ARM Simulator written in C++ for Computer Architecture
+    teaching purposes. Free software licensed under the MIT License (see license
+    below).
+
+    (PT) Aritmética por elemento das instruções Advanced SIMD (NEON) com o SIMD do hospedeiro.
+    
+	armethyst - Um simulador ARM simples escrito em C++ para o ensino de
+    Arquitetura de Computadores. Software livre licenciado pela MIT License
+    (veja a licença, em inglês, abaixo).
+
+    (EN) MIT LICENSE:
+
+    Copyright 2020 André Vital Saúde
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+   ----------------------------------------------------------------------------
+*/
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__SSE4_1__)
+#include <smmintrin.h>
+#endif
+#if defined(__FMA__)
+#include <immintrin.h>
+#endif
+
+/**
+ * Operações das instruções Advanced SIMD sobre registradores de 128 bits.
+ *
+ * Um registrador vetorial é um par de palavras de 64 bits: [0] com os
+ * bits 63-0 e [1] com os bits 127-64. Cada operação calcula os 128 bits
+ * de d a partir de n e m (e de d, em FMLA), com elementos do tipo T:
+ * uint8_t, uint16_t, uint32_t ou uint64_t nas operações inteiras (16B,
+ * 8H, 4S, 2D) e float ou double nas de ponto flutuante (4S, 2D). Nos
+ * arranjos de 64 bits (8B, 4H, 2S) quem chama zera d[1].
+ *
+ * Em hospedeiros x86-64 as operações usam SSE2 (SSE4.1 e FMA, se o
+ * compilador os habilitar; ver HostArch no makefile). Nos demais, ou nas
+ * operações sem instrução equivalente, cada elemento é calculado em C++.
+ * FMLA é sempre fundida (um único arredondamento), como no ARM.
+ *
+ * d pode ser o mesmo registrador que n ou m.
+ */
+class Simd
+{
+	public:
+		template <class T>
+		static void add(uint64_t *d, const uint64_t *n, const uint64_t *m)
+		{
+			lanes<T>(d, n, m, [](T a, T b, T) { return (T)(a + b); });
+		}
+
+		template <class T>
+		static void sub(uint64_t *d, const uint64_t *n, const uint64_t *m)
+		{
+			lanes<T>(d, n, m, [](T a, T b, T) { return (T)(a - b); });
+		}
+
+		template <class T>
+		static void mul(uint64_t *d, const uint64_t *n, const uint64_t *m)
+		{
+			lanes<T>(d, n, m, [](T a, T b, T) { return (T)(a * b); });
+		}
+
+		template <class T>
+		static void fadd(uint64_t *d, const uint64_t *n, const uint64_t *m)
+		{
+			lanes<T>(d, n, m, [](T a, T b, T) { return a + b; });
+		}
+
+		template <class T>
+		static void fsub(uint64_t *d, const uint64_t *n, const uint64_t *m)
+		{
+			lanes<T>(d, n, m, [](T a, T b, T) { return a - b; });
+		}
+
+		template <class T>
+		static void fmul(uint64_t *d, const uint64_t *n, const uint64_t *m)
+		{
+			lanes<T>(d, n, m, [](T a, T b, T) { return a * b; });
+		}
+
+		// d = d + n * m
+		template <class T>
+		static void fmla(uint64_t *d, const uint64_t *n, const uint64_t *m)
+		{
+			lanes<T>(d, n, m, [](T a, T b, T c) { return std::fma(a, b, c); });
+		}
+
+	private:
+		// versão escalar: f(n[i], m[i], d[i]) para cada elemento i
+		template <class T, class F>
+		static void lanes(uint64_t *d, const uint64_t *n, const uint64_t *m, F f)
+		{
+			const int count = 16 / sizeof(T);
+			T a[count], b[count], c[count];
+			memcpy(a, n, 16);
+			memcpy(b, m, 16);
+			memcpy(c, d, 16);
+			for (int i = 0; i < count; i++) {
+				c[i] = f(a[i], b[i], c[i]);
+			}
+			memcpy(d, c, 16);
+		}
+};
+
+#if defined(__SSE2__)
+
+/**
+ * Especializações com SSE2 (e SSE4.1, FMA).
+ */
+#define SIMD_SSE_INT(op, T, expr) \
+	template <> inline void Simd::op<T>(uint64_t *d, const uint64_t *n, const uint64_t *m) \
+	{ \
+		__m128i a = _mm_loadu_si128((const __m128i *)n); \
+		__m128i b = _mm_loadu_si128((const __m128i *)m); \
+		_mm_storeu_si128((__m128i *)d, expr); \
+	}
+
+SIMD_SSE_INT(add, uint8_t, _mm_add_epi8(a, b))
+SIMD_SSE_INT(add, uint16_t, _mm_add_epi16(a, b))
+SIMD_SSE_INT(add, uint32_t, _mm_add_epi32(a, b))
+SIMD_SSE_INT(add, uint64_t, _mm_add_epi64(a, b))
+SIMD_SSE_INT(sub, uint8_t, _mm_sub_epi8(a, b))
+SIMD_SSE_INT(sub, uint16_t, _mm_sub_epi16(a, b))
+SIMD_SSE_INT(sub, uint32_t, _mm_sub_epi32(a, b))
+SIMD_SSE_INT(sub, uint64_t, _mm_sub_epi64(a, b))
+SIMD_SSE_INT(mul, uint16_t, _mm_mullo_epi16(a, b))
+
+// 16B: bytes pares e ímpares multiplicados em elementos de 16 bits
+SIMD_SSE_INT(mul, uint8_t, _mm_or_si128(
+		_mm_and_si128(_mm_mullo_epi16(a, b), _mm_set1_epi16(0x00FF)),
+		_mm_slli_epi16(_mm_mullo_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8)), 8)))
+
+#if defined(__SSE4_1__)
+SIMD_SSE_INT(mul, uint32_t, _mm_mullo_epi32(a, b))
+#else
+// 4S: elementos pares e ímpares multiplicados em 64 bits
+SIMD_SSE_INT(mul, uint32_t, _mm_unpacklo_epi32(
+		_mm_shuffle_epi32(_mm_mul_epu32(a, b), _MM_SHUFFLE(0, 0, 2, 0)),
+		_mm_shuffle_epi32(_mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32)),
+							_MM_SHUFFLE(0, 0, 2, 0))))
+#endif
+
+#undef SIMD_SSE_INT
+
+#define SIMD_SSE_FP(op, T, load, store, expr) \
+	template <> inline void Simd::op<T>(uint64_t *d, const uint64_t *n, const uint64_t *m) \
+	{ \
+		auto a = load((const T *)n); \
+		auto b = load((const T *)m); \
+		store((T *)d, expr); \
+	}
+
+SIMD_SSE_FP(fadd, float, _mm_loadu_ps, _mm_storeu_ps, _mm_add_ps(a, b))
+SIMD_SSE_FP(fadd, double, _mm_loadu_pd, _mm_storeu_pd, _mm_add_pd(a, b))
+SIMD_SSE_FP(fsub, float, _mm_loadu_ps, _mm_storeu_ps, _mm_sub_ps(a, b))
+SIMD_SSE_FP(fsub, double, _mm_loadu_pd, _mm_storeu_pd, _mm_sub_pd(a, b))
+SIMD_SSE_FP(fmul, float, _mm_loadu_ps, _mm_storeu_ps, _mm_mul_ps(a, b))
+SIMD_SSE_FP(fmul, double, _mm_loadu_pd, _mm_storeu_pd, _mm_mul_pd(a, b))
+
+#if defined(__FMA__)
+SIMD_SSE_FP(fmla, float, _mm_loadu_ps, _mm_storeu_ps,
+			_mm_fmadd_ps(a, b, _mm_loadu_ps((const float *)d)))
+SIMD_SSE_FP(fmla, double, _mm_loadu_pd, _mm_storeu_pd,
+			_mm_fmadd_pd(a, b, _mm_loadu_pd((const double *)d)))
+#endif
+
+#undef SIMD_SSE_FP
+
+#endif
@@ -0,0 +1,79 @@
+/* ----------------------------------------------------------------------------
+
+    (EN) Error that prevents a simulation from being set up.
+		
+	armethyst - A simple ARM Simulator written in C++ for Computer Architecture
+    teaching purposes. Free software licensed under the MIT License (see license
+    below).
+
+    (PT) Erro que impede a preparação de uma simulação.
+    
+	armethyst - Um simulador ARM simples escrito em C++ para o ensino de
+    Arquitetura de Computadores. Software livre licenciado pela MIT License
+    (veja a licença, em inglês, abaixo).
+
+    (EN) MIT LICENSE:
+
+    Copyright 2020 André Vital Saúde
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+   ----------------------------------------------------------------------------
+*/
+#pragma once
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <sstream>
+
+/**
+ * Erro na preparação ou na execução de uma simulação: binário que não
+ * pode ser carregado, memória que não pode ser alocada, acesso fora
+ * dela, checkpoint que não pode ser gravado ou restaurado.
+ *
+ * Os simuladores informam a mensagem e terminam; o armethyst-batch
+ * registra o erro no resultado do programa e segue com os demais.
+ */
+class SimulatorError : public std::runtime_error
+{
+	public:
+		SimulatorError(const std::string &message) : std::runtime_error(message) {}
+
+		/**
+		 * Acesso do programa simulado a address, fora da memória.
+		 */
+		static SimulatorError addressOutOfRange(uint64_t address)
+		{
+			std::ostringstream message;
+			message << "Memory address out of range: 0x" << std::hex << address;
+			return SimulatorError(message.str());
+		}
+
+		/**
+		 * Escrita de size bytes a partir de address fora da memória.
+		 */
+		static SimulatorError writeOutOfRange(uint64_t address, uint64_t size)
+		{
+			std::ostringstream message;
+			message << "Memory write out of range: 0x" << std::hex << address
+					<< " (" << std::dec << size << " bytes)";
+			return SimulatorError(message.str());
+		}
+};
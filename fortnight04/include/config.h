@@ -37,23 +37,182 @@
 
 // Files
 #define FILENAME "isummation.o"
+
+// Load address of relocatable objects (ElfLoader); executables are loaded
+// at their own addresses and start at their ELF entry point
 #define STARTADDRESS 0x40
 
+// Initial stack pointer (top of the stack): end of the memory for
+// BasicMemory, end of the 48-bit address space for SparseMemory
+#define STACKADDRESS (MEM_IMPL == MEM_IMPL_SPARSE ? 0x1000000000000 : MEMORY_SIZE)
+
+// Return address of main: the CPU starts the link register (X30) with it
+// and the process is finished when the program branches back to it
+#define EXITADDRESS 0
+
 /*
  * Memory
  */
 
 // Available Memory implementations
 #define MEM_IMPL_BASIC 0 // BasicMemory
+#define MEM_IMPL_SPARSE 1 // SparseMemory
 
-// Memory implementation
+// Memory implementation (must match MemImpl in the makefile, which
+// defines it for each implementation measured by make bench)
+#ifndef MEM_IMPL
 #define MEM_IMPL MEM_IMPL_BASIC
+#endif
 
-// Memory whole size
+// Memory whole size (BasicMemory)
 #define MEMORY_SIZE 65536
 
-// Memory log output file
-#define MEMORY_LOG_FILE "saida.txt"
+// Memory trace output file of the test memory (binary, convert it to
+// text with armethyst-trace)
+#define MEMORY_TRACE_FILE "saida.trace"
+
+/*
+ * Cache hierarchy (CachedMemory)
+ */
+
+// Simulate L1I/L1D/L2 caches in front of the memory selected above
+// (statistics printed when the memory is destroyed), 0 disables it.
+// Every CPU reports the instructions it executes to the L1I, including
+// those served from its decoded instruction or block caches: BasicCPU
+// and PipelinedCPU on each fetch, FastCPU and JITCPU once per block
+// entry (runcheck is built with it enabled, see the makefile). The
+// CachedMemory is not thread-safe, so it cannot be combined with
+// PROC_IMPL_MULTICORE (the Factory refuses to compile)
+#ifndef CACHE_ENABLED
+#define CACHE_ENABLED 0
+#endif
+
+// Available replacement policies
+#define CACHE_REPL_LRU 0 // least recently used
+#define CACHE_REPL_PLRU 1 // tree pseudo-LRU (associativity must be a power of 2)
+#define CACHE_REPL_RANDOM 2 // random
+
+// Available write policies
+#define CACHE_WRITE_BACK 0 // write-back, write-allocate
+#define CACHE_WRITE_THROUGH 1 // write-through, no-write-allocate
+
+// Level configuration: size and line size in bytes (powers of 2),
+// associativity, replacement and write policies
+#define L1I_SIZE 32768
+#define L1I_ASSOC 4
+#define L1I_LINE 64
+#define L1I_REPL CACHE_REPL_LRU
+#define L1I_WRITE CACHE_WRITE_BACK
+
+#define L1D_SIZE 32768
+#define L1D_ASSOC 8
+#define L1D_LINE 64
+#define L1D_REPL CACHE_REPL_LRU
+#define L1D_WRITE CACHE_WRITE_BACK
+
+#define L2_SIZE 262144
+#define L2_ASSOC 8
+#define L2_LINE 64
+#define L2_REPL CACHE_REPL_PLRU
+#define L2_WRITE CACHE_WRITE_BACK
+
+/*
+ * CPU
+ */
+
+// Available CPU implementations
+#define CPU_IMPL_BASIC 0 // BasicCPU
+#define CPU_IMPL_FAST 1 // FastCPU
+#define CPU_IMPL_JIT 2 // JITCPU (x86-64 hosts only)
+#define CPU_IMPL_PIPELINED 3 // PipelinedCPU
+
+// CPU implementation (must match CPUImpl in the makefile, which defines
+// it for each implementation measured by make bench)
+#ifndef CPU_IMPL
+#define CPU_IMPL CPU_IMPL_BASIC
+#endif
+
+// Number of entries of the decoded instruction cache (BasicCPU),
+// must be a power of 2
+#define DECODE_CACHE_SIZE 4096
+
+// Maximum number of instructions in a translated basic block (FastCPU)
+#define BLOCK_MAX_SIZE 64
+
+// Execute common instruction pairs (ADRP + ADD, LDR + ADD, CMP + B.cond)
+// as a single operation (FastCPU), 0 disables it
+#define MACRO_FUSION 1
+
+// Instructions examined after a fused CMP + B.cond to find whether the
+// NZCV flags are read again (FastCPU)
+#define FUSION_SCAN 16
+
+// The software TLB that maps guest data pages to host memory (FastCPU,
+// JITCPU) has 2^TLB_BITS entries
+#define TLB_BITS 8
+
+// Number of executions after which a block is compiled to native code
+// (JITCPU)
+#define JIT_THRESHOLD 50
+
+// Size in bytes of the native code buffer (JITCPU)
+#define JIT_BUFFER_SIZE (1 << 20)
+
+// Forwarding of EX/MEM and MEM/WB results to dependent instructions
+// (PipelinedCPU); 0 stalls them until the producer writes back
+#define PIPELINE_FORWARDING 1
+
+/*
+ * Branch prediction
+ */
+
+// Available branch predictor models
+#define BP_BIMODAL 1 // 2-bit counters indexed by PC
+#define BP_GSHARE 2 // 2-bit counters indexed by PC xor global history
+#define BP_TAGE 4 // TAGE-lite: bimodal base plus tagged tables
+#define BP_BTB 8 // branch target buffer
+#define BP_RAS 16 // return address stack
+
+// Models fed by the CPU with every resolved branch (sum of the ones
+// above, statistics printed when the CPU is destroyed), 0 disables
+// branch prediction
+#define BRANCH_PREDICTORS 0
+
+// log2 of the number of counters (bimodal, gshare and TAGE base)
+#define BP_COUNTER_BITS 12
+
+// Global history bits (gshare)
+#define BP_HISTORY_BITS 12
+
+// Tagged tables (TAGE), with histories of 8, 16, 32 and 64 branches,
+// log2 of the entries of each table and tag bits
+#define BP_TAGE_TABLES 4
+#define BP_TAGE_BITS 10
+#define BP_TAGE_TAG_BITS 9
+
+// Entries and associativity of the branch target buffer
+#define BP_BTB_ENTRIES 512
+#define BP_BTB_ASSOC 4
+
+// Return address stack depth
+#define BP_RAS_DEPTH 16
+
+// Branches listed in the statistics of each model (the ones with most
+// mispredictions)
+#define BP_REPORT_BRANCHES 10
+
+/*
+ * Profiling
+ */
+
+// Count retired instructions per PC of the program text (armethyst) and
+// write a report symbolized with the ELF symbols and the .S source of
+// the same name (isummation.o -> isummation.S) to PROFILE_FILE at exit
+#define PROFILE_ENABLED 0
+#define PROFILE_FILE "profile.txt"
+
+// Functions, blocks, loops and instructions listed in the report
+#define PROFILE_TOP 20
 
 /*
  * Processor
@@ -61,10 +220,18 @@
 
 // Available Processor implementations
 #define PROC_IMPL_BASIC 0 // BasicProcessor
+#define PROC_IMPL_MULTICORE 1 // MultiCoreProcessor
 
-// Processor implementation
+// Processor implementation (must match ProcImpl in the makefile)
 #define PROC_IMPL PROC_IMPL_BASIC
 
+// Number of cores (MultiCoreProcessor), each one on its own host thread
+#define PROC_CORES 4
+
+// Stack size of each core (MultiCoreProcessor): core i starts with
+// SP = STACKADDRESS - i * CORE_STACK_SIZE
+#define CORE_STACK_SIZE 0x1000
+
 /*
  * Test levels
  */
@@ -0,0 +1,455 @@
+/* ----------------------------------------------------------------------------
+
+    (EN) ElfLoader - loads ELF64 AArch64 executables and relocatable objects
+		
+	armethyst - A simple ARM Simulator written in C++ for Computer Architecture
+    teaching purposes. Free software licensed under the MIT License (see license
+    below).
+
+    (PT) ElfLoader - carrega executáveis e objetos relocáveis ELF64 AArch64
+    
+	armethyst - Um simulador ARM simples escrito em C++ para o ensino de
+    Arquitetura de Computadores. Software livre licenciado pela MIT License
+    (veja a licença, em inglês, abaixo).
+
+    (EN) MIT LICENSE:
+
+    Copyright 2020 André Vital Saúde
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+   ----------------------------------------------------------------------------
+*/
+
+#include "config.h"
+#include "ElfLoader.h"
+#include "SimulatorError.h"
+
+#include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+using namespace std;
+
+ElfLoader::ElfLoader(Memory *memory)
+{
+	this->memory = memory;
+	entry = 0;
+	textBase = textEnd = 0;
+	nextAddress = STARTADDRESS;
+	placed = placedCode = false;
+	fd = -1;
+	file = nullptr;
+	fileSize = 0;
+}
+
+ElfLoader::~ElfLoader()
+{
+	release();
+}
+
+void ElfLoader::release()
+{
+	if (file) {
+		munmap((void *)file, fileSize);
+		file = nullptr;
+	}
+	if (fd >= 0) {
+		close(fd);
+		fd = -1;
+	}
+}
+
+void ElfLoader::fail(string message)
+{
+	release();
+	throw SimulatorError(filename + ": " + message);
+}
+
+const Elf64SectionHeader &ElfLoader::section(int index)
+{
+	return *(const Elf64SectionHeader *)&file[header.shoff + index * header.shentsize];
+}
+
+const char *ElfLoader::stringAt(int strtab, uint32_t offset)
+{
+	return &file[section(strtab).offset + offset];
+}
+
+uint64_t ElfLoader::findSymbol(std::string name)
+{
+	for (Symbol &symbol : symbols) {
+		if (symbol.name == name) {
+			return symbol.address;
+		}
+	}
+	return 0;
+}
+
+/**
+ * O arquivo é mapeado somente para leitura, de modo que apenas os
+ * cabeçalhos, símbolos e relocações são efetivamente lidos pelo
+ * carregador. O conteúdo das partes alocáveis é entregue à memória com
+ * Memory::mapFile, que pode mapeá-lo sem cópia.
+ */
+uint64_t ElfLoader::load(std::string filename)
+{
+	release();
+	this->filename = filename;
+
+	fd = open(filename.c_str(), O_RDONLY);
+	if (fd < 0) {
+		fail("unable to open file");
+	}
+	fileSize = lseek(fd, 0, SEEK_END);
+	if (fileSize < sizeof(Elf64Header)) {
+		fail("not an ELF file");
+	}
+	void *mapped = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (mapped == MAP_FAILED) {
+		fail("unable to map file");
+	}
+	file = (const char *)mapped;
+
+	if (memcmp(file, "\177ELF", 4) != 0) {
+		fail("not an ELF file");
+	}
+	memcpy(&header, file, sizeof(header));
+	if (header.ident[4] != 2 || header.ident[5] != 1) {
+		fail("not a little-endian ELF64 file");
+	}
+	if (header.machine != ELF_EM_AARCH64) {
+		fail("not an AArch64 ELF file");
+	}
+	if (header.shoff + (uint64_t)header.shnum * header.shentsize > fileSize
+			|| header.phoff + (uint64_t)header.phnum * header.phentsize > fileSize) {
+		fail("truncated ELF file");
+	}
+
+	sectionAddress.assign(header.shnum, 0);
+	symbols.clear();
+
+	switch (header.type) {
+		case ELF_ET_EXEC:
+		case ELF_ET_DYN:
+			loadSegments();
+			break;
+		case ELF_ET_REL:
+			loadSections();
+			break;
+		default:
+			fail("unsupported ELF type");
+	}
+
+	textBase = textEnd = 0;
+	for (int i = 0; i < header.shnum; i++) {
+		const Elf64SectionHeader &s = section(i);
+		if (!(s.flags & ELF_SHF_EXECINSTR) || !sectionAddress[i] || !s.size) continue;
+		if (textBase == textEnd) {
+			textBase = sectionAddress[i];
+			textEnd = sectionAddress[i] + s.size;
+		} else {
+			textBase = min(textBase, sectionAddress[i]);
+			textEnd = max(textEnd, sectionAddress[i] + s.size);
+		}
+	}
+
+	for (int i = 0; i < header.shnum; i++) {
+		if (section(i).type == ELF_SHT_SYMTAB) {
+			readSymbols(section(i));
+		}
+	}
+
+	for (int i = 0; i < header.shnum; i++) {
+		if (section(i).type == ELF_SHT_RELA) {
+			applyRelocations(section(i));
+		}
+	}
+
+	if (header.type == ELF_ET_REL) {
+		entry = findSymbol("main");
+		for (int i = 0; !entry && i < header.shnum; i++) {
+			if ((section(i).flags & ELF_SHF_EXECINSTR) && sectionAddress[i]) {
+				entry = sectionAddress[i];
+			}
+		}
+	} else {
+		entry = header.entry;
+	}
+
+	release();
+	return entry;
+}
+
+/**
+ * Executáveis: segmentos PT_LOAD nos seus endereços virtuais.
+ */
+void ElfLoader::loadSegments()
+{
+	for (int i = 0; i < header.phnum; i++) {
+		const Elf64ProgramHeader &segment =
+				*(const Elf64ProgramHeader *)&file[header.phoff + i * header.phentsize];
+		if (segment.type != ELF_PT_LOAD) continue;
+
+		if (segment.offset + segment.filesz > fileSize) {
+			fail("truncated segment");
+		}
+		memory->mapFile(segment.vaddr, fd, segment.offset, segment.filesz);
+		if (segment.memsz > segment.filesz) {
+			std::vector<char> zeros(segment.memsz - segment.filesz, 0);
+			memory->writeBytes(segment.vaddr + segment.filesz, zeros.data(), zeros.size());
+		}
+	}
+
+	for (int i = 0; i < header.shnum; i++) {
+		if (section(i).flags & ELF_SHF_ALLOC) {
+			sectionAddress[i] = section(i).addr;
+		}
+	}
+}
+
+/**
+ * Objetos relocáveis: seções alocáveis em sequência a partir de
+ * STARTADDRESS.
+ */
+void ElfLoader::loadSections()
+{
+	for (int i = 0; i < header.shnum; i++) {
+		const Elf64SectionHeader &s = section(i);
+		if (!(s.flags & ELF_SHF_ALLOC) || s.size == 0) continue;
+
+		uint64_t address = allocate(s.size, s.addralign ? s.addralign : 1,
+									s.flags & ELF_SHF_EXECINSTR);
+		sectionAddress[i] = address;
+
+		if (s.type == ELF_SHT_NOBITS) {
+			std::vector<char> zeros(s.size, 0);
+			memory->writeBytes(address, zeros.data(), zeros.size());
+		} else {
+			if (s.offset + s.size > fileSize) {
+				fail("truncated section");
+			}
+			memory->mapFile(address, fd, s.offset, s.size);
+		}
+	}
+}
+
+uint64_t ElfLoader::allocate(uint64_t size, uint64_t align, bool code)
+{
+	if (placed && code != placedCode && align < HOST_PAGE_SIZE) {
+		align = HOST_PAGE_SIZE;
+	}
+	uint64_t address = (nextAddress + align - 1) & ~(align - 1);
+	nextAddress = address + size;
+	placed = true;
+	placedCode = code;
+	return address;
+}
+
+/**
+ * Calcula o endereço final de cada símbolo. Símbolos COMMON (variáveis
+ * globais não inicializadas de compiladores antigos) são alocados após
+ * as seções.
+ */
+void ElfLoader::readSymbols(const Elf64SectionHeader &symtab)
+{
+	uint64_t count = symtab.size / sizeof(Elf64Symbol);
+	symbolAddress.assign(count, 0);
+	symbolDefined.assign(count, true);
+
+	for (uint64_t i = 0; i < count; i++) {
+		const Elf64Symbol &sym = *(const Elf64Symbol *)&file[symtab.offset + i * sizeof(Elf64Symbol)];
+		uint64_t address;
+
+		if (sym.shndx == ELF_SHN_UNDEF) {
+			symbolDefined[i] = i == 0;
+			continue;
+		} else if (sym.shndx == ELF_SHN_ABS) {
+			address = sym.value;
+		} else if (sym.shndx == ELF_SHN_COMMON) {
+			address = allocate(sym.size, sym.value ? sym.value : 1, false);
+			std::vector<char> zeros(sym.size, 0);
+			memory->writeBytes(address, zeros.data(), zeros.size());
+		} else if (sym.shndx < header.shnum) {
+			address = header.type == ELF_ET_REL
+					? sectionAddress[sym.shndx] + sym.value
+					: sym.value;
+		} else {
+			continue;
+		}
+		symbolAddress[i] = address;
+
+		// apenas funções e objetos nomeados; $x, $d são marcadores
+		const char *name = stringAt(symtab.link, sym.name);
+		uint8_t type = sym.info & 0xF;
+		if (*name && *name != '$' && type <= ELF_STT_FUNC) {
+			symbols.push_back({ name, address, sym.size, type == ELF_STT_FUNC });
+		}
+	}
+}
+
+void ElfLoader::applyRelocations(const Elf64SectionHeader &rela)
+{
+	// relocações de seções não carregadas (ex.: depuração) são ignoradas
+	if (header.type == ELF_ET_REL && !sectionAddress[rela.info]) return;
+	// executáveis já foram ligados
+	if (header.type == ELF_ET_EXEC) return;
+
+	uint64_t count = rela.size / sizeof(Elf64Rela);
+	for (uint64_t i = 0; i < count; i++) {
+		const Elf64Rela &r = *(const Elf64Rela *)&file[rela.offset + i * sizeof(Elf64Rela)];
+		uint32_t index = r.info >> 32;
+		uint32_t type = r.info & 0xFFFFFFFF;
+
+		uint64_t place = header.type == ELF_ET_REL
+				? sectionAddress[rela.info] + r.offset
+				: r.offset;
+
+		uint64_t symbol = 0;
+		if (index) {
+			if (index >= symbolAddress.size() || !symbolDefined[index]) {
+				fail("undefined symbol in relocation");
+			}
+			symbol = symbolAddress[index];
+		}
+
+		relocate(type, place, symbol + r.addend);
+	}
+}
+
+void ElfLoader::patchInstruction(uint64_t address, uint64_t value, int shift, int bits)
+{
+	uint32_t mask = ((1u << bits) - 1) << shift;
+	uint32_t instruction = memory->readInstruction32(address);
+	instruction = (instruction & ~mask) | (((uint32_t)value << shift) & mask);
+	memory->writeInstruction32(address, instruction);
+}
+
+// Page(expr) da especificação: expr com os 12 bits menos significativos zerados
+#define PAGE(x) ((x) & ~(uint64_t)0xFFF)
+
+void ElfLoader::relocate(uint32_t type, uint64_t place, uint64_t value)
+{
+	int64_t offset = value - place;
+
+	switch (type) {
+		case R_AARCH64_NONE:
+			break;
+
+		// dados
+		case R_AARCH64_ABS64:
+			memory->writeData64(place, value);
+			break;
+		case R_AARCH64_ABS32:
+			memory->writeData32(place, value);
+			break;
+		case R_AARCH64_PREL64:
+			memory->writeData64(place, offset);
+			break;
+		case R_AARCH64_PREL32:
+			memory->writeData32(place, offset);
+			break;
+		case R_AARCH64_RELATIVE:
+			// ET_DYN carregado no endereço base 0: o valor é o addend
+			memory->writeData64(place, value);
+			break;
+
+		// MOVZ/MOVK: imm16, bits 5-20
+		case R_AARCH64_MOVW_UABS_G0:
+		case R_AARCH64_MOVW_UABS_G0_NC:
+			patchInstruction(place, value, 5, 16);
+			break;
+		case R_AARCH64_MOVW_UABS_G1:
+		case R_AARCH64_MOVW_UABS_G1_NC:
+			patchInstruction(place, value >> 16, 5, 16);
+			break;
+		case R_AARCH64_MOVW_UABS_G2:
+		case R_AARCH64_MOVW_UABS_G2_NC:
+			patchInstruction(place, value >> 32, 5, 16);
+			break;
+		case R_AARCH64_MOVW_UABS_G3:
+			patchInstruction(place, value >> 48, 5, 16);
+			break;
+
+		// ADR, ADRP: immlo, bits 29-30, e immhi, bits 5-23
+		case R_AARCH64_ADR_PREL_LO21:
+			patchInstruction(place, offset, 29, 2);
+			patchInstruction(place, offset >> 2, 5, 19);
+			break;
+		case R_AARCH64_ADR_PREL_PG_HI21:
+		case R_AARCH64_ADR_PREL_PG_HI21_NC:
+			{
+				int64_t pages = (int64_t)(PAGE(value) - PAGE(place)) >> 12;
+				if (type == R_AARCH64_ADR_PREL_PG_HI21
+						&& (pages < -(1 << 20) || pages >= (1 << 20))) {
+					fail("ADR_PREL_PG_HI21 relocation out of range");
+				}
+				patchInstruction(place, pages, 29, 2);
+				patchInstruction(place, pages >> 2, 5, 19);
+			}
+			break;
+
+		// ADD e loads/stores (unsigned offset): imm12, bits 10-21
+		case R_AARCH64_ADD_ABS_LO12_NC:
+		case R_AARCH64_LDST8_ABS_LO12_NC:
+			patchInstruction(place, value & 0xFFF, 10, 12);
+			break;
+		case R_AARCH64_LDST16_ABS_LO12_NC:
+			patchInstruction(place, (value & 0xFFF) >> 1, 10, 12);
+			break;
+		case R_AARCH64_LDST32_ABS_LO12_NC:
+			patchInstruction(place, (value & 0xFFF) >> 2, 10, 12);
+			break;
+		case R_AARCH64_LDST64_ABS_LO12_NC:
+			patchInstruction(place, (value & 0xFFF) >> 3, 10, 12);
+			break;
+		case R_AARCH64_LDST128_ABS_LO12_NC:
+			patchInstruction(place, (value & 0xFFF) >> 4, 10, 12);
+			break;
+
+		// desvios
+		case R_AARCH64_JUMP26:
+		case R_AARCH64_CALL26:
+			if (offset < -(1 << 27) || offset >= (1 << 27)) {
+				fail("CALL26/JUMP26 relocation out of range");
+			}
+			patchInstruction(place, offset >> 2, 0, 26);
+			break;
+		case R_AARCH64_CONDBR19:
+		case R_AARCH64_LD_PREL_LO19:
+			if (offset < -(1 << 20) || offset >= (1 << 20)) {
+				fail("CONDBR19/LD_PREL_LO19 relocation out of range");
+			}
+			patchInstruction(place, offset >> 2, 5, 19);
+			break;
+		case R_AARCH64_TSTBR14:
+			if (offset < -(1 << 15) || offset >= (1 << 15)) {
+				fail("TSTBR14 relocation out of range");
+			}
+			patchInstruction(place, offset >> 2, 5, 14);
+			break;
+
+		default:
+			fail("unsupported relocation type " + to_string(type));
+	}
+}
@@ -0,0 +1,283 @@
+/* ----------------------------------------------------------------------------
+
+    (EN) ElfLoader - loads ELF64 AArch64 executables and relocatable objects
+		
+	armethyst - A simple ARM Simulator written in C++ for Computer Architecture
+    teaching purposes. Free software licensed under the MIT License (see license
+    below).
+
+    (PT) ElfLoader - carrega executáveis e objetos relocáveis ELF64 AArch64
+    
+	armethyst - Um simulador ARM simples escrito em C++ para o ensino de
+    Arquitetura de Computadores. Software livre licenciado pela MIT License
+    (veja a licença, em inglês, abaixo).
+
+    (EN) MIT LICENSE:
+
+    Copyright 2020 André Vital Saúde
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+   ----------------------------------------------------------------------------
+*/
+
+#pragma once
+
+#include "Memory.h"
+
+#include <string>
+#include <vector>
+
+/**
+ * Estruturas do formato ELF64 (apenas os campos e constantes usados).
+ */
+struct Elf64Header {
+	uint8_t ident[16];
+	uint16_t type;
+	uint16_t machine;
+	uint32_t version;
+	uint64_t entry;
+	uint64_t phoff;
+	uint64_t shoff;
+	uint32_t flags;
+	uint16_t ehsize;
+	uint16_t phentsize;
+	uint16_t phnum;
+	uint16_t shentsize;
+	uint16_t shnum;
+	uint16_t shstrndx;
+};
+
+struct Elf64ProgramHeader {
+	uint32_t type;
+	uint32_t flags;
+	uint64_t offset;
+	uint64_t vaddr;
+	uint64_t paddr;
+	uint64_t filesz;
+	uint64_t memsz;
+	uint64_t align;
+};
+
+struct Elf64SectionHeader {
+	uint32_t name;
+	uint32_t type;
+	uint64_t flags;
+	uint64_t addr;
+	uint64_t offset;
+	uint64_t size;
+	uint32_t link;
+	uint32_t info;
+	uint64_t addralign;
+	uint64_t entsize;
+};
+
+struct Elf64Symbol {
+	uint32_t name;
+	uint8_t info;
+	uint8_t other;
+	uint16_t shndx;
+	uint64_t value;
+	uint64_t size;
+};
+
+struct Elf64Rela {
+	uint64_t offset;
+	uint64_t info;
+	int64_t addend;
+};
+
+#define ELF_ET_REL 1
+#define ELF_ET_EXEC 2
+#define ELF_ET_DYN 3
+#define ELF_EM_AARCH64 183
+
+#define ELF_PT_LOAD 1
+
+#define ELF_SHT_SYMTAB 2
+#define ELF_SHT_RELA 4
+#define ELF_SHT_NOBITS 8
+#define ELF_SHF_ALLOC 0x2
+#define ELF_SHF_EXECINSTR 0x4
+
+#define ELF_SHN_UNDEF 0
+#define ELF_SHN_ABS 0xFFF1
+#define ELF_SHN_COMMON 0xFFF2
+
+#define ELF_STT_FUNC 2
+
+/**
+ * Relocações AArch64 tratadas (ELF for the Arm 64-bit Architecture,
+ * seção 5.7).
+ */
+#define R_AARCH64_NONE 0
+#define R_AARCH64_ABS64 257
+#define R_AARCH64_ABS32 258
+#define R_AARCH64_PREL64 260
+#define R_AARCH64_PREL32 261
+#define R_AARCH64_MOVW_UABS_G0 263
+#define R_AARCH64_MOVW_UABS_G0_NC 264
+#define R_AARCH64_MOVW_UABS_G1 265
+#define R_AARCH64_MOVW_UABS_G1_NC 266
+#define R_AARCH64_MOVW_UABS_G2 267
+#define R_AARCH64_MOVW_UABS_G2_NC 268
+#define R_AARCH64_MOVW_UABS_G3 269
+#define R_AARCH64_LD_PREL_LO19 273
+#define R_AARCH64_ADR_PREL_LO21 274
+#define R_AARCH64_ADR_PREL_PG_HI21 275
+#define R_AARCH64_ADR_PREL_PG_HI21_NC 276
+#define R_AARCH64_ADD_ABS_LO12_NC 277
+#define R_AARCH64_LDST8_ABS_LO12_NC 278
+#define R_AARCH64_TSTBR14 279
+#define R_AARCH64_CONDBR19 280
+#define R_AARCH64_JUMP26 282
+#define R_AARCH64_CALL26 283
+#define R_AARCH64_LDST16_ABS_LO12_NC 284
+#define R_AARCH64_LDST32_ABS_LO12_NC 285
+#define R_AARCH64_LDST64_ABS_LO12_NC 286
+#define R_AARCH64_LDST128_ABS_LO12_NC 299
+#define R_AARCH64_RELATIVE 1027
+
+/**
+ * ElfLoader
+ *
+ * Carrega um arquivo ELF64 AArch64 na memória, copiando apenas o que o
+ * programa usa em execução (cabeçalhos, tabelas de símbolos e de
+ * relocação ficam fora da memória simulada):
+ *
+ *	- executáveis (ET_EXEC, ET_DYN): os segmentos PT_LOAD são copiados
+ *	  para seus endereços virtuais, com o restante de cada segmento
+ *	  (.bss) zerado. O ponto de entrada é e_entry.
+ *
+ *	- objetos relocáveis (ET_REL, como isummation.o): as seções alocáveis
+ *	  (.text, .data, .bss, ...) são dispostas em sequência a partir de
+ *	  STARTADDRESS, respeitando o alinhamento de cada uma, e as
+ *	  relocações RELA são aplicadas. O ponto de entrada é o símbolo main
+ *	  ou, se não houver, o início da primeira seção executável.
+ *
+ * Erros (arquivo inválido, relocação não suportada, símbolo indefinido)
+ * lançam SimulatorError (ver load).
+ */
+class ElfLoader
+{
+	public:
+		/**
+		 * Símbolo do programa carregado, já com o endereço final.
+		 */
+		struct Symbol {
+			std::string name;
+			uint64_t address;
+			uint64_t size;
+			bool function;
+		};
+
+		ElfLoader(Memory *memory);
+		~ElfLoader();
+
+		/**
+		 * Carrega filename na memória e retorna o ponto de entrada.
+		 * Lança SimulatorError se o arquivo não puder ser carregado.
+		 */
+		uint64_t load(std::string filename);
+
+		uint64_t getEntry() { return entry; }
+
+		std::string getFilename() { return filename; }
+
+		/**
+		 * Intervalo [textBase, textBase + textSize) que contém as seções
+		 * executáveis do programa carregado.
+		 */
+		uint64_t getTextBase() { return textBase; }
+		uint64_t getTextSize() { return textEnd - textBase; }
+
+		/**
+		 * Símbolos (funções e objetos) do programa carregado.
+		 */
+		const std::vector<Symbol> &getSymbols() { return symbols; }
+
+		/**
+		 * Endereço do símbolo name, ou 0 se não existir.
+		 */
+		uint64_t findSymbol(std::string name);
+
+	private:
+		Memory *memory;
+		std::string filename;
+
+		// arquivo mapeado somente para leitura durante load()
+		int fd;
+		const char *file;
+		uint64_t fileSize;
+
+		Elf64Header header;
+
+		// endereço de carga de cada seção (0 se não alocada)
+		std::vector<uint64_t> sectionAddress;
+
+		// próximo endereço livre, na disposição de seções de ET_REL, e
+		// se a última parte disposta (seção ou símbolo COMMON) foi de
+		// código (ver allocate)
+		uint64_t nextAddress;
+		bool placed;
+		bool placedCode;
+
+		// endereço final de cada símbolo da tabela de símbolos, e se
+		// ele está definido
+		std::vector<uint64_t> symbolAddress;
+		std::vector<bool> symbolDefined;
+
+		uint64_t entry;
+		uint64_t textBase, textEnd;
+		std::vector<Symbol> symbols;
+
+		const Elf64SectionHeader &section(int index);
+		const char *stringAt(int strtab, uint32_t offset);
+
+		void loadSegments();
+		void loadSections();
+		void readSymbols(const Elf64SectionHeader &symtab);
+
+		/**
+		 * Dispõe size bytes alinhados a align a partir de nextAddress e
+		 * retorna o endereço. Código e dados não compartilham páginas
+		 * do hospedeiro, como nos segmentos de um executável ligado:
+		 * escritas em páginas com instruções já lidas passam pela
+		 * memória (ver Memory::getHostPage).
+		 */
+		uint64_t allocate(uint64_t size, uint64_t align, bool code);
+		void applyRelocations(const Elf64SectionHeader &rela);
+
+		/**
+		 * Aplica a relocação type no endereço place, com o valor S + A.
+		 */
+		void relocate(uint32_t type, uint64_t place, uint64_t value);
+
+		/**
+		 * Altera os bits [shift, shift + bits) da instrução em address.
+		 */
+		void patchInstruction(uint64_t address, uint64_t value, int shift, int bits);
+
+		/**
+		 * Fecha o arquivo mapeado por load(), se ainda aberto.
+		 */
+		void release();
+
+		void fail(std::string message);
+};
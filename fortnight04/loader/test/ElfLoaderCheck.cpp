@@ -0,0 +1,174 @@
+/* ----------------------------------------------------------------------------
+
+    (EN) armethyst - A simple ARM Simulator written in C++ for Computer Architecture
+    teaching purposes. Free software licensed under the MIT License (see license
+    below).
+
+    (PT) armethyst - Um simulador ARM simples escrito em C++ para o ensino de
+    Arquitetura de Computadores. Software livre licenciado pela MIT License
+    (veja a licença, em inglês, abaixo).
+
+    (EN) MIT LICENSE:
+
+    Copyright 2020 André Vital Saúde
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+   ----------------------------------------------------------------------------
+*/
+
+#include "ElfLoaderCheck.h"
+#include "Check.h"
+#include "ElfLoader.h"
+#include "FastCPU.h"
+
+using namespace std;
+
+#define RELOCS_FILE "loader/test/relocs.o"
+
+/**
+ * Campo de bits [shift, shift + bits) de ir, com extensão de sinal se
+ * signed.
+ */
+static int64_t field(uint32_t ir, int shift, int bits, bool isSigned)
+{
+	uint64_t value = (ir >> shift) & (((uint64_t)1 << bits) - 1);
+	if (isSigned && (value >> (bits - 1))) {
+		value |= ~(uint64_t)0 << bits;
+	}
+	return (int64_t)value;
+}
+
+/**
+ * Imediato de 21 bits de ADR e ADRP (immhi, bits 5-23, e immlo, bits
+ * 29-30).
+ */
+static int64_t adrImmediate(uint32_t ir)
+{
+	return field(ir, 5, 19, true) * 4 + field(ir, 29, 2, false);
+}
+
+static uint64_t symbol(ElfLoader &loader, string name)
+{
+	uint64_t address = loader.findSymbol(name);
+	CHECK(address != 0);
+	return address;
+}
+
+/**
+ * Cada campo relocado de relocs.o (ver relocs.S) leva ao endereço final
+ * do seu símbolo, em cada implementação de memória.
+ */
+static void checkRelocations(int memImpl)
+{
+	string name = "ElfLoader relocations on " + memoryName(memImpl);
+	beginCheck(name);
+
+	Memory *memory = createMemory(memImpl);
+	ElfLoader loader(memory);
+	uint64_t entry = loader.load(RELOCS_FILE);
+
+	uint64_t main = symbol(loader, "main");
+	uint64_t helper = symbol(loader, "helper");
+	uint64_t table = symbol(loader, "table");
+	uint64_t word = symbol(loader, "word");
+	uint64_t dword = symbol(loader, "dword");
+	uint64_t literal = symbol(loader, "literal");
+	uint64_t zeros = symbol(loader, "zeros");
+	cout << hex << "	main=0x" << main << " helper=0x" << helper << " table=0x" << table
+			<< " zeros=0x" << zeros << dec << endl;
+	CHECK(entry == main);
+	CHECK(main >= STARTADDRESS);
+	CHECK(helper >= main + 0x40 && (helper & 3) == 0);
+	CHECK(loader.getTextBase() <= main && helper < loader.getTextBase() + loader.getTextSize());
+
+	// dados em outras páginas do hospedeiro que o código
+	CHECK(table >> HOST_PAGE_BITS != (helper + 3) >> HOST_PAGE_BITS);
+	CHECK(zeros > literal);
+
+	// instruções
+	auto ir = [&](uint64_t offset) { return memory->readData32(main + offset); };
+	uint64_t page = ~(uint64_t)0xFFF;
+	CHECK((main & page) + (adrImmediate(ir(0x00)) << 12) == (table & page));
+	CHECK((uint64_t)field(ir(0x04), 10, 12, false) == (table & 0xFFF));
+	CHECK(((main + 0x08) & page) + (adrImmediate(ir(0x08)) << 12) == (word & page));
+	CHECK((uint64_t)field(ir(0x0c), 10, 12, false) * 4 == (word & 0xFFF));
+	CHECK(((main + 0x10) & page) + (adrImmediate(ir(0x10)) << 12) == (dword & page));
+	CHECK((uint64_t)field(ir(0x14), 10, 12, false) * 8 == (dword & 0xFFF));
+	CHECK(main + 0x18 + adrImmediate(ir(0x18)) == table);
+	CHECK(main + 0x1c + field(ir(0x1c), 5, 19, true) * 4 == literal);
+	uint64_t moved = 0;
+	for (int i = 0; i < 4; i++) {
+		moved |= (uint64_t)field(ir(0x20 + 4 * i), 5, 16, false) << (48 - 16 * i);
+	}
+	CHECK(moved == table);
+	CHECK(main + 0x30 + field(ir(0x30), 0, 26, true) * 4 == helper);
+	CHECK(main + 0x34 + field(ir(0x34), 5, 19, true) * 4 == helper);
+	CHECK(main + 0x38 + field(ir(0x38), 5, 14, true) * 4 == helper);
+	CHECK(main + 0x3c + field(ir(0x3c), 0, 26, true) * 4 == helper);
+
+	// os demais campos das instruções não mudam
+	CHECK((ir(0x30) & 0xFC000000) == 0x94000000);	// BL
+	CHECK((ir(0x34) & 0xFF00001F) == 0x54000000);	// B.EQ
+	CHECK((ir(0x3c) & 0xFC000000) == 0x14000000);	// B
+	CHECK(memory->readData32(helper) == 0xD65F03C0);	// RET
+
+	// dados
+	CHECK(memory->readData64(table) == main);
+	CHECK(memory->readData32(table + 8) == helper);
+	CHECK((int32_t)memory->readData32(table + 12) == (int64_t)(helper - (table + 12)));
+	CHECK(memory->readData64(table + 16) == helper - (table + 16));
+	CHECK(memory->readData32(word) == 0x11223344);
+	CHECK(memory->readData64(dword) == 0x5566778899aabbcc);
+	CHECK(memory->readData64(literal) == 0x0102030405060708);
+	CHECK(memory->readData64(zeros) == 0 && memory->readData64(zeros + 8) == 0);
+
+	delete memory;
+	endCheck(name);
+}
+
+/**
+ * isummation.o, com relocações ADRP + ADD, executa na FastCPU e chega à
+ * soma de v em summ.
+ */
+static void checkRelocatedProgram(int memImpl)
+{
+	string name = "ElfLoader isummation.o on " + memoryName(memImpl);
+	beginCheck(name);
+
+	Memory *memory = createMemory(memImpl);
+	ElfLoader loader(memory);
+	uint64_t entry = loader.load("isummation.o");
+	FastCPU *cpu = new FastCPU(memory);
+	cpu->setSP(memImpl == MEM_IMPL_SPARSE ? (uint64_t)1 << 48 : MEMORY_SIZE);
+	cpu->start(entry);
+	CHECK(cpu->runFor(CPU::NO_LIMIT).reason == CPU::EXIT_FINISHED);
+	CHECK(memory->readData32(loader.findSymbol("summ")) == 55);
+
+	delete cpu;
+	delete memory;
+	endCheck(name);
+}
+
+void checkElfLoader()
+{
+	checkRelocations(MEM_IMPL_BASIC);
+	checkRelocations(MEM_IMPL_SPARSE);
+	checkRelocatedProgram(MEM_IMPL_BASIC);
+}
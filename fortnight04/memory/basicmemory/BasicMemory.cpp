@@ -34,20 +34,43 @@
 */
 
 #include "BasicMemory.h"
+#include "Checkpoint.h"
+#include "SimulatorError.h"
 
 #include <iostream>
 #include <iomanip>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
 
 using namespace std;
 
-BasicMemory::BasicMemory(int size)
+/**
+ * O buffer  alocado com mmap, alinhado a pginas do hospedeiro, para
+ * que mapFile possa mapear arquivos sobre ele. Lana SimulatorError se
+ * o hospedeiro no puder mapear size bytes.
+ */
+BasicMemory::BasicMemory(uint64_t size)
 {
-	data = new char[size];
+	void *mapped = size ? mmap(nullptr, size, PROT_READ | PROT_WRITE,
+							   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)
+						: MAP_FAILED;
+	if (mapped == MAP_FAILED) {
+		throw SimulatorError("Unable to allocate " + to_string(size) + " bytes of memory");
+	}
+	data = (char *)mapped;
+	this->size = size;
+	fileSize = 0;
+	codePages = new uint8_t[((size - 1) >> HOST_PAGE_BITS) + 1]();
+	codeWords = new uint64_t[((size - 1) >> 8) + 1]();
 }
 
 BasicMemory::~BasicMemory()
 {
-	delete[] data;
+	munmap(data, size);
+	delete[] codePages;
+	delete[] codeWords;
 }
 
 /**
@@ -58,6 +81,8 @@ BasicMemory::~BasicMemory()
  */
 uint32_t BasicMemory::readInstruction32(uint64_t address)
 {
+	checkAccess(address, 4, false);
+	markCode(address);
 	return ((uint32_t*)data)[address >> 2];
 }
 
@@ -66,6 +91,7 @@ uint32_t BasicMemory::readInstruction32(uint64_t address)
  */
 uint32_t BasicMemory::readData32(uint64_t address)
 {
+	checkAccess(address, 4, false);
 	return ((uint32_t*)data)[address >> 2];
 }
 
@@ -74,6 +100,7 @@ uint32_t BasicMemory::readData32(uint64_t address)
  */
 uint64_t BasicMemory::readData64(uint64_t address)
 {
+	checkAccess(address, 8, false);
 	return ((uint64_t*)data)[address >> 3];
 }
 
@@ -83,7 +110,9 @@ uint64_t BasicMemory::readData64(uint64_t address)
  */
 void BasicMemory::writeInstruction32(uint64_t address, uint32_t value)
 {
+	checkAccess(address, 4, true);
 	((uint32_t*)data)[address >> 2] = value;
+	notifyCodeModified(address, 4);
 }
 
 /**
@@ -91,7 +120,9 @@ void BasicMemory::writeInstruction32(uint64_t address, uint32_t value)
  */
 void BasicMemory::writeData32(uint64_t address, uint32_t value)
 {
+	checkAccess(address, 4, true);
 	((uint32_t*)data)[address >> 2] = value;
+	dataWritten(address & ~(uint64_t)3, 4);
 }
 
 /**
@@ -99,7 +130,122 @@ void BasicMemory::writeData32(uint64_t address, uint32_t value)
  */
 void BasicMemory::writeData64(uint64_t address, uint64_t value)
 {
+	checkAccess(address, 8, true);
 	((uint64_t*)data)[address >> 3] = value;
+	dataWritten(address & ~(uint64_t)7, 8);
+}
+
+/**
+ * Copia size bytes para a memria, a partir de address.
+ */
+void BasicMemory::writeBytes(uint64_t address, const void *bytes, uint64_t size)
+{
+    if (address > this->size || size > this->size - address) {
+        throw SimulatorError::writeOutOfRange(address, size);
+    }
+    memcpy(data + address, bytes, size);
+    notifyCodeModified(address, size);
+}
+
+/**
+ * Pginas do hospedeiro inteiramente contidas em [address, address +
+ * size) so substitudas pelo mapeamento privado do arquivo: so lidas
+ * sob demanda, compartilhadas com o cache de pginas do sistema e
+ * copiadas pelo kernel apenas na primeira escrita. O incio e o fim
+ * que no ocupam pginas inteiras, ou trechos cujo deslocamento no
+ * arquivo no est alinhado como o endereo, so copiados.
+ */
+void BasicMemory::mapFile(uint64_t address, int fd, uint64_t offset, uint64_t size)
+{
+    if (address > this->size || size > this->size - address) {
+        throw SimulatorError::writeOutOfRange(address, size);
+    }
+
+    uint64_t page = sysconf(_SC_PAGESIZE);
+    uint64_t begin = (address + page - 1) & ~(page - 1);
+    uint64_t end = (address + size) & ~(page - 1);
+    if ((address & (page - 1)) != (offset & (page - 1)) || begin >= end) {
+        Memory::mapFile(address, fd, offset, size);
+        return;
+    }
+
+    if (mmap(data + begin, end - begin, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_FIXED, fd, offset + (begin - address)) == MAP_FAILED) {
+        Memory::mapFile(address, fd, offset, size);
+        return;
+    }
+    notifyCodeModified(begin, end - begin);
+    Memory::mapFile(address, fd, offset, begin - address);
+    Memory::mapFile(end, fd, offset + (end - address), address + size - end);
+}
+
+/**
+ * Grava as pginas no nulas do buffer; a ltima, se incompleta, 
+ * completada com zeros.
+ */
+void BasicMemory::save(CheckpointWriter &checkpoint)
+{
+    checkpoint.section("MEM ");
+    checkpoint.writeUint64(size);
+    for (uint64_t address = 0; address < size; address += CHECKPOINT_PAGE_SIZE) {
+        if (size - address >= CHECKPOINT_PAGE_SIZE) {
+            checkpoint.writePage(address, (uint8_t *)data + address);
+        } else {
+            uint8_t page[CHECKPOINT_PAGE_SIZE] = {};
+            memcpy(page, data + address, size - address);
+            checkpoint.writePage(address, page);
+        }
+    }
+    checkpoint.endPages();
+}
+
+/**
+ * O buffer  substitudo por um mapeamento annimo novo, j zerado, o
+ * que tambm desfaz os mapeamentos de arquivos feitos por mapFile. Um
+ * checkpoint incremental (de outra implementao)  aplicado sobre o
+ * buffer atual.
+ */
+void BasicMemory::restore(CheckpointReader &checkpoint)
+{
+    bool incremental = checkpoint.section("MEM ", "MEMI");
+    checkpoint.readUint64();
+    if (!incremental && mmap(data, size, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0) == MAP_FAILED) {
+        cout << "Unable to allocate " << size << " bytes of memory" << endl;
+        cout << "Aborting... " << endl;
+        exit(1);
+    }
+
+    uint64_t address;
+    uint8_t page[CHECKPOINT_PAGE_SIZE];
+    while (checkpoint.readPage(address, page)) {
+        if (address >= size) {
+            throw SimulatorError::writeOutOfRange(address, CHECKPOINT_PAGE_SIZE);
+        }
+        uint64_t length = size - address < CHECKPOINT_PAGE_SIZE ? size - address : CHECKPOINT_PAGE_SIZE;
+        memcpy(data + address, page, length);
+    }
+    notifyCodeModified(0, size);
+}
+
+Memory *BasicMemory::fork()
+{
+    BasicMemory *child = new BasicMemory(size);
+    memcpy(child->data, data, size);
+    child->fileSize = fileSize;
+    return child;
+}
+
+uint8_t *BasicMemory::getHostPage(uint64_t address, bool write)
+{
+    uint64_t page = address & ~(HOST_PAGE_SIZE - 1);
+    if (page >= size || size - page < HOST_PAGE_SIZE) {
+        return nullptr;
+    }
+    if (write && __atomic_load_n(&codePages[page >> HOST_PAGE_BITS], __ATOMIC_RELAXED)) {
+        return nullptr;
+    }
+    return (uint8_t *)data + page;
 }
 
 /**
@@ -107,22 +253,22 @@ void BasicMemory::writeData64(uint64_t address, uint64_t value)
  */
 void BasicMemory::loadBinary(string filename)
 {
-    streampos size;
-
-    ifstream file(filename, ios::in|ios::binary|ios::ate);
-    if (file.is_open())
-    {
-        fileSize = file.tellg();
-        file.seekg (0, ios::beg);
-        file.read (data, fileSize);
-        file.close();
-    }
-    else {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
         cout << "Unable to open file " << filename << endl;
 		cout << "Aborting... " << endl;
 		exit(1);
     }
 
+    fileSize = lseek(fd, 0, SEEK_END);
+    if (fileSize > size) {
+        cout << "File " << filename << " does not fit in memory ("
+             << fileSize << " > " << size << " bytes)" << endl;
+        cout << "Aborting... " << endl;
+        exit(1);
+    }
+    mapFile(0, fd, 0, fileSize);
+    close(fd);
 }
 
 
@@ -133,7 +279,8 @@ void BasicMemory::loadBinary(string filename)
 void BasicMemory::writeBinaryAsText (string basename) {
     string filename = "txt_" + basename + ".txt";
     ofstream ofp;
-    int i,j;
+    uint64_t i;
+    int j;
 
     cout << "Gerado arquivo " << filename << endl << endl;
     ofp.open(filename);
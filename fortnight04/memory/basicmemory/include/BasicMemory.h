@@ -34,6 +34,7 @@
 */
 
 #include "Memory.h"
+#include "SimulatorError.h"
 #include <string>
 #include <fstream>
 
@@ -42,7 +43,7 @@ using namespace std;
 class BasicMemory : public Memory
 {
 public:
-	BasicMemory(int size);
+	BasicMemory(uint64_t size);
 	~BasicMemory();
 
 	void loadBinary(std::string filename);
@@ -79,9 +80,92 @@ public:
 	 */
 	void writeData64(uint64_t address, uint64_t value);
 
+	/**
+	 * Copia size bytes para a memria, a partir de address.
+	 */
+	void writeBytes(uint64_t address, const void *bytes, uint64_t size);
+
+	/**
+	 * Mapeia o arquivo sobre o buffer da memria (MAP_FIXED |
+	 * MAP_PRIVATE), nas pginas inteiras do intervalo.
+	 */
+	void mapFile(uint64_t address, int fd, uint64_t offset, uint64_t size);
+
+	void save(CheckpointWriter &checkpoint);
+	void restore(CheckpointReader &checkpoint);
+
+	/**
+	 * Cpia integral do buffer: no h tabela de pginas a compartilhar
+	 * (ver SparseMemory).
+	 */
+	Memory *fork();
+
+	/**
+	 * Pginas inteiramente contidas no buffer, que no muda de lugar;
+	 * para escrita, apenas as que no tm instrues j lidas. Uma
+	 * pgina passa a ter instrues na primeira leitura de uma delas,
+	 * que avisa os observadores (hostPagesChanged).
+	 */
+	uint8_t *getHostPage(uint64_t address, bool write);
+
 protected:
 	char* data;        //memory data
-	unsigned short fileSize;    //size of the loaded binary file
+	uint64_t size;     //memory size
+	uint64_t fileSize;    //size of the loaded binary file
+
+	// instrues j lidas por readInstruction32: um byte por pgina de
+	// HOST_PAGE_SIZE bytes e um bit por palavra de 4 bytes
+	uint8_t *codePages;
+	uint64_t *codeWords;
+
+	/**
+	 * Marca a instruo em address como lida. Na primeira instruo de
+	 * uma pgina, avisa os observadores que ela no pode mais ser
+	 * escrita diretamente.
+	 */
+	void markCode(uint64_t address)
+	{
+		uint64_t word = address >> 2;
+		uint64_t bit = (uint64_t)1 << (word & 63);
+		if (__atomic_load_n(&codeWords[word >> 6], __ATOMIC_RELAXED) & bit) {
+			return;
+		}
+		__atomic_fetch_or(&codeWords[word >> 6], bit, __ATOMIC_RELAXED);
+		if (!__atomic_exchange_n(&codePages[address >> HOST_PAGE_BITS], 1, __ATOMIC_RELAXED)) {
+			notifyHostPagesChanged();
+		}
+	}
+
+	/**
+	 * Lana SimulatorError se o acesso de bytes bytes em address,
+	 * leitura ou escrita (write), sair do buffer.
+	 */
+	void checkAccess(uint64_t address, uint64_t bytes, bool write)
+	{
+		if (address >= size || size - address < bytes) {
+			throw write ? SimulatorError::writeOutOfRange(address, bytes)
+						: SimulatorError::addressOutOfRange(address);
+		}
+	}
+
+	/**
+	 * Avisa os observadores se a escrita de size bytes em address
+	 * alcanou instrues j lidas.
+	 */
+	void dataWritten(uint64_t address, uint64_t size)
+	{
+		uint64_t last = address + size - 1;
+		if (!__atomic_load_n(&codePages[address >> HOST_PAGE_BITS], __ATOMIC_RELAXED)
+				&& !__atomic_load_n(&codePages[last >> HOST_PAGE_BITS], __ATOMIC_RELAXED)) {
+			return;
+		}
+		for (uint64_t word = address >> 2; word <= last >> 2; word++) {
+			if ((__atomic_load_n(&codeWords[word >> 6], __ATOMIC_RELAXED) >> (word & 63)) & 1) {
+				notifyCodeModified(address, size);
+				return;
+			}
+		}
+	}
 
 };
 
@@ -39,13 +39,12 @@
 
 using namespace std;
 
-BasicMemoryTest::BasicMemoryTest(int size) : BasicMemory{size}
+BasicMemoryTest::BasicMemoryTest(uint64_t size) : BasicMemory{size},
+	trace(MEMORY_TRACE_FILE, true)
 {
-    memLogStream.open(MEMORY_LOG_FILE);
 }
 BasicMemoryTest::~BasicMemoryTest()
 {
-	memLogStream.close();
 }
 
 /**
@@ -53,8 +52,9 @@ BasicMemoryTest::~BasicMemoryTest()
  */
 uint32_t BasicMemoryTest::readInstruction32(uint64_t address)
 {
-    memLogStream << hex << "ri " << setfill('0') << setw(16) << address << endl;
- 	return BasicMemory::readInstruction32(address);
+	uint32_t value = BasicMemory::readInstruction32(address);
+	trace.record(MemoryTrace::TRACE_READ_INSTRUCTION, 4, address, value);
+	return value;
 }
 
 /**
@@ -62,9 +62,10 @@ uint32_t BasicMemoryTest::readInstruction32(uint64_t address)
  */
 uint32_t BasicMemoryTest::readData32(uint64_t address)
 {
-    memLogStream << hex << "rd " << setfill('0') << setw(16) << address << endl;
+	uint32_t value = BasicMemory::readData32(address);
+	trace.record(MemoryTrace::TRACE_READ_DATA, 4, address, value);
 	lastDataMemAccess = MemAccessType::MAT_READ32;
- 	return BasicMemory::readData32(address);
+	return value;
 }
 
 /**
@@ -72,9 +73,10 @@ uint32_t BasicMemoryTest::readData32(uint64_t address)
  */
 uint64_t BasicMemoryTest::readData64(uint64_t address)
 {
-    memLogStream << hex << "rd " << setfill('0') << setw(16) << address << endl;
+	uint64_t value = BasicMemory::readData64(address);
+	trace.record(MemoryTrace::TRACE_READ_DATA, 8, address, value);
 	lastDataMemAccess = MemAccessType::MAT_READ64;
- 	return BasicMemory::readData64(address);
+	return value;
 }
 
 /**
@@ -82,7 +84,7 @@ uint64_t BasicMemoryTest::readData64(uint64_t address)
  */
 void BasicMemoryTest::writeInstruction32(uint64_t address, uint32_t value)
 {
-    memLogStream << hex << "wi " << setfill('0') << setw(16) << address << endl;
+	trace.record(MemoryTrace::TRACE_WRITE_INSTRUCTION, 4, address, value);
 	lastDataMemAccess = MemAccessType::MAT_WRITE32;
  	BasicMemory::writeInstruction32(address, value);
 }
@@ -92,7 +94,7 @@ void BasicMemoryTest::writeInstruction32(uint64_t address, uint32_t value)
  */
 void BasicMemoryTest::writeData32(uint64_t address, uint32_t value)
 {
-    memLogStream << hex << "wd " << setfill('0') << setw(16) << address << endl;
+	trace.record(MemoryTrace::TRACE_WRITE_DATA, 4, address, value);
 	lastDataMemAccess = MemAccessType::MAT_WRITE32;
  	BasicMemory::writeData32(address, value);
 }
@@ -102,7 +104,7 @@ void BasicMemoryTest::writeData32(uint64_t address, uint32_t value)
  */
 void BasicMemoryTest::writeData64(uint64_t address, uint64_t value)
 {
-    memLogStream << hex << "wd " << setfill('0') << setw(16) << address << endl;
+	trace.record(MemoryTrace::TRACE_WRITE_DATA, 8, address, value);
 	lastDataMemAccess = MemAccessType::MAT_WRITE64;
  	BasicMemory::writeData64(address, value);
 }
@@ -126,7 +128,8 @@ void BasicMemoryTest::resetLastDataMemAccess() {
 void BasicMemoryTest::writeBinaryAsTextELF (string basename) {
     string filename = "elf_" + basename + ".txt";
     ofstream ofp;
-    int i,j;
+    uint64_t i;
+    int j;
 
     ofp.open(filename);
 
@@ -182,30 +185,4 @@ void BasicMemoryTest::writeBinaryAsTextELF (string basename) {
     ofp.close();
 }
 
-/**
- * Realoca endereços das variáveis.
- * 
- * Específico para o arquivo de teste usado.
- */
-void BasicMemoryTest::relocateManual() {
-	unsigned int *uiData = (unsigned int *)data;
-	long address;
-	unsigned int instruction;
-	
-	//0x0050		91000000		fazer | 0x00028000
-	address = 0x50>>2;
-	instruction = uiData[address];
-	uiData[address] = instruction | 0x00027000;
-	
-	//0x0060		91000000		fazer | 0x00027000
-	address = 0x60>>2;
-	instruction = uiData[address];
-	uiData[address] = instruction | 0x00028000;
-
-	//0x0070		91000000		fazer | 0x00027000
-	address = 0x70>>2;
-	instruction = uiData[address];
-	uiData[address] = instruction | 0x00028000;
-}
-
  
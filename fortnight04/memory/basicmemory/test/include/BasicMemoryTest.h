@@ -34,6 +34,7 @@
 */
 #include "config.h"
 #include "BasicMemory.h"
+#include "MemoryTrace.h"
 
 using namespace std;
 
@@ -42,17 +43,16 @@ class BasicMemoryTest : public BasicMemory
 public:
 	enum MemAccessType {MAT_NONE, MAT_READ32, MAT_WRITE32, MAT_READ64, MAT_WRITE64};
 
-	BasicMemoryTest(int size);
+	BasicMemoryTest(uint64_t size);
 	~BasicMemoryTest();
 		
-	void relocateManual();
 	void writeBinaryAsTextELF (string basename);
 	
 	MemAccessType getLastDataMemAccess();
 	void resetLastDataMemAccess();
 	
 	/*
-	 * Logs dos métodos da superclasse.
+	 * Registro (em MEMORY_TRACE_FILE) dos métodos da superclasse.
 	 */
 	uint32_t readInstruction32(uint64_t address);
 	uint32_t readData32(uint64_t address);
@@ -63,7 +63,7 @@ public:
 
 private:
 	MemAccessType lastDataMemAccess;
-	ofstream memLogStream;
+	MemoryTrace trace;
 	
 };
 
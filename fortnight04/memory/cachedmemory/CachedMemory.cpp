@@ -0,0 +1,345 @@
+/* ----------------------------------------------------------------------------
+
+    (EN) CachedMemory - A cache hierarchy simulator in front of any memory. Part
+	of armethyst project.
+		
+	armethyst - A simple ARM Simulator written in C++ for Computer Architecture
+    teaching purposes. Free software licensed under the MIT License (see license
+    below).
+
+    (PT) CachedMemory - Um simulador de hierarquia de caches à frente de qualquer
+	memória. Parte do projeto armethyst.
+    
+	armethyst - Um simulador ARM simples escrito em C++ para o ensino de
+    Arquitetura de Computadores. Software livre licenciado pela MIT License
+    (veja a licença, em inglês, abaixo).
+
+    (EN) MIT LICENSE:
+
+    Copyright 2020 André Vital Saúde
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+   ----------------------------------------------------------------------------
+*/
+
+#include "config.h"
+#include "CachedMemory.h"
+
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+
+using namespace std;
+
+static unsigned floorLog2(uint64_t value)
+{
+	unsigned bits = 0;
+	while ((value >> bits) > 1) {
+		bits++;
+	}
+	return bits;
+}
+
+Cache::Cache(string name, CacheConfig config, Cache *next)
+{
+	this->name = name;
+	this->config = config;
+	this->next = next;
+
+	sets = config.size / (config.lineSize * config.associativity);
+	lineBits = floorLog2(config.lineSize);
+	setBits = floorLog2(sets);
+	if (!sets || (sets & (sets - 1)) || (config.lineSize & (config.lineSize - 1))
+			|| (config.replacement == CACHE_REPL_PLRU
+				&& ((config.associativity & (config.associativity - 1)) || config.associativity > 64))) {
+		cout << "Invalid configuration of cache " << name << endl;
+		cout << "Aborting... " << endl;
+		exit(1);
+	}
+	lines = vector<Line>(sets * config.associativity, Line{0, 0, false, false});
+	plru = vector<uint64_t>(sets, 0);
+	clock = 0;
+	random = 0x9E3779B97F4A7C15;
+	stats = Stats();
+}
+
+Cache::Cache(const Cache &cache, Cache *next) : Cache(cache)
+{
+	this->next = next;
+	stats = Stats();
+}
+
+void Cache::access(uint64_t address, uint64_t size, bool write)
+{
+	uint64_t line = address >> lineBits;
+	uint64_t last = (address + size - 1) >> lineBits;
+	accessLine(address, size, write);
+	while (line++ < last) {
+		accessLine(line << lineBits, size, write);
+	}
+}
+
+/**
+ * Escrita em write-through repassa ao nível seguinte apenas os bytes
+ * escritos; faltas (e escritas de volta) transferem a linha inteira.
+ */
+void Cache::accessLine(uint64_t address, uint64_t size, bool write)
+{
+	uint64_t number = address >> lineBits;
+	uint64_t set = number & (sets - 1);
+	uint64_t tag = number >> setBits;
+	Line *ways = &lines[set * config.associativity];
+	bool writeThrough = config.writePolicy == CACHE_WRITE_THROUGH;
+
+	clock++;
+	if (write) {
+		stats.writes++;
+	} else {
+		stats.reads++;
+	}
+
+	for (uint64_t way = 0; way < config.associativity; way++) {
+		if (ways[way].valid && ways[way].tag == tag) {
+			touch(set, way);
+			if (write) {
+				if (writeThrough) {
+					if (next) next->access(address, size, true);
+				} else {
+					ways[way].dirty = true;
+				}
+			}
+			return;
+		}
+	}
+
+	if (write) {
+		stats.writeMisses++;
+		if (writeThrough) {
+			if (next) next->access(address, size, true);
+			return;
+		}
+	} else {
+		stats.readMisses++;
+	}
+
+	uint64_t way = victim(set);
+	Line &line = ways[way];
+	if (line.valid) {
+		stats.evictions++;
+		if (line.dirty) {
+			stats.writebacks++;
+			uint64_t victimNumber = (line.tag << setBits) | set;
+			if (next) next->access(victimNumber << lineBits, config.lineSize, true);
+		}
+	}
+	if (next) next->access(number << lineBits, config.lineSize, false);
+
+	line.tag = tag;
+	line.valid = true;
+	line.dirty = write;
+	touch(set, way);
+}
+
+/**
+ * Vias inválidas são usadas antes de qualquer substituição.
+ */
+uint64_t Cache::victim(uint64_t set)
+{
+	Line *ways = &lines[set * config.associativity];
+	for (uint64_t way = 0; way < config.associativity; way++) {
+		if (!ways[way].valid) {
+			return way;
+		}
+	}
+
+	switch (config.replacement) {
+		case CACHE_REPL_PLRU: {
+			// desce pela árvore seguindo os bits
+			uint64_t node = 0;
+			while (node < config.associativity - 1) {
+				node = 2 * node + 1 + ((plru[set] >> node) & 1);
+			}
+			return node - (config.associativity - 1);
+		}
+		case CACHE_REPL_RANDOM:
+			random ^= random << 13;
+			random ^= random >> 7;
+			random ^= random << 17;
+			return random % config.associativity;
+		default: {
+			uint64_t oldest = 0;
+			for (uint64_t way = 1; way < config.associativity; way++) {
+				if (ways[way].lastUse < ways[oldest].lastUse) {
+					oldest = way;
+				}
+			}
+			return oldest;
+		}
+	}
+}
+
+void Cache::touch(uint64_t set, uint64_t way)
+{
+	lines[set * config.associativity + way].lastUse = clock;
+
+	// sobe pela árvore apontando cada nó para a outra metade
+	uint64_t node = way + config.associativity - 1;
+	while (node > 0) {
+		uint64_t parent = (node - 1) / 2;
+		if (node == 2 * parent + 1) {
+			plru[set] |= (uint64_t)1 << parent;
+		} else {
+			plru[set] &= ~((uint64_t)1 << parent);
+		}
+		node = parent;
+	}
+}
+
+void Cache::printStats()
+{
+	uint64_t accesses = stats.reads + stats.writes;
+	uint64_t misses = stats.readMisses + stats.writeMisses;
+	streamsize precision = cout.precision();
+	cout << name << ": " << stats.reads << " reads (" << stats.readMisses << " misses), "
+			<< stats.writes << " writes (" << stats.writeMisses << " misses), miss rate ";
+	if (accesses) {
+		cout << fixed << setprecision(2) << 100.0 * misses / accesses << "%";
+		cout.unsetf(ios::floatfield);
+		cout.precision(precision);
+	} else {
+		cout << "-";
+	}
+	cout << ", " << stats.evictions << " evictions, " << stats.writebacks << " writebacks" << endl;
+}
+
+CachedMemory::CachedMemory(Memory *memory, CacheConfig l1i, CacheConfig l1d, CacheConfig l2)
+	: l2("L2", l2, nullptr), l1i("L1I", l1i, &this->l2), l1d("L1D", l1d, &this->l2)
+{
+	this->memory = memory;
+	memory->addListener(this);
+}
+
+CachedMemory::CachedMemory(const CachedMemory &parent, Memory *memory)
+	: l2(parent.l2, nullptr), l1i(parent.l1i, &this->l2), l1d(parent.l1d, &this->l2)
+{
+	this->memory = memory;
+	memory->addListener(this);
+}
+
+CachedMemory::~CachedMemory()
+{
+	printStats();
+	memory->removeListener(this);
+	delete memory;
+}
+
+void CachedMemory::printStats()
+{
+	l1i.printStats();
+	l1d.printStats();
+	l2.printStats();
+}
+
+void CachedMemory::loadBinary(string filename)
+{
+	memory->loadBinary(filename);
+}
+
+void CachedMemory::writeBinaryAsText(string basename)
+{
+	memory->writeBinaryAsText(basename);
+}
+
+uint32_t CachedMemory::readInstruction32(uint64_t address)
+{
+	return memory->readInstruction32(address);
+}
+
+void CachedMemory::fetchInstructions(uint64_t address, uint64_t count)
+{
+	for (uint64_t i = 0; i < count; i++) {
+		l1i.access(address + (i << 2), 4, false);
+	}
+}
+
+uint32_t CachedMemory::readData32(uint64_t address)
+{
+	l1d.access(address, 4, false);
+	return memory->readData32(address);
+}
+
+uint64_t CachedMemory::readData64(uint64_t address)
+{
+	l1d.access(address, 8, false);
+	return memory->readData64(address);
+}
+
+void CachedMemory::writeInstruction32(uint64_t address, uint32_t value)
+{
+	l1i.access(address, 4, true);
+	memory->writeInstruction32(address, value);
+}
+
+void CachedMemory::writeData32(uint64_t address, uint32_t value)
+{
+	l1d.access(address, 4, true);
+	memory->writeData32(address, value);
+}
+
+void CachedMemory::writeData64(uint64_t address, uint64_t value)
+{
+	l1d.access(address, 8, true);
+	memory->writeData64(address, value);
+}
+
+void CachedMemory::writeBytes(uint64_t address, const void *bytes, uint64_t size)
+{
+	memory->writeBytes(address, bytes, size);
+}
+
+void CachedMemory::mapFile(uint64_t address, int fd, uint64_t offset, uint64_t size)
+{
+	memory->mapFile(address, fd, offset, size);
+}
+
+void CachedMemory::save(CheckpointWriter &checkpoint)
+{
+	memory->save(checkpoint);
+}
+
+void CachedMemory::saveIncremental(CheckpointWriter &checkpoint)
+{
+	memory->saveIncremental(checkpoint);
+}
+
+void CachedMemory::restore(CheckpointReader &checkpoint)
+{
+	memory->restore(checkpoint);
+}
+
+Memory *CachedMemory::fork()
+{
+	return new CachedMemory(*this, memory->fork());
+}
+
+void CachedMemory::codeModified(uint64_t address, uint64_t size)
+{
+	notifyCodeModified(address, size);
+}
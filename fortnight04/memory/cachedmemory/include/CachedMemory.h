@@ -0,0 +1,221 @@
+/* ----------------------------------------------------------------------------
+
+    (EN) CachedMemory - A cache hierarchy simulator in front of any memory. Part
+	of armethyst project.
+		
+	armethyst - A simple ARM Simulator written in C++ for Computer Architecture
+    teaching purposes. Free software licensed under the MIT License (see license
+    below).
+
+    (PT) CachedMemory - Um simulador de hierarquia de caches à frente de qualquer
+	memória. Parte do projeto armethyst.
+    
+	armethyst - Um simulador ARM simples escrito em C++ para o ensino de
+    Arquitetura de Computadores. Software livre licenciado pela MIT License
+    (veja a licença, em inglês, abaixo).
+
+    (EN) MIT LICENSE:
+
+    Copyright 2020 André Vital Saúde
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+   ----------------------------------------------------------------------------
+*/
+
+#pragma once
+
+#include "Memory.h"
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+/**
+ * Configuração de um nível de cache (ver config.h).
+ */
+struct CacheConfig {
+	uint64_t size;			// bytes, potência de 2
+	uint64_t associativity;
+	uint64_t lineSize;		// bytes, potência de 2
+	int replacement;		// CACHE_REPL_*
+	int writePolicy;		// CACHE_WRITE_*
+};
+
+/**
+ * Um nível de cache associativa por conjuntos.
+ *
+ * Guarda apenas as etiquetas das linhas: os dados continuam na memória
+ * decorada, e a cache só contabiliza acertos, faltas, substituições e
+ * escritas de volta. As faltas e escritas de volta são repassadas ao
+ * nível seguinte (next), se houver.
+ */
+class Cache
+{
+	public:
+		struct Stats {
+			uint64_t reads, writes;
+			uint64_t readMisses, writeMisses;
+			uint64_t evictions;		// linhas válidas substituídas
+			uint64_t writebacks;	// ... sujas, escritas no nível seguinte
+		};
+
+		Cache(std::string name, CacheConfig config, Cache *next);
+
+		/**
+		 * Cópia de cache, com as mesmas linhas e as estatísticas
+		 * zeradas, sobre o nível next.
+		 */
+		Cache(const Cache &cache, Cache *next);
+
+		/**
+		 * Acesso de leitura ou escrita a size bytes a partir de
+		 * address, em uma ou mais linhas.
+		 */
+		void access(uint64_t address, uint64_t size, bool write);
+
+		const Stats &getStats() { return stats; }
+
+		/**
+		 * Escreve as estatísticas em uma linha.
+		 */
+		void printStats();
+
+	private:
+		struct Line {
+			uint64_t tag;
+			uint64_t lastUse;	// LRU
+			bool valid;
+			bool dirty;
+		};
+
+		std::string name;
+		CacheConfig config;
+		Cache *next;
+
+		uint64_t sets;
+		unsigned lineBits, setBits;
+		std::vector<Line> lines;		// sets * associativity
+
+		// bits da árvore de PLRU de cada conjunto (associativity - 1
+		// por conjunto, no máximo 64): o bit de cada nó aponta a
+		// metade menos recentemente usada
+		std::vector<uint64_t> plru;
+
+		uint64_t clock;			// contador de acessos, para LRU
+		uint64_t random;		// estado do gerador xorshift
+
+		Stats stats;
+
+		/**
+		 * Escolhe a via substituída no conjunto set.
+		 */
+		uint64_t victim(uint64_t set);
+
+		/**
+		 * Registra o uso da via way do conjunto set.
+		 */
+		void touch(uint64_t set, uint64_t way);
+
+		/**
+		 * Acesso à linha que contém address.
+		 */
+		void accessLine(uint64_t address, uint64_t size, bool write);
+};
+
+/**
+ * CachedMemory
+ *
+ * Decorador de memória: repassa todas as operações à memória decorada
+ * e, antes, simula os acessos da CPU em uma hierarquia de caches, L1 de
+ * instruções (fetchInstructions, writeInstruction32) e L1 de dados
+ * (readData*, writeData*), ambas sobre uma L2 unificada. As cópias feitas
+ * por carregadores (writeBytes, mapFile, loadBinary) não passam pelas
+ * caches; as relocações que o ElfLoader aplica com writeInstruction32,
+ * sim.
+ *
+ * readInstruction32 não passa pela L1I: as CPUs guardam as instruções
+ * decodificadas, e a FastCPU também as lê ao examinar código que não
+ * executa (ver FastCPU::flagsLive). Cada instrução executada é informada
+ * por fetchInstructions, e os números da L1I valem para todas as CPUs:
+ * a BasicCPU e a PipelinedCPU informam cada busca, e a FastCPU e a
+ * JITCPU informam as instruções de um bloco na entrada dele, antes dos
+ * seus acessos a dados.
+ *
+ * As estatísticas de cada nível são escritas quando a memória é
+ * destruída.
+ *
+ * Não é segura para acesso concorrente (MultiCoreProcessor).
+ */
+class CachedMemory : public Memory, public MemoryListener
+{
+public:
+	/**
+	 * Decora memory, que passa a pertencer à CachedMemory.
+	 */
+	CachedMemory(Memory *memory, CacheConfig l1i, CacheConfig l1d, CacheConfig l2);
+	~CachedMemory();
+
+	void loadBinary(std::string filename);
+	void writeBinaryAsText (std::string basename);
+
+	uint32_t readInstruction32(uint64_t address);
+	void fetchInstructions(uint64_t address, uint64_t count);
+	uint32_t readData32(uint64_t address);
+	uint64_t readData64(uint64_t address);
+	void writeInstruction32(uint64_t address, uint32_t value);
+	void writeData32(uint64_t address, uint32_t value);
+	void writeData64(uint64_t address, uint64_t value);
+	void writeBytes(uint64_t address, const void *bytes, uint64_t size);
+	void mapFile(uint64_t address, int fd, uint64_t offset, uint64_t size);
+	void save(CheckpointWriter &checkpoint);
+	void saveIncremental(CheckpointWriter &checkpoint);
+	void restore(CheckpointReader &checkpoint);
+
+	/**
+	 * Decora o fork da memória decorada com caches no mesmo estado das
+	 * desta (ver Cache(const Cache &, Cache *)).
+	 */
+	Memory *fork();
+
+	/**
+	 * Métodos herdados de MemoryListener: repassa aos observadores da
+	 * CachedMemory os avisos da memória decorada.
+	 */
+	void codeModified(uint64_t address, uint64_t size);
+
+	Cache &getL1I() { return l1i; }
+	Cache &getL1D() { return l1d; }
+	Cache &getL2() { return l2; }
+
+	/**
+	 * Escreve as estatísticas de todos os níveis.
+	 */
+	void printStats();
+
+private:
+	Memory *memory;
+
+	CachedMemory(const CachedMemory &parent, Memory *memory);
+
+	// L2 declarada antes: é o nível seguinte das L1
+	Cache l2;
+	Cache l1i;
+	Cache l1d;
+};
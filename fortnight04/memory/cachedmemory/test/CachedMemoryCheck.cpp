@@ -0,0 +1,179 @@
+/* ----------------------------------------------------------------------------
+
+    (EN) armethyst - A simple ARM Simulator written in C++ for Computer Architecture
+    teaching purposes. Free software licensed under the MIT License (see license
+    below).
+
+    (PT) armethyst - Um simulador ARM simples escrito em C++ para o ensino de
+    Arquitetura de Computadores. Software livre licenciado pela MIT License
+    (veja a licença, em inglês, abaixo).
+
+    (EN) MIT LICENSE:
+
+    Copyright 2020 André Vital Saúde
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+   ----------------------------------------------------------------------------
+*/
+
+#include "CachedMemoryCheck.h"
+#include "Check.h"
+#include "CachedMemory.h"
+
+using namespace std;
+
+#define CHECK_N 1000
+
+// L1 de 1 KiB, 2 vias e linhas de 64 bytes: 8 conjuntos, e endereços a
+// LINE_STRIDE bytes uns dos outros caem no mesmo conjunto
+#define LINE_STRIDE 512
+
+static CachedMemory *createCachedMemory(Memory *memory, int l1dWrite = CACHE_WRITE_BACK)
+{
+	return new CachedMemory(memory,
+			{1024, 2, 64, CACHE_REPL_LRU, CACHE_WRITE_BACK},
+			{1024, 2, 64, CACHE_REPL_LRU, l1dWrite},
+			{8192, 4, 64, CACHE_REPL_LRU, CACHE_WRITE_BACK});
+}
+
+static void checkStats(Cache &cache, uint64_t reads, uint64_t readMisses, uint64_t writes,
+						uint64_t writeMisses, uint64_t evictions, uint64_t writebacks)
+{
+	const Cache::Stats &stats = cache.getStats();
+	CHECK(stats.reads == reads);
+	CHECK(stats.readMisses == readMisses);
+	CHECK(stats.writes == writes);
+	CHECK(stats.writeMisses == writeMisses);
+	CHECK(stats.evictions == evictions);
+	CHECK(stats.writebacks == writebacks);
+}
+
+/**
+ * Acertos, faltas, substituições LRU e escritas de volta de sequências
+ * de acessos com resultado conhecido.
+ */
+static void checkCounts()
+{
+	string name = "CachedMemory hit and miss counts";
+	beginCheck(name);
+	CachedMemory *memory;
+
+	// duas passadas por 8 linhas: só a primeira falta
+	memory = createCachedMemory(createMemory(MEM_IMPL_BASIC));
+	for (int pass = 0; pass < 2; pass++) {
+		for (uint64_t address = 0x8000; address < 0x8200; address += 4) {
+			memory->readData32(address);
+		}
+	}
+	checkStats(memory->getL1D(), 256, 8, 0, 0, 0, 0);
+	checkStats(memory->getL2(), 8, 8, 0, 0, 0, 0);
+	checkStats(memory->getL1I(), 0, 0, 0, 0, 0, 0);
+	delete memory;
+
+	// três linhas no mesmo conjunto de 2 vias: A B C B A C, com LRU
+	// C substitui A, A substitui C e C substitui B
+	memory = createCachedMemory(createMemory(MEM_IMPL_BASIC));
+	static const int sequence[] = {0, 1, 2, 1, 0, 2};
+	for (int line : sequence) {
+		memory->readData32(0x8000 + line * LINE_STRIDE);
+	}
+	checkStats(memory->getL1D(), 6, 5, 0, 0, 3, 0);
+	delete memory;
+
+	// linha escrita (write-allocate) e substituída: uma escrita de volta
+	// na L2; uma leitura que cruza linhas acessa as duas (a segunda no
+	// mesmo conjunto), e cada falta, inclusive a da escrita, lê da L2
+	memory = createCachedMemory(createMemory(MEM_IMPL_BASIC));
+	memory->writeData32(0x8000, 1);
+	memory->readData32(0x8000 + LINE_STRIDE);
+	memory->readData32(0x8000 + 2 * LINE_STRIDE);
+	memory->readData64(0x8000 + 3 * LINE_STRIDE - 4);
+	checkStats(memory->getL1D(), 4, 4, 1, 1, 2, 1);
+	checkStats(memory->getL2(), 5, 5, 1, 0, 0, 0);
+	CHECK(memory->readData32(0x8000) == 1);
+	delete memory;
+
+	// write-through sem write-allocate: a escrita vai à L2 (que aloca a
+	// linha) e a leitura seguinte ainda falta na L1D
+	memory = createCachedMemory(createMemory(MEM_IMPL_BASIC), CACHE_WRITE_THROUGH);
+	memory->writeData32(0x8000, 1);
+	memory->readData32(0x8000);
+	memory->writeData32(0x8000, 2);
+	checkStats(memory->getL1D(), 1, 1, 2, 1, 0, 0);
+	checkStats(memory->getL2(), 1, 0, 2, 1, 0, 0);
+	delete memory;
+
+	// buscas de instruções, de 0x40 a 0xbc (duas linhas): só
+	// fetchInstructions passa pela L1I
+	memory = createCachedMemory(createMemory(MEM_IMPL_BASIC));
+	memory->fetchInstructions(0x40, 32);
+	memory->readInstruction32(0x40);
+	checkStats(memory->getL1I(), 32, 2, 0, 0, 0, 0);
+	delete memory;
+
+	endCheck(name);
+}
+
+/**
+ * Cada CPU informa à L1I as instruções que executa e à L1D os acessos a
+ * dados do programa, mesmo servidos das suas caches de instruções e de
+ * blocos ou da TLB.
+ */
+static void checkCPUAccesses(int cpuImpl)
+{
+	string name = "CachedMemory accesses of " + cpuName(cpuImpl);
+	beginCheck(name);
+
+	Memory *base = createMemory(MEM_IMPL_BASIC);
+	CheckProgram program = assembleCheckProgram(base, CHECK_N);
+	CachedMemory *memory = createCachedMemory(base);
+	CPU *cpu = createCPU(cpuImpl, memory);
+	startCheckProgram(cpu, program);
+	CPU::RunResult result = cpu->runFor(CPU::NO_LIMIT);
+	CHECK(result.reason == CPU::EXIT_FINISHED);
+
+	const Cache::Stats &l1i = memory->getL1I().getStats();
+	const Cache::Stats &l1d = memory->getL1D().getStats();
+	cout << "	" << result.retired << " instructions" << endl;
+	if (cpuImpl == CPU_IMPL_PIPELINED) {
+		// e as buscadas após desvios tomados, descartadas
+		CHECK(l1i.reads > result.retired);
+	} else {
+		CHECK(l1i.reads == result.retired);
+	}
+	CHECK(l1i.writes == 0);
+	// loads: v[i] e a soma relida; stores: v[i] e três resultados
+	CHECK(l1d.reads == CHECK_N + 1);
+	CHECK(l1d.writes == CHECK_N + 3);
+	CHECK(memory->readData32(program.result) == checkProgramSum(CHECK_N));
+
+	delete cpu;
+	delete memory;
+	endCheck(name);
+}
+
+void checkCachedMemory()
+{
+	checkCounts();
+	checkCPUAccesses(CPU_IMPL_BASIC);
+	checkCPUAccesses(CPU_IMPL_FAST);
+	checkCPUAccesses(CPU_IMPL_JIT);
+	checkCPUAccesses(CPU_IMPL_PIPELINED);
+}
@@ -0,0 +1,107 @@
+/* ----------------------------------------------------------------------------
+
+    (EN) FlatMemory - a BasicMemory with inline accessors for static builds
+		
+	armethyst - A simple ARM Simulator written in C++ for Computer Architecture
+    teaching purposes. Free software licensed under the MIT License (see license
+    below).
+
+    (PT) FlatMemory - uma BasicMemory com acessos em linha, para builds estáticos
+    
+	armethyst - Um simulador ARM simples escrito em C++ para o ensino de
+    Arquitetura de Computadores. Software livre licenciado pela MIT License
+    (veja a licença, em inglês, abaixo).
+
+    (EN) MIT LICENSE:
+
+    Copyright 2020 André Vital Saúde
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+   ----------------------------------------------------------------------------
+*/
+
+#pragma once
+
+#include "config.h"
+#include "BasicMemory.h"
+
+#include <cstring>
+
+/**
+ * FlatMemory
+ *
+ * A mesma memória da BasicMemory (buffer único de MEMORY_SIZE bytes), com
+ * os acessos definidos no cabeçalho. Como a classe é final, chamadas por
+ * um FlatMemory* não precisam do despacho virtual e o compilador expande
+ * os acessos em linha no laço da CPU (ver StaticProcessor).
+ *
+ * Os acessos usam memcpy, e não são truncados ao alinhamento como na
+ * BasicMemory.
+ */
+class FlatMemory final : public BasicMemory
+{
+public:
+	FlatMemory() : BasicMemory(MEMORY_SIZE) {}
+
+	uint32_t readInstruction32(uint64_t address)
+	{
+		markCode(address);
+		uint32_t value;
+		memcpy(&value, data + address, sizeof(value));
+		return value;
+	}
+
+	uint32_t readData32(uint64_t address)
+	{
+		uint32_t value;
+		memcpy(&value, data + address, sizeof(value));
+		return value;
+	}
+
+	uint64_t readData64(uint64_t address)
+	{
+		uint64_t value;
+		memcpy(&value, data + address, sizeof(value));
+		return value;
+	}
+
+	void writeInstruction32(uint64_t address, uint32_t value)
+	{
+		memcpy(data + address, &value, sizeof(value));
+		notifyCodeModified(address, 4);
+	}
+
+	void writeData32(uint64_t address, uint32_t value)
+	{
+		memcpy(data + address, &value, sizeof(value));
+		dataWritten(address, sizeof(value));
+	}
+
+	void writeData64(uint64_t address, uint64_t value)
+	{
+		memcpy(data + address, &value, sizeof(value));
+		dataWritten(address, sizeof(value));
+	}
+
+	/**
+	 * Topo da pilha: fim da memória.
+	 */
+	uint64_t getStackAddress() { return size; }
+};
@@ -0,0 +1,681 @@
+/* ----------------------------------------------------------------------------
+
+    (EN) SparseMemory - a sparse 48-bit memory backed by a multi-level page table
+		
+	armethyst - A simple ARM Simulator written in C++ for Computer Architecture
+    teaching purposes. Free software licensed under the MIT License (see license
+    below).
+
+    (PT) SparseMemory - uma memória esparsa de 48 bits, com tabela de páginas de
+		  vários níveis
+    
+	armethyst - Um simulador ARM simples escrito em C++ para o ensino de
+    Arquitetura de Computadores. Software livre licenciado pela MIT License
+    (veja a licença, em inglês, abaixo).
+
+    (EN) MIT LICENSE:
+
+    Copyright 2020 André Vital Saúde
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+   ----------------------------------------------------------------------------
+*/
+
+#include "SparseMemory.h"
+#include "Checkpoint.h"
+#include "SimulatorError.h"
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <cstring>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+using namespace std;
+
+thread_local SparseMemory::PageCache SparseMemory::lastPage = {0, 0, nullptr, false, nullptr, nullptr, nullptr};
+atomic<uint64_t> SparseMemory::nextId(1);
+
+// Marcas nos bits inferiores das entradas de último nível: páginas
+// compartilhadas (ver fork) e páginas escritas desde o último checkpoint
+// (ver saveIncremental), e páginas com instruções já lidas (ver
+// markCode). Páginas são alocadas com new ou mapeadas de arquivos, e
+// estão sempre alinhadas a pelo menos 16 bytes.
+#define SHARED_PAGE ((uintptr_t)1)
+#define DIRTY_PAGE ((uintptr_t)2)
+#define CODE_PAGE ((uintptr_t)4)
+
+static inline bool isShared(void *entry)
+{
+	return (uintptr_t)entry & SHARED_PAGE;
+}
+
+static inline bool isDirty(void *entry)
+{
+	return (uintptr_t)entry & DIRTY_PAGE;
+}
+
+static inline bool isCode(void *entry)
+{
+	return (uintptr_t)entry & CODE_PAGE;
+}
+
+static inline void *withFlags(void *entry, uintptr_t flags)
+{
+	return (void *)((uintptr_t)entry | flags);
+}
+
+static inline uint8_t *pageOf(void *entry)
+{
+	return (uint8_t *)((uintptr_t)entry & ~(SHARED_PAGE | DIRTY_PAGE | CODE_PAGE));
+}
+
+SparseMemory::SparseMemory()
+{
+	root = new void*[TABLE_SIZE]();
+	id = nextId++;
+	residentPages = 0;
+	mappedPages = 0;
+	fileSize = 0;
+}
+
+SparseMemory::~SparseMemory()
+{
+	freeTable(root, TABLE_LEVELS - 1);
+	for (Mapping &mapping : mappings) {
+		munmap(mapping.base, mapping.length);
+	}
+}
+
+SparseMemory::SharedPages::~SharedPages()
+{
+	for (uint8_t *page : pages) {
+		delete[] page;
+	}
+	for (Mapping &mapping : mappings) {
+		munmap(mapping.base, mapping.length);
+	}
+}
+
+bool SparseMemory::isMapped(uint8_t *page)
+{
+	for (Mapping &mapping : mappings) {
+		if (page >= mapping.base && page < mapping.base + mapping.length) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void SparseMemory::freeTable(void **table, int level)
+{
+	for (int i = 0; i < TABLE_SIZE; i++) {
+		if (!table[i]) continue;
+		if (level > 0) {
+			freeTable((void **)table[i], level - 1);
+		} else if (!isShared(table[i]) && !isMapped(pageOf(table[i]))) {
+			delete[] pageOf(table[i]);
+		}
+	}
+	delete[] table;
+}
+
+/**
+ * Busca na tabela de páginas.
+ *
+ * Os 36 bits do número da página são divididos em 4 índices de 9 bits,
+ * do mais significativo (tabela raiz) ao menos significativo (página).
+ *
+ * Uma entrada vazia é preenchida com compare-and-swap: se outro núcleo
+ * alocou a mesma tabela ou página antes, a alocação desta thread é
+ * descartada e a do outro núcleo é usada. Da mesma forma, para escrita,
+ * uma página compartilhada é substituída por sua cópia.
+ *
+ * A última página acessada só é usada para escrita se já estiver marcada
+ * como escrita: a marca é feita aqui, uma vez por página a cada
+ * checkpoint, e não a cada escrita. Se for compartilhada, só é usada para
+ * leitura se a entrada ainda a apontar, já que outro núcleo pode tê-la
+ * substituído por uma cópia.
+ */
+uint8_t *SparseMemory::getPage(uint64_t address, bool allocate)
+{
+	uint64_t number = address >> PAGE_BITS;
+	if (lastPage.id == id && lastPage.pageNumber == number) {
+		if (lastPage.writable) {
+			return lastPage.page;
+		}
+		if (!allocate && (!lastPage.sharedEntry
+				|| __atomic_load_n(lastPage.sharedEntry, __ATOMIC_ACQUIRE) == lastPage.shared)) {
+			return lastPage.page;
+		}
+	}
+
+	if (address >> ADDRESS_BITS) {
+		throw SimulatorError::addressOutOfRange(address);
+	}
+
+	void **table = root;
+	void **entry = nullptr;
+	for (int level = TABLE_LEVELS - 1; level >= 0; level--) {
+		uint64_t index = (number >> (level * TABLE_BITS)) & (TABLE_SIZE - 1);
+		entry = &table[index];
+		void *next = __atomic_load_n(entry, __ATOMIC_ACQUIRE);
+		if (!next) {
+			if (!allocate) {
+				return nullptr;
+			}
+			void *fresh;
+			if (level > 0) {
+				fresh = new void*[TABLE_SIZE]();
+			} else {
+				fresh = withFlags(new uint8_t[PAGE_SIZE](), DIRTY_PAGE);
+			}
+			if (__atomic_compare_exchange_n(&table[index], &next, fresh, false,
+											__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+				next = fresh;
+				if (level == 0) {
+					residentPages++;
+				}
+			} else if (level > 0) {
+				delete[] (void **)fresh;
+			} else {
+				delete[] pageOf(fresh);
+			}
+		}
+		table = (void **)next;
+	}
+
+	// a entrada pode mudar entre a leitura e a troca: outro núcleo
+	// copiou a página, ou markCode a marcou; nesse caso, tenta de novo
+	void *page = table;
+	while (allocate && isShared(page)) {
+		uint8_t *copy = new uint8_t[PAGE_SIZE];
+		memcpy(copy, pageOf(page), PAGE_SIZE);
+		void *fresh = withFlags(copy, DIRTY_PAGE | ((uintptr_t)page & CODE_PAGE));
+		if (__atomic_compare_exchange_n(entry, &page, fresh, false,
+										__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+			page = fresh;
+			residentPages++;
+		} else {
+			delete[] copy;
+		}
+	}
+	if (allocate && !isDirty(page)) {
+		page = (void *)__atomic_or_fetch((uintptr_t *)entry, DIRTY_PAGE, __ATOMIC_ACQ_REL);
+	}
+
+	lastPage = {id, number, pageOf(page), !isShared(page) && isDirty(page),
+				isShared(page) ? entry : nullptr, page,
+				isCode(page) ? findCodeWords(number) : nullptr};
+	return pageOf(page);
+}
+
+void **SparseMemory::findEntry(uint64_t address)
+{
+	if (address >> ADDRESS_BITS) {
+		return nullptr;
+	}
+
+	uint64_t number = address >> PAGE_BITS;
+	void **table = root;
+	for (int level = TABLE_LEVELS - 1; level > 0; level--) {
+		uint64_t index = (number >> (level * TABLE_BITS)) & (TABLE_SIZE - 1);
+		void *next = __atomic_load_n(&table[index], __ATOMIC_ACQUIRE);
+		if (!next) {
+			return nullptr;
+		}
+		table = (void **)next;
+	}
+	void **entry = &table[number & (TABLE_SIZE - 1)];
+	return __atomic_load_n(entry, __ATOMIC_ACQUIRE) ? entry : nullptr;
+}
+
+uint64_t *SparseMemory::findCodeWords(uint64_t number)
+{
+	lock_guard<mutex> lock(codeLock);
+	auto words = codeWords.find(number);
+	return words == codeWords.end() ? nullptr : words->second.get();
+}
+
+/**
+ * Páginas inexistentes são lidas como zeros e não são marcadas: a
+ * escrita que as aloca não alcança instruções já lidas.
+ */
+void SparseMemory::markCode(uint64_t address)
+{
+	uint64_t number = address >> PAGE_BITS;
+	uint64_t word = (address & (PAGE_SIZE - 1)) >> 2;
+	uint64_t bit = (uint64_t)1 << (word & 63);
+	if (lastPage.id == id && lastPage.pageNumber == number && lastPage.codeWords
+			&& (__atomic_load_n(&lastPage.codeWords[word >> 6], __ATOMIC_RELAXED) & bit)) {
+		return;
+	}
+
+	void **entry = findEntry(address);
+	if (!entry) {
+		return;
+	}
+	{
+		lock_guard<mutex> lock(codeLock);
+		unique_ptr<uint64_t[]> &words = codeWords[number];
+		if (!words) {
+			words.reset(new uint64_t[PAGE_SIZE / 4 / 64]());
+		}
+		__atomic_fetch_or(&words[word >> 6], bit, __ATOMIC_RELAXED);
+	}
+	if (!isCode(__atomic_load_n(entry, __ATOMIC_ACQUIRE))) {
+		__atomic_fetch_or((uintptr_t *)entry, CODE_PAGE, __ATOMIC_ACQ_REL);
+		id = nextId++;
+		notifyHostPagesChanged();
+	}
+}
+
+/**
+ * Escritas que cruzam páginas avisam sempre.
+ */
+void SparseMemory::dataWritten(uint64_t address, uint64_t size)
+{
+	uint64_t first = address & (PAGE_SIZE - 1);
+	uint64_t last = first + size - 1;
+	if (last >= PAGE_SIZE) {
+		notifyCodeModified(address, size);
+		return;
+	}
+	uint64_t *words = lastPage.codeWords;
+	if (!words) {
+		return;
+	}
+	for (uint64_t word = first >> 2; word <= last >> 2; word++) {
+		if (__atomic_load_n(&words[word >> 6], __ATOMIC_RELAXED) & ((uint64_t)1 << (word & 63))) {
+			notifyCodeModified(address, size);
+			return;
+		}
+	}
+}
+
+void **SparseMemory::getEntry(uint64_t address)
+{
+	if (address >> ADDRESS_BITS) {
+		throw SimulatorError::addressOutOfRange(address);
+	}
+
+	uint64_t number = address >> PAGE_BITS;
+	void **table = root;
+	for (int level = TABLE_LEVELS - 1; level > 0; level--) {
+		uint64_t index = (number >> (level * TABLE_BITS)) & (TABLE_SIZE - 1);
+		if (!table[index]) {
+			table[index] = new void*[TABLE_SIZE]();
+		}
+		table = (void **)table[index];
+	}
+	return &table[number & (TABLE_SIZE - 1)];
+}
+
+void SparseMemory::checkRange(uint64_t address, uint64_t size)
+{
+	uint64_t limit = (uint64_t)1 << ADDRESS_BITS;
+	if (address > limit || size > limit - address) {
+		throw SimulatorError::writeOutOfRange(address, size);
+	}
+}
+
+void SparseMemory::read(uint64_t address, void *value, uint64_t size)
+{
+	uint8_t *dest = (uint8_t *)value;
+	while (size) {
+		uint64_t offset = address & (PAGE_SIZE - 1);
+		uint64_t chunk = PAGE_SIZE - offset < size ? PAGE_SIZE - offset : size;
+		uint8_t *page = getPage(address, false);
+		if (page) {
+			memcpy(dest, page + offset, chunk);
+		} else {
+			memset(dest, 0, chunk);
+		}
+		address += chunk;
+		dest += chunk;
+		size -= chunk;
+	}
+}
+
+void SparseMemory::write(uint64_t address, const void *value, uint64_t size)
+{
+	const uint8_t *src = (const uint8_t *)value;
+	while (size) {
+		uint64_t offset = address & (PAGE_SIZE - 1);
+		uint64_t chunk = PAGE_SIZE - offset < size ? PAGE_SIZE - offset : size;
+		memcpy(getPage(address, true) + offset, src, chunk);
+		address += chunk;
+		src += chunk;
+		size -= chunk;
+	}
+}
+
+/**
+ * Lê uma instrução de 32 bits considerando um endereçamento em bytes.
+ */
+uint32_t SparseMemory::readInstruction32(uint64_t address)
+{
+	uint32_t value;
+	read(address, &value, sizeof(value));
+	markCode(address);
+	return value;
+}
+
+/**
+ * Lê um dado de 32 bits considerando um endereçamento em bytes.
+ */
+uint32_t SparseMemory::readData32(uint64_t address)
+{
+	uint32_t value;
+	read(address, &value, sizeof(value));
+	return value;
+}
+
+/**
+ * Lê um dado de 64 bits considerando um endereçamento em bytes.
+ */
+uint64_t SparseMemory::readData64(uint64_t address)
+{
+	uint64_t value;
+	read(address, &value, sizeof(value));
+	return value;
+}
+
+/**
+ * Escreve uma instrução de 32 bits considerando um
+ * endereçamento em bytes.
+ */
+void SparseMemory::writeInstruction32(uint64_t address, uint32_t value)
+{
+	write(address, &value, sizeof(value));
+	notifyCodeModified(address, 4);
+}
+
+/**
+ * Escreve um dado (value) de 32 bits considerando um endereçamento em bytes.
+ */
+void SparseMemory::writeData32(uint64_t address, uint32_t value)
+{
+	write(address, &value, sizeof(value));
+	dataWritten(address, sizeof(value));
+}
+
+/**
+ * Escreve um dado (value) de 64 bits considerando um endereçamento em bytes.
+ */
+void SparseMemory::writeData64(uint64_t address, uint64_t value)
+{
+	write(address, &value, sizeof(value));
+	dataWritten(address, sizeof(value));
+}
+
+/**
+ * Copia size bytes para a memória, a partir de address.
+ */
+void SparseMemory::writeBytes(uint64_t address, const void *bytes, uint64_t size)
+{
+	checkRange(address, size);
+	write(address, bytes, size);
+	notifyCodeModified(address, size);
+}
+
+/**
+ * O trecho do arquivo é mapeado uma única vez (MAP_PRIVATE, a partir do
+ * deslocamento alinhado à página do hospedeiro) e as entradas das páginas
+ * inteiramente contidas no intervalo passam a apontar para ele. Páginas
+ * já existentes, o início e o fim parciais, e trechos cujo deslocamento
+ * no arquivo não está alinhado como o endereço, são copiados.
+ */
+void SparseMemory::mapFile(uint64_t address, int fd, uint64_t offset, uint64_t size)
+{
+	checkRange(address, size);
+	uint64_t begin = (address + PAGE_SIZE - 1) & ~(uint64_t)(PAGE_SIZE - 1);
+	uint64_t end = (address + size) & ~(uint64_t)(PAGE_SIZE - 1);
+	if ((address & (PAGE_SIZE - 1)) != (offset & (PAGE_SIZE - 1)) || begin >= end) {
+		Memory::mapFile(address, fd, offset, size);
+		return;
+	}
+
+	// o deslocamento do mmap precisa estar alinhado à página do hospedeiro
+	uint64_t fileBegin = offset + (begin - address);
+	uint64_t skew = fileBegin & (sysconf(_SC_PAGESIZE) - 1);
+	uint64_t length = skew + (end - begin);
+	uint8_t *base = (uint8_t *)mmap(nullptr, length, PROT_READ | PROT_WRITE,
+									MAP_PRIVATE, fd, fileBegin - skew);
+	if (base == MAP_FAILED) {
+		Memory::mapFile(address, fd, offset, size);
+		return;
+	}
+	mappings.push_back({base, length});
+
+	for (uint64_t page = begin; page < end; page += PAGE_SIZE) {
+		uint8_t *source = base + skew + (page - begin);
+		void **entry = getEntry(page);
+		if (*entry && !isShared(*entry)) {
+			memcpy(pageOf(*entry), source, PAGE_SIZE);
+			*entry = withFlags(*entry, DIRTY_PAGE);
+		} else {
+			*entry = withFlags(source, DIRTY_PAGE);
+			mappedPages++;
+		}
+	}
+	notifyCodeModified(begin, end - begin);
+	notifyHostPagesChanged();
+
+	Memory::mapFile(address, fd, offset, begin - address);
+	Memory::mapFile(end, fd, offset + (end - address), address + size - end);
+}
+
+void SparseMemory::saveTable(CheckpointWriter *checkpoint, void **table, int level,
+								uint64_t number, bool incremental)
+{
+	for (int i = 0; i < TABLE_SIZE; i++) {
+		if (!table[i]) continue;
+		uint64_t entryNumber = (number << TABLE_BITS) | i;
+		if (level > 0) {
+			saveTable(checkpoint, (void **)table[i], level - 1, entryNumber, incremental);
+			continue;
+		}
+		if (checkpoint && (!incremental || isDirty(table[i]))) {
+			checkpoint->writePage(entryNumber << PAGE_BITS, pageOf(table[i]), incremental);
+		}
+		table[i] = (void *)((uintptr_t)table[i] & ~DIRTY_PAGE);
+	}
+}
+
+/**
+ * Apenas as páginas existentes são visitadas; as que estão inteiramente
+ * nulas não são gravadas. Todas passam a ser consideradas não escritas,
+ * e o novo id faz com que a próxima escrita em cada uma passe por
+ * getPage e a marque novamente.
+ */
+void SparseMemory::save(CheckpointWriter &checkpoint)
+{
+	checkpoint.section("MEM ");
+	checkpoint.writeUint64((uint64_t)1 << ADDRESS_BITS);
+	saveTable(&checkpoint, root, TABLE_LEVELS - 1, 0, false);
+	checkpoint.endPages();
+	id = nextId++;
+	notifyHostPagesChanged();
+}
+
+/**
+ * Como save, mas apenas as páginas marcadas como escritas são gravadas,
+ * mesmo que nulas.
+ */
+void SparseMemory::saveIncremental(CheckpointWriter &checkpoint)
+{
+	checkpoint.section("MEMI");
+	checkpoint.writeUint64((uint64_t)1 << ADDRESS_BITS);
+	saveTable(&checkpoint, root, TABLE_LEVELS - 1, 0, true);
+	checkpoint.endPages();
+	id = nextId++;
+	notifyHostPagesChanged();
+}
+
+/**
+ * Todas as páginas e mapeamentos de arquivos são descartados e as
+ * páginas gravadas são alocadas novamente; as de um checkpoint
+ * incremental são escritas sobre o conteúdo atual. Ao final, nenhuma
+ * página está marcada como escrita. O novo id invalida a última página
+ * acessada guardada pelas threads.
+ */
+void SparseMemory::restore(CheckpointReader &checkpoint)
+{
+	bool incremental = checkpoint.section("MEM ", "MEMI");
+	checkpoint.readUint64();
+
+	if (!incremental) {
+		freeTable(root, TABLE_LEVELS - 1);
+		for (Mapping &mapping : mappings) {
+			munmap(mapping.base, mapping.length);
+		}
+		mappings.clear();
+		shared.clear();
+		root = new void*[TABLE_SIZE]();
+		residentPages = 0;
+		mappedPages = 0;
+	}
+	id = nextId++;
+
+	uint64_t address;
+	uint8_t page[CHECKPOINT_PAGE_SIZE];
+	while (checkpoint.readPage(address, page)) {
+		write(address, page, CHECKPOINT_PAGE_SIZE);
+	}
+	saveTable(nullptr, root, TABLE_LEVELS - 1, 0, false);
+	id = nextId++;
+	notifyCodeModified(0, (uint64_t)1 << ADDRESS_BITS);
+	notifyHostPagesChanged();
+}
+
+void **SparseMemory::copyTable(void **table, int level, SharedPages *frozen)
+{
+	void **copy = new void*[TABLE_SIZE]();
+	for (int i = 0; i < TABLE_SIZE; i++) {
+		if (!table[i]) continue;
+		if (level > 0) {
+			copy[i] = copyTable((void **)table[i], level - 1, frozen);
+			continue;
+		}
+		if (!isShared(table[i]) && !isMapped(pageOf(table[i]))) {
+			frozen->pages.push_back(pageOf(table[i]));
+		}
+		table[i] = withFlags(table[i], SHARED_PAGE);
+		copy[i] = (void *)((uintptr_t)table[i] & ~CODE_PAGE);
+	}
+	return copy;
+}
+
+/**
+ * As tabelas são copiadas e todas as páginas passam a ser compartilhadas
+ * pelas duas memórias; as desta, e seus mapeamentos de arquivos, passam
+ * para um SharedPages comum. O novo id invalida a última página acessada
+ * guardada pelas threads, que podia estar marcada como privada.
+ */
+Memory *SparseMemory::fork()
+{
+	shared_ptr<SharedPages> frozen = make_shared<SharedPages>();
+	SparseMemory *child = new SparseMemory();
+	delete[] child->root;
+	child->root = copyTable(root, TABLE_LEVELS - 1, frozen.get());
+	frozen->mappings.swap(mappings);
+	shared.push_back(frozen);
+	child->shared = shared;
+	child->fileSize = fileSize;
+	id = nextId++;
+	notifyHostPagesChanged();
+	return child;
+}
+
+/**
+ * Para escrita, a página é obtida como em uma escrita comum: alocada,
+ * copiada se compartilhada e marcada como escrita; páginas com
+ * instruções já lidas não são entregues, já que escritas nelas precisam
+ * passar por writeData32 e writeData64. Para leitura, páginas
+ * compartilhadas não são entregues, já que a escrita de outro núcleo as
+ * substituiria por uma cópia sem que esta CPU soubesse; nem páginas
+ * inexistentes, que não são alocadas por leituras.
+ */
+uint8_t *SparseMemory::getHostPage(uint64_t address, bool write)
+{
+	if (write) {
+		uint8_t *page = getPage(address, true);
+		return lastPage.codeWords ? nullptr : page;
+	}
+
+	void **entry = findEntry(address);
+	if (!entry) {
+		return nullptr;
+	}
+	void *page = __atomic_load_n(entry, __ATOMIC_ACQUIRE);
+	return isShared(page) ? nullptr : pageOf(page);
+}
+
+/**
+ * carrega arquivo binário na memória, a partir do endereço 0
+ */
+void SparseMemory::loadBinary(string filename)
+{
+	int fd = open(filename.c_str(), O_RDONLY);
+	if (fd < 0) {
+		cout << "Unable to open file " << filename << endl;
+		cout << "Aborting... " << endl;
+		exit(1);
+	}
+
+	fileSize = lseek(fd, 0, SEEK_END);
+	mapFile(0, fd, 0, fileSize);
+	close(fd);
+}
+
+/**
+ * Escreve arquivo binario em um arquivo legível
+ */
+#define LINE_SIZE 4
+void SparseMemory::writeBinaryAsText (string basename) {
+	string filename = "txt_" + basename + ".txt";
+	ofstream ofp;
+
+	cout << "Gerado arquivo " << filename << endl << endl;
+	ofp.open(filename);
+
+	ofp << uppercase << hex;
+
+	// caption
+	ofp << "ADDR    ";
+	for (int j = 0; j < LINE_SIZE; j++) {
+		ofp << "ADDR+" << setfill('0') << setw(2) << 4*j << "  ";
+	}
+	ofp << endl << "----------------------------------------------------------------------------" << endl;
+
+	// binary
+	for (uint64_t address = 0; address < fileSize; address += 4 * LINE_SIZE) {
+		ofp << setw(4) << address << "    ";
+		for (int j = 0; j < LINE_SIZE; j++) {
+			ofp << setw(8) << readData32(address + 4 * j) << " ";
+		}
+		ofp << endl;
+	}
+	ofp.close();
+}
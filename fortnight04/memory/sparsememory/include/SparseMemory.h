@@ -0,0 +1,299 @@
+/* ----------------------------------------------------------------------------
+
+    (EN) SparseMemory - a sparse 48-bit memory backed by a multi-level page table
+		
+	armethyst - A simple ARM Simulator written in C++ for Computer Architecture
+    teaching purposes. Free software licensed under the MIT License (see license
+    below).
+
+    (PT) SparseMemory - uma memória esparsa de 48 bits, com tabela de páginas de
+		  vários níveis
+    
+	armethyst - Um simulador ARM simples escrito em C++ para o ensino de
+    Arquitetura de Computadores. Software livre licenciado pela MIT License
+    (veja a licença, em inglês, abaixo).
+
+    (EN) MIT LICENSE:
+
+    Copyright 2020 André Vital Saúde
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+   ----------------------------------------------------------------------------
+*/
+
+#pragma once
+
+#include "Memory.h"
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+// Páginas de 4 KiB
+#define PAGE_BITS 12
+#define PAGE_SIZE (1 << PAGE_BITS)
+
+// Tabelas de 512 entradas, em 4 níveis: 12 + 4 * 9 = 48 bits de endereço
+#define TABLE_BITS 9
+#define TABLE_SIZE (1 << TABLE_BITS)
+#define TABLE_LEVELS 4
+#define ADDRESS_BITS (PAGE_BITS + TABLE_LEVELS * TABLE_BITS)
+
+/**
+ * SparseMemory
+ *
+ * Memória de Von Neumann, como a BasicMemory, mas com espaço de endereços
+ * de 48 bits. As páginas são alocadas apenas na primeira escrita, já
+ * zeradas; leituras de páginas nunca escritas retornam 0 sem alocá-las.
+ * A memória ocupada no hospedeiro é, portanto, proporcional às páginas
+ * efetivamente usadas pelo programa.
+ *
+ * Acessos a endereços fora dos 48 bits encerram o simulador.
+ *
+ * Binários carregados com mapFile têm as páginas apontando diretamente
+ * para um mapeamento privado do arquivo: várias instâncias do simulador
+ * executando o mesmo binário compartilham o cache de páginas do sistema,
+ * e o kernel só copia uma página quando o programa a escreve.
+ *
+ * Cada página é marcada na primeira escrita após um checkpoint (save,
+ * saveIncremental ou restore): checkpoints incrementais gravam apenas
+ * as páginas marcadas. Páginas também são marcadas na primeira leitura
+ * de uma instrução (readInstruction32), e só as escritas de dados nessas
+ * páginas verificam se alcançaram instruções já lidas.
+ *
+ * fork cria uma cópia que compartilha todas as páginas existentes: as
+ * entradas das duas memórias passam a apontar as mesmas páginas, marcadas
+ * como compartilhadas, e a primeira escrita em uma delas, por qualquer das
+ * memórias, aloca a cópia privada da página. Variantes de um mesmo estado
+ * custam, assim, apenas a cópia das tabelas e das páginas que escrevem, e
+ * podem executar em paralelo, cada uma em sua thread.
+ *
+ * Pode ser acessada por vários núcleos ao mesmo tempo (ver
+ * MultiCoreProcessor): tabelas e páginas são alocadas com
+ * compare-and-swap e a última página acessada é guardada por thread.
+ * Carregar binários (loadBinary, mapFile) não é seguro durante a
+ * execução.
+ */
+class SparseMemory : public Memory
+{
+public:
+	SparseMemory();
+	~SparseMemory();
+
+	void loadBinary(std::string filename);
+	void writeBinaryAsText (std::string basename);
+
+	/**
+	 * Lê uma instrução de 32 bits considerando um endereçamento em bytes.
+	 */
+	uint32_t readInstruction32(uint64_t address);
+
+	/**
+	 * Lê um dado de 32 bits considerando um endereçamento em bytes.
+	 */
+	uint32_t readData32(uint64_t address);
+
+	/**
+	 * Lê um dado de 64 bits considerando um endereçamento em bytes.
+	 */
+	uint64_t readData64(uint64_t address);
+
+	/**
+	 * Escreve uma instrução de 32 bits considerando um
+	 * endereçamento em bytes.
+	 */
+	void writeInstruction32(uint64_t address, uint32_t value);
+
+	/**
+	 * Escreve um dado (value) de 32 bits considerando um endereçamento em bytes.
+	 */
+	void writeData32(uint64_t address, uint32_t value);
+
+	/**
+	 * Escreve um dado (value) de 64 bits considerando um endereçamento em bytes.
+	 */
+	void writeData64(uint64_t address, uint64_t value);
+
+	/**
+	 * Copia size bytes para a memória, a partir de address.
+	 */
+	void writeBytes(uint64_t address, const void *bytes, uint64_t size);
+
+	/**
+	 * Mapeia as páginas inteiras do intervalo diretamente do arquivo.
+	 */
+	void mapFile(uint64_t address, int fd, uint64_t offset, uint64_t size);
+
+	void save(CheckpointWriter &checkpoint);
+	void saveIncremental(CheckpointWriter &checkpoint);
+	void restore(CheckpointReader &checkpoint);
+	Memory *fork();
+
+	/**
+	 * Páginas privadas desta memória; para escrita, apenas as que não
+	 * têm instruções já lidas. Valem até o próximo checkpoint, fork ou
+	 * mapFile, ou até a primeira leitura de uma instrução da página, que
+	 * avisam os observadores (hostPagesChanged).
+	 */
+	uint8_t *getHostPage(uint64_t address, bool write);
+
+	/**
+	 * Número de páginas alocadas por esta memória, inclusive as cópias
+	 * de páginas compartilhadas (ver fork).
+	 */
+	uint64_t getResidentPages() { return residentPages.load(std::memory_order_relaxed); }
+
+	/**
+	 * Número de páginas mapeadas de arquivos.
+	 */
+	uint64_t getMappedPages() { return mappedPages; }
+
+protected:
+	// tabela de primeiro nível; as entradas dos níveis intermediários
+	// apontam tabelas, as do último nível apontam páginas
+	void **root;
+
+	// última página acessada pela thread (cache da busca na tabela);
+	// id distingue as instâncias, inclusive uma nova alocada no lugar de
+	// outra já destruída
+	struct PageCache {
+		uint64_t id;
+		uint64_t pageNumber;
+		uint8_t *page;
+		bool writable;		// falso se compartilhada
+		void **sharedEntry;	// entrada da página, se compartilhada
+		void *shared;		// valor da entrada quando foi lida
+		uint64_t *codeWords;	// ver codeWords, se a página tem instruções
+	};
+	static thread_local PageCache lastPage;
+	static std::atomic<uint64_t> nextId;
+	std::atomic<uint64_t> id;
+
+	// instruções já lidas por readInstruction32, um bit por palavra de
+	// 4 bytes, por número de página; as entradas dessas páginas têm a
+	// marca CODE_PAGE
+	std::unordered_map<uint64_t, std::unique_ptr<uint64_t[]>> codeWords;
+	std::mutex codeLock;
+
+	std::atomic<uint64_t> residentPages;
+	uint64_t mappedPages;
+
+	// mapeamentos de arquivos feitos por mapFile; suas páginas não são
+	// liberadas individualmente
+	struct Mapping {
+		uint8_t *base;
+		uint64_t length;
+	};
+	std::vector<Mapping> mappings;
+	uint64_t fileSize;		// tamanho do binário carregado
+
+	// páginas e mapeamentos que eram desta memória ou de outra quando
+	// uma delas fez fork, agora compartilhados: as entradas que apontam
+	// essas páginas têm o bit SHARED_PAGE, e elas são liberadas com a
+	// última memória que as compartilha
+	struct SharedPages {
+		std::vector<uint8_t *> pages;
+		std::vector<Mapping> mappings;
+		~SharedPages();
+	};
+	std::vector<std::shared_ptr<SharedPages>> shared;
+
+	/**
+	 * Retorna a página que contém address. Se a página não existe, ela
+	 * é alocada se allocate, senão retorna nullptr. Lança SimulatorError
+	 * se address estiver além de ADDRESS_BITS bits.
+	 */
+	uint8_t *getPage(uint64_t address, bool allocate);
+
+	/**
+	 * Retorna a entrada da tabela de último nível para address,
+	 * alocando as tabelas intermediárias. Lança SimulatorError como
+	 * getPage.
+	 */
+	void **getEntry(uint64_t address);
+
+	/**
+	 * Lança SimulatorError se [address, address + size) não couber nos
+	 * ADDRESS_BITS bits do espaço de endereçamento.
+	 */
+	void checkRange(uint64_t address, uint64_t size);
+
+	/**
+	 * Entrada da tabela de último nível para address, ou nullptr se a
+	 * página não existe; nada é alocado.
+	 */
+	void **findEntry(uint64_t address);
+
+	/**
+	 * Bits de codeWords da página number, ou nullptr.
+	 */
+	uint64_t *findCodeWords(uint64_t number);
+
+	/**
+	 * Marca a instrução em address como lida. Na primeira instrução de
+	 * uma página, marca a página, invalida a última página guardada
+	 * pelas threads e avisa os observadores que ela não pode mais ser
+	 * escrita diretamente.
+	 */
+	void markCode(uint64_t address);
+
+	/**
+	 * Avisa os observadores se a escrita de dados de size bytes em
+	 * address, que acabou de ser feita por write, alcançou instruções
+	 * já lidas.
+	 */
+	void dataWritten(uint64_t address, uint64_t size);
+
+	/**
+	 * Diz se page pertence a um dos mapeamentos de arquivos.
+	 */
+	bool isMapped(uint8_t *page);
+
+	/**
+	 * Copia a tabela table, do nível level, e as tabelas abaixo dela,
+	 * marcando as páginas como compartilhadas nas duas cópias. As páginas
+	 * que eram desta memória passam para frozen.
+	 */
+	void **copyTable(void **table, int level, SharedPages *frozen);
+
+	/**
+	 * Libera a tabela table, do nível level, e tudo abaixo dela (exceto
+	 * as páginas compartilhadas).
+	 */
+	void freeTable(void **table, int level);
+
+	/**
+	 * Grava em checkpoint as páginas da tabela table, do nível level,
+	 * cujos números de página começam em number (se incremental, apenas
+	 * as escritas), e as marca como não escritas. Com checkpoint nulo,
+	 * apenas as marca.
+	 */
+	void saveTable(CheckpointWriter *checkpoint, void **table, int level, uint64_t number,
+					bool incremental);
+
+	/**
+	 * Leitura e escrita de size bytes, inclusive entre páginas.
+	 */
+	void read(uint64_t address, void *value, uint64_t size);
+	void write(uint64_t address, const void *value, uint64_t size);
+};
@@ -0,0 +1,173 @@
+/* ----------------------------------------------------------------------------
+
+    (EN) armethyst - A simple ARM Simulator written in C++ for Computer Architecture
+    teaching purposes. Free software licensed under the MIT License (see license
+    below).
+
+    (PT) armethyst - Um simulador ARM simples escrito em C++ para o ensino de
+    Arquitetura de Computadores. Software livre licenciado pela MIT License
+    (veja a licença, em inglês, abaixo).
+
+    (EN) MIT LICENSE:
+
+    Copyright 2020 André Vital Saúde
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+   ----------------------------------------------------------------------------
+*/
+
+#include "ForkCheck.h"
+#include "Check.h"
+#include "SparseMemory.h"
+
+using namespace std;
+
+#define CHECK_N 1000
+
+// no laço de soma, antes de ler v[n - 1]
+#define FORK_AT 7000
+
+#define PERTURBATION 1000
+
+/**
+ * Variante de um estado: o processador faz fork no meio do programa de
+ * verificação. O pai termina primeiro, e suas escritas (inclusive por
+ * páginas que a FastCPU já acessava diretamente) não aparecem na
+ * memória do filho; o filho então altera v[n - 1] e termina com a soma
+ * alterada, sem mudar a memória do pai. O pai chega ao mesmo estado e à
+ * mesma memória que uma execução sem fork.
+ */
+static void checkVariant(int cpuImpl, int memImpl)
+{
+	string name = "fork of " + cpuName(cpuImpl) + " on " + memoryName(memImpl);
+	beginCheck(name);
+
+	Memory *refMemory = createMemory(memImpl);
+	CheckProgram program = assembleCheckProgram(refMemory, CHECK_N);
+	CPU *ref = createCPU(cpuImpl, refMemory);
+	startCheckProgram(ref, program);
+	CHECK(ref->runFor(CPU::NO_LIMIT).reason == CPU::EXIT_FINISHED);
+
+	Memory *memory = createMemory(memImpl);
+	assembleCheckProgram(memory, CHECK_N);
+	CheckProcessor *parent = new CheckProcessor(cpuImpl, memory);
+	startCheckProgram(parent->getCPU(), program);
+	CHECK(parent->getCPU()->runFor(FORK_AT).retired == FORK_AT);
+
+	Processor *child = parent->fork();
+	Memory *childMemory = child->getMemory();
+	CPUState parentState, childState;
+	parent->getCPU()->getState(parentState);
+	child->getCPU()->getState(childState);
+	CHECK(sameState(parentState, childState));
+
+	CHECK(parent->getCPU()->runFor(CPU::NO_LIMIT).reason == CPU::EXIT_FINISHED);
+	CHECK(memory->readData32(program.result) == checkProgramSum(CHECK_N));
+	CHECK(childMemory->readData32(program.result) == 0);
+
+	uint64_t last = program.v + 4 * (CHECK_N - 1);
+	childMemory->writeData32(last, CHECK_N - 1 + PERTURBATION);
+	CHECK(child->getCPU()->runFor(CPU::NO_LIMIT).reason == CPU::EXIT_FINISHED);
+	cout << "	parent sum=" << memory->readData32(program.result) << ", child sum="
+			<< childMemory->readData32(program.result) << endl;
+	CHECK(childMemory->readData32(program.result) == checkProgramSum(CHECK_N) + PERTURBATION);
+	CHECK(memory->readData32(last) == CHECK_N - 1);
+
+	CPUState expected;
+	ref->getState(expected);
+	parent->getCPU()->getState(parentState);
+	if (!sameState(expected, parentState)) {
+		printStateDiff(expected, parentState);
+	}
+	CHECK(sameState(expected, parentState));
+	checkSameMemory(refMemory, memory, STARTADDRESS,
+					CHECK_PROGRAM_END(CHECK_N) - STARTADDRESS);
+
+	// o filho sobrevive ao pai
+	delete parent;
+	delete memory;
+	CHECK(childMemory->readData32(program.result) == checkProgramSum(CHECK_N) + PERTURBATION);
+	CHECK(childMemory->readData32(program.v) == 0);
+
+	delete child;
+	delete childMemory;
+	delete ref;
+	delete refMemory;
+	endCheck(name);
+}
+
+/**
+ * SparseMemory: a cópia começa sem páginas próprias e só aloca as que
+ * escreve, dados ou instruções; escritas de cada lado, depois do fork,
+ * não aparecem no outro, inclusive em cópias de cópias.
+ */
+static void checkSharedPages()
+{
+	string name = "SparseMemory fork page sharing";
+	beginCheck(name);
+
+	SparseMemory *memory = new SparseMemory();
+	CheckProgram program = assembleCheckProgram(memory, CHECK_N);
+	uint64_t resident = memory->getResidentPages();
+	uint32_t code = memory->readInstruction32(program.entry);
+
+	SparseMemory *child = (SparseMemory*)memory->fork();
+	CHECK(child->getResidentPages() == 0);
+	CHECK(child->readInstruction32(program.entry) == code);
+	CHECK(child->readData32(program.v) == 0);
+
+	child->writeData32(program.v, 7);
+	child->writeInstruction32(program.end, 0xd503201f);	// nop
+	CHECK(child->getResidentPages() == 2);
+	CHECK(memory->readData32(program.v) == 0);
+	CHECK(memory->readInstruction32(program.end) == 0xd65f03c0);	// ret
+
+	memory->writeData64(program.result, 0x1122334455667788ULL);
+	CHECK(memory->getResidentPages() == resident + 1);
+	CHECK(child->readData64(program.result) == 0);
+
+	SparseMemory *grandchild = (SparseMemory*)child->fork();
+	child->writeData32(program.v, 8);
+	CHECK(grandchild->readData32(program.v) == 7);
+	CHECK(grandchild->readInstruction32(program.end) == 0xd503201f);
+	CHECK(grandchild->readData64(program.result) == 0);
+	CHECK(grandchild->getResidentPages() == 0);
+	cout << "	resident pages: " << memory->getResidentPages() << " parent, "
+			<< child->getResidentPages() << " child, "
+			<< grandchild->getResidentPages() << " grandchild" << endl;
+
+	delete child;
+	CHECK(grandchild->readData32(program.v) == 7);
+	CHECK(memory->readData64(program.result) == 0x1122334455667788ULL);
+	delete memory;
+	CHECK(grandchild->readInstruction32(program.entry) == code);
+	delete grandchild;
+	endCheck(name);
+}
+
+void checkFork()
+{
+	checkVariant(CPU_IMPL_BASIC, MEM_IMPL_BASIC);
+	checkVariant(CPU_IMPL_FAST, MEM_IMPL_BASIC);
+	checkVariant(CPU_IMPL_FAST, MEM_IMPL_SPARSE);
+	checkVariant(CPU_IMPL_JIT, MEM_IMPL_SPARSE);
+	checkVariant(CPU_IMPL_PIPELINED, MEM_IMPL_SPARSE);
+	checkSharedPages();
+}
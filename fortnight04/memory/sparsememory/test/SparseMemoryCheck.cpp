@@ -0,0 +1,150 @@
+/* ----------------------------------------------------------------------------
+
+    (EN) armethyst - A simple ARM Simulator written in C++ for Computer Architecture
+    teaching purposes. Free software licensed under the MIT License (see license
+    below).
+
+    (PT) armethyst - Um simulador ARM simples escrito em C++ para o ensino de
+    Arquitetura de Computadores. Software livre licenciado pela MIT License
+    (veja a licença, em inglês, abaixo).
+
+    (EN) MIT LICENSE:
+
+    Copyright 2020 André Vital Saúde
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+   ----------------------------------------------------------------------------
+*/
+
+#include "SparseMemoryCheck.h"
+#include "Check.h"
+#include "SparseMemory.h"
+#include "FastCPU.h"
+#include "ElfLoader.h"
+#include "SimulatorError.h"
+
+#include <vector>
+
+using namespace std;
+
+#define TOP_ADDRESS ((uint64_t)1 << ADDRESS_BITS)
+
+/**
+ * Leituras de páginas nunca escritas retornam 0 sem alocá-las; escritas
+ * que cruzam páginas, inclusive na fronteira de uma tabela de primeiro
+ * nível, alocam as duas páginas; acessos e cópias além dos 48 bits
+ * lançam SimulatorError.
+ */
+static void checkAddressSpace()
+{
+	string name = "SparseMemory 48-bit address space";
+	beginCheck(name);
+
+	SparseMemory *memory = new SparseMemory();
+	static const uint64_t unmapped[] = {0, 0x1000, 0x123456789000, TOP_ADDRESS / 2, TOP_ADDRESS - 8};
+	for (uint64_t address : unmapped) {
+		CHECK(memory->readData32(address) == 0);
+		CHECK(memory->readData64(address) == 0);
+	}
+	CHECK(memory->getResidentPages() == 0);
+
+	uint64_t boundary = TOP_ADDRESS / 2 - 4;
+	memory->writeData64(boundary, 0x0123456789abcdef);
+	CHECK(memory->readData64(boundary) == 0x0123456789abcdef);
+	CHECK(memory->readData32(boundary) == 0x89abcdef);
+	CHECK(memory->readData32(boundary + 4) == 0x01234567);
+	CHECK(memory->getResidentPages() == 2);
+
+	memory->writeData32(TOP_ADDRESS - 4, 0xcafe);
+	CHECK(memory->readData32(TOP_ADDRESS - 4) == 0xcafe);
+	CHECK(memory->getResidentPages() == 3);
+
+	// acessos da CPU e dos carregadores fora dos 48 bits
+	uint32_t word = 1;
+	int thrown = 0;
+	try {
+		memory->writeBytes(TOP_ADDRESS - 2, &word, 4);
+	} catch (SimulatorError &e) {
+		thrown++;
+	}
+	try {
+		memory->readData32(TOP_ADDRESS);
+	} catch (SimulatorError &e) {
+		thrown++;
+	}
+	try {
+		memory->writeData64(TOP_ADDRESS - 4, 1);
+	} catch (SimulatorError &e) {
+		thrown++;
+	}
+	CHECK(thrown == 3);
+
+	// writeBytes desalinhado por três páginas
+	vector<uint8_t> bytes(3 * PAGE_SIZE + 100);
+	for (uint64_t i = 0; i < bytes.size(); i++) {
+		bytes[i] = (uint8_t)(i * 7 + 1);
+	}
+	uint64_t address = 0x123456789abc;
+	memory->writeBytes(address, bytes.data(), bytes.size());
+	for (uint64_t i = 0; i + 4 <= bytes.size(); i += 4) {
+		uint32_t expected = bytes[i] | bytes[i + 1] << 8 | bytes[i + 2] << 16
+							| (uint32_t)bytes[i + 3] << 24;
+		CHECK(memory->readData32(address + i) == expected);
+	}
+	CHECK(memory->getResidentPages() == 3 + 4);
+
+	delete memory;
+	endCheck(name);
+}
+
+/**
+ * isummation.o executa com a pilha no topo do espaço de endereços
+ * (STACKADDRESS da SparseMemory), longe do programa.
+ */
+static void checkHighStack()
+{
+	string name = "SparseMemory program with a high stack";
+	beginCheck(name);
+
+	SparseMemory *memory = new SparseMemory();
+	ElfLoader loader(memory);
+	uint64_t entry = loader.load("isummation.o");
+	FastCPU *cpu = new FastCPU(memory);
+	cpu->setSP(TOP_ADDRESS);
+	cpu->start(entry);
+	CPU::RunResult result = cpu->runFor(CPU::NO_LIMIT);
+	CHECK(result.reason == CPU::EXIT_FINISHED);
+
+	uint64_t summ = loader.findSymbol("summ");
+	cout << "	summ=" << memory->readData32(summ) << ";  Expected summ=55" << endl;
+	CHECK(memory->readData32(summ) == 55);
+	// isummation.o lê o índice da pilha, na última página
+	CHECK(memory->readData32(TOP_ADDRESS - 16 + 12) == 10);
+
+	delete cpu;
+	delete memory;
+	endCheck(name);
+}
+
+void checkSparseMemory()
+{
+	checkAddressSpace();
+	checkHighStack();
+}
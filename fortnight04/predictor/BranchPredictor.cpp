@@ -0,0 +1,328 @@
+/* ----------------------------------------------------------------------------
+
+    (EN) BranchPredictor - Branch predictor models. Part of armethyst project.
+		
+	armethyst - A simple ARM Simulator written in C++ for Computer Architecture
+    teaching purposes. Free software licensed under the MIT License (see license
+    below).
+
+    (PT) BranchPredictor - Modelos de previsão de desvios. Parte do projeto
+	armethyst.
+    
+	armethyst - Um simulador ARM simples escrito em C++ para o ensino de
+    Arquitetura de Computadores. Software livre licenciado pela MIT License
+    (veja a licença, em inglês, abaixo).
+
+    (EN) MIT LICENSE:
+
+    Copyright 2020 André Vital Saúde
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+   ----------------------------------------------------------------------------
+*/
+
+#include "config.h"
+#include "BranchPredictor.h"
+
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <cstdlib>
+
+using namespace std;
+
+BranchPredictor::BranchPredictor(string name)
+{
+	this->name = name;
+	branches = 0;
+	mispredictions = 0;
+}
+
+void BranchPredictor::branch(uint64_t pc, BranchType type, bool taken, uint64_t target)
+{
+	bool mispredicted;
+	if (!predict(pc, type, taken, target, mispredicted)) {
+		return;
+	}
+
+	BranchStats &stats = perBranch[pc];
+	branches++;
+	stats.executions++;
+	if (mispredicted) {
+		mispredictions++;
+		stats.mispredictions++;
+	}
+}
+
+void BranchPredictor::printStats(uint64_t instructions)
+{
+	streamsize precision = cout.precision();
+	cout << "Branch predictor " << name << ": " << branches << " branches, "
+			<< mispredictions << " mispredictions" << fixed << setprecision(2);
+	if (branches) {
+		cout << " (" << 100.0 * mispredictions / branches << "%)";
+	}
+	if (instructions) {
+		cout << ", " << 1000.0 * mispredictions / instructions << " MPKI";
+	}
+	cout << endl;
+	cout.unsetf(ios::floatfield);
+	cout.precision(precision);
+
+	vector<pair<uint64_t, BranchStats>> worst(perBranch.begin(), perBranch.end());
+	sort(worst.begin(), worst.end(),
+		[](const pair<uint64_t, BranchStats> &a, const pair<uint64_t, BranchStats> &b) {
+			if (a.second.mispredictions != b.second.mispredictions) {
+				return a.second.mispredictions > b.second.mispredictions;
+			}
+			return a.first < b.first;
+		});
+	for (size_t i = 0; i < worst.size() && i < BP_REPORT_BRANCHES; i++) {
+		if (!worst[i].second.mispredictions) {
+			break;
+		}
+		cout << "\t0x" << hex << setfill('0') << setw(16) << worst[i].first << dec << setfill(' ')
+				<< ": " << worst[i].second.executions << " executions, "
+				<< worst[i].second.mispredictions << " mispredictions" << endl;
+	}
+}
+
+/*
+ * Bimodal
+ */
+BimodalPredictor::BimodalPredictor(unsigned counterBits)
+	: BranchPredictor("bimodal"), counters((size_t)1 << counterBits, 1)
+{
+}
+
+bool BimodalPredictor::predict(uint64_t pc, BranchType type, bool taken, uint64_t /*target*/,
+								bool &mispredicted)
+{
+	if (type != BRANCH_CONDITIONAL) {
+		return false;
+	}
+	uint8_t &counter = counters[(pc >> 2) & (counters.size() - 1)];
+	mispredicted = (counter >= 2) != taken;
+	train(counter, taken);
+	return true;
+}
+
+/*
+ * Gshare
+ */
+GsharePredictor::GsharePredictor(unsigned counterBits, unsigned historyBits)
+	: BranchPredictor("gshare"), counters((size_t)1 << counterBits, 1)
+{
+	history = 0;
+	historyMask = historyBits >= 64 ? ~(uint64_t)0 : ((uint64_t)1 << historyBits) - 1;
+}
+
+bool GsharePredictor::predict(uint64_t pc, BranchType type, bool taken, uint64_t /*target*/,
+								bool &mispredicted)
+{
+	if (type != BRANCH_CONDITIONAL) {
+		return false;
+	}
+	uint8_t &counter = counters[((pc >> 2) ^ history) & (counters.size() - 1)];
+	mispredicted = (counter >= 2) != taken;
+	train(counter, taken);
+	history = ((history << 1) | taken) & historyMask;
+	return true;
+}
+
+/*
+ * TAGE-lite
+ */
+TagePredictor::TagePredictor(unsigned counterBits, unsigned tables, unsigned tableBits,
+								unsigned tagBits)
+	: BranchPredictor("TAGE-lite"), base((size_t)1 << counterBits, 1)
+{
+	// fold dobra a história em tableBits e em tagBits - 1 bits, e as
+	// etiquetas são de 16 bits
+	if (!tableBits || tagBits < 2 || tagBits > 16) {
+		cout << "Invalid configuration of branch predictor TAGE-lite" << endl;
+		cout << "Aborting... " << endl;
+		exit(1);
+	}
+	this->tableBits = tableBits;
+	this->tagBits = tagBits;
+	for (unsigned i = 0; i < tables; i++) {
+		this->tables.push_back(vector<Entry>((size_t)1 << tableBits, Entry{0, 0, 0}));
+		historyLengths.push_back(i < 3 ? 8 << i : 64);
+	}
+	history = 0;
+	allocations = 0;
+}
+
+uint64_t TagePredictor::fold(unsigned length, unsigned bits)
+{
+	uint64_t h = length >= 64 ? history : history & (((uint64_t)1 << length) - 1);
+	uint64_t folded = 0;
+	while (h) {
+		folded ^= h & (((uint64_t)1 << bits) - 1);
+		h >>= bits;
+	}
+	return folded;
+}
+
+bool TagePredictor::predict(uint64_t pc, BranchType type, bool taken, uint64_t /*target*/,
+							bool &mispredicted)
+{
+	if (type != BRANCH_CONDITIONAL) {
+		return false;
+	}
+
+	unsigned count = tables.size();
+	uint64_t address = pc >> 2;
+	vector<Entry *> entries(count);
+	vector<uint16_t> tags(count);
+	int provider = -1, alternate = -1;
+	for (unsigned i = 0; i < count; i++) {
+		uint64_t index = (address ^ (address >> tableBits) ^ fold(historyLengths[i], tableBits))
+							& (((uint64_t)1 << tableBits) - 1);
+		tags[i] = (address ^ fold(historyLengths[i], tagBits)
+					^ (fold(historyLengths[i], tagBits - 1) << 1)) & ((1 << tagBits) - 1);
+		entries[i] = &tables[i][index];
+		if (entries[i]->tag == tags[i]) {
+			alternate = provider;
+			provider = i;
+		}
+	}
+
+	uint8_t &baseCounter = base[address & (base.size() - 1)];
+	bool basePrediction = baseCounter >= 2;
+	bool alternatePrediction = alternate >= 0 ? entries[alternate]->counter >= 0 : basePrediction;
+	bool prediction = provider >= 0 ? entries[provider]->counter >= 0 : basePrediction;
+	mispredicted = prediction != taken;
+
+	if (provider >= 0) {
+		Entry *entry = entries[provider];
+		if (taken && entry->counter < 3) entry->counter++;
+		if (!taken && entry->counter > -4) entry->counter--;
+		if (prediction != alternatePrediction) {
+			if (!mispredicted && entry->useful < 3) entry->useful++;
+			if (mispredicted && entry->useful > 0) entry->useful--;
+		}
+	} else {
+		train(baseCounter, taken);
+	}
+
+	// após um erro, aloca uma entrada em uma tabela de história maior,
+	// alternando a primeira tabela candidata para espalhar as alocações
+	if (mispredicted && provider < (int)count - 1) {
+		unsigned first = provider + 1;
+		unsigned start = first + (allocations++ & 1);
+		if (start >= count) {
+			start = first;
+		}
+		bool allocated = false;
+		for (unsigned i = start; i < count && !allocated; i++) {
+			if (entries[i]->useful == 0) {
+				*entries[i] = Entry{tags[i], (int8_t)(taken ? 0 : -1), 0};
+				allocated = true;
+			}
+		}
+		if (!allocated) {
+			for (unsigned i = first; i < count; i++) {
+				if (entries[i]->useful > 0) entries[i]->useful--;
+			}
+		}
+	}
+
+	history = (history << 1) | taken;
+	return true;
+}
+
+/*
+ * BTB
+ */
+BTBPredictor::BTBPredictor(unsigned entries, unsigned associativity)
+	: BranchPredictor("BTB")
+{
+	this->associativity = associativity;
+	sets = entries / associativity;
+	if (sets == 0) {
+		sets = 1;
+	}
+	this->entries = vector<Entry>(sets * associativity, Entry{0, 0, 0, false});
+	clock = 0;
+}
+
+bool BTBPredictor::predict(uint64_t pc, BranchType type, bool taken, uint64_t target,
+							bool &mispredicted)
+{
+	if (!taken || type == BRANCH_RETURN) {
+		return false;
+	}
+
+	clock++;
+	Entry *set = &entries[((pc >> 2) % sets) * associativity];
+	Entry *victim = &set[0];
+	for (unsigned way = 0; way < associativity; way++) {
+		if (set[way].valid && set[way].pc == pc) {
+			mispredicted = set[way].target != target;
+			set[way].target = target;
+			set[way].lastUse = clock;
+			return true;
+		}
+		if (!set[way].valid || (victim->valid && set[way].lastUse < victim->lastUse)) {
+			victim = &set[way];
+		}
+	}
+
+	mispredicted = true;
+	*victim = Entry{pc, target, clock, true};
+	return true;
+}
+
+/*
+ * Pilha de endereços de retorno
+ */
+RASPredictor::RASPredictor(unsigned depth)
+	: BranchPredictor("RAS"), stack(depth, 0)
+{
+	top = 0;
+	count = 0;
+}
+
+bool RASPredictor::predict(uint64_t pc, BranchType type, bool /*taken*/, uint64_t target,
+							bool &mispredicted)
+{
+	if (type == BRANCH_CALL) {
+		stack[top] = pc + 4;
+		top = (top + 1) % stack.size();
+		if (count < stack.size()) {
+			count++;
+		}
+		return false;
+	}
+	if (type != BRANCH_RETURN) {
+		return false;
+	}
+
+	if (count == 0) {
+		mispredicted = true;
+		return true;
+	}
+	top = (top + stack.size() - 1) % stack.size();
+	count--;
+	mispredicted = stack[top] != target;
+	return true;
+}
@@ -0,0 +1,247 @@
+/* ----------------------------------------------------------------------------
+
+    (EN) BranchPredictor - Branch predictor models. Part of armethyst project.
+		
+	armethyst - A simple ARM Simulator written in C++ for Computer Architecture
+    teaching purposes. Free software licensed under the MIT License (see license
+    below).
+
+    (PT) BranchPredictor - Modelos de previsão de desvios. Parte do projeto
+	armethyst.
+    
+	armethyst - Um simulador ARM simples escrito em C++ para o ensino de
+    Arquitetura de Computadores. Software livre licenciado pela MIT License
+    (veja a licença, em inglês, abaixo).
+
+    (EN) MIT LICENSE:
+
+    Copyright 2020 André Vital Saúde
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+   ----------------------------------------------------------------------------
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+/**
+ * BranchPredictor
+ *
+ * Modelo de previsão de desvios. A CPU informa cada desvio resolvido
+ * (branch), com seu tipo, se foi tomado e o destino; o modelo compara com
+ * a sua previsão, conta os erros (no total e por endereço do desvio) e
+ * se treina com o resultado.
+ *
+ * Cada modelo prevê apenas os desvios que lhe cabem: os de direção
+ * (bimodal, gshare, TAGE-lite) os condicionais, o BTB o destino dos
+ * desvios tomados e a pilha de endereços de retorno o destino dos
+ * retornos. Os demais não entram nas suas estatísticas.
+ *
+ * Os modelos não interferem na execução.
+ */
+class BranchPredictor
+{
+	public:
+		enum BranchType {
+			BRANCH_CONDITIONAL,		// B.cond, CBZ, CBNZ
+			BRANCH_DIRECT,			// B
+			BRANCH_CALL,			// BL, BLR
+			BRANCH_INDIRECT,		// BR
+			BRANCH_RETURN,			// RET
+		};
+
+		BranchPredictor(std::string name);
+		virtual ~BranchPredictor() {}
+
+		/**
+		 * Desvio resolvido no endereço pc.
+		 */
+		void branch(uint64_t pc, BranchType type, bool taken, uint64_t target);
+
+		/**
+		 * Escreve as estatísticas, com a taxa de erros por mil
+		 * instruções (MPKI) para instructions instruções executadas, e
+		 * os BP_REPORT_BRANCHES desvios com mais erros.
+		 */
+		void printStats(uint64_t instructions);
+
+		uint64_t getBranches() { return branches; }
+		uint64_t getMispredictions() { return mispredictions; }
+
+	protected:
+		/**
+		 * Prevê o desvio e treina o modelo com o resultado. Retorna
+		 * false se o modelo não prevê desvios deste tipo; senão,
+		 * mispredicted diz se a previsão estava errada.
+		 */
+		virtual bool predict(uint64_t pc, BranchType type, bool taken, uint64_t target,
+								bool &mispredicted) = 0;
+
+		/**
+		 * Contador saturado de 2 bits: prevê tomado a partir de 2.
+		 */
+		static void train(uint8_t &counter, bool taken)
+		{
+			if (taken) {
+				if (counter < 3) counter++;
+			} else {
+				if (counter > 0) counter--;
+			}
+		}
+
+	private:
+		struct BranchStats {
+			uint64_t executions;
+			uint64_t mispredictions;
+		};
+
+		std::string name;
+		uint64_t branches;
+		uint64_t mispredictions;
+		std::unordered_map<uint64_t, BranchStats> perBranch;
+};
+
+/**
+ * Contadores de 2 bits indexados pelo endereço do desvio.
+ */
+class BimodalPredictor : public BranchPredictor
+{
+	public:
+		BimodalPredictor(unsigned counterBits);
+
+	protected:
+		bool predict(uint64_t pc, BranchType type, bool taken, uint64_t target,
+						bool &mispredicted);
+
+	private:
+		std::vector<uint8_t> counters;
+};
+
+/**
+ * Contadores de 2 bits indexados pelo endereço do desvio combinado (ou
+ * exclusivo) com a história global dos últimos desvios condicionais.
+ */
+class GsharePredictor : public BranchPredictor
+{
+	public:
+		GsharePredictor(unsigned counterBits, unsigned historyBits);
+
+	protected:
+		bool predict(uint64_t pc, BranchType type, bool taken, uint64_t target,
+						bool &mispredicted);
+
+	private:
+		std::vector<uint8_t> counters;
+		uint64_t history;
+		uint64_t historyMask;
+};
+
+/**
+ * TAGE-lite: uma tabela bimodal de base e tables tabelas com etiquetas,
+ * indexadas pelo endereço e por histórias globais de comprimentos
+ * geométricos (8, 16, 32, ... até 64 desvios). Prevê a tabela de maior
+ * história com etiqueta coincidente; após um erro, uma entrada é
+ * alocada em uma tabela de história maior que a da que previu.
+ *
+ * tableBits deve ser positivo e tagBits de 2 a 16; outras configurações
+ * encerram o simulador, como as das caches.
+ */
+class TagePredictor : public BranchPredictor
+{
+	public:
+		TagePredictor(unsigned counterBits, unsigned tables, unsigned tableBits,
+						unsigned tagBits);
+
+	protected:
+		bool predict(uint64_t pc, BranchType type, bool taken, uint64_t target,
+						bool &mispredicted);
+
+	private:
+		struct Entry {
+			uint16_t tag;
+			int8_t counter;		// -4..3: prevê tomado se >= 0
+			uint8_t useful;		// 0..3
+		};
+
+		std::vector<uint8_t> base;
+		std::vector<std::vector<Entry>> tables;
+		std::vector<unsigned> historyLengths;
+		unsigned tableBits, tagBits;
+		uint64_t history;
+		uint64_t allocations;	// escolha da tabela alocada
+
+		/**
+		 * history com os length desvios mais recentes, dobrada em bits
+		 * bits por ou exclusivo.
+		 */
+		uint64_t fold(unsigned length, unsigned bits);
+};
+
+/**
+ * Buffer de destinos de desvios, associativo por conjuntos com
+ * substituição LRU. Prevê o destino dos desvios tomados (erro se o
+ * desvio não está no BTB ou o destino mudou), exceto retornos, que
+ * ficam com a pilha de endereços de retorno.
+ */
+class BTBPredictor : public BranchPredictor
+{
+	public:
+		BTBPredictor(unsigned entries, unsigned associativity);
+
+	protected:
+		bool predict(uint64_t pc, BranchType type, bool taken, uint64_t target,
+						bool &mispredicted);
+
+	private:
+		struct Entry {
+			uint64_t pc;
+			uint64_t target;
+			uint64_t lastUse;
+			bool valid;
+		};
+
+		std::vector<Entry> entries;
+		unsigned sets, associativity;
+		uint64_t clock;
+};
+
+/**
+ * Pilha de endereços de retorno: chamadas empilham o endereço seguinte
+ * e retornos são previstos pelo topo. Quando cheia, a pilha descarta o
+ * endereço mais antigo.
+ */
+class RASPredictor : public BranchPredictor
+{
+	public:
+		RASPredictor(unsigned depth);
+
+	protected:
+		bool predict(uint64_t pc, BranchType type, bool taken, uint64_t target,
+						bool &mispredicted);
+
+	private:
+		std::vector<uint64_t> stack;	// circular
+		unsigned top;					// posição do próximo empilhamento
+		unsigned count;					// endereços válidos na pilha
+};
@@ -0,0 +1,205 @@
+/* ----------------------------------------------------------------------------
+
+    (EN) armethyst - A simple ARM Simulator written in C++ for Computer Architecture
+    teaching purposes. Free software licensed under the MIT License (see license
+    below).
+
+    (PT) armethyst - Um simulador ARM simples escrito em C++ para o ensino de
+    Arquitetura de Computadores. Software livre licenciado pela MIT License
+    (veja a licença, em inglês, abaixo).
+
+    (EN) MIT LICENSE:
+
+    Copyright 2020 André Vital Saúde
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+   ----------------------------------------------------------------------------
+*/
+
+#include "BranchPredictorCheck.h"
+#include "Check.h"
+#include "BranchPredictor.h"
+
+using namespace std;
+
+#define CHECK_N 1000
+
+#define PC 0x1000
+#define TARGET 0x2000
+
+static void report(BranchPredictor &predictor, string pattern)
+{
+	cout << "	" << pattern << ": " << predictor.getBranches() << " branches, "
+			<< predictor.getMispredictions() << " mispredictions" << endl;
+}
+
+/**
+ * Padrões de direção: um desvio sempre tomado custa um erro ao bimodal
+ * (contadores iniciados em fracamente não tomado); alternado, o bimodal
+ * erra sempre e o gshare aprende pela história; com período 5, TAGE-lite
+ * erra bem menos que o bimodal, que erra uma vez por período.
+ */
+static void checkDirection()
+{
+	string name = "branch predictor direction patterns";
+	beginCheck(name);
+
+	BimodalPredictor always(BP_COUNTER_BITS);
+	for (int i = 0; i < 100; i++) {
+		always.branch(PC, BranchPredictor::BRANCH_CONDITIONAL, true, TARGET);
+	}
+	report(always, "bimodal, always taken");
+	CHECK(always.getBranches() == 100);
+	CHECK(always.getMispredictions() == 1);
+
+	BimodalPredictor bimodal(BP_COUNTER_BITS);
+	GsharePredictor gshare(BP_COUNTER_BITS, BP_HISTORY_BITS);
+	for (int i = 0; i < CHECK_N; i++) {
+		bimodal.branch(PC, BranchPredictor::BRANCH_CONDITIONAL, i % 2 == 0, TARGET);
+		gshare.branch(PC, BranchPredictor::BRANCH_CONDITIONAL, i % 2 == 0, TARGET);
+	}
+	report(bimodal, "bimodal, alternating");
+	report(gshare, "gshare, alternating");
+	CHECK(bimodal.getMispredictions() == CHECK_N);
+	CHECK(gshare.getMispredictions() < 2 * BP_HISTORY_BITS);
+
+	BimodalPredictor periodic(BP_COUNTER_BITS);
+	TagePredictor tage(BP_COUNTER_BITS, BP_TAGE_TABLES, BP_TAGE_BITS, BP_TAGE_TAG_BITS);
+	for (int i = 0; i < 5 * CHECK_N; i++) {
+		periodic.branch(PC, BranchPredictor::BRANCH_CONDITIONAL, i % 5 != 4, TARGET);
+		tage.branch(PC, BranchPredictor::BRANCH_CONDITIONAL, i % 5 != 4, TARGET);
+	}
+	report(periodic, "bimodal, period 5");
+	report(tage, "TAGE-lite, period 5");
+	// um erro no aquecimento, depois um por período
+	CHECK(periodic.getMispredictions() == CHECK_N + 1);
+	CHECK(tage.getMispredictions() < CHECK_N / 10);
+
+	// desvios incondicionais não entram nas estatísticas de direção
+	bimodal.branch(PC, BranchPredictor::BRANCH_DIRECT, true, TARGET);
+	tage.branch(PC, BranchPredictor::BRANCH_RETURN, true, TARGET);
+	CHECK(bimodal.getBranches() == CHECK_N);
+	CHECK(tage.getBranches() == 5 * CHECK_N);
+
+	endCheck(name);
+}
+
+/**
+ * BTB: erra na primeira execução e quando o destino muda; não vê
+ * desvios não tomados nem retornos; cinco desvios em um conjunto de 4
+ * vias, em ciclo, sempre se substituem (LRU). RAS: acerta os retornos
+ * de chamadas aninhadas até a sua profundidade e erra os que excedem.
+ */
+static void checkTargets()
+{
+	string name = "branch predictor targets";
+	beginCheck(name);
+
+	BTBPredictor btb(BP_BTB_ENTRIES, BP_BTB_ASSOC);
+	for (int i = 0; i < 20; i++) {
+		btb.branch(PC, BranchPredictor::BRANCH_INDIRECT, true, i < 10 ? TARGET : TARGET + 4);
+		btb.branch(PC + 4, BranchPredictor::BRANCH_CONDITIONAL, false, TARGET);
+		btb.branch(PC + 8, BranchPredictor::BRANCH_RETURN, true, TARGET);
+	}
+	report(btb, "BTB, target change");
+	CHECK(btb.getBranches() == 20);
+	CHECK(btb.getMispredictions() == 2);
+
+	BTBPredictor conflicts(BP_BTB_ENTRIES, BP_BTB_ASSOC);
+	uint64_t setStride = 4 * BP_BTB_ENTRIES / BP_BTB_ASSOC;
+	for (int i = 0; i < 50; i++) {
+		conflicts.branch(PC + (i % (BP_BTB_ASSOC + 1)) * setStride,
+							BranchPredictor::BRANCH_DIRECT, true, TARGET);
+	}
+	report(conflicts, "BTB, set conflicts");
+	CHECK(conflicts.getMispredictions() == 50);
+
+	RASPredictor ras(BP_RAS_DEPTH);
+	for (int depth : {BP_RAS_DEPTH / 2, BP_RAS_DEPTH + 4}) {
+		for (int i = 0; i < depth; i++) {
+			ras.branch(PC + 8 * i, BranchPredictor::BRANCH_CALL, true, TARGET);
+		}
+		for (int i = depth - 1; i >= 0; i--) {
+			ras.branch(TARGET, BranchPredictor::BRANCH_RETURN, true, PC + 8 * i + 4);
+		}
+	}
+	report(ras, "RAS, nested calls");
+	CHECK(ras.getBranches() == BP_RAS_DEPTH / 2 + BP_RAS_DEPTH + 4);
+	CHECK(ras.getMispredictions() == 4);
+
+	endCheck(name);
+}
+
+/**
+ * Todas as CPUs informam os mesmos desvios, com os mesmos resultados,
+ * aos modelos: 3n + 2 desvios condicionais no programa de verificação e
+ * um retorno sem chamada.
+ */
+static void checkCPUBranches()
+{
+	string name = "branch predictors fed by every CPU";
+	beginCheck(name);
+
+	static const int cpus[] = {CPU_IMPL_BASIC, CPU_IMPL_FAST, CPU_IMPL_JIT, CPU_IMPL_PIPELINED};
+	uint64_t expected[3][2];
+	for (int cpuImpl : cpus) {
+		Memory *memory = createMemory(MEM_IMPL_BASIC);
+		CheckProgram program = assembleCheckProgram(memory, CHECK_N);
+		CPU *cpu = createCPU(cpuImpl, memory);
+		BranchPredictor *predictors[3] = {
+			new GsharePredictor(BP_COUNTER_BITS, BP_HISTORY_BITS),
+			new BTBPredictor(BP_BTB_ENTRIES, BP_BTB_ASSOC),
+			new RASPredictor(BP_RAS_DEPTH),
+		};
+		for (BranchPredictor *predictor : predictors) {
+			cpu->addBranchPredictor(predictor);
+		}
+		startCheckProgram(cpu, program);
+		CHECK(cpu->runFor(CPU::NO_LIMIT).reason == CPU::EXIT_FINISHED);
+
+		cout << "	" << cpuName(cpuImpl) << ":" << endl;
+		report(*predictors[0], "	gshare");
+		report(*predictors[1], "	BTB");
+		report(*predictors[2], "	RAS");
+		CHECK(predictors[0]->getBranches() == 3 * CHECK_N + 2);
+		CHECK(predictors[2]->getBranches() == 1);
+		CHECK(predictors[2]->getMispredictions() == 1);
+		for (int i = 0; i < 3; i++) {
+			if (cpuImpl == CPU_IMPL_BASIC) {
+				expected[i][0] = predictors[i]->getBranches();
+				expected[i][1] = predictors[i]->getMispredictions();
+			}
+			CHECK(predictors[i]->getBranches() == expected[i][0]);
+			CHECK(predictors[i]->getMispredictions() == expected[i][1]);
+		}
+
+		delete cpu;
+		delete memory;
+	}
+
+	endCheck(name);
+}
+
+void checkBranchPredictor()
+{
+	checkDirection();
+	checkTargets();
+	checkCPUBranches();
+}
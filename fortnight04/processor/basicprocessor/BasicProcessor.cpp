@@ -40,15 +40,31 @@
 */
 
 #include "BasicProcessor.h"
-#include "BasicCPU.h"
+#include "Factory.h"
 
 BasicProcessor::BasicProcessor(Memory* _memory)
 {
 	memory = _memory;
-	cpu = new BasicCPU(memory);
+	cpu = Factory::createCPU(memory);
+}
+
+BasicProcessor::~BasicProcessor()
+{
+	delete cpu;
+}
+
+Processor *BasicProcessor::fork()
+{
+	BasicProcessor *child = new BasicProcessor(memory->fork());
+	CPUState state;
+	cpu->getState(state);
+	child->cpu->setState(state);
+	child->lastCheckpoint = lastCheckpoint;
+	return child;
 }
 
 int BasicProcessor::run(uint64_t startAddress)
 {
+	cpu->setSP(STACKADDRESS);
 	return cpu->run(startAddress);
 }
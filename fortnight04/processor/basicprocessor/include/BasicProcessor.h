@@ -45,6 +45,8 @@ class BasicProcessor: public Processor
 {
 	public:
 		BasicProcessor(Memory* _memory);
+		~BasicProcessor();
 		
 		int run(uint64_t startAddress);
+		Processor *fork();
 };
@@ -0,0 +1,118 @@
+/* ----------------------------------------------------------------------------
+
+    (EN) MultiCoreProcessor - A multi core processor, one host thread per core.
+	Part of armethyst project.
+		
+	armethyst - A simple ARM Simulator written in C++ for Computer Architecture
+    teaching purposes. Free software licensed under the MIT License (see license
+    below).
+
+    (PT) MultiCoreProcessor - Um processador de múltiplos núcleos, uma thread do
+	hospedeiro por núcleo. Parte do projeto armethyst.
+    
+	armethyst - Um simulador ARM simples escrito em C++ para o ensino de
+    Arquitetura de Computadores. Software livre licenciado pela MIT License
+    (veja a licença, em inglês, abaixo).
+
+    (EN) MIT LICENSE:
+
+    Copyright 2020 André Vital Saúde
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+   ----------------------------------------------------------------------------
+*/
+
+#include "MultiCoreProcessor.h"
+
+#include <iostream>
+#include <thread>
+
+using namespace std;
+
+MultiCoreProcessor::MultiCoreProcessor(Memory* _memory, int _cores,
+		CPU* (*_createCPU)(Memory*))
+{
+	memory = _memory;
+	cores = _cores;
+	createCPU = _createCPU;
+	for (int i = 0; i < cores; i++) {
+		cpus.push_back(createCPU(memory));
+	}
+	startAddresses.resize(cores, (uint64_t)CPU::NO_ADDRESS);
+	cpu = cpus[0];
+}
+
+MultiCoreProcessor::~MultiCoreProcessor()
+{
+	for (CPU *core : cpus) {
+		delete core;
+	}
+}
+
+void MultiCoreProcessor::setStartAddress(int core, uint64_t address)
+{
+	startAddresses[core] = address;
+}
+
+Processor *MultiCoreProcessor::fork()
+{
+	MultiCoreProcessor *child = new MultiCoreProcessor(memory->fork(), cores, createCPU);
+	CPUState state;
+	for (int i = 0; i < cores; i++) {
+		cpus[i]->getState(state);
+		child->cpus[i]->setState(state);
+	}
+	child->startAddresses = startAddresses;
+	child->lastCheckpoint = lastCheckpoint;
+	return child;
+}
+
+void MultiCoreProcessor::runCore(int core, uint64_t startAddress, int *result)
+{
+	if (startAddresses[core] != CPU::NO_ADDRESS) {
+		startAddress = startAddresses[core];
+	}
+	cpus[core]->setSP(STACKADDRESS - (uint64_t)core * CORE_STACK_SIZE);
+	*result = cpus[core]->run(startAddress);
+}
+
+/**
+ * O núcleo 0 executa na thread que chamou run; os demais, em threads
+ * criadas aqui.
+ */
+int MultiCoreProcessor::run(uint64_t startAddress)
+{
+	vector<int> results(cores);
+	vector<thread> threads;
+	for (int i = 1; i < cores; i++) {
+		threads.emplace_back(&MultiCoreProcessor::runCore, this, i, startAddress, &results[i]);
+	}
+	runCore(0, startAddress, &results[0]);
+	for (thread &t : threads) {
+		t.join();
+	}
+
+	for (int result : results) {
+		if (result) {
+			return 1;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,115 @@
+/* ----------------------------------------------------------------------------
+
+    (EN) MultiCoreProcessor - A multi core processor, one host thread per core.
+	Part of armethyst project.
+		
+	armethyst - A simple ARM Simulator written in C++ for Computer Architecture
+    teaching purposes. Free software licensed under the MIT License (see license
+    below).
+
+    (PT) MultiCoreProcessor - Um processador de múltiplos núcleos, uma thread do
+	hospedeiro por núcleo. Parte do projeto armethyst.
+    
+	armethyst - Um simulador ARM simples escrito em C++ para o ensino de
+    Arquitetura de Computadores. Software livre licenciado pela MIT License
+    (veja a licença, em inglês, abaixo).
+
+    (EN) MIT LICENSE:
+
+    Copyright 2020 André Vital Saúde
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+   ----------------------------------------------------------------------------
+*/
+
+#pragma once
+
+#include "Processor.h"
+#include "Factory.h"
+
+#include <vector>
+
+/**
+ * MultiCoreProcessor
+ *
+ * Processador com cores núcleos (CPUs da implementação selecionada em
+ * CPU_IMPL), cada um com seus próprios registradores e executado em sua
+ * própria thread do hospedeiro, todos compartilhando a mesma memória.
+ *
+ * O núcleo i começa com SP = STACKADDRESS - i * CORE_STACK_SIZE e
+ * executa a partir do endereço definido em setStartAddress ou, se não
+ * definido, do endereço passado a run.
+ *
+ * A memória deve ser segura para acesso concorrente (BasicMemory e
+ * SparseMemory são; a CachedMemory não é, por isso CACHE_ENABLED não
+ * compila com PROC_IMPL_MULTICORE). Acessos concorrentes do programa
+ * simulado ao mesmo endereço não são sincronizados: cabe ao programa
+ * evitá-los.
+ */
+class MultiCoreProcessor: public Processor
+{
+	public:
+		/**
+		 * Os núcleos são criados por _createCPU: Factory::createCPU ou,
+		 * no runcheck, uma CPU de qualquer implementação.
+		 */
+		MultiCoreProcessor(Memory* _memory, int _cores,
+				CPU* (*_createCPU)(Memory*) = Factory::createCPU);
+		~MultiCoreProcessor();
+
+		/**
+		 * Executa todos os núcleos até que todos terminem.
+		 *
+		 * Retorna 0: se todos executaram corretamente e
+		 *		   1: se houve erro em algum núcleo.
+		 */
+		int run(uint64_t startAddress);
+
+		/**
+		 * Define o endereço inicial do núcleo core.
+		 */
+		void setStartAddress(int core, uint64_t address);
+
+		/**
+		 * Cópia com o mesmo número de núcleos, cada um com o estado do
+		 * núcleo correspondente, e os mesmos endereços iniciais.
+		 */
+		Processor *fork();
+
+		int getCores() { return cores; }
+
+		/**
+		 * CPU do núcleo core (getCPU() é a do núcleo 0).
+		 */
+		CPU *getCPU(int core) { return cpus[core]; }
+
+	private:
+		int cores;
+		std::vector<CPU*> cpus;
+		CPU* (*createCPU)(Memory*);
+
+		// CPU::NO_ADDRESS: usa o endereço passado a run
+		std::vector<uint64_t> startAddresses;
+
+		/**
+		 * Executa o núcleo core, guardando o resultado em result.
+		 */
+		void runCore(int core, uint64_t startAddress, int *result);
+};
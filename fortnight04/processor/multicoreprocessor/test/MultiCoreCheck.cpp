@@ -0,0 +1,134 @@
+/* ----------------------------------------------------------------------------
+
+    (EN) armethyst - A simple ARM Simulator written in C++ for Computer Architecture
+    teaching purposes. Free software licensed under the MIT License (see license
+    below).
+
+    (PT) armethyst - Um simulador ARM simples escrito em C++ para o ensino de
+    Arquitetura de Computadores. Software livre licenciado pela MIT License
+    (veja a licença, em inglês, abaixo).
+
+    (EN) MIT LICENSE:
+
+    Copyright 2020 André Vital Saúde
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+   ----------------------------------------------------------------------------
+*/
+
+#include "MultiCoreCheck.h"
+#include "Check.h"
+#include "Assembler.h"
+#include "MultiCoreProcessor.h"
+
+using namespace std;
+
+// voltas do laço do núcleo i: (i + 1) * MULTICORE_LOOPS, acima de
+// JIT_THRESHOLD para que a JITCPU o compile
+#define MULTICORE_LOOPS 200
+
+template <int cpuImpl>
+static CPU *createCore(Memory *memory)
+{
+	return createCPU(cpuImpl, memory);
+}
+
+static uint64_t stackOf(int core)
+{
+	return STACKADDRESS - (uint64_t)core * CORE_STACK_SIZE;
+}
+
+/**
+ * PROC_CORES núcleos do MultiCoreProcessor, com CPUs cpuImpl, executam
+ * em paralelo cada um a sua cópia do programa (setStartAddress):
+ *
+ *		sub x1, sp, #16
+ *		ldr w2, [x1]		// n, na pilha do núcleo
+ *		ldr w0, [x1, #4]	// 0
+ *	loop:
+ *		add w0, w0, w2
+ *		sub x2, x2, #1
+ *		cmp w2, #0
+ *		b.ne loop
+ *		sub x0, x0, #i		// i: o núcleo da cópia
+ *		str w0, [x1, #8]
+ *		ret
+ *
+ * Cada núcleo deve ler o seu n e escrever n(n + 1)/2 - i na sua própria
+ * pilha, o que só acontece se cada um tiver recebido o seu SP e o seu
+ * endereço inicial.
+ */
+static void checkCores(int memImpl, int cpuImpl, CPU *(*create)(Memory *))
+{
+	string name = "MultiCoreProcessor on " + cpuName(cpuImpl)
+					+ " (" + memoryName(memImpl) + ")";
+	beginCheck(name);
+
+	Memory *memory = createMemory(memImpl);
+	MultiCoreProcessor *processor = new MultiCoreProcessor(memory, PROC_CORES, create);
+	Assembler as(memory);
+	for (int i = 0; i < PROC_CORES; i++) {
+		Assembler::Label loop;
+		processor->setStartAddress(i, as.here());
+		as.sub(X(1), SP, 16);
+		as.ldr(W(2), X(1));
+		as.ldr(W(0), X(1), 4);
+		as.bind(loop);
+		as.add(W(0), W(0), W(2));
+		as.sub(X(2), X(2), 1);
+		as.cmp(W(2), 0);
+		as.b(Assembler::NE, loop);
+		as.sub(X(0), X(0), i);
+		as.str(W(0), X(1), 8);
+		as.ret();
+
+		memory->writeData32(stackOf(i) - 16, (i + 1) * MULTICORE_LOOPS);
+		memory->writeData32(stackOf(i) - 12, 0);
+		memory->writeData32(stackOf(i) - 8, 0);
+	}
+	as.finish();
+
+	CHECK(processor->run(EXITADDRESS) == 0);
+	for (int i = 0; i < PROC_CORES; i++) {
+		uint64_t n = (i + 1) * MULTICORE_LOOPS;
+		uint32_t expected = n * (n + 1) / 2 - i;
+		CPUState state;
+		processor->getCPU(i)->getState(state);
+		cout << "	core " << i << ": " << memory->readData32(stackOf(i) - 8)
+				<< " (expected " << expected << ")" << endl;
+		CHECK(memory->readData32(stackOf(i) - 8) == expected);
+		CHECK(state.R[0] == expected);
+		CHECK(state.SP == stackOf(i));
+	}
+
+	delete processor;
+	delete memory;
+	endCheck(name);
+}
+
+void checkMultiCore()
+{
+	static const int memories[] = {MEM_IMPL_BASIC, MEM_IMPL_SPARSE};
+	for (int memImpl : memories) {
+		checkCores(memImpl, CPU_IMPL_BASIC, createCore<CPU_IMPL_BASIC>);
+		checkCores(memImpl, CPU_IMPL_FAST, createCore<CPU_IMPL_FAST>);
+		checkCores(memImpl, CPU_IMPL_JIT, createCore<CPU_IMPL_JIT>);
+	}
+}
@@ -0,0 +1,84 @@
+/* ----------------------------------------------------------------------------
+
+    (EN) StaticProcessor - a processor composed at compile time
+		
+	armethyst - A simple ARM Simulator written in C++ for Computer Architecture
+    teaching purposes. Free software licensed under the MIT License (see license
+    below).
+
+    (PT) StaticProcessor - um processador composto em tempo de compilação
+    
+	armethyst - Um simulador ARM simples escrito em C++ para o ensino de
+    Arquitetura de Computadores. Software livre licenciado pela MIT License
+    (veja a licença, em inglês, abaixo).
+
+    (EN) MIT LICENSE:
+
+    Copyright 2020 André Vital Saúde
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+   ----------------------------------------------------------------------------
+*/
+
+#pragma once
+
+#include "Processor.h"
+
+/**
+ * StaticProcessor
+ *
+ * Processador de um núcleo, como o BasicProcessor, mas com a CPU e a
+ * memória escolhidas por parâmetros de template em vez da Factory:
+ *
+ *		StaticProcessor<FastCPU, FlatMemory> processor;
+ *
+ * A CPU executa com CPUType::execute(MemoryType*, ...), de modo que os
+ * acessos à memória no laço do interpretador são chamadas diretas (e
+ * expandidas em linha) em vez de chamadas virtuais por Memory*. As
+ * interfaces virtuais continuam disponíveis: memory e cpu apontam para
+ * os componentes, e getMemory() pode ser passado ao ElfLoader.
+ *
+ * CPUType deve ter execute instanciado para MemoryType (ver
+ * STATIC_MEM_IMPL no makefile), e MemoryType deve informar o topo da
+ * pilha em getStackAddress().
+ */
+template <class CPUType, class MemoryType>
+class StaticProcessor: public Processor
+{
+	public:
+		StaticProcessor() : staticCPU(&staticMemory)
+		{
+			memory = &staticMemory;
+			cpu = &staticCPU;
+		}
+
+		MemoryType *getMemory() { return &staticMemory; }
+
+		int run(uint64_t startAddress)
+		{
+			staticCPU.setSP(staticMemory.getStackAddress());
+			return staticCPU.execute(&staticMemory, startAddress);
+		}
+
+	private:
+		// a memória precede a CPU: é construída antes e destruída depois
+		MemoryType staticMemory;
+		CPUType staticCPU;
+};
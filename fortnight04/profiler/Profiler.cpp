@@ -0,0 +1,360 @@
+/* ----------------------------------------------------------------------------
+
+    (EN) Profiler - Guest program hot-spot profiler. Part of armethyst project.
+		
+	armethyst - A simple ARM Simulator written in C++ for Computer Architecture
+    teaching purposes. Free software licensed under the MIT License (see license
+    below).
+
+    (PT) Profiler - Perfil de execução do programa simulado. Parte do projeto
+	armethyst.
+    
+	armethyst - Um simulador ARM simples escrito em C++ para o ensino de
+    Arquitetura de Computadores. Software livre licenciado pela MIT License
+    (veja a licença, em inglês, abaixo).
+
+    (EN) MIT LICENSE:
+
+    Copyright 2020 André Vital Saúde
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+   ----------------------------------------------------------------------------
+*/
+
+#include "config.h"
+#include "Profiler.h"
+#include "ElfLoader.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+
+using namespace std;
+
+static string trim(const string &text)
+{
+	size_t begin = text.find_first_not_of(" \t\r");
+	if (begin == string::npos) {
+		return "";
+	}
+	size_t end = text.find_last_not_of(" \t\r");
+	return text.substr(begin, end - begin + 1);
+}
+
+static bool isLabel(const string &text)
+{
+	if (text.empty()) {
+		return false;
+	}
+	for (char c : text) {
+		if (!isalnum((unsigned char)c) && c != '_' && c != '.' && c != '$') {
+			return false;
+		}
+	}
+	return true;
+}
+
+Profiler::Profiler(ElfLoader &loader)
+{
+	program = loader.getFilename();
+	textBase = loader.getTextBase();
+	size = loader.getTextSize() >> 2;
+	delta.assign(size + 1, 0);
+	backTaken.assign(size, 0);
+	backTarget.assign(size, 0);
+
+	// rótulos globais de fontes assembly nem sempre têm tipo função
+	for (const ElfLoader::Symbol &symbol : loader.getSymbols()) {
+		if (symbol.function || symbol.address - textBase < (size << 2)) {
+			functions.push_back({symbol.name, symbol.address, symbol.size});
+		}
+	}
+	sort(functions.begin(), functions.end(),
+		[](const Symbol &a, const Symbol &b) { return a.address < b.address; });
+
+	// fonte de mesmo nome: isummation.o -> isummation.S
+	string base = program;
+	size_t dot = base.rfind('.');
+	if (dot != string::npos && base.find('/', dot) == string::npos) {
+		base = base.substr(0, dot);
+	}
+	if (!loadSource(base + ".S")) {
+		loadSource(base + ".s");
+	}
+}
+
+void Profiler::merge(const Profiler &other)
+{
+	for (uint64_t i = 0; i < size; i++) {
+		delta[i] += other.delta[i];
+		backTaken[i] += other.backTaken[i];
+		if (other.backTaken[i]) {
+			backTarget[i] = other.backTarget[i];
+		}
+	}
+	delta[size] += other.delta[size];
+}
+
+bool Profiler::loadSource(string filename)
+{
+	ifstream in(filename);
+	if (!in) {
+		return false;
+	}
+	source = filename.substr(filename.rfind('/') + 1);
+	sourceLine.assign(size, 0);
+
+	bool text = false;
+	bool known = false;		// endereço conhecido (após um rótulo de função)
+	uint64_t address = 0;
+	string line;
+	int number = 0;
+	while (getline(in, line)) {
+		number++;
+		sourceLines.push_back(line);
+
+		string s = line;
+		size_t comment = s.find("//");
+		if (comment != string::npos) {
+			s = s.substr(0, comment);
+		}
+		s = trim(s);
+
+		// rótulos, possivelmente seguidos de uma instrução
+		size_t colon;
+		while ((colon = s.find(':')) != string::npos && isLabel(s.substr(0, colon))) {
+			string label = s.substr(0, colon);
+			for (const Symbol &function : functions) {
+				if (text && function.name == label) {
+					address = function.address;
+					known = true;
+				}
+			}
+			s = trim(s.substr(colon + 1));
+		}
+		if (s.empty()) {
+			continue;
+		}
+
+		if (s[0] == '.') {
+			istringstream directive(s);
+			string name, argument;
+			directive >> name >> argument;
+			if (name == ".text") {
+				text = true;
+			} else if (name == ".data" || name == ".bss" || name == ".rodata") {
+				text = false;
+			} else if (name == ".section") {
+				text = argument.compare(0, 5, ".text") == 0;
+			} else if (text && known && (name == ".align" || name == ".p2align")) {
+				uint64_t alignment = (uint64_t)1 << atoi(argument.c_str());
+				address = (address + alignment - 1) & ~(alignment - 1);
+			} else if (text && known && (name == ".word" || name == ".inst" || name == ".4byte")) {
+				address += 4 * (std::count(s.begin(), s.end(), ',') + 1);
+			}
+			continue;
+		}
+
+		if (text && known) {
+			uint64_t index = (address - textBase) >> 2;
+			if (index < size) {
+				sourceLine[index] = number;
+			}
+			address += 4;
+		}
+	}
+	return true;
+}
+
+string Profiler::symbolize(uint64_t address)
+{
+	ostringstream out;
+	auto next = upper_bound(functions.begin(), functions.end(), address,
+		[](uint64_t a, const Symbol &symbol) { return a < symbol.address; });
+	if (next != functions.begin()) {
+		const Symbol &function = *(next - 1);
+		if (!function.size || address < function.address + function.size) {
+			out << function.name;
+			if (address != function.address) {
+				out << "+0x" << hex << address - function.address;
+			}
+			return out.str();
+		}
+	}
+	out << "0x" << hex << address;
+	return out.str();
+}
+
+string Profiler::sourceAt(uint64_t address)
+{
+	uint64_t index = (address - textBase) >> 2;
+	if (index >= sourceLine.size() || !sourceLine[index]) {
+		return "";
+	}
+	return source + ":" + to_string(sourceLine[index]);
+}
+
+/**
+ * Blocos são as sequências máximas de instruções consecutivas com a
+ * mesma contagem; laços são os desvios tomados para trás, do destino
+ * (cabeçalho) até o desvio, com as entradas estimadas pelas vezes em
+ * que o desvio não foi tomado.
+ */
+void Profiler::report(string filename)
+{
+	vector<uint64_t> counts(size);
+	int64_t running = 0;
+	uint64_t total = 0;
+	for (uint64_t i = 0; i < size; i++) {
+		running += delta[i];
+		counts[i] = running;
+		total += counts[i];
+	}
+
+	ofstream out(filename);
+	if (!out) {
+		cout << "Profile: unable to write " << filename << endl;
+		return;
+	}
+	out << fixed << setprecision(2);
+	auto percent = [total](uint64_t value) { return total ? 100.0 * value / total : 0.0; };
+	auto address = [this](uint64_t index) { return textBase + (index << 2); };
+	auto range = [this](uint64_t first, uint64_t last) {
+		string text = symbolize(first) + " - " + symbolize(last);
+		string from = sourceAt(first), to = sourceAt(last);
+		if (!from.empty() && !to.empty()) {
+			text += "  " + from + "-" + to.substr(to.rfind(':') + 1);
+		}
+		return text;
+	};
+
+	out << "Profile of " << program << ": " << total << " instructions" << endl;
+
+	// funções
+	vector<pair<uint64_t, string>> perFunction;
+	{
+		vector<uint64_t> sums(functions.size() + 1, 0);
+		for (uint64_t i = 0; i < size; i++) {
+			if (!counts[i]) continue;
+			uint64_t pc = address(i);
+			auto next = upper_bound(functions.begin(), functions.end(), pc,
+				[](uint64_t a, const Symbol &symbol) { return a < symbol.address; });
+			size_t f = next - functions.begin();
+			if (f && (!functions[f - 1].size
+					|| pc < functions[f - 1].address + functions[f - 1].size)) {
+				sums[f - 1] += counts[i];
+			} else {
+				sums[functions.size()] += counts[i];
+			}
+		}
+		for (size_t f = 0; f <= functions.size(); f++) {
+			if (sums[f]) {
+				perFunction.push_back({sums[f], f < functions.size() ? functions[f].name : "(no symbol)"});
+			}
+		}
+		sort(perFunction.rbegin(), perFunction.rend());
+	}
+	out << endl << "Functions:" << endl;
+	out << setw(12) << "count" << setw(9) << "%" << "  function" << endl;
+	for (size_t i = 0; i < perFunction.size() && i < PROFILE_TOP; i++) {
+		out << setw(12) << perFunction[i].first << setw(9) << percent(perFunction[i].first)
+				<< "  " << perFunction[i].second << endl;
+	}
+
+	// blocos
+	struct Block { uint64_t first, last, count; };
+	vector<Block> blocks;
+	for (uint64_t i = 0; i < size; i++) {
+		if (!counts[i]) continue;
+		if (!blocks.empty() && blocks.back().last == i - 1 && blocks.back().count == counts[i]) {
+			blocks.back().last = i;
+		} else {
+			blocks.push_back({i, i, counts[i]});
+		}
+	}
+	sort(blocks.begin(), blocks.end(), [](const Block &a, const Block &b) {
+		return a.count * (a.last - a.first + 1) > b.count * (b.last - b.first + 1);
+	});
+	out << endl << "Hot blocks:" << endl;
+	out << setw(12) << "count" << setw(7) << "instr" << setw(9) << "%" << "  block" << endl;
+	for (size_t i = 0; i < blocks.size() && i < PROFILE_TOP; i++) {
+		uint64_t length = blocks[i].last - blocks[i].first + 1;
+		out << setw(12) << blocks[i].count << setw(7) << length
+				<< setw(9) << percent(blocks[i].count * length)
+				<< "  " << range(address(blocks[i].first), address(blocks[i].last)) << endl;
+	}
+
+	// laços
+	struct Loop { uint64_t header, latch, taken, entries, instructions; };
+	vector<Loop> loops;
+	for (uint64_t i = 0; i < size; i++) {
+		if (!backTaken[i]) continue;
+		Loop loop = {(backTarget[i] - textBase) >> 2, i, backTaken[i],
+						counts[i] > backTaken[i] ? counts[i] - backTaken[i] : 0, 0};
+		for (uint64_t j = loop.header; j <= i; j++) {
+			loop.instructions += counts[j];
+		}
+		loops.push_back(loop);
+	}
+	sort(loops.begin(), loops.end(), [](const Loop &a, const Loop &b) {
+		return a.instructions > b.instructions;
+	});
+	out << endl << "Loops:" << endl;
+	out << setw(12) << "back edges" << setw(9) << "entries" << setw(11) << "trips"
+			<< setw(9) << "%" << "  loop" << endl;
+	for (size_t i = 0; i < loops.size() && i < PROFILE_TOP; i++) {
+		out << setw(12) << loops[i].taken << setw(9) << loops[i].entries;
+		// execuções do cabeçalho por entrada
+		if (loops[i].entries) {
+			out << setw(11) << (double)counts[loops[i].header] / loops[i].entries;
+		} else {
+			out << setw(11) << "-";
+		}
+		out << setw(9) << percent(loops[i].instructions)
+				<< "  " << range(address(loops[i].header), address(loops[i].latch)) << endl;
+	}
+
+	// instruções
+	vector<uint64_t> hottest;
+	for (uint64_t i = 0; i < size; i++) {
+		if (counts[i]) hottest.push_back(i);
+	}
+	stable_sort(hottest.begin(), hottest.end(),
+		[&counts](uint64_t a, uint64_t b) { return counts[a] > counts[b]; });
+	out << endl << "Instructions:" << endl;
+	out << setw(12) << "count" << setw(9) << "%" << "  address" << endl;
+	for (size_t i = 0; i < hottest.size() && i < PROFILE_TOP; i++) {
+		uint64_t index = hottest[i];
+		out << setw(12) << counts[index] << setw(9) << percent(counts[index]) << "  ";
+		string where = sourceAt(address(index));
+		if (where.empty()) {
+			out << symbolize(address(index));
+		} else {
+			out << left << setw(20) << symbolize(address(index)) << "  "
+					<< setw(18) << where << right
+					<< trim(sourceLines[sourceLine[index] - 1]);
+		}
+		out << endl;
+	}
+
+	cout << "Profile: " << total << " instructions, report in " << filename << endl;
+}
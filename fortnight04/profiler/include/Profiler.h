@@ -0,0 +1,154 @@
+/* ----------------------------------------------------------------------------
+
+    (EN) Profiler - Guest program hot-spot profiler. Part of armethyst project.
+		
+	armethyst - A simple ARM Simulator written in C++ for Computer Architecture
+    teaching purposes. Free software licensed under the MIT License (see license
+    below).
+
+    (PT) Profiler - Perfil de execução do programa simulado. Parte do projeto
+	armethyst.
+    
+	armethyst - Um simulador ARM simples escrito em C++ para o ensino de
+    Arquitetura de Computadores. Software livre licenciado pela MIT License
+    (veja a licença, em inglês, abaixo).
+
+    (EN) MIT LICENSE:
+
+    Copyright 2020 André Vital Saúde
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+   ----------------------------------------------------------------------------
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+class ElfLoader;
+
+/**
+ * Profiler
+ *
+ * Conta as instruções executadas por endereço do texto do programa, em
+ * um vetor indexado por (PC - textBase) >> 2, e os desvios tomados para
+ * trás (laços), e escreve um relatório com os endereços simbolizados
+ * pelos símbolos do ELF (ex.: main+0x28) e, se houver, pelas linhas do
+ * fonte assembly (ver loadSource).
+ *
+ * As CPUs informam blocos de instruções executadas (count) e desvios
+ * diretos tomados (backEdge) ao Profiler ligado por CPU::setProfiler; o custo é
+ * de poucas operações por bloco ou instrução, e endereços fora do texto
+ * são ignorados.
+ */
+class Profiler
+{
+	public:
+		/**
+		 * Perfil do texto do programa carregado por loader, com os seus
+		 * símbolos e o fonte .S (ou .s) de mesmo nome, se existir.
+		 */
+		Profiler(ElfLoader &loader);
+
+		/**
+		 * As instruções [pc, pc + 4 * instructions) foram executadas
+		 * times vezes (negativo desfaz contagens).
+		 */
+		void count(uint64_t pc, uint64_t instructions, int64_t times)
+		{
+			uint64_t index = (pc - textBase) >> 2;
+			if (index >= size) return;
+			uint64_t end = index + instructions;
+			delta[index] += times;
+			delta[end < size ? end : size] -= times;
+		}
+
+		/**
+		 * Desvio tomado de pc para target; laço se target <= pc, no texto.
+		 */
+		void backEdge(uint64_t pc, uint64_t target)
+		{
+			uint64_t index = (pc - textBase) >> 2;
+			if (target > pc || target < textBase || index >= size) return;
+			backTaken[index]++;
+			backTarget[index] = target;
+		}
+
+		/**
+		 * Acrescenta as contagens de other, do mesmo programa (ex.: de
+		 * outro núcleo).
+		 */
+		void merge(const Profiler &other);
+
+		/**
+		 * Escreve o relatório em filename: total de instruções, funções,
+		 * blocos, laços e instruções mais executados (PROFILE_TOP de
+		 * cada).
+		 */
+		void report(std::string filename);
+
+	private:
+		struct Symbol {
+			std::string name;
+			uint64_t address;
+			uint64_t size;
+		};
+
+		std::string program;
+		uint64_t textBase;
+		uint64_t size;						// instruções no texto
+
+		// diferenças entre contagens consecutivas (delta[i] =
+		// contagem[i] - contagem[i - 1]): um bloco custa duas escritas
+		std::vector<int64_t> delta;
+
+		// desvios tomados para trás, por endereço do desvio
+		std::vector<uint64_t> backTaken;
+		std::vector<uint64_t> backTarget;
+
+		// funções e demais símbolos do texto, em ordem de endereço
+		std::vector<Symbol> functions;
+
+		// fonte assembly: arquivo, linhas e linha de cada instrução
+		// (0 se desconhecida)
+		std::string source;
+		std::vector<std::string> sourceLines;
+		std::vector<int> sourceLine;
+
+		/**
+		 * Lê o fonte assembly filename, associando cada instrução de
+		 * uma seção de texto a um endereço a partir do rótulo de função
+		 * anterior (diretivas .text/.section, .align e .word/.inst são
+		 * consideradas). Retorna false se o arquivo não existe.
+		 */
+		bool loadSource(std::string filename);
+
+		/**
+		 * "função+0xdeslocamento" ou o endereço, se fora de funções.
+		 */
+		std::string symbolize(uint64_t address);
+
+		/**
+		 * "arquivo:linha", ou vazio se desconhecido.
+		 */
+		std::string sourceAt(uint64_t address);
+};
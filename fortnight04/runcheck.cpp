@@ -0,0 +1,85 @@
+/* ----------------------------------------------------------------------------
+
+    (EN) armethyst - A simple ARM Simulator written in C++ for Computer Architecture
+    teaching purposes. Free software licensed under the MIT License (see license
+    below).
+
+    (PT) armethyst - Um simulador ARM simples escrito em C++ para o ensino de
+    Arquitetura de Computadores. Software livre licenciado pela MIT License
+    (veja a licença, em inglês, abaixo).
+
+    (EN) MIT LICENSE:
+
+    Copyright 2020 André Vital Saúde
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+   ----------------------------------------------------------------------------
+*/
+
+#include "Check.h"
+#include "FastCPUCheck.h"
+#include "JITCPUCheck.h"
+#include "SparseMemoryCheck.h"
+#include "ElfLoaderCheck.h"
+#include "CheckpointCheck.h"
+#include "CachedMemoryCheck.h"
+#include "BranchPredictorCheck.h"
+#include "PipelinedCPUCheck.h"
+#include "AssemblerCheck.h"
+#include "FusionCheck.h"
+#include "SimdCheck.h"
+#include "ForkCheck.h"
+#include "IncrementalCheck.h"
+#include "TLBCheck.h"
+#include "FaultCheck.h"
+#include "FlagsCheck.h"
+#include "MultiCoreCheck.h"
+
+#include <iostream>
+
+using namespace std;
+
+/**
+ * Verificações de comportamento das implementações de CPU e de memória
+ * (ver test/include/Check.h). Encerra com erro na primeira que falhar.
+ */
+int main()
+{
+	checkFastCPU();
+	checkJITCPU();
+	checkSparseMemory();
+	checkElfLoader();
+	checkCheckpoint();
+	checkCachedMemory();
+	checkBranchPredictor();
+	checkPipelinedCPU();
+	checkAssembler();
+	checkFusion();
+	checkSimd();
+	checkFork();
+	checkIncrementalCheckpoint();
+	checkTLB();
+	checkFaults();
+	checkFlags();
+	checkMultiCore();
+
+	cout << "All checks passed." << endl;
+	return 0;
+}
@@ -38,6 +38,7 @@
 
 #include "BasicMemoryTest.h"
 #include "BasicCPUTest.h"
+#include "ElfLoader.h"
 
 #include <iostream>
 #include <iomanip>
@@ -103,7 +104,13 @@ void loadBinary (BasicMemoryTest* memory, string fname)
 {
 	// load executable binary
 	memory->loadBinary(fname);
-	memory->relocateManual();
+
+	// place sections and apply relocations
+	ElfLoader loader(memory);
+	loader.load(fname);
+
+	// as relocações não contam como acesso a dados da instrução testada
+	memory->resetLastDataMemAccess();
 	
 	// create human readable representation of the binary file
 	memory->writeBinaryAsText(fname);
@@ -968,7 +975,7 @@ void test(bool fpOp,
 	cout << "Starting processor..." << endl;
 	cout << "	PC: 0x" << startAddress << endl;
 	cout << "	SP: 0x" << startSP << endl;
-	cpu->run(startAddress);
+	cpu->setPC(startAddress);
 	cpu->setSP(startSP);
 	cout << "processor started!." << endl << endl;
 
@@ -0,0 +1,287 @@
+/* ----------------------------------------------------------------------------
+
+    (EN) armethyst - A simple ARM Simulator written in C++ for Computer Architecture
+    teaching purposes. Free software licensed under the MIT License (see license
+    below).
+
+    (PT) armethyst - Um simulador ARM simples escrito em C++ para o ensino de
+    Arquitetura de Computadores. Software livre licenciado pela MIT License
+    (veja a licença, em inglês, abaixo).
+
+    (EN) MIT LICENSE:
+
+    Copyright 2020 André Vital Saúde
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+   ----------------------------------------------------------------------------
+*/
+
+#include "Check.h"
+#include "Assembler.h"
+#include "BasicMemory.h"
+#include "SparseMemory.h"
+#include "BasicCPU.h"
+#include "FastCPU.h"
+#include "JITCPU.h"
+#include "PipelinedCPU.h"
+
+#include <cstring>
+
+using namespace std;
+
+void beginCheck(string name)
+{
+	cout << "#\n# Checking " << name << "...\n#" << endl;
+}
+
+void endCheck(string name)
+{
+	cout << name << " SUCCESS!" << endl << endl;
+}
+
+Memory *createMemory(int memImpl)
+{
+	if (memImpl == MEM_IMPL_SPARSE) {
+		return new SparseMemory();
+	}
+	return new BasicMemory(MEMORY_SIZE);
+}
+
+string memoryName(int memImpl)
+{
+	return memImpl == MEM_IMPL_SPARSE ? "SparseMemory" : "BasicMemory";
+}
+
+CPU *createCPU(int cpuImpl, Memory *memory)
+{
+	switch (cpuImpl) {
+		case CPU_IMPL_FAST:
+			return new FastCPU(memory);
+		case CPU_IMPL_JIT:
+			return new JITCPU(memory);
+		case CPU_IMPL_PIPELINED:
+			return new PipelinedCPU(memory);
+		default:
+			return new BasicCPU(memory);
+	}
+}
+
+string cpuName(int cpuImpl)
+{
+	switch (cpuImpl) {
+		case CPU_IMPL_FAST:
+			return "FastCPU";
+		case CPU_IMPL_JIT:
+			return "JITCPU";
+		case CPU_IMPL_PIPELINED:
+			return "PipelinedCPU";
+		default:
+			return "BasicCPU";
+	}
+}
+
+/**
+ * Registradores de entrada: x0 = v, x5 = result, x9 = n, w6 = 1,
+ * w10 = 4, x12 = 0, s1 = 1.5 e s2 = 0.25.
+ */
+CheckProgram assembleCheckProgram(Memory *memory, uint64_t n)
+{
+	Assembler as(memory);
+	Assembler::Label fill, fillTest, loop, skip, test, end, result, v;
+	CheckProgram program;
+	program.entry = as.here();
+	program.n = n;
+
+	// v[i] = i, com o endereço de v[i] em w7
+	as.add(W(7), W(0), W(12));
+	as.add(W(8), W(9), W(12));
+	as.add(W(2), W(12), W(12));
+	as.b(fillTest);
+	as.bind(fill);
+	as.str(W(2), X(7));
+	as.add(W(2), W(2), W(6));
+	as.add(W(7), W(7), W(10));
+	as.sub(X(8), X(8), 1);
+	as.bind(fillTest);
+	as.cmp(W(8), 0);
+	as.b(Assembler::NE, fill);
+
+	// soma em w3, soma de v[i], i % 3 == 2, em w13 e contador em w4
+	as.add(W(2), W(12), W(12));
+	as.add(W(3), W(12), W(12));
+	as.add(W(4), W(12), W(12));
+	as.add(W(13), W(12), W(12));
+	as.add(W(8), W(9), W(12));
+	as.b(test);
+	as.bind(loop);
+	as.ldr(W(1), X(0), X(2), true);
+	as.add(W(3), W(3), W(1));
+	as.fadd(S(0), S(0), S(1));
+	as.fsub(S(3), S(3), S(2));
+	as.add(W(4), W(4), W(6));
+	as.cmp(W(4), 3);
+	as.b(Assembler::NE, skip);
+	as.add(W(4), W(12), W(12));
+	as.add(W(13), W(13), W(1));
+	as.bind(skip);
+	as.add(W(2), W(2), W(6));
+	as.sub(X(8), X(8), 1);
+	as.bind(test);
+	as.cmp(W(8), 0);
+	as.b(Assembler::NE, loop);
+
+	// a palavra seguinte à relida fica nula: a BasicCPU lê 64 bits em
+	// LDRSW (ver runtest)
+	as.str(W(3), X(5));
+	as.str(W(13), X(5), 8);
+	as.ldrsw(X(14), X(5));
+	as.str(W(14), X(5), 12);
+	as.bind(end);
+	as.ret();
+
+	// dados em outra página que o código
+	as.align(HOST_PAGE_SIZE);
+	as.bind(result);
+	as.reserve(16);
+	as.bind(v);
+	as.reserve(n * 4);
+	as.finish();
+
+	program.result = result.getAddress();
+	program.v = v.getAddress();
+	program.loop = loop.getAddress();
+	program.end = end.getAddress();
+	return program;
+}
+
+void startCheckProgram(CPU *cpu, const CheckProgram &program)
+{
+	cpu->start(program.entry);
+
+	CPUState state;
+	cpu->getState(state);
+	memset(state.R, 0, 30 * sizeof(state.R[0]));
+	memset(state.V, 0, sizeof(state.V));
+	state.R[0] = program.v;
+	state.R[5] = program.result;
+	state.R[6] = 1;
+	state.R[9] = program.n;
+	state.R[10] = 4;
+	float one = 1.5f, quarter = 0.25f;
+	uint32_t bits;
+	memcpy(&bits, &one, 4);
+	state.V[1][0] = bits;
+	memcpy(&bits, &quarter, 4);
+	state.V[2][0] = bits;
+	state.SP = MEMORY_SIZE;
+	state.NZCV = 0;
+	cpu->setState(state);
+}
+
+uint32_t checkProgramSum(uint64_t n)
+{
+	return (uint32_t)(n * (n - 1) / 2);
+}
+
+uint32_t checkProgramThirds(uint64_t n)
+{
+	uint32_t sum = 0;
+	for (uint64_t i = 2; i < n; i += 3) {
+		sum += (uint32_t)i;
+	}
+	return sum;
+}
+
+bool sameState(const CPUState &a, const CPUState &b)
+{
+	for (int i = 0; i < 32; i++) {
+		if (a.V[i][0] != b.V[i][0]) {
+			return false;
+		}
+	}
+	return memcmp(a.R, b.R, sizeof(a.R)) == 0 && a.SP == b.SP && a.PC == b.PC
+			&& a.NZCV == b.NZCV && a.error == b.error && a.finished == b.finished;
+}
+
+void printStateDiff(const CPUState &ref, const CPUState &cpu)
+{
+	cout << hex;
+	for (int i = 0; i < 31; i++) {
+		if (ref.R[i] != cpu.R[i]) {
+			cout << "	X" << dec << i << hex << "=0x" << cpu.R[i]
+					<< ";  Expected X" << dec << i << hex << "=0x" << ref.R[i] << endl;
+		}
+	}
+	for (int i = 0; i < 32; i++) {
+		if (ref.V[i][0] != cpu.V[i][0]) {
+			cout << "	D" << dec << i << hex << "=0x" << cpu.V[i][0]
+					<< ";  Expected D" << dec << i << hex << "=0x" << ref.V[i][0] << endl;
+		}
+	}
+	cout << "	SP=0x" << cpu.SP << ";  Expected SP=0x" << ref.SP << endl;
+	cout << "	PC=0x" << cpu.PC << ";  Expected PC=0x" << ref.PC << endl;
+	cout << "	NZCV=0x" << cpu.NZCV << ";  Expected NZCV=0x" << ref.NZCV << endl;
+	cout << "	error=" << cpu.error << " finished=" << cpu.finished
+			<< ";  Expected error=" << ref.error << " finished=" << ref.finished << endl;
+	cout << dec;
+}
+
+uint64_t checkSlices(CPU *ref, CPU *cpu, const uint64_t *slices, int count,
+						uint64_t maxInstructions)
+{
+	CPUState refState, cpuState;
+	uint64_t total = 0;
+	for (int i = 0; total < maxInstructions; i++) {
+		uint64_t slice = min(slices[i % count], maxInstructions - total);
+		CPU::RunResult result = cpu->runFor(slice);
+		CPU::RunResult expected = ref->runFor(result.retired);
+		total += result.retired;
+
+		ref->getState(refState);
+		cpu->getState(cpuState);
+		if (!sameState(refState, cpuState)) {
+			cout << "	after runFor(" << slice << "), " << total << " instructions:" << endl;
+			printStateDiff(refState, cpuState);
+		}
+		CHECK(sameState(refState, cpuState));
+		CHECK(expected.retired == result.retired);
+		CHECK(result.PC == cpuState.PC);
+
+		if (result.reason != CPU::EXIT_LIMIT) {
+			CHECK(result.reason == CPU::EXIT_FINISHED);
+			break;
+		}
+		CHECK(result.retired == slice);
+	}
+	return total;
+}
+
+void checkSameMemory(Memory *ref, Memory *memory, uint64_t address, uint64_t size)
+{
+	for (uint64_t offset = 0; offset < size; offset += 4) {
+		uint32_t expected = ref->readData32(address + offset);
+		uint32_t value = memory->readData32(address + offset);
+		if (value != expected) {
+			cout << hex << "	[0x" << address + offset << "]=0x" << value
+					<< ";  Expected 0x" << expected << dec << endl;
+		}
+		CHECK(value == expected);
+	}
+}
@@ -0,0 +1,194 @@
+/* ----------------------------------------------------------------------------
+
+    (EN) armethyst - A simple ARM Simulator written in C++ for Computer Architecture
+    teaching purposes. Free software licensed under the MIT License (see license
+    below).
+
+    (PT) armethyst - Um simulador ARM simples escrito em C++ para o ensino de
+    Arquitetura de Computadores. Software livre licenciado pela MIT License
+    (veja a licença, em inglês, abaixo).
+
+    (EN) MIT LICENSE:
+
+    Copyright 2020 André Vital Saúde
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+   ----------------------------------------------------------------------------
+*/
+
+#pragma once
+
+#include "config.h"
+#include "CPU.h"
+#include "Memory.h"
+#include "Processor.h"
+#include "Checkpoint.h"
+
+#include <iostream>
+#include <string>
+#include <cstdlib>
+
+/**
+ * Verificações de comportamento (runcheck)
+ *
+ * Diferente de runtest, que testa os estágios da BasicCPU instrução a
+ * instrução, runcheck executa programas inteiros em todas as
+ * implementações de CPU e de memória, ligadas no mesmo executável, e
+ * compara os resultados entre elas. Cada módulo tem as suas verificações
+ * no seu diretório test (ex.: cpu/fastcpu/test/FastCPUCheck.cpp).
+ *
+ * Uma verificação que falha escreve a condição e encerra, como os testes
+ * de runtest.
+ */
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			std::cout << __FILE__ << ":" << __LINE__ << ": '" << #condition \
+						<< "' FAILED!" << std::endl; \
+			std::cout << "Exit..." << std::endl; \
+			exit(1); \
+		} \
+	} while (0)
+
+/**
+ * Início e fim de cada verificação, como em runtest.
+ */
+void beginCheck(std::string name);
+void endCheck(std::string name);
+
+/**
+ * Memória de uma implementação (MEM_IMPL_BASIC ou MEM_IMPL_SPARSE), sem
+ * caches.
+ */
+Memory *createMemory(int memImpl);
+std::string memoryName(int memImpl);
+
+/**
+ * CPU de uma implementação (CPU_IMPL_BASIC, ...), sem modelos de
+ * previsão de desvios.
+ */
+CPU *createCPU(int cpuImpl, Memory *memory);
+std::string cpuName(int cpuImpl);
+
+/**
+ * Processador de um núcleo, como o BasicProcessor, sobre uma CPU de
+ * qualquer implementação (sem a Factory), para verificar save,
+ * saveIncremental, restore e fork. A CPU é do processador.
+ */
+class CheckProcessor : public Processor
+{
+	public:
+		CheckProcessor(int cpuImpl, Memory *memory) : cpuImpl(cpuImpl)
+		{
+			this->memory = memory;
+			cpu = createCPU(cpuImpl, memory);
+		}
+
+		~CheckProcessor()
+		{
+			delete cpu;
+		}
+
+		int run(uint64_t startAddress)
+		{
+			return cpu->run(startAddress);
+		}
+
+		Processor *fork()
+		{
+			CheckProcessor *child = new CheckProcessor(cpuImpl, memory->fork());
+			CPUState state;
+			cpu->getState(state);
+			child->cpu->setState(state);
+			child->lastCheckpoint = lastCheckpoint;
+			return child;
+		}
+
+	private:
+		int cpuImpl;
+};
+
+/**
+ * Programa de verificação, montado pelo Assembler apenas com instruções
+ * que a BasicCPU decodifica, para comparar qualquer CPU com ela:
+ *
+ *	- preenche v[i] = i, i < n;
+ *	- soma v, com um desvio que depende do índice a cada 3 elementos;
+ *	- acumula em ponto flutuante (FADD e FSUB) a cada elemento;
+ *	- escreve as somas em result e as relê (LDRSW).
+ *
+ * Tem os pares que a FastCPU funde (CMP + B.cond, LDR + ADD) e laços
+ * que chegam a JIT_THRESHOLD com n grande. Usa apenas a memória de
+ * STARTADDRESS até CHECK_PROGRAM_END(n).
+ */
+struct CheckProgram {
+	uint64_t entry;
+	uint64_t result;	// somas: inteira, 0, a dos i % 3 == 2 e a relida
+	uint64_t v;			// n palavras de 32 bits
+	uint64_t n;
+	uint64_t loop;		// início do laço de soma
+	uint64_t end;		// endereço do RET final
+};
+#define CHECK_PROGRAM_END(n) (STARTADDRESS + 2 * HOST_PAGE_SIZE + 4 * (n))
+
+/**
+ * Monta o programa de verificação em memory.
+ */
+CheckProgram assembleCheckProgram(Memory *memory, uint64_t n);
+
+/**
+ * Prepara cpu para executar program: start e registradores de entrada.
+ */
+void startCheckProgram(CPU *cpu, const CheckProgram &program);
+
+/**
+ * Resultados do programa de verificação, a partir de v.
+ */
+uint32_t checkProgramSum(uint64_t n);
+uint32_t checkProgramThirds(uint64_t n);
+
+/**
+ * Estados iguais: registradores inteiros, SP, PC, os 64 bits inferiores
+ * dos registradores V (os modelados pela BasicCPU), NZCV, erro e fim do
+ * processo.
+ */
+bool sameState(const CPUState &a, const CPUState &b);
+
+/**
+ * Escreve as diferenças entre os estados da referência (ref) e da CPU
+ * verificada (cpu).
+ */
+void printStateDiff(const CPUState &ref, const CPUState &cpu);
+
+/**
+ * Executa cpu em fatias de runFor, com os tamanhos slices[0..count-1]
+ * em ciclo, e ref, a cada fatia, pelo mesmo número de instruções.
+ * Verifica, após cada fatia, que os estados são iguais, até o fim do
+ * programa ou maxInstructions instruções. Retorna o total de
+ * instruções executadas.
+ */
+uint64_t checkSlices(CPU *ref, CPU *cpu, const uint64_t *slices, int count,
+						uint64_t maxInstructions);
+
+/**
+ * Verifica que size bytes a partir de address são iguais nas duas
+ * memórias.
+ */
+void checkSameMemory(Memory *ref, Memory *memory, uint64_t address, uint64_t size);
@@ -0,0 +1,176 @@
+/* ----------------------------------------------------------------------------
+
+    (EN) MemoryTrace - binary memory access trace with a background writer
+		
+	armethyst - A simple ARM Simulator written in C++ for Computer Architecture
+    teaching purposes. Free software licensed under the MIT License (see license
+    below).
+
+    (PT) MemoryTrace - registro binário de acessos à memória, com escrita em segundo
+		  plano
+    
+	armethyst - Um simulador ARM simples escrito em C++ para o ensino de
+    Arquitetura de Computadores. Software livre licenciado pela MIT License
+    (veja a licença, em inglês, abaixo).
+
+    (EN) MIT LICENSE:
+
+    Copyright 2020 André Vital Saúde
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+   ----------------------------------------------------------------------------
+*/
+
+#include "MemoryTrace.h"
+
+#include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include <chrono>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+
+set<MemoryTrace *> MemoryTrace::openTraces;
+mutex MemoryTrace::openTracesMutex;
+
+MemoryTrace::MemoryTrace(string filename, bool values)
+{
+	this->filename = filename;
+	this->values = values;
+	buffer = new uint64_t[TRACE_BUFFER_WORDS];
+	head = 0;
+	tail = 0;
+	cachedTail = 0;
+	stopping = false;
+
+	fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		cout << "Unable to open file " << filename << endl;
+		cout << "Aborting... " << endl;
+		exit(1);
+	}
+
+	TraceHeader header;
+	memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+	header.version = TRACE_VERSION;
+	header.flags = values ? TRACE_FLAG_VALUES : 0;
+	writeAll(&header, sizeof(header));
+
+	writer = thread(&MemoryTrace::writerLoop, this);
+
+	lock_guard<mutex> lock(openTracesMutex);
+	static bool registered = false;
+	if (!registered) {
+		atexit(finishAll);
+		registered = true;
+	}
+	openTraces.insert(this);
+}
+
+MemoryTrace::~MemoryTrace()
+{
+	finish();
+	delete[] buffer;
+}
+
+void MemoryTrace::finish()
+{
+	{
+		lock_guard<mutex> lock(openTracesMutex);
+		if (openTraces.erase(this) == 0) {
+			return;
+		}
+	}
+	stopping.store(true, memory_order_release);
+	if (writer.get_id() == this_thread::get_id()) {
+		// exit() chamado pela própria thread de escrita (erro de escrita)
+		writer.detach();
+	} else {
+		writer.join();
+	}
+	close(fd);
+}
+
+void MemoryTrace::finishAll()
+{
+	set<MemoryTrace *> traces;
+	{
+		lock_guard<mutex> lock(openTracesMutex);
+		traces = openTraces;
+	}
+	for (MemoryTrace *trace : traces) {
+		trace->finish();
+	}
+}
+
+void MemoryTrace::waitSpace(uint64_t head)
+{
+	cachedTail = tail.load(memory_order_acquire);
+	while (head - cachedTail > TRACE_BUFFER_WORDS) {
+		this_thread::yield();
+		cachedTail = tail.load(memory_order_acquire);
+	}
+}
+
+/**
+ * A thread espera acumular TRACE_FLUSH_WORDS palavras e escreve o trecho
+ * contínuo disponível do buffer (até o fim do buffer, se der a volta)
+ * em uma única chamada. No fechamento, escreve o que restou.
+ */
+void MemoryTrace::writerLoop()
+{
+	while (true) {
+		bool stop = stopping.load(memory_order_acquire);
+		uint64_t h = head.load(memory_order_acquire);
+		uint64_t t = tail.load(memory_order_relaxed);
+		if (h == t && stop) {
+			break;
+		}
+		if (h - t < TRACE_FLUSH_WORDS && !stop) {
+			this_thread::sleep_for(chrono::milliseconds(1));
+			continue;
+		}
+
+		uint64_t begin = t & (TRACE_BUFFER_WORDS - 1);
+		uint64_t count = h - t;
+		if (count > TRACE_BUFFER_WORDS - begin) {
+			count = TRACE_BUFFER_WORDS - begin;
+		}
+		writeAll(&buffer[begin], count * sizeof(uint64_t));
+		tail.store(t + count, memory_order_release);
+	}
+}
+
+void MemoryTrace::writeAll(const void *bytes, uint64_t size)
+{
+	const char *p = (const char *)bytes;
+	while (size) {
+		ssize_t n = write(fd, p, size);
+		if (n <= 0) {
+			cout << "Unable to write file " << filename << endl;
+			cout << "Aborting... " << endl;
+			exit(1);
+		}
+		p += n;
+		size -= n;
+	}
+}
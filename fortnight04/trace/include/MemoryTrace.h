@@ -0,0 +1,182 @@
+/* ----------------------------------------------------------------------------
+
+    (EN) MemoryTrace - binary memory access trace with a background writer
+		
+	armethyst - A simple ARM Simulator written in C++ for Computer Architecture
+    teaching purposes. Free software licensed under the MIT License (see license
+    below).
+
+    (PT) MemoryTrace - registro binário de acessos à memória, com escrita em segundo
+		  plano
+    
+	armethyst - Um simulador ARM simples escrito em C++ para o ensino de
+    Arquitetura de Computadores. Software livre licenciado pela MIT License
+    (veja a licença, em inglês, abaixo).
+
+    (EN) MIT LICENSE:
+
+    Copyright 2020 André Vital Saúde
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+
+   ----------------------------------------------------------------------------
+*/
+
+#pragma once
+
+#include <string>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <set>
+#include <cstdint>
+
+// Palavras de 64 bits no buffer circular (potência de 2): 512 KiB
+#define TRACE_BUFFER_WORDS (1 << 16)
+
+// Mínimo de palavras acumuladas para uma escrita no arquivo, exceto no
+// fechamento
+#define TRACE_FLUSH_WORDS (1 << 13)
+
+// Identificação do arquivo de registro
+#define TRACE_MAGIC "ARMTRACE"
+#define TRACE_VERSION 1
+
+// Os registros guardam os valores acessados
+#define TRACE_FLAG_VALUES 1
+
+/**
+ * Cabeçalho do arquivo de registro. Segue-se uma sequência de registros,
+ * cada um com uma palavra de 64 bits (ver MemoryTrace::encode) e, se
+ * flags tem TRACE_FLAG_VALUES, uma segunda palavra com o valor lido ou
+ * escrito.
+ */
+struct TraceHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t flags;
+};
+
+/**
+ * MemoryTrace
+ *
+ * Registro binário dos acessos à memória. Cada acesso é gravado em um
+ * buffer circular com um único produtor (a CPU que acessa a memória) e
+ * um único consumidor (uma thread que esvazia o buffer no arquivo com
+ * write() de blocos grandes). Produtor e consumidor se comunicam apenas
+ * pelos índices head e tail, atômicos: não há locks no caminho da CPU,
+ * que só espera se o buffer estiver cheio.
+ *
+ * O arquivo pode ser convertido para o formato texto (uma linha
+ * "ri 0000000000000040" por acesso) com armethyst-trace.
+ */
+class MemoryTrace
+{
+	public:
+		enum RecordType {
+			TRACE_READ_INSTRUCTION,		// ri
+			TRACE_READ_DATA,			// rd
+			TRACE_WRITE_INSTRUCTION,	// wi
+			TRACE_WRITE_DATA,			// wd
+		};
+
+		/**
+		 * Abre filename e inicia a thread de escrita. Se values, cada
+		 * registro guarda também o valor acessado.
+		 */
+		MemoryTrace(std::string filename, bool values);
+
+		/**
+		 * Chama finish().
+		 */
+		~MemoryTrace();
+
+		/**
+		 * Esvazia o buffer, termina a thread de escrita e fecha o
+		 * arquivo. Chamado também por exit() para os registros ainda
+		 * abertos, pois o simulador costuma terminar sem destruir a
+		 * memória.
+		 */
+		void finish();
+
+		/**
+		 * Registra um acesso de size bytes (4 ou 8) em address.
+		 */
+		void record(RecordType type, unsigned size, uint64_t address, uint64_t value)
+		{
+			uint64_t h = head.load(std::memory_order_relaxed);
+			uint64_t words = values ? 2 : 1;
+			if (h + words - cachedTail > TRACE_BUFFER_WORDS) {
+				waitSpace(h + words);
+			}
+			buffer[h & (TRACE_BUFFER_WORDS - 1)] = encode(type, size, address);
+			if (values) {
+				buffer[(h + 1) & (TRACE_BUFFER_WORDS - 1)] = value;
+			}
+			head.store(h + words, std::memory_order_release);
+		}
+
+		/**
+		 * Palavra de um registro: endereço nos bits 0-55, tipo nos bits
+		 * 56-59 e log2 do tamanho nos bits 60-63.
+		 */
+		static uint64_t encode(RecordType type, unsigned size, uint64_t address)
+		{
+			uint64_t log2size = size == 8 ? 3 : size == 4 ? 2 : size == 2 ? 1 : 0;
+			return (address & 0x00FFFFFFFFFFFFFF) | ((uint64_t)type << 56) | (log2size << 60);
+		}
+
+		static RecordType recordType(uint64_t word) { return (RecordType)((word >> 56) & 0xF); }
+		static unsigned recordSize(uint64_t word) { return 1 << (word >> 60); }
+		static uint64_t recordAddress(uint64_t word) { return word & 0x00FFFFFFFFFFFFFF; }
+
+	private:
+		bool values;
+		int fd;
+		std::string filename;
+		uint64_t *buffer;
+
+		// índices crescentes (sem volta), em palavras, separados por
+		// uma linha de cache para que produtor e consumidor não
+		// disputem a mesma linha
+		std::atomic<uint64_t> head;		// escrito pelo produtor
+		uint64_t cachedTail;			// cópia de tail do produtor
+		char padding[64];
+		std::atomic<uint64_t> tail;		// escrito pelo consumidor
+		std::atomic<bool> stopping;
+
+		std::thread writer;
+
+		/**
+		 * Espera até que o buffer comporte head, em palavras.
+		 */
+		void waitSpace(uint64_t head);
+
+		/**
+		 * Laço da thread de escrita.
+		 */
+		void writerLoop();
+
+		void writeAll(const void *bytes, uint64_t size);
+
+		// registros abertos, finalizados em exit()
+		static std::set<MemoryTrace *> openTraces;
+		static std::mutex openTracesMutex;
+		static void finishAll();
+};
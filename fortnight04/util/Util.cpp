@@ -35,25 +35,32 @@
 
 #include "Util.h"
 
+#include <cstring>
+
 uint64_t Util::floatAsUint64Low(float value)
 {
-	return (uint64_t)(*((uint32_t *)(&value)));
+	uint32_t low_uint;
+	memcpy(&low_uint, &value, sizeof(low_uint));
+	return (uint64_t)low_uint;
 }
 
 float Util::uint64LowAsFloat(uint64_t value)
 {
 	uint32_t low_uint = 0x00000000FFFFFFFF & value;
-	float *low_fp = (float *)(&low_uint);
-	return (*low_fp);
+	float low_fp;
+	memcpy(&low_fp, &low_uint, sizeof(low_fp));
+	return low_fp;
 }
 
 uint64_t Util::doubleAsUint64(double value)
 {
-	uint64_t *ui_point = (uint64_t *)(&value);
-	return *ui_point;
+	uint64_t ui;
+	memcpy(&ui, &value, sizeof(ui));
+	return ui;
 }
 
 double Util::uint64AsDouble(uint64_t value) {
-	double *fp = (double *)(&value);
-	return *fp;
+	double fp;
+	memcpy(&fp, &value, sizeof(fp));
+	return fp;
 }